@@ -1,27 +1,5 @@
 #include "flexpoch.h"
-
-#define CP_FLOAT_SIGN 0x0000000080000000
-#define CP_UNDEFINED_FP -0x8000000000000000
-#define NS_PER_SEC 1000000000
-
-#define FP_YEAR_MAX 19254
-#define FP_YEAR_MIN -2250
-
-#define TZ_BIN_OFFSET 1024    // binary offset
-#define TZ_LEAPSEC 1023    // special offset value for leapsecond
-
-// Constants
-// ============================================================================
-
-// codepoint (CP) bytes
-const int8_t CP_ABS_YEAR_POS = 0x7F;  // codepoint absolute years
-const int8_t CP_ABS_YEAR_NEG = -0x20; // codepoint absolute years: -0x20 or 0xE0
-const int8_t CP_REL_SEC = 0b1101;   // 4-bit codepoint relative time 0xD0
-const int8_t CP_REL_FRAC = 0b1100;   // 4-bit codepoint relative high-res fraction 0xC0
-const int8_t CP_CUSTOM   = 0b1011;   // 4-bit codepoint for custom code 0xB0
-const int8_t CP_LOGICAL  = 0b1010;   // 4-bit codepoint for logical clocks 0xA0
-const int8_t CP_RESERVED = 0b100;    // 3-bit codepoint for reserved (0x8 or 0x9)
-
+#include "fp_internal.h"
 
 // Functions
 // ============================================================================
@@ -46,15 +24,40 @@ FP_Components FP_new(){
 
 
 
+// Constant divisions as multiply-high with a rounded up reciprocal, exact for
+// every 64 bit dividend (Granlund/Montgomery, see Hacker's Delight ch. 10).
+// Targets without a 64x64->128 bit multiply get four 32 bit products instead
+// of a division call.
+static inline uint64_t mulhi64(uint64_t a, uint64_t b){
+#ifdef __SIZEOF_INT128__
+    return (uint64_t)(((unsigned __int128)a * b) >> 64);
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t mid = (a_lo * b_lo >> 32) + (uint32_t)(a_hi * b_lo) + a_lo * b_hi;
+    return a_hi * b_hi + (a_hi * b_lo >> 32) + (mid >> 32);
+#endif
+}
+
+// x / 119209289551 (1e18 / 2^23 rounded up): ceil(2^101 / D) needs 65 bits, the
+// implicit 2^64 is added back with the overflow free average (t + x) / 2
+static inline uint64_t div_frac_unit(uint64_t x){
+    uint64_t t = mulhi64(x, 0x2725DD1D21E73B8F);
+    return (t + ((x - t) >> 1)) >> 36;
+}
+
+// x / 1e9 = (x / 2^9) / 1953125, ceil(2^75 / 1953125) fits 64 bits
+static inline uint64_t div_1e9(uint64_t x){
+    return mulhi64(x >> 9, 0x44B82FA09B5A53) >> 11;
+}
+
 uint32_t ns2frac(uint32_t nanoseconds) {
-    uint64_t temp = (uint64_t)((uint64_t)(nanoseconds) * 1000000000 + 59604644775) / 119209289551;
-    return (uint32_t) temp;
+    return (uint32_t)div_frac_unit((uint64_t)nanoseconds * 1000000000 + 59604644775);
 }
 
 // convert fraction to ns. This only works for small fraction (e.g. 20bit)
 uint32_t frac2ns(uint64_t binary) {
-    uint64_t temp = (uint64_t)((binary>>1) * 119209289551 + 500000000) / 1000000000;  // 2^64 ~ 10^19. add 0.5e9 for correct rounding
-    return (uint32_t)(temp);
+    return (uint32_t)div_1e9((binary>>1) * 119209289551 + 500000000);  // 2^64 ~ 10^19. add 0.5e9 for correct rounding
 }
 
 int16_t FP_tz_offset_to_bin(int16_t tz_offset){
@@ -158,96 +161,169 @@ void FP_from_tm(struct tm *tm, FP_Components *out){
     out->precision = PRC_SECOND;
 };
 
-ErrNo FP_from_iso(char *isostr, FP_Components *out){
-    struct tm tm = {0};
-    tm.tm_mday = 1;  // important! Otherwise strptime can fail
-
-    const char *formats[] = {
-        "%Y-%m-%dT%H:%M:%S.%f%z",
-        "%Y-%m-%dT%H:%M:%S.%fZ",
-        "%Y-%m-%dT%H:%M:%S.%f",
-        "%Y-%m-%dT%H:%M:%S%z",
-        "%Y-%m-%dT%H:%M:%SZ",
-        "%Y-%m-%dT%H:%M:%S",
-        "%Y-%m-%dT%H:%M",
-        "%Y-%m-%dT%H",
-        "%Y-%m-%d",
-        "%Y-W%W",
-        "%Y-%m",
-        "%Y",
-    };
-
-    
-    size_t num_formats = 12;
-    bool is_match = false;
-    
-    for (size_t i = 0; i < num_formats; i++) {
-        tm.tm_mday = 1; 
-        if (strptime(isostr, formats[i], &tm) != NULL) {
-            tm.tm_isdst = 0; // ensure that tm is interpreted as UTC!
-            if (strlen(isostr) >= 19 && (strncmp(&isostr[17], "60", 2) == 0)){
-                out->is_leapsecond = true;
-                tm.tm_sec = 59;
-            }
-            FP_from_tm(&tm, out);
-            is_match = true;
-            if(i == 11){ 
-                out->precision = PRC_YEAR;
-            } else if (i == 3 || i == 4) {
-                out->precision = PRC_SECOND;
-
-            } else {
-                out->precision = i - 5;
-            }
-            break;
-        }
-    }
+// ISO 8601 parser
+// ----------------------------------------------------------------------------
 
-    if (!is_match){
-        return ERR_INVALID_ISO;
-    }
+static inline bool iso_is_space(char c){
+    return c == ' ' || ('\t' <= c && c <= '\r');
+}
 
-    // Parse timezone offset if present
-    char *tz_sign = strrchr(isostr, '+');
-    if (!tz_sign && strlen(isostr) > 16) {
-        tz_sign = strrchr(isostr + 16, '-');
-    }
+static inline bool iso_is_digit(char c){
+    return '0' <= c && c <= '9';
+}
 
-    // Find the position of the subsecond part
-    const char *dot = strchr(isostr, '.');
-    int numsubsdigits = 0;
-    if (dot) {
-        while (*(dot+1+numsubsdigits) && isdigit(*(dot+1+numsubsdigits))){
-            numsubsdigits++;
+// Read a number like strptime(): skip blanks, read up to max_digits while the value
+// can still grow within [from, to]. Returns false if no digit or out of range.
+static bool iso_number(const char *str, size_t len, size_t *pos, int from, int to, int max_digits, int *val){
+    size_t p = *pos;
+    while (p < len && iso_is_space(str[p])){ p++; }
+    if (p >= len || !iso_is_digit(str[p])){ return false; }
+    int v = 0;
+    do {
+        v = v * 10 + (str[p++] - '0');
+    } while (--max_digits > 0 && v * 10 <= to && p < len && iso_is_digit(str[p]));
+    if (v < from || v > to){ return false; }
+    *pos = p;
+    *val = v;
+    return true;
+}
+
+// match a literal separator followed by a number
+static bool iso_field(const char *str, size_t len, size_t *pos, char sep, int from, int to, int *val){
+    size_t p = *pos;
+    if (p >= len || str[p] != sep){ return false; }
+    p++;
+    if (!iso_number(str, len, &p, from, to, 2, val)){ return false; }
+    *pos = p;
+    return true;
+}
+
+// Read an int like sscanf("%d"): blanks, optional sign, digits. Returns 0 if no digits.
+static int iso_int(const char *str, size_t len, size_t *pos, bool *ok){
+    size_t p = *pos;
+    int sign = 1;
+    int64_t v = 0;
+    while (p < len && iso_is_space(str[p])){ p++; }
+    if (p < len && (str[p] == '+' || str[p] == '-')){
+        sign = (str[p] == '-') ? -1 : 1;
+        p++;
+    }
+    *ok = (p < len && iso_is_digit(str[p]));
+    if (!*ok){ return 0; }
+    while (p < len && iso_is_digit(str[p])){
+        if (v < INT32_MAX){ v = v * 10 + (str[p] - '0'); }
+        p++;
+    }
+    *pos = p;
+    return (int)(sign * (v < INT32_MAX ? v : INT32_MAX));
+}
+
+// Single pass ISO 8601 parser for the layouts (strptime() notation)
+//   %Y-%m-%dT%H:%M:%S(%z|Z), %Y-%m-%dT%H:%M, %Y-%m-%dT%H, %Y-%m-%d, %Y-W%W, %Y-%m, %Y
+// The longest matching layout gives the precision, the first '.' the subseconds and
+// the last '+' (or '-' after index 16) the tz offset.
+int FP_parse_iso(const char *str, size_t len, FP_Components *out){
+    int year = 0, month = 1, day = 1, hour = 0, minute = 0, second = 0, week = 0;
+    Precision prc = PRC_YEAR;
+    size_t pos = 0;
+
+    // markers for subseconds and timezone
+    size_t dot = len, tz_sign = len, tz_minus = len;
+    for (size_t i = 0; i < len; i++){
+        char c = str[i];
+        if (c == '.' && dot == len){ dot = i; }
+        if (c == '+'){ tz_sign = i; }
+        if (c == '-' && i >= 16){ tz_minus = i; }
+    }
+    if (tz_sign == len && len > 16){ tz_sign = tz_minus; }
+
+    if (!iso_number(str, len, &pos, 0, 9999, 4, &year)){
+        return ERR_INVALID_ISO;
+    }
+    if (iso_field(str, len, &pos, '-', 1, 12, &month)){
+        prc = PRC_MONTH;
+        if (iso_field(str, len, &pos, '-', 1, 31, &day)){
+            prc = PRC_DAY;
+            if (iso_field(str, len, &pos, 'T', 0, 23, &hour)){
+                prc = PRC_HOUR;
+                if (iso_field(str, len, &pos, ':', 0, 59, &minute)){
+                    prc = PRC_MINUTE;
+                    if (iso_field(str, len, &pos, ':', 0, 61, &second)){
+                        prc = PRC_SECOND;
+                    }
+                }
+            }
         }
-        char subseconds[10];
-        strncpy(subseconds, dot + 1, numsubsdigits);
-        subseconds[numsubsdigits] = '\0'; // Null-terminate the string
-        if(numsubsdigits == 0){ 
-            out->precision = PRC_SECOND; 
-        } else if(numsubsdigits <= 3){ 
-            out->precision = PRC_MILLISEC; 
-            out->ns = atoi(subseconds) * 1000000; 
-        } else if(numsubsdigits <= 6){ 
-            out->precision = PRC_MICROSEC; 
-            out->ns = atoi(subseconds) * 1000; 
-        } else if(numsubsdigits <= 9){ 
-            out->precision = PRC_NANOSEC; 
-            out->ns = atoi(subseconds); 
+    } else if (pos + 1 < len && str[pos] == '-' && str[pos+1] == 'W'){
+        size_t p = pos + 2;
+        if (iso_number(str, len, &p, 0, 53, 2, &week)){  // week number does not move the date
+            prc = PRC_WEEK;
+            pos = p;
         }
     }
-
-
-    if (tz_sign) {
-        int tz_hour = 0, tz_min = 0;
-        sscanf(tz_sign, "%c%d:%d", tz_sign, &tz_hour, &tz_min);
-        int offset = (tz_hour * 60 + tz_min) * (*tz_sign == '+' ? 1 : -1);
+    size_t consumed = pos;
+
+    if (len >= 19 && str[17] == '6' && str[18] == '0'){
+        out->is_leapsecond = true;
+        second = 59;
+    }
+    int64_t days = FP_days_from_civil(year, month, 1) + day - 1;
+    out->seconds = days * 86400 + hour * 3600 + minute * 60 + second;
+    out->ns = 0;   // FP_new() leaves -1, FP_to_java() would add it
+    out->is_dst = false;
+    out->precision = prc;
+
+    // subseconds
+    if (dot < len){
+        size_t p = dot + 1;
+        uint32_t value = 0;
+        while (p < len && iso_is_digit(str[p])){
+            value = value * 10 + (str[p] - '0');
+            p++;
+        }
+        size_t numsubsdigits = p - (dot + 1);
+        if (numsubsdigits == 0){
+            out->precision = PRC_SECOND;
+        } else if (numsubsdigits <= 3){
+            out->precision = PRC_MILLISEC;
+            out->ns = value * 1000000;
+        } else if (numsubsdigits <= 6){
+            out->precision = PRC_MICROSEC;
+            out->ns = value * 1000;
+        } else if (numsubsdigits <= 9){
+            out->precision = PRC_NANOSEC;
+            out->ns = value;
+        }
+        if (p > consumed){ consumed = p; }
+    }
+
+    // timezone offset "+hh:mm" (missing parts count as 0)
+    if (tz_sign < len){
+        size_t p = tz_sign + 1;
+        bool ok;
+        int tz_hour = iso_int(str, len, &p, &ok);
+        int tz_min = 0;
+        if (ok && p < len && str[p] == ':'){
+            size_t q = p + 1;
+            tz_min = iso_int(str, len, &q, &ok);
+            if (ok){ p = q; }
+        }
+        int offset = (tz_hour * 60 + tz_min) * (str[tz_sign] == '+' ? 1 : -1);
         out->tz_offset = offset;
         out->seconds -= offset*60;
+        if (p > consumed){ consumed = p; }
+    } else if (consumed < len && str[consumed] == 'Z'){  // UTC designator
+        consumed++;
     }
 
-    return SUCCESS; 
-};
+    return consumed;
+}
+
+ErrNo FP_from_iso(char *isostr, FP_Components *out){
+    int result = FP_parse_iso(isostr, strlen(isostr), out);
+    return (result < 0) ? result : SUCCESS;
+}
+
 
 
 ErrNo FP_from_unix(int64_t unixtime, FP_Components *out){
@@ -354,98 +430,468 @@ ErrNo FP_to_logic(FP_Components *fpc, int64_t* out){
 
 
 // Convert FP_Components to ISO date time format string
-ErrNo FP_to_iso(FP_Components *fpc, char *out) {
+// two digit lookup for the ISO formatter
+static const char iso_digits2[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static inline void iso_put2(char *out, unsigned value){
+    out[0] = iso_digits2[2 * value];
+    out[1] = iso_digits2[2 * value + 1];
+}
+
+// unsigned decimal zero padded to width, like printf "%0*lu"
+static size_t iso_put_uint(char *out, uint64_t value, int width){
+    char tmp[24];
+    char *p = tmp + sizeof(tmp);
+    while (value >= 100){
+        p -= 2;
+        iso_put2(p, value % 100);
+        value /= 100;
+    }
+    if (value >= 10){
+        p -= 2;
+        iso_put2(p, value);
+    } else {
+        *--p = '0' + value;
+    }
+    while (tmp + sizeof(tmp) - p < width){ *--p = '0'; }
+    size_t len = tmp + sizeof(tmp) - p;
+    memcpy(out, p, len);
+    return len;
+}
+
+// signed decimal like printf "%0*d", the sign counts into the width
+static size_t iso_put_int(char *out, int64_t value, int width){
+    if (value < 0){
+        out[0] = '-';
+        return 1 + iso_put_uint(out + 1, -(uint64_t)value, width - 1);
+    }
+    return iso_put_uint(out, value, width);
+}
+
+static size_t iso_put_str(char *out, const char *str){
+    size_t len = strlen(str);
+    memcpy(out, str, len);
+    return len;
+}
+
+// float year like printf "%.1f", exact for every float
+static size_t iso_put_year(char *out, float year){
+    size_t idx = 0;
+    if (signbit(year)){
+        out[idx++] = '-';
+        year = -year;
+    }
+    if (isnan(year)){ return idx + iso_put_str(out + idx, "nan"); }
+    if (isinf(year)){ return idx + iso_put_str(out + idx, "inf"); }
+    if (year < 16777216.0f){
+        // 24 bit mantissa * 10 is exact in double, the 2^52 trick rounds ties to even like printf
+        uint64_t tenths = (uint64_t)(((double)year * 10.0 + 4503599627370496.0) - 4503599627370496.0);
+        idx += iso_put_uint(out + idx, tenths / 10, 1);
+        out[idx++] = '.';
+        out[idx++] = '0' + tenths % 10;
+        return idx;
+    }
+    char tmp[40];   // integral, up to 39 digits
+    size_t len = 0;
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 value = (unsigned __int128)year;
+    do {
+        tmp[sizeof(tmp) - ++len] = '0' + (int)(value % 10);
+        value /= 10;
+    } while (value);
+#else
+    // mantissa << exponent in four 32 bit limbs (lowest first), divided by 10 from the top
+    uint32_t bits, limb[4] = {0};
+    memcpy(&bits, &year, sizeof(bits));
+    uint64_t mant = (bits & 0x7FFFFF) | 0x800000;
+    int exp = (int)((bits >> 23) & 0xFF) - 150;   // 1 .. 104 from 2^24 on
+    limb[exp / 32] = (uint32_t)(mant << exp % 32);
+    if (exp / 32 < 3){ limb[exp / 32 + 1] = (uint32_t)(mant << exp % 32 >> 32); }
+    bool more;
+    do {
+        uint64_t rem = 0;
+        more = false;
+        for (int k = 3; k >= 0; k--){
+            uint64_t cur = rem << 32 | limb[k];
+            limb[k] = (uint32_t)(cur / 10);
+            rem = cur % 10;
+            more |= limb[k] != 0;
+        }
+        tmp[sizeof(tmp) - ++len] = '0' + (int)rem;
+    } while (more);
+#endif
+    memcpy(out + idx, tmp + sizeof(tmp) - len, len);
+    idx += len;
+    return idx + iso_put_str(out + idx, ".0");
+}
+
+// subseconds of the time of day, nothing for second and coarser precisions
+static inline size_t iso_put_frac(char *out, Precision prc, uint32_t ns){
+    if (prc == PRC_MILLISEC){
+        out[0] = '.';
+        return 1 + iso_put_uint(out + 1, (uint32_t)(ns + 500000) / 1000000, 3);
+    }
+    if (prc == PRC_MICROSEC || prc == PRC_15BIT){
+        out[0] = '.';
+        return 1 + iso_put_uint(out + 1, (uint32_t)(ns + 500) / 1000, 6);
+    }
+    if (prc == PRC_NANOSEC || prc == PRC_23BIT){
+        out[0] = '.';
+        return 1 + iso_put_uint(out + 1, ns, 9);
+    }
+    return 0;
+}
+
+// tz offset or "Z" and the DST marker
+static size_t iso_put_suffix(char *out, const FP_Components *fpc){
+    size_t idx = 0;
+    if (fpc->tz_offset != 0) {
+        uint64_t offset = fpc->tz_offset < 0 ? -(int64_t)fpc->tz_offset : fpc->tz_offset;
+        out[idx++] = fpc->tz_offset < 0 ? '-' : '+';
+        idx += iso_put_uint(out + idx, offset / 60, 2);
+        out[idx++] = ':';
+        iso_put2(out + idx, offset % 60);
+        idx += 2;
+    }
+    if (fpc->tz_offset == 0 && fpc->precision <= PRC_HOUR){
+        out[idx++] = 'Z';
+    }
+    if (fpc->is_dst) {
+        idx += iso_put_str(out + idx, " DST");
+    }
+    return idx;
+}
+
+// FP_format_iso() without the NUL, out has room for FP_ISO_MAX_LEN bytes
+static int iso_format(const FP_Components *fpc, char *out){
     if (fpc->year != 0){
-        sprintf(out, "%.1f", fpc->year);
-        return SUCCESS;
+        return iso_put_year(out, fpc->year);
     }
-    time_t rawtime = fpc->seconds + fpc->tz_offset*60;
-    int idx = 0;
+    size_t idx = 0;
     if (fpc->fmt == FMT_REL_SEC){
         if(fpc->precision <= PRC_SECOND){
-            idx = sprintf(out+idx, "PT%lu", fpc->seconds);
+            idx += iso_put_str(out + idx, "PT");
+            idx += iso_put_uint(out + idx, fpc->seconds, 1);
             uint32_t decimals = FP_ns_to_precision(fpc->ns, fpc->precision);
             switch(fpc->precision){
                 case PRC_NANOSEC: ;;
-                case PRC_23BIT: sprintf(out+idx, ".%09uS", decimals); break;
+                case PRC_23BIT: out[idx++] = '.'; idx += iso_put_uint(out + idx, decimals, 9); break;
                 case PRC_MICROSEC: ;;
-                case PRC_15BIT: sprintf(out+idx, ".%06uS", decimals); break;
-                case PRC_MILLISEC: sprintf(out+idx, ".%03uS", decimals); break;
-                case PRC_SECOND: sprintf(out+idx, "S"); break;
+                case PRC_15BIT: out[idx++] = '.'; idx += iso_put_uint(out + idx, decimals, 6); break;
+                case PRC_MILLISEC: out[idx++] = '.'; idx += iso_put_uint(out + idx, decimals, 3); break;
+                case PRC_SECOND: break;
                 default: return ERR_INVALID_PRECISION;
             }
+            out[idx++] = 'S';
         } else {
-            uint64_t value = FP_ns_to_precision(fpc->seconds*NS_PER_SEC, fpc->precision);
-            char unit[3];
+            uint64_t value = FP_ns_to_precision((uint64_t)fpc->seconds * NS_PER_SEC, fpc->precision);
+            char unit[4];
             FP_precision_name(fpc->precision, unit);
-            if(fpc->precision <= PRC_HOUR){
-                sprintf(out+idx, "PT%lu%s", value, unit);
-            } else {
-                sprintf(out+idx, "P%lu%s", value, unit);
-            }
+            idx += iso_put_str(out + idx, fpc->precision <= PRC_HOUR ? "PT" : "P");
+            idx += iso_put_uint(out + idx, value, 1);
+            idx += iso_put_str(out + idx, unit);
         }
-        return SUCCESS;
-    }
-    struct tm *tm = gmtime(&rawtime); 
-    if (fpc->is_leapsecond && tm->tm_hour == 23 && tm->tm_min == 59 && tm->tm_sec == 59){
-        tm->tm_sec += 1;
-    }
-    if (fpc->precision == PRC_MILLENNIUM){  
-        idx += sprintf(out+idx, "%01dxxx", (tm->tm_year + 1900)/1000);
-    }
-    if (fpc->precision == PRC_CENTURY){  
-        idx += sprintf(out+idx, "%02dxx", (tm->tm_year + 1900)/100);
-    }
-    if (fpc->precision == PRC_DECADE){  
-        idx += sprintf(out+idx, "%03dx", (tm->tm_year + 1900)/10);
-    }
-    if (fpc->precision <= PRC_YEAR){  
-        idx += sprintf(out+idx, "%04d", tm->tm_year + 1900);
-    }
-    if (fpc->precision == PRC_QUATER){ 
-        idx += sprintf(out+idx, "-Q%d", (tm->tm_mon+1) / 4 + 1);
-    }
-    if (fpc->precision <= PRC_MONTH && !(fpc->precision == PRC_WEEK)){ 
-        idx += sprintf(out+idx, "-%02d", tm->tm_mon + 1);
+        return idx;
+    }
+
+    int64_t rawtime = fpc->seconds + fpc->tz_offset*60;
+    int64_t days = rawtime / 86400 - (rawtime % 86400 < 0);
+    int64_t sod = rawtime - days * 86400;
+    int64_t year;
+    int month, day;
+    FP_civil_from_days(days, &year, &month, &day);
+    int hour = sod / 3600, minute = sod / 60 % 60, second = sod % 60;
+    if (fpc->is_leapsecond && sod == 86399){
+        second = 60;
+    }
+
+    if (fpc->precision == PRC_MILLENNIUM){
+        idx += iso_put_int(out + idx, year / 1000, 1);
+        idx += iso_put_str(out + idx, "xxx");
+    }
+    if (fpc->precision == PRC_CENTURY){
+        idx += iso_put_int(out + idx, year / 100, 2);
+        idx += iso_put_str(out + idx, "xx");
+    }
+    if (fpc->precision == PRC_DECADE){
+        idx += iso_put_int(out + idx, year / 10, 3);
+        out[idx++] = 'x';
+    }
+    if (fpc->precision <= PRC_YEAR){
+        idx += iso_put_int(out + idx, year, 4);
+    }
+    if (fpc->precision == PRC_QUATER){
+        idx += iso_put_str(out + idx, "-Q");
+        out[idx++] = '0' + month / 4 + 1;
+    }
+    if (fpc->precision <= PRC_MONTH && !(fpc->precision == PRC_WEEK)){
+        out[idx++] = '-';
+        iso_put2(out + idx, month);
+        idx += 2;
+    }
+    if (fpc->precision == PRC_WEEK){   // strftime "%W": weeks start on monday
+        int yday = days - FP_days_from_civil(year, 1, 1);
+        int wday = (days % 7 + 11) % 7;   // 1970-01-01 was a thursday
+        idx += iso_put_str(out + idx, "-W");
+        iso_put2(out + idx, (yday + 7 - (wday + 6) % 7) / 7);
+        idx += 2;
+    }
+    if (fpc->precision <= PRC_DAY){
+        out[idx++] = '-';
+        iso_put2(out + idx, day);
+        idx += 2;
+    }
+    if (fpc->precision <= PRC_HOUR){
+        out[idx++] = 'T';
+        iso_put2(out + idx, hour);
+        idx += 2;
+    }
+    if (fpc->precision <= PRC_MINUTE){
+        out[idx++] = ':';
+        iso_put2(out + idx, minute);
+        idx += 2;
+    }
+    if (fpc->precision <= PRC_SECOND){
+        out[idx++] = ':';
+        iso_put2(out + idx, second);
+        idx += 2;
+    }
+    idx += iso_put_frac(out + idx, fpc->precision, fpc->ns);
+    idx += iso_put_suffix(out + idx, fpc);
+    return idx;
+}
+
+int FP_format_iso(const FP_Components *fpc, char *out, size_t size){
+    char tmp[FP_ISO_MAX_LEN];
+    char *dst = (size >= FP_ISO_MAX_LEN) ? out : tmp;
+    int len = iso_format(fpc, dst);
+    if (len < 0){
+        return len;
     }
-    if (fpc->precision == PRC_WEEK){ 
-        idx += strftime(out+idx, 5, "-W%W", tm);
+    if ((size_t)len >= size){
+        return ERR_OUT_OF_RANGE;
     }
-    if (fpc->precision <= PRC_DAY){  
-        idx += sprintf(out+idx, "-%02d", tm->tm_mday);
+    if (dst != out){
+        memcpy(out, tmp, len);
     }
-    if (fpc->precision <= PRC_HOUR){  
-        idx += sprintf(out+idx, "T%02d", tm->tm_hour);
+    out[len] = '\0';
+    return len;
+}
+
+ErrNo FP_to_iso(FP_Components *fpc, char *out) {
+    int len = FP_format_iso(fpc, out, FP_ISO_MAX_LEN);
+    return (len < 0) ? len : SUCCESS;
+}
+
+void FP_iso_cache_init(FP_IsoCache *cache){
+    memset(cache, 0, sizeof(*cache));
+    cache->day_start = INT64_MIN;
+    cache->precision = PRC_UNKNOWN;
+}
+
+int FP_format_iso_cached(FP_IsoCache *cache, const FP_Components *fpc, char *out, size_t size){
+    Precision prc = fpc->precision;
+    bool cachable = (prc == PRC_NANOSEC || prc == PRC_23BIT || prc == PRC_MICROSEC || prc == PRC_15BIT ||
+                     prc == PRC_MILLISEC || prc == PRC_SECOND || prc == PRC_MINUTE || prc == PRC_HOUR);
+    if (!cachable || fpc->year != 0 || fpc->fmt == FMT_REL_SEC || fpc->is_leapsecond){
+        return FP_format_iso(fpc, out, size);
+    }
+
+    if (cache->precision != prc || cache->tz_offset != fpc->tz_offset || cache->is_dst != fpc->is_dst){
+        cache->precision = prc;
+        cache->tz_offset = fpc->tz_offset;
+        cache->is_dst = fpc->is_dst;
+        cache->suffix_len = iso_put_suffix(cache->suffix, fpc);
+        cache->day_start = INT64_MIN;
+    }
+
+    int64_t rawtime = fpc->seconds + fpc->tz_offset*60;
+    if (rawtime != cache->second || cache->day_start == INT64_MIN){
+        if ((uint64_t)rawtime - (uint64_t)cache->day_start >= 86400){   // new day
+            int64_t days = rawtime / 86400 - (rawtime % 86400 < 0);
+            int64_t year;
+            int month, day;
+            FP_civil_from_days(days, &year, &month, &day);
+            size_t idx = iso_put_int(cache->prefix, year, 4);
+            cache->prefix[idx++] = '-';
+            iso_put2(cache->prefix + idx, month);
+            cache->prefix[idx + 2] = '-';
+            iso_put2(cache->prefix + idx + 3, day);
+            cache->prefix[idx + 5] = 'T';
+            cache->time_pos = idx + 5;
+            cache->prefix[idx + 8] = ':';
+            cache->prefix[idx + 11] = ':';
+            cache->prefix_len = cache->time_pos + 3 + 3 * (prc <= PRC_MINUTE) + 3 * (prc <= PRC_SECOND);
+            cache->day_start = days * 86400;
+        }
+        int sod = rawtime - cache->day_start;
+        char *time = cache->prefix + cache->time_pos;
+        iso_put2(time + 1, sod / 3600);
+        iso_put2(time + 4, sod / 60 % 60);
+        iso_put2(time + 7, sod % 60);
+        cache->second = rawtime;
+    }
+
+    char tmp[FP_ISO_MAX_LEN];
+    char *dst = (size >= FP_ISO_MAX_LEN) ? out : tmp;
+    size_t len = cache->prefix_len;
+    memcpy(dst, cache->prefix, sizeof(cache->prefix));
+    len += iso_put_frac(dst + len, prc, fpc->ns);
+    memcpy(dst + len, cache->suffix, sizeof(cache->suffix));
+    len += cache->suffix_len;
+    if (len >= size){
+        return ERR_OUT_OF_RANGE;
     }
-    if (fpc->precision <= PRC_MINUTE){  
-        idx += sprintf(out+idx, ":%02d", tm->tm_min);
+    if (dst != out){
+        memcpy(out, tmp, len);
     }
-    if (fpc->precision <= PRC_SECOND){  
-        idx += sprintf(out+idx, ":%02d", tm->tm_sec);
+    out[len] = '\0';
+    return len;
+}
+
+
+ErrNo FP_to_http(FP_Components *fpc, char *out){
+    int len = FP_format_rfc(fpc, RFC_7231, out, FP_ISO_MAX_LEN);
+    return (len < 0) ? len : SUCCESS;
+}
+
+ErrNo FP_to_rfc2822(FP_Components *fpc, char *out){
+    int len = FP_format_rfc(fpc, RFC_2822, out, FP_ISO_MAX_LEN);
+    return (len < 0) ? len : SUCCESS;
+}
+
+ErrNo FP_to_rfc3339(FP_Components *fpc, char *out){
+    int len = FP_format_rfc(fpc, RFC_3339, out, FP_ISO_MAX_LEN);
+    return (len < 0) ? len : SUCCESS;
+}
+
+static const char rfc_wday[7][4] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+static const char rfc_month[12][4] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                      "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+// render the second of fpc into the memo
+static ErrNo rfc_render(FP_RfcCache *cache, const FP_Components *fpc, FP_RfcStyle style){
+    int32_t tz = (style == RFC_7231) ? 0 : fpc->tz_offset;   // HTTP dates are always GMT
+    if (tz <= -24*60 || 24*60 <= tz){
+        return ERR_INVALID_OFFSET;
     }
-    if (fpc->precision == PRC_MILLISEC){ 
-        idx += sprintf(out+idx, ".%03u", (fpc->ns + 500000) / 1000000);
+    int64_t rawtime = fpc->seconds + tz*60;
+    int64_t days = rawtime / 86400 - (rawtime % 86400 < 0);
+    int sod = rawtime - days * 86400;
+    int64_t year;
+    int month, day;
+    FP_civil_from_days(days, &year, &month, &day);
+    if (year < 0 || 9999 < year){
+        return ERR_OUT_OF_RANGE;
     }
-    if (fpc->precision == PRC_MICROSEC || fpc->precision == PRC_15BIT ){ 
-        idx += sprintf(out+idx, ".%06u", (fpc->ns + 500) / 1000);
+    int second = (fpc->is_leapsecond && sod == 86399) ? 60 : sod % 60;
+
+    char *p = cache->head;
+    if (style == RFC_3339){
+        iso_put2(p, year / 100);
+        iso_put2(p + 2, year % 100);
+        p[4] = '-';
+        iso_put2(p + 5, month);
+        p[7] = '-';
+        iso_put2(p + 8, day);
+        p[10] = 'T';
+        p += 11;
+    } else {
+        memcpy(p, rfc_wday[(days % 7 + 11) % 7], 3);   // 1970-01-01 was a thursday
+        p[3] = ',';
+        p[4] = ' ';
+        iso_put2(p + 5, day);
+        p[7] = ' ';
+        memcpy(p + 8, rfc_month[month - 1], 3);
+        p[11] = ' ';
+        iso_put2(p + 12, year / 100);
+        iso_put2(p + 14, year % 100);
+        p[16] = ' ';
+        p += 17;
+    }
+    iso_put2(p, sod / 3600);
+    p[2] = ':';
+    iso_put2(p + 3, sod / 60 % 60);
+    p[5] = ':';
+    iso_put2(p + 6, second);
+    p += 8;
+
+    char *t = cache->tail;
+    int32_t offset = tz < 0 ? -tz : tz;
+    if (style == RFC_7231){
+        memcpy(p, " GMT", 4);
+        p += 4;
+    } else if (style == RFC_2822){
+        p[0] = ' ';
+        p[1] = tz < 0 ? '-' : '+';
+        iso_put2(p + 2, offset / 60);
+        iso_put2(p + 4, offset % 60);
+        p += 6;
+    } else if (tz == 0){
+        *t++ = 'Z';
+    } else {
+        t[0] = tz < 0 ? '-' : '+';
+        iso_put2(t + 1, offset / 60);
+        t[3] = ':';
+        iso_put2(t + 4, offset % 60);
+        t += 6;
+    }
+    cache->head_len = p - cache->head;
+    cache->tail_len = t - cache->tail;
+    cache->seconds = fpc->seconds;
+    cache->tz_offset = fpc->tz_offset;
+    cache->is_leapsecond = fpc->is_leapsecond;
+    cache->style = style;
+    return SUCCESS;
+}
+
+void FP_rfc_cache_init(FP_RfcCache *cache){
+    memset(cache, 0, sizeof(*cache));
+    cache->style = -1;
+}
+
+int FP_format_rfc_cached(FP_RfcCache *cache, const FP_Components *fpc, FP_RfcStyle style,
+                         char *out, size_t size){
+    if (fpc->year != 0 || fpc->fmt == FMT_REL_SEC || fpc->fmt == FMT_LOGICAL){
+        return ERR_INCOMPATIBLE_OUTPUT;
     }
-    if (fpc->precision == PRC_NANOSEC || fpc->precision == PRC_23BIT){ 
-        idx += sprintf(out+idx, ".%09u", fpc->ns);
+    if (cache->style != style || cache->seconds != fpc->seconds || cache->tz_offset != fpc->tz_offset ||
+        cache->is_leapsecond != fpc->is_leapsecond){
+        ErrNo err = rfc_render(cache, fpc, style);
+        if (err != SUCCESS){
+            cache->style = -1;
+            return err;
+        }
     }
-    if (fpc->tz_offset != 0) {
-        int hours = abs(fpc->tz_offset) / 60;
-        int minutes = (abs(fpc->tz_offset) % 60);
-        idx += sprintf(out+idx, "%c%02d:%02d", fpc->tz_offset < 0 ? '-' : '+', hours, minutes);
+    char tmp[FP_ISO_MAX_LEN];
+    char *dst = (size >= FP_ISO_MAX_LEN) ? out : tmp;
+    size_t len = cache->head_len;
+    memcpy(dst, cache->head, sizeof(cache->head));
+    if (style == RFC_3339){
+        len += iso_put_frac(dst + len, fpc->precision, fpc->ns);
+        memcpy(dst + len, cache->tail, sizeof(cache->tail));
+        len += cache->tail_len;
     }
-    if (fpc->tz_offset == 0 && fpc->precision <= PRC_HOUR){
-        idx += sprintf(out+idx, "Z");
+    if (len >= size){
+        return ERR_OUT_OF_RANGE;
     }
-    if (fpc->is_dst) {
-        idx += sprintf(out+idx, " DST");
+    if (dst != out){
+        memcpy(out, tmp, len);
     }
-    return SUCCESS;
+    out[len] = '\0';
+    return len;
 }
 
+int FP_format_rfc(const FP_Components *fpc, FP_RfcStyle style, char *out, size_t size){
+    FP_RfcCache cache;
+    FP_rfc_cache_init(&cache);
+    return FP_format_rfc_cached(&cache, fpc, style, out, size);
+}
 
 
 // Function to write the individual Flexpoch components to stdout
@@ -503,22 +949,22 @@ bool FP_is_sec(FP_NumType flexpoch){
 }
 
 
+// chained divisions merged into one per unit, floor(floor(a/b)/c) = floor(a/(b*c))
 uint64_t FP_ns_to_precision(uint64_t ns, Precision prc){
-    uint64_t frac = ((uint64_t)(ns) * 1000000000 + 59604644775) / 119209289551;
     switch (prc) {
         case PRC_NANOSEC:  return ns;
         case PRC_MICROSEC: return ns / 1000;
         case PRC_MILLISEC: return ns / 1000000;
         case PRC_SECOND:   return ns / NS_PER_SEC;
-        case PRC_MINUTE:   return ns / NS_PER_SEC / 60;
-        case PRC_HOUR:     return ns / NS_PER_SEC / 60 / 60;
-        case PRC_DAY:      return ns / NS_PER_SEC / 60 / 60 / 24;
-        case PRC_WEEK:     return ns / NS_PER_SEC / 60 / 60 / 24 / 7;
-        case PRC_MONTH:    return ns / NS_PER_SEC / 60 / 60 / 24 / 30;
-        case PRC_QUATER:   return ns / NS_PER_SEC / 60 / 60 / 24;
-        case PRC_YEAR:     return ns / NS_PER_SEC / 60 / 60 / 24 * 100 / 36525;
-        case PRC_23BIT:    return frac;
-        case PRC_15BIT:    return frac >> 8;
+        case PRC_MINUTE:   return ns / ((uint64_t)NS_PER_SEC * 60);
+        case PRC_HOUR:     return ns / ((uint64_t)NS_PER_SEC * 60 * 60);
+        case PRC_DAY:      return ns / ((uint64_t)NS_PER_SEC * 60 * 60 * 24);
+        case PRC_WEEK:     return ns / ((uint64_t)NS_PER_SEC * 60 * 60 * 24 * 7);
+        case PRC_MONTH:    return ns / ((uint64_t)NS_PER_SEC * 60 * 60 * 24 * 30);
+        case PRC_QUATER:   return ns / ((uint64_t)NS_PER_SEC * 60 * 60 * 24);
+        case PRC_YEAR:     return ns / ((uint64_t)NS_PER_SEC * 60 * 60 * 24) * 4 / 1461;   // * 100 / 36525
+        case PRC_23BIT:    return div_frac_unit(ns * 1000000000 + 59604644775);
+        case PRC_15BIT:    return div_frac_unit(ns * 1000000000 + 59604644775) >> 8;
         default: return -1;
     }
 }
@@ -543,4 +989,29 @@ void FP_precision_name(Precision prc, char *out){
         case PRC_MILLENNIUM: strcpy(out, "Mil"); break;
         default: strcpy(out, "N/A"); break;
     }
-}
\ No newline at end of file
+}
+
+
+// days since 1970-01-01 for a proleptic Gregorian date (H. Hinnant's algorithm).
+// Days beyond the end of the month roll over like timegm().
+int64_t FP_days_from_civil(int64_t year, int month, int day){
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yoe = year - era * 400;                                   // [0, 399]
+    int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;              // [0, 146096]
+    return era * 146097 + doe - 719468;
+}
+
+// inverse of FP_days_from_civil()
+void FP_civil_from_days(int64_t days, int64_t *year, int *month, int *day){
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t doe = days - era * 146097;                                    // [0, 146096]
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;  // [0, 399]
+    int64_t doy = doe - (yoe * 365 + yoe / 4 - yoe / 100);                // [0, 365]
+    int64_t mp = (doy * 5 + 2) / 153;                                     // [0, 11], march first
+    *day = doy - (mp * 153 + 2) / 5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year = era * 400 + yoe + (*month <= 2);
+}
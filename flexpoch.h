@@ -17,6 +17,7 @@
 
 #define FP_VERSION "1.1"
 
+#define FP_ISO_MAX_LEN 64    // FP_format_iso() output incl. NUL never exceeds this
 
 
 // types
@@ -46,6 +47,7 @@ typedef enum {
     ERR_INVALID_OFFSET = -11,
     ERR_OFFSET_AND_LEAPSECOND = -12,
     ERR_INCOMPATIBLE_OUTPUT = -13,
+    ERR_IO = -14,  // file access failed, see errno
     ERR_INVALID_6TH_BYTE = -106,
     ERR_CUSTOM_FORMAT = -64,
     ERR_RESERVED_FORMAT = -128,
@@ -87,6 +89,39 @@ typedef struct {
     int64_t rawdata;
 } FP_Components;
 
+// State of FP_format_iso_cached(): the rendered date and time of day of the last
+// local second plus the tz/DST suffix. Initialize with FP_iso_cache_init().
+typedef struct {
+    int64_t day_start;     // first local second of the rendered date
+    int64_t second;        // local second rendered in prefix
+    Precision precision;
+    int32_t tz_offset;
+    bool is_dst;
+    uint8_t time_pos;      // index of the 'T'
+    uint8_t prefix_len;
+    uint8_t suffix_len;
+    char prefix[32];       // "YYYY-MM-DDTHH:MM:SS"
+    char suffix[24];       // "+HH:MM DST"
+} FP_IsoCache;
+
+typedef enum {
+    RFC_7231 = 0,   // HTTP IMF-fixdate "Sun, 06 Nov 1994 08:49:37 GMT"
+    RFC_2822 = 1,   // mail "Sun, 06 Nov 1994 09:49:37 +0100"
+    RFC_3339 = 2,   // "1994-11-06T09:49:37.123+01:00"
+} FP_RfcStyle;
+
+// Memo of FP_format_rfc_cached(): the rendering of one second without subseconds
+typedef struct {
+    int64_t seconds;
+    int32_t tz_offset;
+    bool is_leapsecond;
+    int8_t style;          // FP_RfcStyle, -1 if empty
+    uint8_t head_len;
+    uint8_t tail_len;
+    char head[32];         // up to the seconds
+    char tail[8];          // zone of RFC 3339
+} FP_RfcCache;
+
 
 
 // Functions
@@ -110,6 +145,10 @@ ErrNo FP_from_fp(int64_t flexpoch, FP_Components *out) ;
 
 ErrNo FP_from_iso(char *isostr, FP_Components *out);
 
+// Parse the first len bytes of an ISO 8601 string (no NUL needed, reentrant).
+// Returns the number of bytes consumed or a negative ErrNo.
+int FP_parse_iso(const char *str, size_t len, FP_Components *out);
+
 ErrNo FP_from_unix(int64_t unixtime, FP_Components *out);
 
 ErrNo FP_from_java(int64_t javatime, FP_Components *out);
@@ -130,6 +169,33 @@ ErrNo FP_to_logic(FP_Components *fpc, int64_t* out);
 
 ErrNo FP_to_iso(FP_Components *fpc, char *out);
 
+// Reentrant and async-signal-safe FP_to_iso() into a buffer of size bytes.
+// Returns the string length or a negative ErrNo (ERR_OUT_OF_RANGE if it does not fit).
+int FP_format_iso(const FP_Components *fpc, char *out, size_t size);
+
+void FP_iso_cache_init(FP_IsoCache *cache);
+
+// FP_format_iso() for (nearly) monotonic streams: only the digits of a new second
+// are rendered, the date only on a new day. Same output and return value.
+int FP_format_iso_cached(FP_IsoCache *cache, const FP_Components *fpc, char *out, size_t size);
+
+ErrNo FP_to_http(FP_Components *fpc, char *out);
+
+ErrNo FP_to_rfc2822(FP_Components *fpc, char *out);
+
+ErrNo FP_to_rfc3339(FP_Components *fpc, char *out);
+
+// RFC date formats for years 0..9999. Float years, relative and logical times give
+// ERR_INCOMPATIBLE_OUTPUT. Only RFC 3339 shows subseconds. Returns the length or
+// a negative ErrNo, like FP_format_iso().
+int FP_format_rfc(const FP_Components *fpc, FP_RfcStyle style, char *out, size_t size);
+
+void FP_rfc_cache_init(FP_RfcCache *cache);
+
+// FP_format_rfc() that renders each second only once, e.g. for per-response headers
+int FP_format_rfc_cached(FP_RfcCache *cache, const FP_Components *fpc, FP_RfcStyle style,
+                         char *out, size_t size);
+
 
 // Helper functions
 // ----------------------------------------------------------------------------
@@ -145,5 +211,13 @@ uint64_t FP_ns_to_precision(uint64_t ns, Precision prc);
 
 void FP_precision_name(Precision prc, char *out);
 
+int16_t FP_tz_offset_to_bin(int16_t tz_offset);
+
+int16_t FP_tz_offset_from_bin(int16_t tz_code);
+
+int64_t FP_days_from_civil(int64_t year, int month, int day);
+
+void FP_civil_from_days(int64_t days, int64_t *year, int *month, int *day);
+
 
 #endif // _FLEXPOCH_H
\ No newline at end of file
@@ -0,0 +1,300 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include "fp_agg.h"
+#include "fp_internal.h"
+#include "fp_simd.h"
+
+#define AGG_CHUNK 512                      // rows per bucket index buffer
+#define AGG_CACHE_LINE 64
+#define AGG_SPAN ((int64_t)1 << 41)        // max. seconds of all buckets, keeps the unit estimate exact
+
+// Rows are mapped to units of a grid starting at origin; units are the buckets
+// themselves, or days mapped to buckets by a table for months and above.
+typedef struct {
+    int64_t origin;       // unix seconds of unit 0
+    int64_t unit;         // seconds
+    int64_t n_units;
+    double inv_unit;
+    int64_t month0;       // calendar units above weeks: first month since year 0
+    int64_t months;       // per bucket, 0 otherwise
+    int64_t offset;       // tz offset in seconds
+    uint32_t *day_bucket;
+} AggGrid;
+
+
+// Grid
+// ----------------------------------------------------------------------------
+
+// day table only with map, without it the grid is good for bucket starts
+static ErrNo grid_build(const FP_AggSpec *spec, bool map, AggGrid *g){
+    static const int64_t unit_seconds[] = {1, 60, 3600, 86400, 604800};      // PRC_SECOND ...
+    *g = (AggGrid){0};
+    if (spec->prc != PRC_UNKNOWN && (spec->prc < PRC_SECOND || spec->prc > PRC_MILLENNIUM)){
+        return ERR_INVALID_PRECISION;
+    }
+    if (spec->tz_offset <= -TZ_BIN_OFFSET || spec->tz_offset >= TZ_LEAPSEC){ return ERR_INVALID_OFFSET; }
+    if (!spec->n_buckets || spec->n_buckets > (size_t)AGG_SPAN){ return ERR_OUT_OF_RANGE; }
+    const int64_t min_sec = (int64_t)CP_ABS_YEAR_NEG << 32;
+    const int64_t max_sec = (int64_t)CP_ABS_YEAR_POS << 32;
+    if (spec->start <= min_sec || max_sec <= spec->start){ return ERR_OUT_OF_RANGE; }
+    g->offset = spec->tz_offset * 60;
+    int64_t local = spec->start + g->offset;
+
+    if (spec->prc == PRC_UNKNOWN){
+        if (spec->width < 1 || spec->width > AGG_SPAN){ return ERR_OUT_OF_RANGE; }
+        g->origin = spec->start;
+        g->unit = spec->width;
+        g->n_units = spec->n_buckets;
+    } else if (spec->prc <= PRC_WEEK){
+        int64_t unit = unit_seconds[spec->prc];
+        int64_t base = (spec->prc == PRC_WEEK) ? CAL_MONDAY : 0;
+        g->origin = floor_div(local - base, unit) * unit + base - g->offset;
+        g->unit = unit;
+        g->n_units = spec->n_buckets;
+    } else {
+        int64_t year;
+        int month, day;
+        FP_civil_from_days(floor_div(local, 86400), &year, &month, &day);
+        int64_t months = unit_months(spec->prc);
+        if (spec->n_buckets > FP_AGG_MAX_DAYS / 28){ return ERR_OUT_OF_RANGE; }
+        g->month0 = floor_div(year * 12 + month - 1, months) * months;
+        g->months = months;
+        g->origin = month_start(g->month0) - g->offset;
+        g->unit = 86400;
+        g->n_units = (month_start(g->month0 + (int64_t)spec->n_buckets * months) - month_start(g->month0)) / 86400;
+        if (g->n_units > FP_AGG_MAX_DAYS){ return ERR_OUT_OF_RANGE; }
+    }
+    if (g->n_units > AGG_SPAN / g->unit){ return ERR_OUT_OF_RANGE; }
+    g->inv_unit = 1.0 / g->unit;
+
+    if (map && g->months){
+        g->day_bucket = malloc(g->n_units * sizeof(uint32_t));
+        if (!g->day_bucket){ return ERR_IO; }
+        int64_t first = month_start(g->month0) / 86400;
+        for (size_t b = 0; b < spec->n_buckets; b++){
+            int64_t lo = month_start(g->month0 + (int64_t)b * g->months) / 86400 - first;
+            int64_t hi = month_start(g->month0 + (int64_t)(b + 1) * g->months) / 86400 - first;
+            for (int64_t d = lo; d < hi; d++){ g->day_bucket[d] = b; }
+        }
+    }
+    return SUCCESS;
+}
+
+int64_t FP_agg_bucket_start(const FP_AggSpec *spec, size_t b){
+    AggGrid g;
+    if (grid_build(spec, false, &g) || b > spec->n_buckets){ return INT64_MIN; }
+    if (g.months){ return month_start(g.month0 + (int64_t)b * g.months) - g.offset; }
+    return g.origin + (int64_t)b * g.unit;
+}
+
+
+// Bucket indices
+// ----------------------------------------------------------------------------
+
+// unit of a row, -1 if the row is skipped
+static inline int64_t unit_scalar(int64_t flexpoch, const AggGrid *g){
+    int8_t first_byte = flexpoch >> 56;
+    bool sec_plus = (flexpoch & 0b111) == 0b111;
+    if (first_byte <= CP_ABS_YEAR_NEG || first_byte >= CP_ABS_YEAR_POS ||
+        (sec_plus && ((flexpoch >> 3) & 0xF) > PRC_MILLENNIUM)){
+        return -1;
+    }
+    int64_t d = (flexpoch >> 24) - g->origin;
+    if (d < 0){ return -1; }
+    int64_t q = d / g->unit;
+    return (q < g->n_units) ? q : -1;
+}
+
+static void units_scalar(const int64_t *in, size_t n, const AggGrid *g, int64_t *units){
+    for (size_t i = 0; i < n; i++){
+        units[i] = unit_scalar(in[i], g);
+    }
+}
+
+// The quotient of the seconds is estimated in double precision (|d| < 2^42) and
+// corrected by one step. n is a multiple of FP_VLANES.
+FP_SIMD_CLONES
+static void units_simd(const int64_t *in, size_t n, const AggGrid *g, int64_t *units){
+    const int64_t unit = g->unit;
+    for (size_t i = 0; i < n; i += FP_VLANES){
+        fp_vi64 v;
+        FP_VLOAD(v, in + i);
+        fp_vi64 first_byte = v >> 56;
+        fp_vi64 sec_plus = ((v & 0b111) == 0b111);
+        fp_vi64 ok = (first_byte > CP_ABS_YEAR_NEG) & (first_byte < CP_ABS_YEAR_POS) &
+                     ~(sec_plus & (((v >> 3) & 0xF) > PRC_MILLENNIUM));
+        fp_vi64 d = (v >> 24) - g->origin;
+        d = FP_VSEL(ok, d, -1);   // keeps the estimate of skipped rows in range
+        fp_vi64 q = fp_v_f64_to_i51(fp_v_i51_to_f64(d) * g->inv_unit);
+        fp_vi64 r = d - q * unit;
+        q += (r < 0);
+        q -= (r >= unit);
+        fp_vi64 in_grid = ok & (d >= 0) & (q < g->n_units);
+        fp_vi64 u = FP_VSEL(in_grid, q, -1);
+        FP_VSTORE(units + i, u);
+    }
+}
+
+static void units_of(const int64_t *in, size_t n, const AggGrid *g, int64_t *units){
+    size_t full = 0;
+    if (fp_simd_available()){
+        full = n - n % FP_VLANES;
+        units_simd(in, full, g, units);
+    }
+    units_scalar(in + full, n - full, g, units + full);
+}
+
+
+// Accumulation
+// ----------------------------------------------------------------------------
+
+static void buckets_clear(FP_AggBucket *buckets, size_t n){
+    for (size_t b = 0; b < n; b++){
+        buckets[b] = (FP_AggBucket){0, 0.0, INFINITY, -INFINITY};
+    }
+}
+
+static inline void bucket_add(FP_AggBucket *b, uint64_t count, double sum, double min, double max){
+    b->count += count;
+    b->sum += sum;
+    b->min = (min < b->min) ? min : b->min;
+    b->max = (max > b->max) ? max : b->max;
+}
+
+// every row into its bucket
+static size_t add_rows(FP_AggBucket *acc, const int64_t *units, const double *vals, size_t m){
+    size_t used = 0;
+    for (size_t k = 0; k < m; k++){
+        if (units[k] < 0){ continue; }
+        bucket_add(&acc[units[k]], 1, vals[k], vals[k], vals[k]);
+        used++;
+    }
+    return used;
+}
+
+// Runs of rows of the same bucket, as in time ordered input, are summed up in
+// registers, rows of a run would otherwise wait for each other's stores.
+static size_t add_runs(FP_AggBucket *acc, const int64_t *units, const double *vals, size_t m){
+    size_t used = 0;
+    size_t k = 0;
+    while (k < m){
+        int64_t u = units[k];
+        size_t first = k;
+        double sum = 0.0, min = vals[k], max = vals[k];
+        for (; k < m && units[k] == u; k++){
+            double v = vals[k];
+            sum += v;
+            min = (v < min) ? v : min;
+            max = (v > max) ? v : max;
+        }
+        if (u < 0){ continue; }
+        bucket_add(&acc[u], k - first, sum, min, max);
+        used += k - first;
+    }
+    return used;
+}
+
+// rows [from, to) into acc, returns the number of aggregated rows
+static size_t accumulate(const AggGrid *g, const int64_t *flexpochs, const double *values,
+                         size_t from, size_t to, FP_AggBucket *acc){
+    int64_t units[AGG_CHUNK];
+    size_t used = 0;
+    for (size_t i = from; i < to; i += AGG_CHUNK){
+        size_t m = (to - i < AGG_CHUNK) ? to - i : AGG_CHUNK;
+        units_of(flexpochs + i, m, g, units);
+        if (g->day_bucket){
+            for (size_t k = 0; k < m; k++){
+                units[k] = (units[k] < 0) ? -1 : (int64_t)g->day_bucket[units[k]];
+            }
+        }
+        if (!values){
+            for (size_t k = 0; k < m; k++){
+                if (units[k] < 0){ continue; }
+                acc[units[k]].count++;
+                used++;
+            }
+            continue;
+        }
+        size_t changes = 0;
+        for (size_t k = 1; k < m; k++){
+            changes += units[k] != units[k - 1];
+        }
+        used += (changes * 4 < m) ? add_runs(acc, units, values + i, m) : add_rows(acc, units, values + i, m);
+    }
+    return used;
+}
+
+
+// Pool
+// ----------------------------------------------------------------------------
+
+typedef struct {
+    const AggGrid *grid;
+    const int64_t *flexpochs;
+    const double *values;
+    FP_AggBucket *partial;   // slots * stride buckets, slot FP_pool_worker()
+    size_t stride;
+    int slots;               // workers + 1 for the calling thread
+    size_t n_buckets;
+    FP_AggBucket *out;
+    size_t used;
+} AggRun;
+
+static void agg_task(void *ctx, size_t from, size_t to){
+    AggRun *r = ctx;
+    int slot = FP_pool_worker();
+    if (slot < 0 || slot >= r->slots - 1){ slot = r->slots - 1; }   // inline run
+    size_t used = accumulate(r->grid, r->flexpochs, r->values, from, to, r->partial + slot * r->stride);
+    __atomic_fetch_add(&r->used, used, __ATOMIC_RELAXED);
+}
+
+static void merge_task(void *ctx, size_t from, size_t to){
+    AggRun *r = ctx;
+    for (size_t b = from; b < to; b++){
+        FP_AggBucket m = r->partial[b];
+        for (int s = 1; s < r->slots; s++){
+            const FP_AggBucket *p = &r->partial[s * r->stride + b];
+            m.count += p->count;
+            m.sum += p->sum;
+            m.min = (p->min < m.min) ? p->min : m.min;
+            m.max = (p->max > m.max) ? p->max : m.max;
+        }
+        r->out[b] = m;
+    }
+}
+
+static void clear_task(void *ctx, size_t from, size_t to){
+    AggRun *r = ctx;
+    buckets_clear(r->partial + from, to - from);
+}
+
+ErrNo FP_aggregate(FP_Pool *pool, const FP_AggSpec *spec, const int64_t *flexpochs, const double *values,
+                   size_t n, FP_AggBucket *out, size_t *used){
+    AggGrid g;
+    ErrNo err = grid_build(spec, true, &g);
+    if (err){ return err; }
+    size_t n_buckets = spec->n_buckets;
+
+    // every slot starts on its own cache line
+    const size_t per_line = AGG_CACHE_LINE / sizeof(FP_AggBucket);
+    size_t stride = (n_buckets + per_line - 1) / per_line * per_line;
+    int slots = pool ? FP_pool_size(pool) + 1 : 0;
+    FP_AggBucket *partial = pool ? aligned_alloc(AGG_CACHE_LINE, slots * stride * sizeof(FP_AggBucket)) : NULL;
+
+    size_t n_used;
+    if (!partial){   // no pool or out of memory: single threaded
+        buckets_clear(out, n_buckets);
+        n_used = accumulate(&g, flexpochs, values, 0, n, out);
+    } else {
+        AggRun r = {&g, flexpochs, values, partial, stride, slots, n_buckets, out, 0};
+        FP_pool_run(pool, slots * stride, clear_task, &r);
+        FP_pool_run(pool, n, agg_task, &r);
+        FP_pool_run(pool, n_buckets, merge_task, &r);
+        n_used = r.used;
+        free(partial);
+    }
+    free(g.day_bucket);
+    if (used){ *used = n_used; }
+    return SUCCESS;
+}
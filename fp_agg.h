@@ -0,0 +1,62 @@
+#ifndef _FP_AGG_H
+#define _FP_AGG_H
+
+#include "fp_pool.h"
+
+// Count, sum, min and max of a value column per time bucket of a flexpoch column,
+// e.g. for dashboards. Buckets are either of a fixed width in seconds or calendar
+// units (PRC_SECOND ... PRC_MILLENNIUM, cut like FP_truncate()) in the local time
+// of one tz offset, so that rows with different offsets land in the same buckets.
+// Bucket 0 holds spec.start, the n_buckets buckets follow each other without gaps.
+//
+// The rows may be in any order. The bucket of every row is computed with SIMD from
+// the upper 40 bits (whole seconds) only, calendar units above weeks by a table of
+// days. Rows are accumulated in one pass, with a pool every worker fills its own
+// partial buckets and these are merged at the end. Rows that are no valid absolute
+// seconds (relative, logical, float years, invalid) or fall outside all buckets
+// are skipped.
+
+
+// types
+// ============================================================================
+
+#define FP_AGG_MAX_DAYS (1 << 24)   // about 46000 years
+
+typedef struct {
+    Precision prc;       // calendar unit PRC_SECOND ... PRC_MILLENNIUM or PRC_UNKNOWN
+    int64_t width;       // seconds per bucket if prc is PRC_UNKNOWN
+    int64_t start;       // unix seconds in bucket 0
+    int16_t tz_offset;   // minutes, local time of the calendar units
+    size_t n_buckets;
+} FP_AggSpec;
+
+typedef struct {
+    uint64_t count;
+    double sum;
+    double min;   // INFINITY / -INFINITY while count is 0
+    double max;
+} FP_AggBucket;
+
+
+
+// Functions
+// ============================================================================
+
+// Aggregate n rows into out (spec->n_buckets buckets, overwritten). pool may be
+// NULL to run in the calling thread; with a pool the summation order and so the
+// last bits of the sums depend on the threads. values may be NULL to count only
+// (sum 0, min/max stay infinite). used (may be NULL)
+// gets the number of aggregated rows. Fails without touching out with
+// ERR_INVALID_PRECISION, ERR_INVALID_OFFSET, ERR_OUT_OF_RANGE (no buckets, width
+// below 1, start outside the encodable range, buckets longer than 2^41 seconds in
+// total or FP_AGG_MAX_DAYS days for calendar units above weeks) or ERR_IO if out
+// of memory.
+ErrNo FP_aggregate(FP_Pool *pool, const FP_AggSpec *spec, const int64_t *flexpochs, const double *values,
+                   size_t n, FP_AggBucket *out, size_t *used);
+
+// Unix seconds at which bucket b starts (b == n_buckets for the end of the last),
+// INT64_MIN for an invalid spec.
+int64_t FP_agg_bucket_start(const FP_AggSpec *spec, size_t b);
+
+
+#endif // _FP_AGG_H
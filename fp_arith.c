@@ -0,0 +1,216 @@
+#include "fp_arith.h"
+#include "fp_internal.h"
+#include "fp_direct.h"
+#include "fp_simd.h"
+
+typedef enum { ARITH_ADD, ARITH_SUB, ARITH_DIFF } ArithOp;
+
+// shared kernel on the fields of fp_direct_split()
+static inline ErrNo arith_parts(DirectParts x, DirectParts y, ArithOp op, int64_t *out){
+    *out = CP_UNDEFINED_FP;
+    if (op == ARITH_ADD && x.rel && !y.rel){   // duration + time
+        DirectParts t = x;
+        x = y;
+        y = t;
+    }
+    if ((op == ARITH_DIFF) ? x.rel != y.rel : !y.rel){ return ERR_INCOMPATIBLE_OUTPUT; }
+
+    Precision prc = (x.prc > y.prc) ? x.prc : y.prc;
+    int64_t frac = (op == ARITH_ADD) ? x.frac + y.frac : x.frac - y.frac;
+    int64_t seconds = (op == ARITH_ADD) ? x.seconds + y.seconds : x.seconds - y.seconds;
+    seconds += frac >> 24;   // carry or borrow
+    frac &= (prc < PRC_SECOND) ? fp_direct_frac_mask(prc) : 0;
+
+    bool rel = x.rel || op == ARITH_DIFF;
+    int64_t tz_bin = (op == ARITH_DIFF || x.rel) ? TZ_BIN_OFFSET : x.tz_bin;
+    if (tz_bin == TZ_LEAP_BIN && seconds != x.seconds){ tz_bin = TZ_BIN_OFFSET; }
+    return fp_direct_join((DirectParts){seconds, frac, prc, tz_bin, rel}, out);
+}
+
+static inline ErrNo arith_one(int64_t a, int64_t b, ArithOp op, int64_t *out){
+    DirectParts x, y;
+    ErrNo err = fp_direct_split(a, &x);
+    if (!err){ err = fp_direct_split(b, &y); }
+    if (err){
+        *out = CP_UNDEFINED_FP;
+        return err;
+    }
+    return arith_parts(x, y, op, out);
+}
+
+ErrNo FP_add(int64_t a, int64_t b, int64_t *out){
+    return arith_one(a, b, ARITH_ADD, out);
+}
+
+ErrNo FP_sub(int64_t a, int64_t duration, int64_t *out){
+    return arith_one(a, duration, ARITH_SUB, out);
+}
+
+ErrNo FP_diff(int64_t t2, int64_t t1, int64_t *out){
+    return arith_one(t2, t1, ARITH_DIFF, out);
+}
+
+// SIMD kernels
+// ----------------------------------------------------------------------------
+// fp_direct_split() and arith_parts() on all lanes with selects instead of switches.
+// Lanes that fail are flagged and redone by the scalar path for their ErrNo.
+
+typedef struct {
+    fp_vi64 seconds;
+    fp_vi64 frac;
+    fp_vi64 prc;
+    fp_vi64 tz_bin;
+    fp_vi64 rel;   // 0 / -1
+    fp_vi64 ok;
+} ArithLanes;
+
+static inline __attribute__((always_inline)) fp_vi64 lanes_frac_mask(fp_vi64 prc){
+    return FP_VSEL(prc >= PRC_SECOND, 0, FP_VSEL(prc == PRC_MILLISEC, 0xFFC000, FP_VSEL(prc == PRC_15BIT, 0xFFFE00,
+           FP_VSEL(prc == PRC_MICROSEC, 0xFFFFF0, 0xFFFFFE))));
+}
+
+static inline __attribute__((always_inline)) ArithLanes lanes_split(fp_vi64 v){
+    ArithLanes p;
+    fp_vi64 first_byte = v >> 56;
+    fp_vi64 pattern = v & 0b111;
+    fp_vi64 sec_plus = (pattern == 0b111);
+    fp_vi64 ms = (pattern == 0b101);
+    p.prc = FP_VSEL(sec_plus, (v >> 3) & 0xF, FP_VSEL(ms, PRC_MILLISEC, FP_VSEL(pattern == 0b011, PRC_15BIT,
+            FP_VSEL(pattern == 0b001, PRC_MICROSEC, PRC_23BIT))));
+    p.ok = (first_byte >= (int8_t)(CP_REL_SEC<<4)) & (first_byte < CP_ABS_YEAR_POS) &
+           (first_byte != CP_ABS_YEAR_NEG) & ~(sec_plus & (p.prc > PRC_MILLENNIUM));
+    p.rel = (((fp_vu64)v >> 60) == (uint64_t)CP_REL_SEC);
+    p.seconds = FP_VSEL(p.rel, (v >> 24) & REL_SEC_MAX, v >> 24);
+    p.tz_bin = FP_VSEL(sec_plus, (v >> 13) & 0x7FF, FP_VSEL(ms, (v >> 3) & 0x7FF, TZ_BIN_OFFSET));
+    p.frac = v & lanes_frac_mask(p.prc);
+    return p;
+}
+
+static inline __attribute__((always_inline)) fp_vi64 lanes_parts(ArithLanes x, ArithLanes y, ArithOp op, fp_vi64 *bad){
+    if (op == ARITH_ADD){   // duration + time
+        fp_vi64 swap = x.rel & ~y.rel;
+        ArithLanes t = x;
+        x.seconds = FP_VSEL(swap, y.seconds, x.seconds);
+        x.frac = FP_VSEL(swap, y.frac, x.frac);
+        x.prc = FP_VSEL(swap, y.prc, x.prc);
+        x.tz_bin = FP_VSEL(swap, y.tz_bin, x.tz_bin);
+        x.rel = FP_VSEL(swap, y.rel, x.rel);
+        y.seconds = FP_VSEL(swap, t.seconds, y.seconds);
+        y.frac = FP_VSEL(swap, t.frac, y.frac);
+        y.prc = FP_VSEL(swap, t.prc, y.prc);
+        y.rel = FP_VSEL(swap, t.rel, y.rel);
+    }
+    fp_vi64 compatible = (op == ARITH_DIFF) ? ~(x.rel ^ y.rel) : y.rel;
+
+    fp_vi64 prc = FP_VSEL(x.prc > y.prc, x.prc, y.prc);
+    fp_vi64 frac = (op == ARITH_ADD) ? x.frac + y.frac : x.frac - y.frac;
+    fp_vi64 seconds = (op == ARITH_ADD) ? x.seconds + y.seconds : x.seconds - y.seconds;
+    seconds += frac >> 24;
+    frac &= lanes_frac_mask(prc);
+
+    fp_vi64 rel = (op == ARITH_DIFF) ? (fp_vi64){0} - 1 : x.rel;
+    fp_vi64 tz_bin = FP_VSEL(rel, TZ_BIN_OFFSET, x.tz_bin);
+    tz_bin = FP_VSEL((tz_bin == TZ_LEAP_BIN) & (seconds != x.seconds), TZ_BIN_OFFSET, tz_bin);
+
+    fp_vi64 in_range = FP_VSEL(rel, (seconds >= 0) & (seconds <= REL_SEC_MAX),
+                       (seconds > (int64_t)CP_ABS_YEAR_NEG<<32) & (seconds < (int64_t)CP_ABS_YEAR_POS<<32));
+    *bad = ~(x.ok & y.ok & compatible & in_range);
+
+    fp_vi64 suffix = FP_VSEL(prc >= PRC_SECOND, tz_bin << 13 | prc << 3 | 0b111,
+                     FP_VSEL(prc == PRC_MILLISEC, frac | tz_bin << 3 | 0b101, FP_VSEL(prc == PRC_15BIT, frac | 0b011,
+                     FP_VSEL(prc == PRC_MICROSEC, frac | 0b001, frac))));
+    fp_vi64 value = (fp_vi64)((fp_vu64)seconds << 24) | suffix;
+    return FP_VSEL(rel, (value & 0x0FFFFFFFFFFFFFFF) | (int64_t)((uint64_t)CP_REL_SEC << 60), value);
+}
+
+// n is a multiple of FP_VLANES, returns the number of failed values
+FP_SIMD_CLONES
+static size_t shift_simd(const int64_t *in, size_t n, int64_t duration, ArithOp op, int64_t *out, int16_t *err){
+    size_t n_err = 0;
+    ArithLanes d = lanes_split((fp_vi64){0} + duration);
+    for (size_t i = 0; i < n; i += FP_VLANES){
+        fp_vi64 v, bad;
+        FP_VLOAD(v, in + i);
+        fp_vi64 r = lanes_parts(lanes_split(v), d, op, &bad);
+        FP_VSTORE(out + i, r);
+        for (int l = 0; l < FP_VLANES; l++){
+            ErrNo e = bad[l] ? arith_one(v[l], duration, op, &out[i + l]) : SUCCESS;
+            n_err += e != SUCCESS;
+            if (err){ err[i + l] = e; }
+        }
+    }
+    return n_err;
+}
+
+FP_SIMD_CLONES
+static size_t diff_simd(const int64_t *t2, const int64_t *t1, size_t n, int64_t *out, int16_t *err){
+    size_t n_err = 0;
+    for (size_t i = 0; i < n; i += FP_VLANES){
+        fp_vi64 a, b, bad;
+        FP_VLOAD(a, t2 + i);
+        FP_VLOAD(b, t1 + i);
+        fp_vi64 r = lanes_parts(lanes_split(a), lanes_split(b), ARITH_DIFF, &bad);
+        FP_VSTORE(out + i, r);
+        for (int l = 0; l < FP_VLANES; l++){
+            ErrNo e = bad[l] ? arith_one(a[l], b[l], ARITH_DIFF, &out[i + l]) : SUCCESS;
+            n_err += e != SUCCESS;
+            if (err){ err[i + l] = e; }
+        }
+    }
+    return n_err;
+}
+
+
+// Batches
+// ----------------------------------------------------------------------------
+
+// the duration is split once
+static size_t shift_scalar(const int64_t *in, size_t n, int64_t duration, ArithOp op, int64_t *out, int16_t *err){
+    DirectParts d = {0};
+    ErrNo e_dur = fp_direct_split(duration, &d);
+    size_t n_err = 0;
+    for (size_t i = 0; i < n; i++){
+        DirectParts x;
+        ErrNo e = fp_direct_split(in[i], &x);   // the value's error first, like arith_one()
+        e = e ? e : e_dur;
+        if (e){
+            out[i] = CP_UNDEFINED_FP;
+        } else {
+            e = arith_parts(x, d, op, &out[i]);
+        }
+        n_err += e != SUCCESS;
+        if (err){ err[i] = e; }
+    }
+    return n_err;
+}
+
+static size_t shift_batch(const int64_t *in, size_t n, int64_t duration, ArithOp op, int64_t *out, int16_t *err){
+    size_t full = 0, n_err = 0;
+    if (fp_simd_available()){   // SIMD for full vectors, scalar for the tail
+        full = n - n % FP_VLANES;
+        n_err = shift_simd(in, full, duration, op, out, err);
+    }
+    return n_err + shift_scalar(in + full, n - full, duration, op, out + full, err ? err + full : NULL);
+}
+
+size_t FP_add_batch(const int64_t *in, size_t n, int64_t duration, int64_t *out, int16_t *err){
+    return shift_batch(in, n, duration, ARITH_ADD, out, err);
+}
+
+size_t FP_sub_batch(const int64_t *in, size_t n, int64_t duration, int64_t *out, int16_t *err){
+    return shift_batch(in, n, duration, ARITH_SUB, out, err);
+}
+
+size_t FP_diff_batch(const int64_t *t2, const int64_t *t1, size_t n, int64_t *out, int16_t *err){
+    size_t full = 0, n_err = 0;
+    if (fp_simd_available()){
+        full = n - n % FP_VLANES;
+        n_err = diff_simd(t2, t1, full, out, err);
+    }
+    for (size_t i = full; i < n; i++){
+        ErrNo e = arith_one(t2[i], t1[i], ARITH_DIFF, &out[i]);
+        n_err += e != SUCCESS;
+        if (err){ err[i] = e; }
+    }
+    return n_err;
+}
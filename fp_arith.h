@@ -0,0 +1,44 @@
+#ifndef _FP_ARITH_H
+#define _FP_ARITH_H
+
+#include "flexpoch.h"
+
+// Arithmetic on encoded flexpochs without decoding: shift a time by a duration
+// (relative seconds, CP_REL_SEC) or take the duration between two times. The
+// fractions are added in 24 bit fixed point with the carry into the seconds. The
+// result has the coarser of the two precisions (sub-second fractions are cut to
+// it) and the tz offset of the absolute operand; durations and differences are in
+// UTC. Calculations follow the stored (POSIX) seconds, a leap second counts as
+// the second before it and keeps its flag only while the result stays in it.
+//
+// Float years, logical clocks and mixing the wrong kinds fail with
+// ERR_INCOMPATIBLE_OUTPUT, invalid values with the ErrNo of FP_from_fp(), results
+// outside the encodable range (including negative durations) with ERR_OUT_OF_RANGE.
+// Failed values become CP_UNDEFINED_FP.
+
+
+
+// Functions
+// ============================================================================
+
+// a + b where at most one of them is absolute: time + duration or duration + duration
+ErrNo FP_add(int64_t a, int64_t b, int64_t *out);
+
+// time - duration or duration - duration
+ErrNo FP_sub(int64_t a, int64_t duration, int64_t *out);
+
+// Duration from t1 to t2 (both absolute or both relative) as relative seconds,
+// ERR_OUT_OF_RANGE if t2 is before t1.
+ErrNo FP_diff(int64_t t2, int64_t t1, int64_t *out);
+
+// FP_add() / FP_sub() of one duration on n values, in and out may be the same array.
+// err (may be NULL) gets the ErrNo of every value. Returns the number of failed values.
+size_t FP_add_batch(const int64_t *in, size_t n, int64_t duration, int64_t *out, int16_t *err);
+
+size_t FP_sub_batch(const int64_t *in, size_t n, int64_t duration, int64_t *out, int16_t *err);
+
+// FP_diff() of n pairs t2[i], t1[i]
+size_t FP_diff_batch(const int64_t *t2, const int64_t *t1, size_t n, int64_t *out, int16_t *err);
+
+
+#endif // _FP_ARITH_H
@@ -0,0 +1,1031 @@
+#include "fp_batch.h"
+#include "fp_internal.h"
+#include "fp_direct.h"
+#include "fp_simd.h"
+
+static bool use_simd = true;
+
+// precision dependent part of FP_to_fp(), resolved once per batch
+typedef struct {
+    int rshift;        // fraction bits dropped by the precision
+    int64_t keep_frac; // 0 for second and coarser precisions
+    int64_t suffix;    // pattern, precision and timezone bits
+} EncodeCfg;
+
+
+// Scalar reference
+// ----------------------------------------------------------------------------
+
+// decode one value exactly like FP_from_fp() but without stdout side effects
+static ErrNo decode_one(int64_t flexpoch, FP_Components *fpc){
+    ErrNo err;
+    *fpc = FP_new();
+    if (((flexpoch >> 60) & 0xF) == CP_REL_FRAC){
+        err = ERR_RESERVED_FORMAT;
+    } else {
+        err = FP_from_fp(flexpoch, fpc);
+    }
+    if (err != SUCCESS){
+        *fpc = FP_new();
+    }
+    return err;
+}
+
+// FP_from_fp() error without decoding, plus the tz offset range of FP_to_fp()
+static ErrNo validate_one(int64_t flexpoch){
+    ErrNo err = fp_direct_validate(flexpoch);
+    if (err || !fp_direct_is_sec(flexpoch >> 56)){ return err; }
+    int64_t tz_bin;
+    switch (flexpoch & 0b111){
+        case 0b101: tz_bin = (flexpoch >> 3) & 0x7FF; break;
+        case 0b111: tz_bin = (flexpoch >> 13) & 0x7FF; break;
+        default:    return SUCCESS;
+    }
+    int64_t offset = tz_bin - TZ_BIN_OFFSET;
+    return (offset == TZ_LEAPSEC || (-1020 <= offset && offset <= 1020)) ? SUCCESS : ERR_INVALID_OFFSET;
+}
+
+// rows [from, to), returns the first invalid one or to
+static size_t validate_scalar(const int64_t *in, size_t from, size_t to, uint64_t *err_mask){
+    size_t first = to;
+    for (size_t i = from; i < to; i++){
+        if (validate_one(in[i]) == SUCCESS){ continue; }
+        if (first == to){ first = i; }
+        if (!err_mask){ break; }
+        err_mask[i / 64] |= (uint64_t)1 << (i % 64);
+    }
+    return first;
+}
+
+static size_t decode_scalar(const int64_t *in, size_t n, FP_BatchOut *out){
+    size_t n_err = 0;
+    FP_Components fpc;
+    for (size_t i = 0; i < n; i++){
+        ErrNo err = decode_one(in[i], &fpc);
+        n_err += (err != SUCCESS);
+        if (out->seconds)       { out->seconds[i] = fpc.seconds; }
+        if (out->ns)            { out->ns[i] = fpc.ns; }
+        if (out->precision)     { out->precision[i] = fpc.precision; }
+        if (out->tz_offset)     { out->tz_offset[i] = fpc.tz_offset; }
+        if (out->is_leapsecond) { out->is_leapsecond[i] = fpc.is_leapsecond; }
+        if (out->fmt)           { out->fmt[i] = fpc.fmt; }
+        if (out->err)           { out->err[i] = err; }
+    }
+    return n_err;
+}
+
+static ErrNo encode_cfg(Precision prc, int16_t tz_offset, EncodeCfg *cfg){
+    if (tz_offset < -1020 || 1020 < tz_offset){
+        return ERR_INVALID_OFFSET;
+    }
+    int64_t tz_bin = FP_tz_offset_to_bin(tz_offset);
+    if (PRC_SECOND <= prc && prc <= PRC_MILLENNIUM){
+        *cfg = (EncodeCfg){0, 0, (prc << 3) + (tz_bin << 13) + 0b111};
+    } else if (prc == PRC_MILLISEC){
+        *cfg = (EncodeCfg){13, -1, (tz_bin << 3) + 0b101};
+    } else if (prc == PRC_15BIT){
+        *cfg = (EncodeCfg){8, -1, 0b011};
+    } else if (prc == PRC_MICROSEC){
+        *cfg = (EncodeCfg){3, -1, 0b001};
+    } else if (prc == PRC_23BIT || prc == PRC_NANOSEC){
+        *cfg = (EncodeCfg){0, -1, 0b0};
+    } else {
+        return ERR_INVALID_PRECISION;
+    }
+    return SUCCESS;
+}
+
+static size_t fail_all(size_t n, ErrNo error, int64_t *out, int16_t *err){
+    for (size_t i = 0; i < n; i++){
+        out[i] = CP_UNDEFINED_FP;
+        if (err){ err[i] = error; }
+    }
+    return n;
+}
+
+// encode one value through FP_to_fp() after the range checks of FP_from_unix()
+static ErrNo encode_one(int64_t seconds, int64_t ns, Precision prc, int16_t tz_offset, int64_t *out){
+    if (seconds <= (int64_t)CP_ABS_YEAR_NEG<<32 || (int64_t)CP_ABS_YEAR_POS<<32 <= seconds ||
+        ns < 0 || NS_PER_SEC <= ns){
+        *out = CP_UNDEFINED_FP;
+        return ERR_OUT_OF_RANGE;
+    }
+    FP_Components fpc = FP_new();
+    fpc.seconds = seconds;
+    fpc.ns = ns;
+    fpc.precision = prc;
+    fpc.tz_offset = tz_offset;
+    return FP_to_fp(&fpc, out);
+}
+
+static size_t encode_unix_scalar(const int64_t *in, size_t n, Precision prc, int16_t tz_offset,
+                                 int64_t *out, int16_t *err){
+    size_t n_err = 0;
+    for (size_t i = 0; i < n; i++){
+        ErrNo error = encode_one(in[i], 0, prc, tz_offset, out + i);
+        n_err += (error != SUCCESS);
+        if (err){ err[i] = error; }
+    }
+    return n_err;
+}
+
+static size_t encode_timespec_scalar(const struct timespec *in, size_t n, Precision prc, int16_t tz_offset,
+                                     int64_t *out, int16_t *err){
+    size_t n_err = 0;
+    for (size_t i = 0; i < n; i++){
+        ErrNo error = encode_one(in[i].tv_sec, in[i].tv_nsec, prc, tz_offset, out + i);
+        n_err += (error != SUCCESS);
+        if (err){ err[i] = error; }
+    }
+    return n_err;
+}
+
+static size_t encode_java_scalar(const int64_t *in, size_t n, Precision prc, int16_t tz_offset,
+                                 int64_t *out, int16_t *err){
+    size_t n_err = 0;
+    for (size_t i = 0; i < n; i++){
+        int64_t seconds = in[i] / 1000;
+        int64_t millis = in[i] % 1000;
+        if (millis < 0){
+            seconds -= 1;
+            millis += 1000;
+        }
+        ErrNo error = encode_one(seconds, millis * 1000000, prc, tz_offset, out + i);
+        n_err += (error != SUCCESS);
+        if (err){ err[i] = error; }
+    }
+    return n_err;
+}
+
+// row i of an ISO column without trailing padding
+static inline void iso_row(const char *base, const size_t *offsets, size_t stride, size_t i,
+                           const char **row, size_t *len){
+    size_t start = offsets ? offsets[i] : i * stride;
+    size_t end = offsets ? offsets[i+1] : start + stride;
+    while (end > start && (base[end-1] == '\0' || base[end-1] == '\n' ||
+                           base[end-1] == '\r' || base[end-1] == ' ')){
+        end--;
+    }
+    *row = base + start;
+    *len = end - start;
+}
+
+static inline void iso_set_err(uint64_t *err_mask, size_t i){
+    if (err_mask){ err_mask[i / 64] |= (uint64_t)1 << (i % 64); }
+}
+
+// FP_from_iso() + FP_to_fp() on one row that has to be consumed completely
+static ErrNo iso_one(const char *str, size_t len, int64_t *out){
+    FP_Components fpc = FP_new();
+    int used = FP_parse_iso(str, len, &fpc);
+    ErrNo err = (used < 0) ? used : ((size_t)used != len) ? ERR_INVALID_ISO : FP_to_fp(&fpc, out);
+    if (err != SUCCESS){ *out = CP_UNDEFINED_FP; }
+    return err;
+}
+
+static size_t iso_scalar(const char *base, const size_t *offsets, size_t stride, size_t from, size_t to,
+                         int64_t *out, uint64_t *err_mask){
+    size_t n_err = 0;
+    for (size_t i = from; i < to; i++){
+        const char *row;
+        size_t len;
+        iso_row(base, offsets, stride, i, &row, &len);
+        if (iso_one(row, len, out + i) != SUCCESS){
+            iso_set_err(err_mask, i);
+            n_err++;
+        }
+    }
+    return n_err;
+}
+
+
+// Fixed ISO layouts
+// ----------------------------------------------------------------------------
+
+#define ISO_MAX_LEN 40   // "YYYY-MM-DDTHH:MM:SS.nnnnnnnnn+HH:MM" has 35
+#define ISO_WORDS (ISO_MAX_LEN / 8)
+
+// Byte masks of one layout, little endian 8 byte words. Digits are checked and
+// converted in all words at once, the fields sit at fixed positions.
+typedef struct {
+    size_t len;
+    int n_words;
+    int frac_digits;     // 0, 3, 6 or 9
+    int64_t frac_scale;  // ns per fraction digit unit
+    int tz_pos;          // index of the offset sign, 0 for none
+    int tz_shift;        // bit position of the tz code, 0 if the precision has none
+    EncodeCfg cfg;       // with tz offset 0
+    int64_t expect[ISO_WORDS];   // literal bytes, '0' at digit positions
+    int64_t literal[ISO_WORDS];  // 0xFF for bytes that must equal expect
+    int64_t digits[ISO_WORDS];   // 0xFF for digit positions
+} IsoLayout;
+
+// derive the layout from one row, false if it has none of the fixed shapes
+static bool iso_layout(const char *row, size_t len, IsoLayout *lay){
+    char tmpl[ISO_MAX_LEN + 1] = "dddd-dd-ddTdd:dd:dd";
+    size_t pos = 19;
+    int frac_digits = 0;
+    if (len < pos || ISO_MAX_LEN < len){ return false; }
+    if (pos < len && row[pos] == '.'){
+        while (pos + 1 + frac_digits < len && '0' <= row[pos + 1 + frac_digits] &&
+               row[pos + 1 + frac_digits] <= '9'){
+            frac_digits++;
+        }
+        if (frac_digits != 3 && frac_digits != 6 && frac_digits != 9){ return false; }
+        tmpl[pos] = '.';
+        memset(tmpl + pos + 1, 'd', frac_digits);
+        pos += 1 + frac_digits;
+    }
+    int tz_pos = 0;
+    if (pos + 1 == len && row[pos] == 'Z'){
+        tmpl[pos++] = 'Z';
+    } else if (pos + 6 == len){
+        tz_pos = pos;
+        memcpy(tmpl + pos, "sdd:dd", 6);
+        pos += 6;
+    }
+    if (pos != len){ return false; }
+
+    *lay = (IsoLayout){.len = len, .n_words = (len + 7) / 8, .frac_digits = frac_digits, .tz_pos = tz_pos};
+    for (size_t k = 0; k < len; k++){
+        int64_t byte = (int64_t)0xFF << (8 * (k % 8));
+        char c = tmpl[k];
+        if (c == 'd'){
+            if (row[k] < '0' || '9' < row[k]){ return false; }
+            lay->digits[k / 8] |= byte;
+            lay->expect[k / 8] |= (int64_t)'0' << (8 * (k % 8));
+        } else if (c == 's'){
+            if (row[k] != '+' && row[k] != '-'){ return false; }
+        } else {
+            if (row[k] != c){ return false; }
+            lay->literal[k / 8] |= byte;
+            lay->expect[k / 8] |= (int64_t)c << (8 * (k % 8));
+        }
+    }
+
+    Precision prc = (frac_digits == 0) ? PRC_SECOND : (frac_digits == 3) ? PRC_MILLISEC :
+                    (frac_digits == 6) ? PRC_MICROSEC : PRC_NANOSEC;
+    lay->frac_scale = (frac_digits == 3) ? 1000000 : (frac_digits == 6) ? 1000 : 1;
+    lay->tz_shift = (prc == PRC_SECOND) ? 13 : (prc == PRC_MILLISEC) ? 3 : 0;
+    return encode_cfg(prc, 0, &lay->cfg) == SUCCESS;
+}
+
+// layout of the first fitting row among the first few
+static bool iso_find_layout(const char *base, const size_t *offsets, size_t stride, size_t n, IsoLayout *lay){
+    for (size_t i = 0; i < n && i < 64; i++){
+        const char *row;
+        size_t len;
+        iso_row(base, offsets, stride, i, &row, &len);
+        if (iso_layout(row, len, lay)){ return true; }
+    }
+    return false;
+}
+
+
+// SIMD kernels
+// ----------------------------------------------------------------------------
+
+// FP_to_fp() for valid lanes, CP_UNDEFINED_FP for the others
+static inline __attribute__((always_inline))
+fp_vi64 encode_lanes(fp_vi64 seconds, fp_vi64 frac, fp_vi64 ok, EncodeCfg cfg){
+    ok &= (seconds > (int64_t)CP_ABS_YEAR_NEG<<32) & (seconds < (int64_t)CP_ABS_YEAR_POS<<32);
+    fp_vi64 low = (((frac >> cfg.rshift) << (cfg.rshift + 1)) & cfg.keep_frac) | cfg.suffix;
+    return FP_VSEL(ok, (seconds << 24) + low, (fp_vi64){0} + CP_UNDEFINED_FP);   // a rounded up fraction carries
+}
+
+static inline __attribute__((always_inline))
+size_t store_encoded(fp_vi64 value, int64_t *out, int16_t *err){
+    fp_vi64 bad = (value == CP_UNDEFINED_FP);
+    FP_VSTORE(out, value);
+    if (err){
+        fp_vi16 res = __builtin_convertvector(bad & ERR_OUT_OF_RANGE, fp_vi16);
+        FP_VSTORE(err, res);
+    }
+    size_t n_bad = 0;
+    for (int l = 0; l < FP_VLANES; l++){ n_bad -= bad[l]; }
+    return n_bad;
+}
+
+FP_SIMD_CLONES
+static size_t encode_unix_simd(const int64_t *in, size_t n, EncodeCfg cfg, int64_t *out, int16_t *err){
+    size_t n_err = 0;
+    size_t i = 0;
+    for (; i + FP_VLANES <= n; i += FP_VLANES){
+        fp_vi64 seconds;
+        FP_VLOAD(seconds, in + i);
+        fp_vi64 value = encode_lanes(seconds, (fp_vi64){0}, (fp_vi64){0} - 1, cfg);  // ns2frac(0) = 0
+        n_err += store_encoded(value, out + i, err ? err + i : NULL);
+    }
+    return n_err;
+}
+
+FP_SIMD_CLONES
+static size_t encode_java_simd(const int64_t *in, size_t n, EncodeCfg cfg, int64_t *out, int16_t *err){
+    const int64_t limit = (int64_t)1 << 50;   // keeps millis exact in double precision
+    // ns2frac(ms * 1e6) = floor(ms * 1e15/D + 0.5 - eps) with D = 119209289551. For ms < 1000 the
+    // product stays >= 1/250 away from integers, so double precision rounds it exactly.
+    const double ms2frac = 1e15 / 119209289551.0;
+    const double frac_bias = 59604644775.0 / 119209289551.0 - 0.5;
+    size_t n_err = 0;
+    for (size_t i = 0; i + FP_VLANES <= n; i += FP_VLANES){
+        fp_vi64 javatime;
+        FP_VLOAD(javatime, in + i);
+        fp_vi64 ok = (javatime > -limit) & (javatime < limit);
+        fp_vf64 millis = fp_v_i51_to_f64(javatime & ok);
+        fp_vf64 seconds = fp_v_round_f64(millis * 0.001);
+        fp_vf64 rem = millis - seconds * 1000.0;
+        fp_vi64 below = (rem < 0.0);   // floor instead of round
+        seconds = (fp_vf64)FP_VSEL(below, (fp_vi64)(seconds - 1.0), (fp_vi64)seconds);
+        rem = (fp_vf64)FP_VSEL(below, (fp_vi64)(rem + 1000.0), (fp_vi64)rem);
+        fp_vi64 frac = fp_v_f64_to_i51(rem * ms2frac + frac_bias);
+        fp_vi64 value = encode_lanes(fp_v_f64_to_i51(seconds), frac, ok, cfg);
+        n_err += store_encoded(value, out + i, err ? err + i : NULL);
+    }
+    return n_err;
+}
+
+// loads two timespecs per 128 bit and splits them into tv_sec and tv_nsec lanes
+_Static_assert(sizeof(struct timespec) == 2*sizeof(int64_t), "timespec must be two 64 bit fields");
+
+FP_SIMD_CLONES
+static size_t encode_timespec_simd(const struct timespec *in, size_t n, EncodeCfg cfg, int64_t *out, int16_t *err){
+    size_t n_err = 0;
+    size_t i = 0;
+    for (; i + FP_VLANES <= n; i += FP_VLANES){
+        fp_vi64 lo, hi;
+        FP_VLOAD(lo, in + i);
+        FP_VLOAD(hi, in + i + FP_VLANES/2);
+        fp_vi64 seconds = __builtin_shuffle(lo, hi, (fp_vi64){0, 2, 4, 6});
+        fp_vi64 ns = __builtin_shuffle(lo, hi, (fp_vi64){1, 3, 5, 7});
+        fp_vi64 ok = (ns >= 0) & (ns < NS_PER_SEC);
+        fp_vi64 value = encode_lanes(seconds, fp_v_ns2frac(ns & ok), ok, cfg);
+        n_err += store_encoded(value, out + i, err ? err + i : NULL);
+    }
+    return n_err;
+}
+
+// Branch-free version of FP_from_fp(): every codepoint and precision pattern is
+// evaluated on all lanes and the results are merged with masks.
+FP_SIMD_CLONES
+static size_t decode_simd(const int64_t *in, size_t n, FP_BatchOut *out){
+    fp_vi64 n_err = {0};
+    size_t i = 0;
+    for (; i + FP_VLANES <= n; i += FP_VLANES){
+        fp_vi64 v;
+        FP_VLOAD(v, in + i);
+
+        fp_vi64 first_byte = v >> 56;
+        fp_vi64 nibble = (fp_vi64)((fp_vu64)v >> 60);
+        fp_vi64 is_year = (first_byte == CP_ABS_YEAR_NEG) | (first_byte == CP_ABS_YEAR_POS);
+        fp_vi64 is_sec = (first_byte >= (int8_t)(CP_REL_SEC<<4)) & (first_byte < CP_ABS_YEAR_POS) & ~is_year;
+        fp_vi64 is_rel = is_sec & (nibble == CP_REL_SEC);
+        fp_vi64 is_logic = (nibble == CP_LOGICAL);
+
+        // absolute and relative seconds
+        fp_vi64 pattern = v & 0b111;
+        fp_vi64 p_23bit = (v & 0b1) == 0;
+        fp_vi64 p_us = (pattern == 0b001);
+        fp_vi64 p_15bit = (pattern == 0b011);
+        fp_vi64 p_ms = (pattern == 0b101);
+        fp_vi64 p_sec = (pattern == 0b111);
+
+        fp_vi64 frac = v & ((p_23bit & 0xFFFFFE) | (p_us & 0xFFFFF0) | (p_15bit & 0xFFFE00) | (p_ms & 0xFFC000));
+        fp_vi64 prc = (p_23bit & PRC_23BIT) | (p_us & PRC_MICROSEC) | (p_15bit & PRC_15BIT) |
+                      (p_ms & PRC_MILLISEC) | (p_sec & ((v >> 3) & 0xF));
+        fp_vi64 tz = ((p_ms & ((v >> 3) & 0x7FF)) | (p_sec & ((v >> 13) & 0x7FF))) - TZ_BIN_OFFSET;
+        tz &= (p_ms | p_sec);
+        fp_vi64 is_leap = (tz == TZ_LEAPSEC);
+        tz &= ~is_leap;
+        fp_vi64 seconds = v >> 24;
+        seconds = FP_VSEL(is_rel, seconds & 0x0FFFFFFFFF, seconds);
+        fp_vi64 ns = fp_v_frac2ns(frac);
+
+        // float years
+        fp_vi32 floatbits = __builtin_convertvector(v >> 24, fp_vi32);
+        fp_vf32 year = (fp_vf32)floatbits;
+        fp_vi32 is_pos32 = __builtin_convertvector(first_byte == CP_ABS_YEAR_POS, fp_vi32);
+        fp_vi32 bad_year32 = FP_VSEL(is_pos32, year < (float)FP_YEAR_MAX+1, year > (float)FP_YEAR_MIN-1);
+        fp_vi64 bad_year = __builtin_convertvector(bad_year32, fp_vi64);
+        fp_vi64 tail_set = (v & 0xFFFFFF) != 0;
+
+        fp_vi64 is_other = ~(is_year | is_sec);
+        fp_vi64 err = (is_year & FP_VSEL(tail_set, (fp_vi64){0} + ERR_NON_ZERO_AFTER_YEAR, bad_year & ERR_INVALID_YEAR))
+                    | (is_sec & p_sec & (prc > 12) & ERR_INVALID_PRECISION)
+                    | (is_other & ((nibble == CP_REL_FRAC) | ((nibble >> 1) == CP_RESERVED)) & ERR_RESERVED_FORMAT)
+                    | (is_other & (nibble == CP_CUSTOM) & ERR_CUSTOM_FORMAT);
+        fp_vi64 ok = (err == 0);
+        n_err += ~ok & 1;
+
+        fp_vi64 ok_sec = ok & is_sec;
+        if (out->seconds){
+            fp_vi64 res = ok & ((is_sec & seconds) | (is_logic & (v & 0x0FFFFFFFFFFFFFFF)));
+            FP_VSTORE(out->seconds + i, res);
+        }
+        if (out->ns){
+            fp_vu32 res = __builtin_convertvector(FP_VSEL(ok_sec, ns, (fp_vi64){0} + UINT32_MAX), fp_vu32);
+            FP_VSTORE(out->ns + i, res);
+        }
+        if (out->precision){
+            fp_vi8 res = __builtin_convertvector(FP_VSEL(ok_sec, prc, (fp_vi64){0} + PRC_UNKNOWN), fp_vi8);
+            FP_VSTORE(out->precision + i, res);
+        }
+        if (out->tz_offset){
+            fp_vi16 res = __builtin_convertvector(ok_sec & tz, fp_vi16);
+            FP_VSTORE(out->tz_offset + i, res);
+        }
+        if (out->is_leapsecond){
+            fp_vu8 res = __builtin_convertvector(ok_sec & is_leap & 1, fp_vu8);
+            FP_VSTORE(out->is_leapsecond + i, res);
+        }
+        if (out->fmt){
+            fp_vu8 res = __builtin_convertvector(ok & ((is_year & FMT_ABS_YEAR) | (is_rel & FMT_REL_SEC) |
+                                                       (is_logic & FMT_LOGICAL)), fp_vu8);
+            FP_VSTORE(out->fmt + i, res);
+        }
+        if (out->err){
+            fp_vi16 res = __builtin_convertvector(err, fp_vi16);
+            FP_VSTORE(out->err + i, res);
+        }
+    }
+
+    size_t total = 0;
+    for (int l = 0; l < FP_VLANES; l++){ total += n_err[l]; }
+
+    if (i < n){
+        FP_BatchOut tail = *out;
+        if (tail.seconds)       { tail.seconds += i; }
+        if (tail.ns)            { tail.ns += i; }
+        if (tail.precision)     { tail.precision += i; }
+        if (tail.tz_offset)     { tail.tz_offset += i; }
+        if (tail.is_leapsecond) { tail.is_leapsecond += i; }
+        if (tail.fmt)           { tail.fmt += i; }
+        if (tail.err)           { tail.err += i; }
+        total += decode_scalar(in + i, n - i, &tail);
+    }
+    return total;
+}
+
+// Quick pass for the common case: one bit per row that is no valid second or
+// logical value (float years included), a superset of the invalid rows.
+static inline __attribute__((always_inline)) uint64_t validate_word_sec(const int64_t *in, size_t m){
+    fp_vi64 bits = {0};
+    fp_vi64 bit = {1, 2, 4, 8};
+    for (size_t k = 0; k < m; k += FP_VLANES, bit <<= FP_VLANES){
+        fp_vi64 v;
+        FP_VLOAD(v, in + k);
+        fp_vi64 first_byte = (fp_vi64)((fp_vu64)v >> 56);
+        fp_vi64 is_sec = (((first_byte - (uint8_t)(CP_REL_SEC<<4)) & 0xFF) < (((uint8_t)CP_ABS_YEAR_POS - (uint8_t)(CP_REL_SEC<<4)) & 0xFF))
+                       & (first_byte != (uint8_t)CP_ABS_YEAR_NEG);
+        // tz bins 4 ... 2044 and the leap second 2047 are rotated to 0 ... 2040 and 2043
+        fp_vi64 p_sec = ((v & 0b111) == 0b111);
+        fp_vi64 tz_bin = (((fp_vi64)((fp_vu64)v >> (fp_vu64)(3 + (p_sec & 10))) - (TZ_BIN_OFFSET - 1020)) & 0x7FF);
+        fp_vi64 bad_tz = ((v & 0b101) == 0b101) & (tz_bin > 2040) & (tz_bin != TZ_LEAPSEC + 1020);
+        fp_vi64 bad_prc = p_sec & (((fp_vi64)((fp_vu64)v >> 3) & 0xF) > PRC_MILLENNIUM);
+        fp_vi64 ok = (is_sec & ~(bad_tz | bad_prc)) | ((fp_vi64)((fp_vu64)v >> 60) == CP_LOGICAL);
+        bits |= ~ok & bit;
+    }
+    uint64_t word = 0;
+    for (int l = 0; l < FP_VLANES; l++){ word |= bits[l]; }
+    return word;
+}
+
+// validate_one() != SUCCESS with the checks of decode_simd() as one bit per row,
+// m <= 64 rows, a multiple of FP_VLANES
+static inline __attribute__((always_inline)) uint64_t validate_word(const int64_t *in, size_t m){
+    // the year limits as float bits: for floats of one sign the bits compare like the values
+    float limit_pos = (float)FP_YEAR_MAX + 1, limit_neg = -((float)FP_YEAR_MIN - 1);
+    int32_t bits_pos, bits_neg;
+    memcpy(&bits_pos, &limit_pos, sizeof(bits_pos));
+    memcpy(&bits_neg, &limit_neg, sizeof(bits_neg));
+
+    fp_vi64 bits = {0};
+    fp_vi64 bit = {1, 2, 4, 8};   // of every lane, moves up by FP_VLANES per vector
+    for (size_t k = 0; k < m; k += FP_VLANES, bit <<= FP_VLANES){
+        fp_vi64 v;
+        FP_VLOAD(v, in + k);
+        // logical shifts only, AVX2 has no 64 bit arithmetic shift
+        fp_vi64 first_byte = (fp_vi64)((fp_vu64)v >> 56);
+        fp_vi64 is_pos = (first_byte == (uint8_t)CP_ABS_YEAR_POS);
+        fp_vi64 is_year = (first_byte == (uint8_t)CP_ABS_YEAR_NEG) | is_pos;
+        fp_vi64 is_sec = (((first_byte - (uint8_t)(CP_REL_SEC<<4)) & 0xFF) < (((uint8_t)CP_ABS_YEAR_POS - (uint8_t)(CP_REL_SEC<<4)) & 0xFF)) & ~is_year;
+        fp_vi64 is_logic = ((fp_vi64)((fp_vu64)v >> 60) == CP_LOGICAL);
+
+        fp_vi64 pattern = v & 0b111;
+        fp_vi64 p_sec = (pattern == 0b111);
+        fp_vi64 tz = ((fp_vi64)((fp_vu64)v >> (fp_vu64)(3 + (p_sec & 10))) & 0x7FF) - TZ_BIN_OFFSET;
+        fp_vi64 bad_tz = ((pattern == 0b101) | p_sec) & (tz != TZ_LEAPSEC) & ((tz < -1020) | (tz > 1020));
+        fp_vi64 bad_prc = p_sec & (((fp_vi64)((fp_vu64)v >> 3) & 0xF) > PRC_MILLENNIUM);
+
+        // year < FP_YEAR_MAX+1 resp. year > FP_YEAR_MIN-1, never true for NaN
+        fp_vi64 year = (fp_vi64)((fp_vu64)v >> 24);
+        fp_vi64 mag = year & 0x7FFFFFFF;
+        fp_vi64 wrong_sign = ((year ^ is_pos) & 0x80000000) == 0;
+        fp_vi64 bad_year = (mag <= 0x7F800000) & (wrong_sign | (mag < FP_VSEL(is_pos, (fp_vi64){0} + bits_pos, (fp_vi64){0} + bits_neg)));
+        bad_year |= ((v & 0xFFFFFF) != 0);
+
+        // everything else is reserved, custom or a relative fraction
+        fp_vi64 bad = (is_year & bad_year) | (is_sec & (bad_prc | bad_tz)) | ~(is_year | is_sec | is_logic);
+        bits |= bad & bit;
+    }
+    uint64_t word = 0;
+    for (int l = 0; l < FP_VLANES; l++){ word |= bits[l]; }
+    return word;
+}
+
+// n is a multiple of FP_VLANES, returns the first invalid row or n
+FP_SIMD_CLONES
+static size_t validate_simd(const int64_t *in, size_t n, uint64_t *err_mask){
+    size_t first = n;
+    for (size_t i = 0; i < n; i += 64){
+        size_t m = (n - i < 64) ? n - i : 64;
+        uint64_t word = (m == 64) ? validate_word_sec(in + i, 64) : validate_word_sec(in + i, m);
+        if (word){ word = validate_word(in + i, m); }
+        if (word && first == n){ first = i + __builtin_ctzll(word); }
+        if (err_mask){
+            err_mask[i / 64] |= word;
+        } else if (word){
+            break;
+        }
+    }
+    return first;
+}
+
+static inline __attribute__((always_inline)) int64_t iso_load(const char *p){
+    int64_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+// decimal value of the digits str[k .. k+n) of all lanes
+static inline __attribute__((always_inline)) fp_vi64 iso_v_num(const fp_vi64 *w, int k, int n){
+    fp_vi64 value = {0};
+    for (; n > 0; k++, n--){
+        value = value * 10 + ((w[k / 8] >> (8 * (k % 8))) & 0xF);
+    }
+    return value;
+}
+
+// One row per lane, each row read as up to five 8 byte words. Rows that miss the
+// layout or a field range (leap seconds included) are redone by the scalar parser.
+FP_SIMD_CLONES
+static size_t iso_simd(const char *base, const size_t *offsets, size_t stride, size_t n, size_t end,
+                       const IsoLayout *lay, int64_t *out, uint64_t *err_mask){
+    char pad[FP_VLANES][ISO_WORDS * 8];
+    size_t n_err = 0;
+    for (size_t i = 0; i + FP_VLANES <= n; i += FP_VLANES){
+        const char *row[FP_VLANES], *src[FP_VLANES];
+        size_t len[FP_VLANES];
+        fp_vi64 bad = {0};
+        for (int l = 0; l < FP_VLANES; l++){
+            iso_row(base, offsets, stride, i + l, &row[l], &len[l]);
+            bad[l] = (len[l] != lay->len);
+            src[l] = row[l];
+            if ((size_t)(row[l] - base) + lay->n_words * 8 > end){   // keep the loads inside the buffer
+                memset(pad[l], 0, sizeof(pad[l]));
+                memcpy(pad[l], row[l], len[l] < sizeof(pad[l]) ? len[l] : sizeof(pad[l]));
+                src[l] = pad[l];
+            }
+        }
+
+        // separators and digits
+        const int64_t hi_nibbles = 0xF0F0F0F0F0F0F0F0;
+        fp_vi64 w[ISO_WORDS];
+        for (int k = 0; k < lay->n_words; k++){
+            w[k] = (fp_vi64){iso_load(src[0] + 8*k), iso_load(src[1] + 8*k),
+                             iso_load(src[2] + 8*k), iso_load(src[3] + 8*k)};
+            fp_vi64 x = w[k] & lay->digits[k];
+            int64_t zeros = lay->expect[k] & lay->digits[k];   // 0x30 per digit
+            bad |= (w[k] ^ lay->expect[k]) & lay->literal[k];
+            bad |= ((x & hi_nibbles) ^ zeros) | (((x + (lay->digits[k] & 0x0606060606060606)) & hi_nibbles) ^ zeros);
+        }
+
+        fp_vi64 year = iso_v_num(w, 0, 4);
+        fp_vi64 month = iso_v_num(w, 5, 2);
+        fp_vi64 day = iso_v_num(w, 8, 2);
+        fp_vi64 hour = iso_v_num(w, 11, 2);
+        fp_vi64 minute = iso_v_num(w, 14, 2);
+        fp_vi64 second = iso_v_num(w, 17, 2);
+        bad |= (month < 1) | (month > 12) | (day < 1) | (day > 31) | (hour > 23) | (minute > 59) | (second > 59);
+
+        fp_vi64 offset = {0};
+        if (lay->tz_pos){
+            int k = lay->tz_pos;
+            fp_vi64 sign = (w[k / 8] >> (8 * (k % 8))) & 0xFF;
+            offset = iso_v_num(w, k + 1, 2) * 60 + iso_v_num(w, k + 4, 2);
+            offset = FP_VSEL(sign == '-', -offset, offset);
+            bad |= ((sign != '+') & (sign != '-')) | (offset < -1020) | (offset > 1020);
+        }
+
+        // FP_days_from_civil() for years 0..9999, shifted by one era so that all
+        // divisions work on positive numbers: y/100 = y*5243 >> 19, x/5 = x*52429 >> 18
+        fp_vi64 early = (month <= 2);
+        fp_vi64 y = year + 400 + early;
+        fp_vi64 mp = month - 3 + (early & 12);
+        fp_vi64 c = (y * 5243) >> 19;
+        fp_vi64 days = y * 365 + (y >> 2) - c + (c >> 2) + (((mp * 153 + 2) * 52429) >> 18) + day - 1 - 865565;
+        fp_vi64 seconds = days * 86400 + hour * 3600 + minute * 60 + second - offset * 60;
+
+        fp_vi64 frac = {0};
+        if (lay->frac_digits){
+            frac = fp_v_ns2frac(iso_v_num(w, 20, lay->frac_digits) * lay->frac_scale);
+        }
+        EncodeCfg cfg = lay->cfg;
+        fp_vi64 low = (((frac >> cfg.rshift) << (cfg.rshift + 1)) & cfg.keep_frac) | cfg.suffix;
+        if (lay->tz_shift){
+            low += offset << lay->tz_shift;   // tz code is offset + 1024
+        }
+        fp_vi64 value = (seconds << 24) + low;   // a rounded up fraction carries
+        FP_VSTORE(out + i, value);
+
+        bad = (bad != 0);
+        if (bad[0] | bad[1] | bad[2] | bad[3]){
+            for (int l = 0; l < FP_VLANES; l++){
+                if (bad[l] && iso_one(row[l], len[l], out + i + l) != SUCCESS){
+                    iso_set_err(err_mask, i + l);
+                    n_err++;
+                }
+            }
+        }
+    }
+    return n_err;
+}
+
+
+// Functions
+// ============================================================================
+
+size_t FP_from_fp_batch(const int64_t *in, size_t n, FP_BatchOut *out){
+    if (use_simd && fp_simd_available()){
+        return decode_simd(in, n, out);
+    }
+    return decode_scalar(in, n, out);
+}
+
+ErrNo FP_validate_batch(const int64_t *in, size_t n, uint64_t *err_mask, size_t *first){
+    if (err_mask){ memset(err_mask, 0, (n + 63) / 64 * sizeof(uint64_t)); }
+    size_t i = 0, bad = n;
+    if (use_simd && fp_simd_available()){   // SIMD for full vectors, scalar for the tail
+        i = n - n % FP_VLANES;
+        bad = validate_simd(in, i, err_mask);
+        if (bad == i){ bad = n; }
+    }
+    if (bad == n || err_mask){
+        size_t tail = validate_scalar(in, i, n, err_mask);
+        bad = (bad < n) ? bad : tail;
+    }
+    if (first){ *first = bad; }
+    return (bad < n) ? validate_one(in[bad]) : SUCCESS;
+}
+
+size_t FP_from_unix_batch(const int64_t *in, size_t n, Precision prc, int16_t tz_offset,
+                          int64_t *out, int16_t *err){
+    EncodeCfg cfg;
+    ErrNo error = encode_cfg(prc, tz_offset, &cfg);
+    if (error){ return fail_all(n, error, out, err); }
+    size_t i = 0, n_err = 0;
+    if (use_simd && fp_simd_available()){   // SIMD for full vectors, scalar for the tail
+        i = n - n % FP_VLANES;
+        n_err = encode_unix_simd(in, i, cfg, out, err);
+    }
+    return n_err + encode_unix_scalar(in + i, n - i, prc, tz_offset, out + i, err ? err + i : NULL);
+}
+
+size_t FP_from_java_batch(const int64_t *in, size_t n, Precision prc, int16_t tz_offset,
+                          int64_t *out, int16_t *err){
+    EncodeCfg cfg;
+    ErrNo error = encode_cfg(prc, tz_offset, &cfg);
+    if (error){ return fail_all(n, error, out, err); }
+    size_t i = 0, n_err = 0;
+    if (use_simd && fp_simd_available()){   // SIMD for full vectors, scalar for the tail
+        i = n - n % FP_VLANES;
+        n_err = encode_java_simd(in, i, cfg, out, err);
+    }
+    return n_err + encode_java_scalar(in + i, n - i, prc, tz_offset, out + i, err ? err + i : NULL);
+}
+
+size_t FP_from_timespec_batch(const struct timespec *in, size_t n, Precision prc, int16_t tz_offset,
+                              int64_t *out, int16_t *err){
+    EncodeCfg cfg;
+    ErrNo error = encode_cfg(prc, tz_offset, &cfg);
+    if (error){ return fail_all(n, error, out, err); }
+    size_t i = 0, n_err = 0;
+    if (use_simd && fp_simd_available()){   // SIMD for full vectors, scalar for the tail
+        i = n - n % FP_VLANES;
+        n_err = encode_timespec_simd(in, i, cfg, out, err);
+    }
+    return n_err + encode_timespec_scalar(in + i, n - i, prc, tz_offset, out + i, err ? err + i : NULL);
+}
+
+size_t FP_from_iso_batch(const char *base, const size_t *offsets, size_t stride, size_t n,
+                         int64_t *out, uint64_t *err_mask){
+    if (err_mask){ memset(err_mask, 0, (n + 63) / 64 * sizeof(uint64_t)); }
+    size_t i = 0, n_err = 0;
+    IsoLayout lay;
+    if (use_simd && fp_simd_available() && iso_find_layout(base, offsets, stride, n, &lay)){
+        size_t end = offsets ? offsets[n] : n * stride;
+        i = n - n % FP_VLANES;
+        n_err = iso_simd(base, offsets, stride, i, end, &lay, out, err_mask);
+    }
+    return n_err + iso_scalar(base, offsets, stride, i, n, out, err_mask);
+}
+
+// Columns
+// ----------------------------------------------------------------------------
+
+static inline FPFormat column_fmt(uint16_t info){
+    return (info >> FP_COL_FMT_SHIFT) & 0x7;
+}
+
+// decode n values into the rows of col starting at row
+static size_t column_fill(FP_Column *col, size_t row, const int64_t *in, size_t n){
+    enum { CHUNK = 256 };
+    int8_t precision[CHUNK];
+    bool is_leapsecond[CHUNK];
+    uint8_t fmt[CHUNK];
+    int16_t dec_err[CHUNK];
+    size_t n_err = 0;
+
+    for (size_t i = 0; i < n; i += CHUNK){
+        size_t m = (n - i < CHUNK) ? n - i : CHUNK;
+        size_t r = row + i;
+        FP_BatchOut cols = {col->seconds + r, col->ns + r, precision, col->tz_offset + r, is_leapsecond,
+                            fmt, dec_err};
+        n_err += FP_from_fp_batch(in + i, m, &cols);
+        for (size_t j = 0; j < m; j++){
+            uint16_t info = (uint8_t)precision[j] | fmt[j] << FP_COL_FMT_SHIFT |
+                            (is_leapsecond[j] ? FP_COL_LEAPSECOND : 0);
+            if (dec_err[j] != SUCCESS){
+                info |= FP_COL_INVALID;
+                col->ns[r + j] = (uint32_t)(int32_t)dec_err[j];
+            } else if (fmt[j] == FMT_ABS_YEAR){
+                col->ns[r + j] = (uint32_t)(in[i + j] >> 24);   // float bits, see FP_from_fp()
+            }
+            col->info[r + j] = info;
+        }
+    }
+    return n_err;
+}
+
+// FP_Components of row i like decode_one()
+static inline ErrNo column_row(const FP_Column *col, size_t i, FP_Components *fpc){
+    uint16_t info = col->info[i];
+    *fpc = FP_new();
+    if (info & FP_COL_INVALID){
+        return (int32_t)col->ns[i];
+    }
+    fpc->fmt = column_fmt(info);
+    fpc->precision = (int8_t)(info & FP_COL_PRECISION);
+    fpc->is_leapsecond = (info & FP_COL_LEAPSECOND) != 0;
+    fpc->seconds = col->seconds[i];
+    fpc->tz_offset = col->tz_offset[i];
+    if (fpc->fmt == FMT_ABS_YEAR){
+        uint32_t bits = col->ns[i];
+        memcpy(&fpc->year, &bits, sizeof(bits));
+    } else {
+        fpc->ns = col->ns[i];
+    }
+    return SUCCESS;
+}
+
+// Format one row at out with avail bytes left, see FP_to_iso_batch(). Returns the
+// bytes the row takes (width for fixed records) or -1 if the arena is full.
+static inline __attribute__((always_inline))
+int64_t iso_put_row(FP_IsoCache *cache, const FP_Components *fpc, ErrNo *error, char *out, size_t avail,
+                    bool with_offsets, size_t width){
+    if (!with_offsets && avail < width){ return -1; }
+
+    // write in place while a full string fits, the NUL lands in the next row
+    int len = 0;
+    if (*error == SUCCESS && avail >= FP_ISO_MAX_LEN){
+        len = FP_format_iso_cached(cache, fpc, out, avail);
+    } else if (*error == SUCCESS){
+        char tmp[FP_ISO_MAX_LEN];
+        len = FP_format_iso_cached(cache, fpc, tmp, sizeof(tmp));
+        if (len > 0 && (size_t)len > avail){
+            if (with_offsets){ return -1; }
+            len = ERR_OUT_OF_RANGE;
+        } else if (len > 0){
+            memcpy(out, tmp, len);
+        }
+    }
+    if (len < 0){
+        *error = len;
+        len = 0;
+    }
+    if (with_offsets){ return len; }
+    if ((size_t)len > width){
+        *error = ERR_OUT_OF_RANGE;
+        len = 0;
+    }
+    memset(out + len, ' ', width - len);
+    return width;
+}
+
+size_t FP_to_iso_batch(const int64_t *in, size_t n, char *arena, size_t size,
+                       size_t *offsets, size_t width, int16_t *err){
+    enum { CHUNK = 256 };   // decoded columns stay on the stack
+    int64_t seconds[CHUNK];
+    uint32_t ns[CHUNK];
+    int8_t precision[CHUNK];
+    int16_t tz_offset[CHUNK], dec_err[CHUNK];
+    bool is_leapsecond[CHUNK];
+    uint8_t fmt[CHUNK];
+    FP_BatchOut cols = {seconds, ns, precision, tz_offset, is_leapsecond, fmt, dec_err};
+    FP_IsoCache cache;
+    FP_iso_cache_init(&cache);
+    size_t pos = 0;
+    if (offsets){ offsets[0] = 0; }
+
+    for (size_t i = 0; i < n; i += CHUNK){
+        size_t m = (n - i < CHUNK) ? n - i : CHUNK;
+        FP_from_fp_batch(in + i, m, &cols);
+        for (size_t j = 0; j < m; j++){
+            FP_Components fpc = FP_new();
+            ErrNo error = dec_err[j];
+            if (error == SUCCESS && fmt[j] == FMT_ABS_YEAR){   // float year is not a column
+                error = decode_one(in[i + j], &fpc);
+            } else if (error == SUCCESS){
+                fpc.seconds = seconds[j];
+                fpc.ns = ns[j];
+                fpc.precision = precision[j];
+                fpc.tz_offset = tz_offset[j];
+                fpc.is_leapsecond = is_leapsecond[j];
+                fpc.fmt = fmt[j];
+            }
+            int64_t used = iso_put_row(&cache, &fpc, &error, arena + pos, size - pos, offsets != NULL, width);
+            if (used < 0){ return i + j; }
+            if (err){ err[i + j] = error; }
+            pos += used;
+            if (offsets){ offsets[i + j + 1] = pos; }
+        }
+    }
+    return n;
+}
+
+// unit of the integer outputs
+typedef enum { OUT_UNIX, OUT_JAVA, OUT_NS } IntOutput;
+
+static inline ErrNo int_value(int64_t seconds, uint32_t ns, ErrNo error, IntOutput unit, int64_t *out){
+    int64_t value = seconds;
+    if (unit == OUT_JAVA){
+        value = seconds * 1000 + ns / 1000000;
+    } else if (unit == OUT_NS && !error &&
+               (__builtin_mul_overflow(seconds, (int64_t)1000000000, &value) ||
+                __builtin_add_overflow(value, (int64_t)ns, &value))){
+        error = ERR_OUT_OF_RANGE;
+    }
+    *out = error ? INT64_MIN : value;
+    return error;
+}
+
+static size_t to_int_batch(const int64_t *in, size_t n, IntOutput unit, int64_t *out, int16_t *err){
+    enum { CHUNK = 256 };
+    int64_t seconds[CHUNK];
+    uint32_t ns[CHUNK];
+    int16_t dec_err[CHUNK];
+    FP_BatchOut cols = {.seconds = seconds, .ns = ns, .err = dec_err};
+    size_t n_err = 0;
+
+    for (size_t i = 0; i < n; i += CHUNK){
+        size_t m = (n - i < CHUNK) ? n - i : CHUNK;
+        FP_from_fp_batch(in + i, m, &cols);
+        for (size_t j = 0; j < m; j++){
+            ErrNo error = int_value(seconds[j], ns[j], dec_err[j], unit, &out[i + j]);
+            if (err){ err[i + j] = error; }
+            n_err += (error != SUCCESS);
+        }
+    }
+    return n_err;
+}
+
+// float years give the FP_new() ns like the batch decoder
+static size_t column_to_int(const FP_Column *col, IntOutput unit, int64_t *out, int16_t *err){
+    size_t n_err = 0;
+    for (size_t i = 0; i < col->n; i++){
+        uint16_t info = col->info[i];
+        ErrNo error = (info & FP_COL_INVALID) ? (int32_t)col->ns[i] : SUCCESS;
+        uint32_t ns = (column_fmt(info) == FMT_ABS_YEAR) ? UINT32_MAX : col->ns[i];
+        error = int_value(col->seconds[i], ns, error, unit, &out[i]);
+        if (err){ err[i] = error; }
+        n_err += (error != SUCCESS);
+    }
+    return n_err;
+}
+
+size_t FP_to_unix_batch(const int64_t *in, size_t n, int64_t *out, int16_t *err){
+    return to_int_batch(in, n, OUT_UNIX, out, err);
+}
+
+size_t FP_to_java_batch(const int64_t *in, size_t n, int64_t *out, int16_t *err){
+    return to_int_batch(in, n, OUT_JAVA, out, err);
+}
+
+size_t FP_to_ns_batch(const int64_t *in, size_t n, int64_t *out, int16_t *err){
+    return to_int_batch(in, n, OUT_NS, out, err);
+}
+
+size_t FP_to_iso_lines(const int64_t *in, size_t n, char *out, int16_t *err){
+    enum { CHUNK = 256 };
+    char arena[CHUNK * FP_ISO_MAX_LEN];
+    size_t offsets[CHUNK + 1];
+    char *p = out;
+
+    for (size_t i = 0; i < n; i += CHUNK){
+        size_t m = (n - i < CHUNK) ? n - i : CHUNK;
+        FP_to_iso_batch(in + i, m, arena, sizeof(arena), offsets, 0, err ? err + i : NULL);
+        for (size_t j = 0; j < m; j++){
+            size_t len = offsets[j + 1] - offsets[j];
+            memcpy(p, arena + offsets[j], len);
+            p[len] = '\n';
+            p += len + 1;
+        }
+    }
+    return p - out;
+}
+
+
+// Columns
+// ----------------------------------------------------------------------------
+
+FP_Column *FP_column_new(size_t capacity){
+    FP_Column *col = calloc(1, sizeof(FP_Column));
+    if (!col){ return NULL; }
+    size_t rows = capacity ? capacity : 1;
+    col->capacity = capacity;
+    col->seconds = malloc(rows * sizeof(int64_t));
+    col->ns = malloc(rows * sizeof(uint32_t));
+    col->tz_offset = malloc(rows * sizeof(int16_t));
+    col->info = malloc(rows * sizeof(uint16_t));
+    if (!col->seconds || !col->ns || !col->tz_offset || !col->info){
+        FP_column_free(col);
+        return NULL;
+    }
+    return col;
+}
+
+FP_Column *FP_column_from_fp(const int64_t *in, size_t n){
+    FP_Column *col = FP_column_new(n);
+    if (col){ FP_column_decode(col, in, n); }
+    return col;
+}
+
+void FP_column_free(FP_Column *col){
+    if (!col){ return; }
+    free(col->seconds);
+    free(col->ns);
+    free(col->tz_offset);
+    free(col->info);
+    free(col);
+}
+
+size_t FP_column_decode(FP_Column *col, const int64_t *in, size_t n){
+    col->n = (n < col->capacity) ? n : col->capacity;
+    return column_fill(col, 0, in, col->n);
+}
+
+ErrNo FP_column_get(const FP_Column *col, size_t i, FP_Components *out){
+    return column_row(col, i, out);
+}
+
+size_t FP_column_to_unix(const FP_Column *col, int64_t *out, int16_t *err){
+    return column_to_int(col, OUT_UNIX, out, err);
+}
+
+size_t FP_column_to_java(const FP_Column *col, int64_t *out, int16_t *err){
+    return column_to_int(col, OUT_JAVA, out, err);
+}
+
+size_t FP_column_to_ns(const FP_Column *col, int64_t *out, int16_t *err){
+    return column_to_int(col, OUT_NS, out, err);
+}
+
+size_t FP_column_to_iso(const FP_Column *col, char *arena, size_t size, size_t *offsets, size_t width,
+                        int16_t *err){
+    FP_IsoCache cache;
+    FP_iso_cache_init(&cache);
+    size_t pos = 0;
+    if (offsets){ offsets[0] = 0; }
+
+    for (size_t i = 0; i < col->n; i++){
+        FP_Components fpc;
+        ErrNo error = column_row(col, i, &fpc);
+        int64_t used = iso_put_row(&cache, &fpc, &error, arena + pos, size - pos, offsets != NULL, width);
+        if (used < 0){ return i; }
+        if (err){ err[i] = error; }
+        pos += used;
+        if (offsets){ offsets[i + 1] = pos; }
+    }
+    return col->n;
+}
+
+
+// Helper functions
+// ----------------------------------------------------------------------------
+
+void FP_batch_set_simd(bool enabled){
+    use_simd = enabled;
+}
+
+const char *FP_batch_simd_name(void){
+    return use_simd ? fp_simd_name() : "scalar";
+}
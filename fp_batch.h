@@ -0,0 +1,154 @@
+#ifndef _FP_BATCH_H
+#define _FP_BATCH_H
+
+#include "flexpoch.h"
+
+
+// types
+// ============================================================================
+
+// Column outputs of the batch decoder. Any pointer may be NULL to skip the column.
+// Valid rows hold what FP_from_fp() writes into an FP_new() struct, invalid rows
+// keep the FP_new() defaults and only report their ErrNo in err.
+typedef struct {
+    int64_t  *seconds;
+    uint32_t *ns;
+    int8_t   *precision;
+    int16_t  *tz_offset;
+    bool     *is_leapsecond;
+    uint8_t  *fmt;       // FPFormat
+    int16_t  *err;       // ErrNo
+} FP_BatchOut;
+
+// info bits of an FP_Column row
+#define FP_COL_PRECISION  0x00FF   // Precision as int8_t
+#define FP_COL_FMT_SHIFT  8        // FPFormat, 3 bits
+#define FP_COL_LEAPSECOND 0x0800
+#define FP_COL_INVALID    0x8000
+
+// Decoded flexpochs as structure of arrays, 16 bytes per row instead of the 56 of
+// an FP_Components. Invalid rows keep the FP_new() defaults and their ErrNo in ns,
+// float years (FMT_ABS_YEAR) keep the float bits of the year in ns. The raw value
+// is not kept.
+typedef struct {
+    size_t n;
+    size_t capacity;
+    int64_t  *seconds;
+    uint32_t *ns;
+    int16_t  *tz_offset;   // minutes
+    uint16_t *info;        // FP_COL_* bits
+} FP_Column;
+
+
+
+// Functions
+// ============================================================================
+
+// Decode n flexpoch numbers into columns. Returns the number of invalid values.
+// Unlike FP_from_fp() this never prints (e.g. for CP_REL_FRAC).
+size_t FP_from_fp_batch(const int64_t *in, size_t n, FP_BatchOut *out);
+
+// Check n flexpochs without decoding them, e.g. before storing untrusted data:
+// the ErrNo of FP_from_fp() (codepoints, float year range and zero tail,
+// precision) plus ERR_INVALID_OFFSET for tz offsets that FP_to_fp() never writes
+// (beyond +-1020 minutes, the leap second marker excepted). Never prints.
+// Invalid values set bit i%64 of err_mask[i/64]; without err_mask (NULL) the
+// check stops at the first invalid value. first (may be NULL) gets its index, n
+// if all values are valid. Returns its ErrNo, SUCCESS if there is none.
+ErrNo FP_validate_batch(const int64_t *in, size_t n, uint64_t *err_mask, size_t *first);
+
+
+// Encode n unix seconds / java millis / timespecs with one common precision and
+// tz offset (minutes). Rows outside the encodable range become CP_UNDEFINED_FP with
+// ERR_OUT_OF_RANGE in err (may be NULL). Returns the number of failed rows; an
+// invalid precision (> PRC_MILLENNIUM included) or offset fails every row.
+// Negative java millis are floored, e.g. -1 ms is -1 s + 999 ms.
+size_t FP_from_unix_batch(const int64_t *in, size_t n, Precision prc, int16_t tz_offset,
+                          int64_t *out, int16_t *err);
+
+size_t FP_from_java_batch(const int64_t *in, size_t n, Precision prc, int16_t tz_offset,
+                          int64_t *out, int16_t *err);
+
+size_t FP_from_timespec_batch(const struct timespec *in, size_t n, Precision prc, int16_t tz_offset,
+                              int64_t *out, int16_t *err);
+
+
+// Parse n ISO 8601 strings into flexpochs, same result as FP_from_iso() + FP_to_fp().
+// Row i is base[offsets[i] .. offsets[i+1]) (n+1 ascending offsets) or, if offsets
+// is NULL, the stride bytes at base + i*stride. Trailing NUL, CR, LF and blanks are
+// ignored, anything else left unparsed fails the row.
+// Rows in the layout of the first valid row ("YYYY-MM-DDTHH:MM:SS" + optional 3/6/9
+// digit fraction + optional "Z" or "+HH:MM") take the SIMD path, all others the
+// scalar parser. Failed rows become CP_UNDEFINED_FP and set bit i%64 of
+// err_mask[i/64] (may be NULL). Returns the number of failed rows.
+size_t FP_from_iso_batch(const char *base, const size_t *offsets, size_t stride, size_t n,
+                         int64_t *out, uint64_t *err_mask);
+
+
+// Format n flexpochs as ISO strings (FP_from_fp() + FP_to_iso()) back to back into
+// one arena of size bytes without NULs. With offsets (n+1 entries) row i ends up in
+// arena[offsets[i] .. offsets[i+1]), otherwise in width byte records padded with
+// blanks. Invalid rows (or rows longer than width) stay empty and report their
+// ErrNo in err (may be NULL). Returns the number of rows written, less than n if
+// the arena is full.
+size_t FP_to_iso_batch(const int64_t *in, size_t n, char *arena, size_t size,
+                       size_t *offsets, size_t width, int16_t *err);
+
+
+// FP_from_fp() + FP_to_unix() / FP_to_java() for n values. Failed rows become
+// INT64_MIN and report their ErrNo in err (may be NULL). Returns the number of
+// failed rows.
+size_t FP_to_unix_batch(const int64_t *in, size_t n, int64_t *out, int16_t *err);
+
+size_t FP_to_java_batch(const int64_t *in, size_t n, int64_t *out, int16_t *err);
+
+// nanoseconds since epoch, ERR_OUT_OF_RANGE outside of 1677..2262
+size_t FP_to_ns_batch(const int64_t *in, size_t n, int64_t *out, int16_t *err);
+
+// FP_to_iso_batch() as text: every row ends with a newline, failed rows are empty.
+// out needs n * FP_ISO_MAX_LEN bytes. Returns the number of bytes written.
+size_t FP_to_iso_lines(const int64_t *in, size_t n, char *out, int16_t *err);
+
+
+// Columns
+// ----------------------------------------------------------------------------
+
+// empty column for up to capacity rows, NULL if out of memory
+FP_Column *FP_column_new(size_t capacity);
+
+// FP_column_new(n) + FP_column_decode(), NULL if out of memory
+FP_Column *FP_column_from_fp(const int64_t *in, size_t n);
+
+void FP_column_free(FP_Column *col);
+
+// Replace the rows with n decoded flexpochs (at most capacity, the rest is
+// dropped). Returns the number of invalid rows.
+size_t FP_column_decode(FP_Column *col, const int64_t *in, size_t n);
+
+// row i as FP_from_fp() gives it (without rawdata), returns the ErrNo of the row
+ErrNo FP_column_get(const FP_Column *col, size_t i, FP_Components *out);
+
+// FP_to_unix_batch() / FP_to_java_batch() / FP_to_ns_batch() / FP_to_iso_batch()
+// on the decoded rows, same results as on the flexpochs they came from
+size_t FP_column_to_unix(const FP_Column *col, int64_t *out, int16_t *err);
+
+size_t FP_column_to_java(const FP_Column *col, int64_t *out, int16_t *err);
+
+size_t FP_column_to_ns(const FP_Column *col, int64_t *out, int16_t *err);
+
+size_t FP_column_to_iso(const FP_Column *col, char *arena, size_t size, size_t *offsets, size_t width,
+                        int16_t *err);
+
+
+// Helper functions
+// ----------------------------------------------------------------------------
+
+// Enable/disable the SIMD kernels (enabled by default). The scalar path gives
+// bit-identical results and is mainly useful for testing and benchmarking.
+void FP_batch_set_simd(bool enabled);
+
+// name of the instruction set the batch kernels currently run on
+const char *FP_batch_simd_name(void);
+
+
+#endif // _FP_BATCH_H
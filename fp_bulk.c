@@ -0,0 +1,266 @@
+#include "fp_bulk.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BULK_CHUNK_DEFAULT (1 << 20)  // input bytes per work item
+#define BULK_ROWS 512                 // rows per decode call, columns stay on the stack
+
+typedef struct {
+    const int64_t *in;
+    size_t n;
+    size_t chunk_rows;
+    size_t n_chunks;
+    FP_BulkOutput output;
+    bool big_endian;
+    int64_t *out;            // mapped output for the binary formats
+    int fd;                  // output file for ISO
+    size_t next_chunk;       // atomic work counter
+    size_t n_failed;         // atomic
+    pthread_mutex_t lock;    // ISO chunks are appended in input order
+    pthread_cond_t turn;
+    size_t next_write;
+    size_t written;          // ISO bytes, only touched by the chunk holding the turn
+    int write_errno;
+} BulkJob;
+
+typedef struct {
+    BulkJob *job;
+    char *text;              // ISO output of one chunk
+} BulkWorker;
+
+
+// Conversion of one block
+// ----------------------------------------------------------------------------
+
+// plain loop, gcc turns it into byte shuffles
+static void bulk_swap(const int64_t *in, size_t n, int64_t *out){
+    for (size_t i = 0; i < n; i++){
+        out[i] = (int64_t)__builtin_bswap64((uint64_t)in[i]);
+    }
+}
+
+// same values as FP_from_fp() + FP_to_unix() / FP_to_java()
+static size_t bulk_binary(const int64_t *in, size_t n, FP_BulkOutput output, int64_t *out){
+    switch (output){
+        case BULK_UNIX: return FP_to_unix_batch(in, n, out, NULL);
+        case BULK_JAVA: return FP_to_java_batch(in, n, out, NULL);
+        default:        return FP_to_ns_batch(in, n, out, NULL);
+    }
+}
+
+// ISO lines appended to text + *pos
+static size_t bulk_iso(const int64_t *in, size_t n, char *text, size_t *pos){
+    int16_t err[BULK_ROWS];
+    size_t n_failed = 0;
+    *pos += FP_to_iso_lines(in, n, text + *pos, err);
+    for (size_t i = 0; i < n; i++){
+        n_failed += (err[i] != SUCCESS);
+    }
+    return n_failed;
+}
+
+
+// Workers
+// ----------------------------------------------------------------------------
+
+static int write_all(int fd, const char *buf, size_t len){
+    while (len){
+        ssize_t w = write(fd, buf, len);
+        if (w < 0 && errno == EINTR){ continue; }
+        if (w <= 0){ return -1; }
+        buf += w;
+        len -= w;
+    }
+    return 0;
+}
+
+static void bulk_write_ordered(BulkJob *job, size_t chunk, const char *text, size_t len){
+    pthread_mutex_lock(&job->lock);
+    while (job->next_write != chunk){
+        pthread_cond_wait(&job->turn, &job->lock);
+    }
+    pthread_mutex_unlock(&job->lock);
+
+    if (!job->write_errno && write_all(job->fd, text, len) != 0){
+        job->write_errno = errno ? errno : EIO;
+    }
+    job->written += len;
+
+    pthread_mutex_lock(&job->lock);
+    job->next_write++;
+    pthread_cond_broadcast(&job->turn);
+    pthread_mutex_unlock(&job->lock);
+}
+
+static void *bulk_worker(void *arg){
+    BulkWorker *worker = arg;
+    BulkJob *job = worker->job;
+    int64_t swapped[BULK_ROWS];
+
+    for (;;){
+        size_t chunk = __atomic_fetch_add(&job->next_chunk, 1, __ATOMIC_RELAXED);
+        if (chunk >= job->n_chunks){ break; }
+        size_t from = chunk * job->chunk_rows;
+        size_t to = (job->n - from < job->chunk_rows) ? job->n : from + job->chunk_rows;
+        size_t n_failed = 0;
+        size_t text_len = 0;
+
+        for (size_t i = from; i < to; i += BULK_ROWS){
+            size_t m = (to - i < BULK_ROWS) ? to - i : BULK_ROWS;
+            const int64_t *src = job->in + i;
+            if (job->big_endian){
+                bulk_swap(src, m, swapped);
+                src = swapped;
+            }
+            if (job->output == BULK_ISO){
+                n_failed += bulk_iso(src, m, worker->text, &text_len);
+            } else {
+                n_failed += bulk_binary(src, m, job->output, job->out + i);
+            }
+        }
+
+        // chunks start on a page boundary and are never read again
+        madvise((void *)(job->in + from), (to - from) * sizeof(int64_t), MADV_DONTNEED);
+        __atomic_fetch_add(&job->n_failed, n_failed, __ATOMIC_RELAXED);
+        if (job->output == BULK_ISO){
+            bulk_write_ordered(job, chunk, worker->text, text_len);
+        }
+    }
+    return NULL;
+}
+
+
+// Public functions
+// ----------------------------------------------------------------------------
+
+ErrNo FP_bulk_transcode(const char *in_path, const char *out_path, const FP_BulkOptions *opt,
+                        FP_BulkStats *stats){
+    FP_BulkStats local;
+    if (!stats){ stats = &local; }
+    *stats = (FP_BulkStats){0, 0, 0};
+
+    ErrNo error = ERR_IO;
+    int saved_errno = 0;
+    int in_fd = -1;
+    int out_fd = -1;
+    void *in_map = MAP_FAILED;
+    void *out_map = MAP_FAILED;
+    size_t size = 0;
+    BulkJob job = {0};
+    BulkWorker *workers = NULL;
+    pthread_t *tids = NULL;
+    int n_threads = 0;
+
+    in_fd = open(in_path, O_RDONLY);
+    if (in_fd < 0){ goto cleanup; }
+    struct stat st;
+    if (fstat(in_fd, &st) != 0){ goto cleanup; }
+    if (st.st_size % sizeof(int64_t)){
+        errno = EINVAL;
+        goto cleanup;
+    }
+    size = st.st_size;
+
+    // no O_TRUNC: ext4 flushes files truncated to zero on close, the final size is
+    // set below instead
+    out_fd = open(out_path, O_RDWR | O_CREAT, 0644);
+    if (out_fd < 0){ goto cleanup; }
+
+    job.n = size / sizeof(int64_t);
+    job.output = opt->output;
+    job.big_endian = opt->big_endian;
+    job.fd = out_fd;
+    stats->n_values = job.n;
+    if (job.n == 0){
+        if (ftruncate(out_fd, 0) == 0){ error = SUCCESS; }
+        goto cleanup;
+    }
+
+    in_map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, in_fd, 0);
+    if (in_map == MAP_FAILED){ goto cleanup; }
+    madvise(in_map, size, MADV_SEQUENTIAL);
+    job.in = in_map;
+
+    if (job.output != BULK_ISO){
+        if (ftruncate(out_fd, size) != 0){ goto cleanup; }
+        // reserve the blocks: a sparse file would raise SIGBUS on a full disk
+        int r = posix_fallocate(out_fd, 0, size);
+        if (r != 0){
+            errno = r;
+            goto cleanup;
+        }
+        out_map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, out_fd, 0);
+        if (out_map == MAP_FAILED){ goto cleanup; }
+        madvise(out_map, size, MADV_SEQUENTIAL);
+        job.out = out_map;
+    }
+
+    // page aligned work items
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t chunk_bytes = opt->chunk_bytes ? opt->chunk_bytes : BULK_CHUNK_DEFAULT;
+    chunk_bytes = (chunk_bytes + page - 1) / page * page;
+    job.chunk_rows = chunk_bytes / sizeof(int64_t);
+    job.n_chunks = (job.n + job.chunk_rows - 1) / job.chunk_rows;
+
+    n_threads = opt->threads > 0 ? opt->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_threads < 1){ n_threads = 1; }
+    if ((size_t)n_threads > job.n_chunks){ n_threads = job.n_chunks; }
+
+    workers = calloc(n_threads, sizeof(BulkWorker));
+    tids = calloc(n_threads, sizeof(pthread_t));
+    if (!workers || !tids){ goto cleanup; }
+    for (int t = 0; t < n_threads; t++){
+        workers[t].job = &job;
+        if (job.output == BULK_ISO){   // a row never exceeds FP_ISO_MAX_LEN incl. newline
+            workers[t].text = malloc(job.chunk_rows * FP_ISO_MAX_LEN);
+            if (!workers[t].text){ goto cleanup; }
+        }
+    }
+
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.turn, NULL);
+
+    // the calling thread is worker 0, failed spawns just leave fewer workers
+    int n_spawned = 1;
+    for (int t = 1; t < n_threads; t++){
+        if (pthread_create(&tids[n_spawned], NULL, bulk_worker, &workers[t]) != 0){ break; }
+        n_spawned++;
+    }
+    bulk_worker(&workers[0]);
+    for (int t = 1; t < n_spawned; t++){
+        pthread_join(tids[t], NULL);
+    }
+
+    pthread_cond_destroy(&job.turn);
+    pthread_mutex_destroy(&job.lock);
+
+    stats->n_failed = job.n_failed;
+    stats->threads = n_spawned;
+    if (job.write_errno){
+        errno = job.write_errno;
+    } else if (job.output != BULK_ISO || ftruncate(out_fd, job.written) == 0){
+        error = SUCCESS;
+    }
+
+cleanup:
+    saved_errno = errno;
+    if (workers){
+        for (int t = 0; t < n_threads; t++){ free(workers[t].text); }
+    }
+    free(workers);
+    free(tids);
+    if (out_map != MAP_FAILED){ munmap(out_map, size); }
+    if (in_map != MAP_FAILED){ munmap(in_map, size); }
+    if (out_fd >= 0 && close(out_fd) != 0 && error == SUCCESS){
+        saved_errno = errno;
+        error = ERR_IO;
+    }
+    if (in_fd >= 0){ close(in_fd); }
+    errno = saved_errno;
+    return error;
+}
@@ -0,0 +1,44 @@
+#ifndef _FP_BULK_H
+#define _FP_BULK_H
+
+#include "fp_batch.h"
+
+
+// types
+// ============================================================================
+
+typedef enum {
+    BULK_UNIX = 0,  // int64 seconds
+    BULK_JAVA = 1,  // int64 milliseconds
+    BULK_NS   = 2,  // int64 nanoseconds since epoch
+    BULK_ISO  = 3,  // text, one ISO string per line
+} FP_BulkOutput;
+
+typedef struct {
+    FP_BulkOutput output;
+    bool big_endian;     // byte order of the input file
+    int threads;         // worker threads, 0 = online CPUs
+    size_t chunk_bytes;  // input bytes per work item, rounded up to pages, 0 = default
+} FP_BulkOptions;
+
+typedef struct {
+    size_t n_values;
+    size_t n_failed;
+    int threads;         // workers actually used
+} FP_BulkStats;
+
+
+
+// Functions
+// ============================================================================
+
+// Convert a file of raw int64 flexpochs into out_path (created or truncated).
+// The input is mmapped and split into page aligned chunks that the worker threads
+// pull in order. Binary outputs are host order int64 columns with INT64_MIN for
+// failed rows, ISO output has an empty line for them. Returns ERR_IO (see errno)
+// if a file cannot be opened, mapped or written, stats may be NULL.
+ErrNo FP_bulk_transcode(const char *in_path, const char *out_path, const FP_BulkOptions *opt,
+                        FP_BulkStats *stats);
+
+
+#endif // _FP_BULK_H
@@ -0,0 +1,131 @@
+#include "fp_calendar.h"
+#include "fp_internal.h"
+#include "fp_direct.h"
+
+// local seconds [lo, hi) of a bucket
+typedef struct {
+    int64_t lo;
+    int64_t hi;
+} Bucket;
+
+// fixed length units, the constant divisors become multiplications
+static inline Bucket fixed_bucket(int64_t t, Precision prc, int64_t origin){
+    int64_t unit;
+    Bucket b;
+    switch (prc){
+        case PRC_MINUTE: unit = 60; b.lo = floor_div(t - origin, 60) * 60; break;
+        case PRC_HOUR:   unit = 3600; b.lo = floor_div(t - origin, 3600) * 3600; break;
+        case PRC_DAY:    unit = 86400; b.lo = floor_div(t - origin, 86400) * 86400; break;
+        default:         unit = 604800; b.lo = floor_div(t - origin, 604800) * 604800; break;
+    }
+    b.lo += origin;
+    b.hi = b.lo + unit;
+    return b;
+}
+
+static Bucket calendar_bucket(int64_t local, Precision prc){
+    if (prc <= PRC_WEEK){ return fixed_bucket(local, prc, (prc == PRC_WEEK) ? CAL_MONDAY : 0); }
+    int64_t year;
+    int month, day;
+    FP_civil_from_days(floor_div(local, 86400), &year, &month, &day);
+    int64_t unit = unit_months(prc);
+    int64_t first = floor_div(year * 12 + month - 1, unit) * unit;
+    return (Bucket){month_start(first), month_start(first + unit)};
+}
+
+static inline bool valid_target(Precision prc){
+    switch (prc){
+        case PRC_NANOSEC: case PRC_23BIT: case PRC_MICROSEC: case PRC_15BIT: case PRC_MILLISEC: return true;
+        default: return PRC_SECOND <= prc && prc <= PRC_MILLENNIUM;
+    }
+}
+
+// shared kernel, cache holds the last calendar bucket of absolute values
+static inline ErrNo calendar_one(int64_t flexpoch, Precision prc, bool round, Bucket *cache, int64_t *out){
+    DirectParts p;
+    *out = CP_UNDEFINED_FP;
+    ErrNo err = fp_direct_split(flexpoch, &p);
+    if (err){ return err; }
+    if (p.prc >= prc){
+        *out = flexpoch;
+        return SUCCESS;
+    }
+
+    if (prc < PRC_SECOND){
+        int64_t mask = fp_direct_frac_mask(prc);
+        if (round){
+            p.frac += (mask & -mask) >> 1;
+            p.seconds += p.frac >> 24;
+            p.tz_bin = (p.frac >> 24 && p.tz_bin == TZ_LEAP_BIN) ? TZ_BIN_OFFSET : p.tz_bin;
+        }
+        p.frac &= mask;
+    } else if (prc == PRC_SECOND){
+        bool up = round && p.frac >= 0x800000;
+        p.seconds += up;
+        p.tz_bin = (up && p.tz_bin == TZ_LEAP_BIN) ? TZ_BIN_OFFSET : p.tz_bin;
+    } else {
+        Bucket b;
+        int64_t offset = 0;
+        if (p.rel){
+            if (prc > PRC_WEEK){ return ERR_INCOMPATIBLE_OUTPUT; }
+            b = fixed_bucket(p.seconds, prc, 0);
+        } else {
+            offset = (p.tz_bin == TZ_LEAP_BIN) ? 0 : FP_tz_offset_from_bin(p.tz_bin) * 60;
+            int64_t local = p.seconds + offset;
+            if ((uint64_t)(local - cache->lo) >= (uint64_t)(cache->hi - cache->lo)){
+                *cache = calendar_bucket(local, prc);
+            }
+            b = *cache;
+        }
+        int64_t local = p.seconds + offset;
+        p.seconds = (round && 2 * (local - b.lo) >= b.hi - b.lo) ? b.hi : b.lo;
+        p.seconds -= offset;
+        p.tz_bin = (p.tz_bin == TZ_LEAP_BIN) ? TZ_BIN_OFFSET : p.tz_bin;
+    }
+    p.prc = prc;
+    return fp_direct_join(p, out);
+}
+
+static size_t calendar_batch(const int64_t *in, size_t n, Precision prc, bool round, int64_t *out, int16_t *err){
+    size_t n_err = 0;
+    Bucket cache = {0, 0};
+    if (!valid_target(prc)){
+        for (size_t i = 0; i < n; i++){
+            out[i] = CP_UNDEFINED_FP;
+            if (err){ err[i] = ERR_INVALID_PRECISION; }
+        }
+        return n;
+    }
+    for (size_t i = 0; i < n; i++){
+        ErrNo e = calendar_one(in[i], prc, round, &cache, &out[i]);
+        n_err += e != SUCCESS;
+        if (err){ err[i] = e; }
+    }
+    return n_err;
+}
+
+ErrNo FP_truncate(int64_t flexpoch, Precision prc, int64_t *out){
+    Bucket cache = {0, 0};
+    if (!valid_target(prc)){
+        *out = CP_UNDEFINED_FP;
+        return ERR_INVALID_PRECISION;
+    }
+    return calendar_one(flexpoch, prc, false, &cache, out);
+}
+
+ErrNo FP_round(int64_t flexpoch, Precision prc, int64_t *out){
+    Bucket cache = {0, 0};
+    if (!valid_target(prc)){
+        *out = CP_UNDEFINED_FP;
+        return ERR_INVALID_PRECISION;
+    }
+    return calendar_one(flexpoch, prc, true, &cache, out);
+}
+
+size_t FP_truncate_batch(const int64_t *in, size_t n, Precision prc, int64_t *out, int16_t *err){
+    return calendar_batch(in, n, prc, false, out, err);
+}
+
+size_t FP_round_batch(const int64_t *in, size_t n, Precision prc, int64_t *out, int16_t *err){
+    return calendar_batch(in, n, prc, true, out, err);
+}
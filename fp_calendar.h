@@ -0,0 +1,41 @@
+#ifndef _FP_CALENDAR_H
+#define _FP_CALENDAR_H
+
+#include "flexpoch.h"
+
+// Truncation and rounding of encoded flexpochs to a coarser precision, e.g. to
+// group by hour, week or month without decoding. Values are cut to the start of
+// their minute, hour, day, week (monday), month, quarter, trimester (4 months),
+// semester, year, decade, century or millennium, or their fraction to a coarser
+// sub-second precision (23 bit > microsec > 15 bit > millisec). Rounding takes
+// the nearer bucket start, halves round up. The result carries the new precision
+// bits and keeps the tz offset; calendar buckets follow the local time of that
+// offset (proleptic Gregorian calendar, decades start at years divisible by 10).
+// Leap seconds lose their flag at PRC_MINUTE and above.
+//
+// Values that already have the target precision or a coarser one are kept.
+// Relative seconds (CP_REL_SEC) are cut to whole minutes, hours, days or weeks,
+// coarser units fail with ERR_INCOMPATIBLE_OUTPUT like float years and logical
+// clocks. Invalid values fail with the ErrNo of FP_from_fp(), results outside the
+// encodable range with ERR_OUT_OF_RANGE. Failed values become CP_UNDEFINED_FP.
+
+
+
+// Functions
+// ============================================================================
+
+// Cut flexpoch to the start of its prc bucket. prc is PRC_NANOSEC, PRC_23BIT ...
+// PRC_MILLENNIUM, others give ERR_INVALID_PRECISION.
+ErrNo FP_truncate(int64_t flexpoch, Precision prc, int64_t *out);
+
+// round flexpoch to the nearest prc bucket start
+ErrNo FP_round(int64_t flexpoch, Precision prc, int64_t *out);
+
+// FP_truncate() / FP_round() on n values, in and out may be the same array. err
+// (may be NULL) gets the ErrNo of every value. Returns the number of failed values.
+size_t FP_truncate_batch(const int64_t *in, size_t n, Precision prc, int64_t *out, int16_t *err);
+
+size_t FP_round_batch(const int64_t *in, size_t n, Precision prc, int64_t *out, int16_t *err);
+
+
+#endif // _FP_CALENDAR_H
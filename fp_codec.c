@@ -0,0 +1,354 @@
+#include "fp_codec.h"
+#include "fp_simd.h"
+
+#define CODEC_DICT_MAX 16
+#define CODEC_SPLIT_SECONDS 24   // suffix bits of the default split
+#define CODEC_SPLIT_MIN 10       // keeps the zigzag delta-of-delta within 57 bits
+#define CODEC_DOD_MAX_BITS 57
+
+enum { SUFFIX_DICT, SUFFIX_XOR };
+
+typedef struct {
+    uint16_t n;
+    uint8_t dod_width;
+    uint8_t suffix_mode;
+    uint8_t suffix_width;
+    uint8_t suffix_shift;      // XOR: dropped trailing zero bits
+    uint8_t n_table;           // dictionary entries, 1 (the base) for XOR
+    uint8_t split;             // suffix bits, the rest is delta-of-delta coded
+    int64_t high;              // value >> split of the first value
+    int64_t delta;             // high of the second minus the first
+} BlockHeader;
+
+_Static_assert(sizeof(BlockHeader) == 24, "block header must not be padded");
+
+
+// Bit packing
+// ----------------------------------------------------------------------------
+// Value i of width w sits at bit i*w of a little endian bit stream, so one 64 bit
+// load at byte i*w/8 holds it for w <= 57. Packed areas end with 8 spare bytes
+// for that load.
+
+static inline size_t packed_bytes(size_t n, int width){
+    return (n * width + 63) / 64 * 8 + 8;
+}
+
+static inline uint64_t load64(const uint8_t *p){
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+// whole words are collected in a register, so no store waits for the one before
+static size_t pack(uint8_t *out, const uint64_t *values, size_t n, int width){
+    size_t bytes = packed_bytes(n, width);
+    memset(out, 0, bytes);
+    uint64_t word = 0;
+    int fill = 0;
+    uint8_t *p = out;
+    for (size_t i = 0; i < n && width; i++){
+        word |= values[i] << fill;
+        fill += width;
+        if (fill >= 64){
+            memcpy(p, &word, sizeof(word));
+            p += sizeof(word);
+            fill -= 64;
+            word = fill ? values[i] >> (width - fill) : 0;
+        }
+    }
+    memcpy(p, &word, sizeof(word));
+    return bytes;
+}
+
+static inline uint64_t unpack(const uint8_t *in, size_t i, int width, uint64_t mask){
+    size_t bit = i * width;
+    return (load64(in + bit / 8) >> (bit % 8)) & mask;
+}
+
+static inline int bit_width(uint64_t x){
+    return x ? 64 - __builtin_clzll(x) : 0;
+}
+
+static inline uint64_t zigzag(int64_t x){
+    return ((uint64_t)x << 1) ^ (uint64_t)(x >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t x){
+    return (int64_t)(x >> 1) ^ -(int64_t)(x & 1);
+}
+
+static inline size_t table_bytes(int n_table){
+    return (n_table * sizeof(uint32_t) + 7) / 8 * 8;
+}
+
+
+// Encoding
+// ----------------------------------------------------------------------------
+
+// zigzag delta-of-deltas of value >> split into codes, returns their bit width
+static int encode_dods(const int64_t *in, size_t n, int split, uint64_t *codes, int64_t *first_delta){
+    int64_t delta = (n > 1) ? (in[1] >> split) - (in[0] >> split) : 0;
+    uint64_t any = 0;
+    *first_delta = delta;
+    for (size_t i = 2; i < n; i++){
+        int64_t d = (in[i] >> split) - (in[i - 1] >> split);
+        codes[i - 2] = zigzag(d - delta);
+        any |= codes[i - 2];
+        delta = d;
+    }
+    return bit_width(any);
+}
+
+static size_t encode_block(const int64_t *in, size_t n, uint8_t *out){
+    uint64_t codes[FP_CODEC_BLOCK], alt_codes[FP_CODEC_BLOCK];
+    uint32_t table[CODEC_DICT_MAX];
+    BlockHeader h = {.n = n, .split = CODEC_SPLIT_SECONDS};
+
+    // suffixes: dictionary if it has room, else XOR with the first one
+    uint32_t base = in[0] & 0xFFFFFF;
+    uint32_t any_xor = 0;
+    int n_dict = 0;
+    uint32_t last = base;
+    for (size_t i = 0; i < n; i++){
+        uint32_t suffix = in[i] & 0xFFFFFF;
+        any_xor |= suffix ^ base;
+        if ((i && suffix == last) || n_dict > CODEC_DICT_MAX){ continue; }
+        last = suffix;
+        int k = 0;
+        while (k < n_dict && table[k] != suffix){ k++; }
+        if (k == n_dict){
+            if (n_dict < CODEC_DICT_MAX){ table[k] = suffix; }
+            n_dict++;
+        }
+    }
+    int shift = any_xor ? __builtin_ctz(any_xor) : 0;
+    int xor_width = bit_width(any_xor >> shift);
+    int dict_width = (n_dict <= CODEC_DICT_MAX) ? bit_width(n_dict - 1) : 64;
+    int suffix_width = (dict_width <= xor_width) ? dict_width : xor_width;
+
+    // seconds: delta-of-delta. If the suffixes change (the fraction of sub-second
+    // values), their upper bits may be cheaper as part of the delta-of-deltas of
+    // a lower split, with the bits below XORed or, if constant, in the table.
+    h.dod_width = encode_dods(in, n, CODEC_SPLIT_SECONDS, codes, &h.delta);
+    int low = any_xor ? __builtin_ctz(any_xor) : CODEC_SPLIT_SECONDS;
+    int split = (low > CODEC_SPLIT_MIN) ? low : CODEC_SPLIT_MIN;
+    size_t rest = (n > 2) ? n - 2 : 0;
+    if (split < CODEC_SPLIT_SECONDS){
+        uint32_t low_xor = any_xor & (((uint32_t)1 << split) - 1);
+        int low_width = low_xor ? bit_width(low_xor >> shift) : 0;
+        int64_t alt_delta;
+        int alt_width = encode_dods(in, n, split, alt_codes, &alt_delta);
+        if (rest * alt_width + n * low_width < rest * h.dod_width + n * suffix_width){
+            h.split = split;
+            h.dod_width = alt_width;
+            h.delta = alt_delta;
+            memcpy(codes, alt_codes, rest * sizeof(uint64_t));
+            base &= ((uint32_t)1 << split) - 1;
+            table[0] = base;
+            n_dict = 1;
+            dict_width = low_xor ? 64 : 0;
+            xor_width = low_width;
+        }
+    }
+    h.high = in[0] >> h.split;
+
+    if (dict_width <= xor_width){
+        h.suffix_mode = SUFFIX_DICT;
+        h.suffix_width = dict_width;
+        h.n_table = n_dict;
+    } else {
+        h.suffix_mode = SUFFIX_XOR;
+        h.suffix_width = xor_width;
+        h.suffix_shift = shift;
+        h.n_table = 1;
+        table[0] = base;
+    }
+    size_t pos = sizeof(h);
+    memcpy(out + pos, table, h.n_table * sizeof(uint32_t));
+    memset(out + pos + h.n_table * sizeof(uint32_t), 0, table_bytes(h.n_table) - h.n_table * sizeof(uint32_t));
+    pos += table_bytes(h.n_table);
+    pos += pack(out + pos, codes, rest, h.dod_width);
+
+    uint32_t suffix_mask = ((uint32_t)1 << h.split) - 1;
+    for (size_t i = 0; i < n; i++){
+        uint32_t suffix = in[i] & suffix_mask;
+        if (h.suffix_mode == SUFFIX_XOR){
+            codes[i] = (suffix ^ base) >> shift;
+        } else {
+            int k = 0;
+            while (table[k] != suffix){ k++; }
+            codes[i] = k;
+        }
+    }
+    pos += pack(out + pos, codes, n, h.suffix_width);
+    memcpy(out, &h, sizeof(h));
+    return pos;
+}
+
+static size_t block_bound(size_t n){
+    return sizeof(BlockHeader) + table_bytes(CODEC_DICT_MAX) + packed_bytes(n, CODEC_DOD_MAX_BITS) +
+           packed_bytes(n, 24);
+}
+
+size_t FP_codec_bound(size_t n){
+    size_t blocks = (n + FP_CODEC_BLOCK - 1) / FP_CODEC_BLOCK;
+    size_t full = n / FP_CODEC_BLOCK;
+    size_t bound = sizeof(uint64_t) * (blocks + 2) + full * block_bound(FP_CODEC_BLOCK);
+    return bound + ((blocks > full) ? block_bound(n % FP_CODEC_BLOCK) : 0);
+}
+
+size_t FP_codec_encode(const int64_t *in, size_t n, uint8_t *out){
+    size_t blocks = (n + FP_CODEC_BLOCK - 1) / FP_CODEC_BLOCK;
+    uint64_t pos = sizeof(uint64_t) * (blocks + 2);
+    uint64_t count = n;
+    memcpy(out, &count, sizeof(count));
+    for (size_t b = 0; b < blocks; b++){
+        memcpy(out + sizeof(uint64_t) * (b + 1), &pos, sizeof(pos));
+        size_t m = (n - b * FP_CODEC_BLOCK < FP_CODEC_BLOCK) ? n - b * FP_CODEC_BLOCK : FP_CODEC_BLOCK;
+        pos += encode_block(in + b * FP_CODEC_BLOCK, m, out + pos);
+    }
+    memcpy(out + sizeof(uint64_t) * (blocks + 1), &pos, sizeof(pos));
+    return pos;
+}
+
+
+// Decoding
+// ----------------------------------------------------------------------------
+
+typedef struct {
+    BlockHeader h;
+    const uint32_t *table;     // may be unaligned, read with memcpy
+    const uint8_t *dods;
+    const uint8_t *suffixes;
+} BlockView;
+
+static BlockView block_view(const uint8_t *block){
+    BlockView v;
+    memcpy(&v.h, block, sizeof(v.h));
+    v.table = (const uint32_t *)(block + sizeof(v.h));
+    v.dods = block + sizeof(v.h) + table_bytes(v.h.n_table);
+    v.suffixes = v.dods + packed_bytes((v.h.n > 2) ? v.h.n - 2 : 0, v.h.dod_width);
+    return v;
+}
+
+static inline int64_t suffix_at(const BlockView *v, size_t i){
+    uint64_t code = unpack(v->suffixes, i, v->h.suffix_width, ((uint64_t)1 << v->h.suffix_width) - 1);
+    uint32_t entry;
+    if (v->h.suffix_mode == SUFFIX_XOR){
+        memcpy(&entry, v->table, sizeof(entry));
+        return entry ^ (code << v->h.suffix_shift);
+    }
+    memcpy(&entry, v->table + code, sizeof(entry));
+    return entry;
+}
+
+static inline int64_t join(int64_t high, int64_t suffix, int split){
+    return (int64_t)((uint64_t)high << split | (uint64_t)suffix);
+}
+
+// values [from, n) of a block, high and delta are those of value from-1
+static void decode_scalar(const BlockView *v, size_t from, int64_t high, int64_t delta, int64_t *out){
+    uint64_t mask = ((uint64_t)1 << v->h.dod_width) - 1;
+    for (size_t i = from; i < v->h.n; i++){
+        delta += unzigzag(unpack(v->dods, i - 2, v->h.dod_width, mask));
+        high += delta;
+        out[i] = join(high, suffix_at(v, i), v->h.split);
+    }
+}
+
+// Values i .. i+3. Up to 14 bits they lie in one 64 bit word that is shifted
+// per lane, wider ones are loaded lane by lane.
+static inline __attribute__((always_inline)) fp_vu64 unpack_lanes(const uint8_t *in, size_t i, int width,
+                                                                  fp_vu64 lane_bits, uint64_t mask){
+    size_t bit = i * width;
+    if (width <= 14){
+        fp_vu64 word = (fp_vu64){0} + load64(in + bit / 8);
+        return (word >> (lane_bits + bit % 8)) & mask;
+    }
+    fp_vu64 pos = lane_bits + bit;
+    fp_vu64 word = {load64(in + pos[0] / 8), load64(in + pos[1] / 8), load64(in + pos[2] / 8), load64(in + pos[3] / 8)};
+    return (word >> (pos & 7)) & mask;
+}
+
+// inclusive prefix sum over the lanes
+static inline __attribute__((always_inline)) fp_vi64 prefix_sum(fp_vi64 x){
+    const fp_vi64 zero = {0};
+    x += __builtin_shuffle(x, zero, (fp_vi64){4, 0, 1, 2});
+    x += __builtin_shuffle(x, zero, (fp_vi64){4, 4, 0, 1});
+    return x;
+}
+
+// Values 2 .. n: the delta-of-deltas of four values are unpacked at once and
+// summed up twice (deltas, then the high parts) with in-register prefix sums, the
+// last lane carries over to the next four. Returns the first value left.
+FP_SIMD_CLONES
+static size_t decode_simd(const BlockView *v, int64_t *out){
+    int dod_width = v->h.dod_width;
+    int suffix_width = v->h.suffix_width;
+    uint64_t dod_mask = ((uint64_t)1 << dod_width) - 1;
+    uint64_t suffix_mask = ((uint64_t)1 << suffix_width) - 1;
+    fp_vu64 dod_bits = (fp_vu64){0, 1, 2, 3} * (uint64_t)dod_width;
+    fp_vu64 suffix_bits = (fp_vu64){0, 1, 2, 3} * (uint64_t)suffix_width;
+    uint32_t table[CODEC_DICT_MAX];
+    memcpy(table, v->table, v->h.n_table * sizeof(uint32_t));
+    bool xor = (v->h.suffix_mode == SUFFIX_XOR || v->h.n_table == 1);   // one entry: XOR with 0 bits
+
+    fp_vi64 delta = (fp_vi64){0} + v->h.delta;
+    fp_vi64 high = (fp_vi64){0} + (v->h.high + v->h.delta);
+    size_t i = 2;
+    for (; i + FP_VLANES <= v->h.n; i += FP_VLANES){
+        fp_vu64 zz = unpack_lanes(v->dods, i - 2, dod_width, dod_bits, dod_mask);
+        fp_vi64 dod = (fp_vi64)(zz >> 1) ^ -(fp_vi64)(zz & 1);
+        fp_vi64 d = delta + prefix_sum(dod);
+        fp_vi64 h = high + prefix_sum(d);
+        delta = __builtin_shuffle(d, (fp_vi64){3, 3, 3, 3});
+        high = __builtin_shuffle(h, (fp_vi64){3, 3, 3, 3});
+
+        fp_vu64 code = unpack_lanes(v->suffixes, i, suffix_width, suffix_bits, suffix_mask);
+        fp_vi64 suffix;
+        if (xor){
+            suffix = (fp_vi64)(table[0] ^ (code << v->h.suffix_shift));
+        } else {
+            suffix = (fp_vi64){table[code[0]], table[code[1]], table[code[2]], table[code[3]]};
+        }
+        fp_vi64 value = (fp_vi64)((fp_vu64)h << v->h.split) | suffix;
+        FP_VSTORE(out + i, value);
+    }
+    return i;
+}
+
+size_t FP_codec_count(const uint8_t *in){
+    uint64_t n;
+    memcpy(&n, in, sizeof(n));
+    return n;
+}
+
+size_t FP_codec_decode_block(const uint8_t *in, size_t b, int64_t *out){
+    uint64_t offset;
+    memcpy(&offset, in + sizeof(uint64_t) * (b + 1), sizeof(offset));
+    BlockView v = block_view(in + offset);
+    size_t n = v.h.n;
+    out[0] = join(v.h.high, suffix_at(&v, 0), v.h.split);
+    if (n < 2){ return n; }
+    out[1] = join(v.h.high + v.h.delta, suffix_at(&v, 1), v.h.split);
+
+    size_t i = 2;
+    if (fp_simd_available()){
+        i = decode_simd(&v, out);
+    }
+    if (i < n){   // scalar tail, it continues from value i-1
+        int64_t prev = out[i - 1] >> v.h.split;
+        int64_t delta = (i > 2) ? prev - (out[i - 2] >> v.h.split) : v.h.delta;
+        decode_scalar(&v, i, prev, delta, out);
+    }
+    return n;
+}
+
+size_t FP_codec_decode(const uint8_t *in, int64_t *out){
+    size_t n = FP_codec_count(in);
+    size_t blocks = (n + FP_CODEC_BLOCK - 1) / FP_CODEC_BLOCK;
+    for (size_t b = 0; b < blocks; b++){
+        FP_codec_decode_block(in, b, out + b * FP_CODEC_BLOCK);
+    }
+    return n;
+}
@@ -0,0 +1,51 @@
+#ifndef _FP_CODEC_H
+#define _FP_CODEC_H
+
+#include "flexpoch.h"
+
+// Block compression of flexpoch streams. Every value is split into its seconds
+// (upper 40 bits) and its suffix (lower 24 bits: fraction, tz offset, precision).
+// Per block of FP_CODEC_BLOCK values the seconds are stored as delta-of-delta,
+// zigzag coded and bit-packed with the width of the largest one. The suffixes are
+// packed as indices into a dictionary of up to 16 values (0 bits if they are all
+// equal) or, if that is smaller, XORed with the first suffix with the common
+// trailing zero bits dropped. Blocks of sub-second values may move the split down
+// to the lowest changing suffix bit (at least bit 10), so that the fraction joins
+// the delta-of-deltas and only the bits below it stay in the suffix.
+//
+//   stream   n (uint64), n_blocks + 1 block offsets (uint64), blocks
+//   block    header, first value and delta above the split, dictionary or XOR
+//            base, packed delta-of-deltas, packed suffixes
+//
+// Any int64 round-trips, invalid flexpochs included. Fields are in host byte
+// order, the bit packing assumes a little endian host.
+
+
+// types
+// ============================================================================
+
+#define FP_CODEC_BLOCK 1024   // values per block
+
+
+
+// Functions
+// ============================================================================
+
+// bytes FP_codec_encode() writes at most for n values
+size_t FP_codec_bound(size_t n);
+
+// Compress n values into out (FP_codec_bound(n) bytes), returns the bytes written.
+size_t FP_codec_encode(const int64_t *in, size_t n, uint8_t *out);
+
+// number of values of an encoded stream
+size_t FP_codec_count(const uint8_t *in);
+
+// Decode block b (values [b*FP_CODEC_BLOCK, (b+1)*FP_CODEC_BLOCK)) into out and
+// return its number of values. The stream is trusted to come from FP_codec_encode().
+size_t FP_codec_decode_block(const uint8_t *in, size_t b, int64_t *out);
+
+// decode all values into out, returns their number
+size_t FP_codec_decode(const uint8_t *in, int64_t *out);
+
+
+#endif // _FP_CODEC_H
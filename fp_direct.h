@@ -0,0 +1,217 @@
+#ifndef _FP_DIRECT_H
+#define _FP_DIRECT_H
+
+#include "flexpoch.h"
+#include "fp_internal.h"
+
+// Conversions and field accessors that read or write the encoded bits directly
+// instead of going through FP_Components. Validation and ErrNos are those of
+// FP_from_fp() (CP_REL_FRAC gives ERR_RESERVED_FORMAT without printing), the
+// values those of FP_from_fp() + FP_to_unix() / FP_to_java(), like the batch
+// functions in fp_batch.h. On failure the outputs get the batch defaults:
+// INT64_MIN for unix/java, CP_UNDEFINED_FP for flexpochs and the FP_new()
+// values for single fields.
+
+
+// Decoding
+// ----------------------------------------------------------------------------
+
+// absolute or relative seconds (CP_ABS_YEAR_NEG lies within their first bytes)
+static inline bool fp_direct_is_sec(int8_t first_byte){
+    return (int8_t)(CP_REL_SEC<<4) <= first_byte && first_byte < CP_ABS_YEAR_POS &&
+           first_byte != CP_ABS_YEAR_NEG;
+}
+
+// same checks and order as FP_from_fp()
+static inline ErrNo fp_direct_validate(int64_t flexpoch){
+    int8_t first_byte = flexpoch >> 56;
+    if (fp_direct_is_sec(first_byte)){
+        bool sec_plus = (flexpoch & 0b111) == 0b111;
+        return (sec_plus && ((flexpoch >> 3) & 0xF) > 12) ? ERR_INVALID_PRECISION : SUCCESS;
+    }
+    if (first_byte == CP_ABS_YEAR_NEG || first_byte == CP_ABS_YEAR_POS){
+        if (flexpoch & 0xFFFFFF){ return ERR_NON_ZERO_AFTER_YEAR; }
+        uint32_t floatbits = (uint32_t)(flexpoch >> 24);
+        float year;
+        memcpy(&year, &floatbits, sizeof(year));
+        bool bad = (first_byte == CP_ABS_YEAR_POS) ? year < (float)FP_YEAR_MAX+1 : year > (float)FP_YEAR_MIN-1;
+        return bad ? ERR_INVALID_YEAR : SUCCESS;
+    }
+    switch ((uint64_t)flexpoch >> 60){
+        case CP_LOGICAL: return SUCCESS;
+        case CP_CUSTOM:  return ERR_CUSTOM_FORMAT;
+        default:         return ERR_RESERVED_FORMAT;   // CP_REL_FRAC and CP_RESERVED
+    }
+}
+
+// precision of absolute or relative seconds
+static inline Precision fp_direct_prc(int64_t flexpoch){
+    switch (flexpoch & 0b111){
+        case 0b001: return PRC_MICROSEC;
+        case 0b011: return PRC_15BIT;
+        case 0b101: return PRC_MILLISEC;
+        case 0b111: return (flexpoch >> 3) & 0xF;
+        default:    return PRC_23BIT;
+    }
+}
+
+// fraction bits of a sub-second precision
+static inline int64_t fp_direct_frac_mask(Precision prc){
+    switch (prc){
+        case PRC_MICROSEC: return 0xFFFFF0;
+        case PRC_15BIT:    return 0xFFFE00;
+        case PRC_MILLISEC: return 0xFFC000;
+        default:           return 0xFFFFFE;
+    }
+}
+
+// fields of absolute or relative seconds, for arithmetic on them
+typedef struct {
+    int64_t seconds;    // without the codepoint of relative seconds
+    int64_t frac;       // 24 bit fixed point, 0 from PRC_SECOND on
+    Precision prc;
+    int64_t tz_bin;     // TZ_BIN_OFFSET (UTC) below PRC_MILLISEC
+    bool rel;
+} DirectParts;
+
+// validated fields, ERR_INCOMPATIBLE_OUTPUT for float years and logical clocks
+static inline ErrNo fp_direct_split(int64_t flexpoch, DirectParts *p){
+    ErrNo err = fp_direct_validate(flexpoch);
+    if (err){ return err; }
+    if (!fp_direct_is_sec(flexpoch >> 56)){ return ERR_INCOMPATIBLE_OUTPUT; }
+    p->rel = ((uint64_t)flexpoch >> 60) == (uint64_t)CP_REL_SEC;
+    p->seconds = p->rel ? (flexpoch >> 24) & REL_SEC_MAX : flexpoch >> 24;
+    p->prc = fp_direct_prc(flexpoch);
+    switch (flexpoch & 0b111){
+        case 0b101: p->tz_bin = (flexpoch >> 3) & 0x7FF; break;
+        case 0b111: p->tz_bin = (flexpoch >> 13) & 0x7FF; break;
+        default:    p->tz_bin = TZ_BIN_OFFSET; break;
+    }
+    p->frac = (p->prc < PRC_SECOND) ? flexpoch & fp_direct_frac_mask(p->prc) : 0;
+    return SUCCESS;
+}
+
+// seconds of a valid flexpoch, 0 for float years
+static inline int64_t fp_direct_seconds(int64_t flexpoch){
+    int8_t first_byte = flexpoch >> 56;
+    if (fp_direct_is_sec(first_byte)){
+        int64_t seconds = flexpoch >> 24;
+        return (((uint8_t)first_byte >> 4) == CP_REL_SEC) ? seconds & REL_SEC_MAX : seconds;
+    }
+    return ((uint64_t)flexpoch >> 60 == CP_LOGICAL) ? flexpoch & 0x0FFFFFFFFFFFFFFF : 0;
+}
+
+// ns of a valid flexpoch, the FP_new() value (UINT32_MAX) if it has no fraction
+static inline uint32_t fp_direct_ns(int64_t flexpoch){
+    if (!fp_direct_is_sec(flexpoch >> 56)){ return UINT32_MAX; }
+    Precision prc = fp_direct_prc(flexpoch);
+    return (prc < PRC_SECOND) ? frac2ns(flexpoch & fp_direct_frac_mask(prc)) : 0;
+}
+
+static inline ErrNo FP_fp_to_unix_direct(int64_t flexpoch, int64_t *out){
+    ErrNo err = fp_direct_validate(flexpoch);
+    *out = err ? INT64_MIN : fp_direct_seconds(flexpoch);
+    return err;
+}
+
+static inline ErrNo FP_fp_to_java_direct(int64_t flexpoch, int64_t *out){
+    ErrNo err = fp_direct_validate(flexpoch);
+    *out = err ? INT64_MIN : fp_direct_seconds(flexpoch) * 1000 + fp_direct_ns(flexpoch) / 1000000;
+    return err;
+}
+
+
+// Field accessors
+// ----------------------------------------------------------------------------
+
+static inline ErrNo FP_get_seconds(int64_t flexpoch, int64_t *out){
+    ErrNo err = fp_direct_validate(flexpoch);
+    *out = err ? 0 : fp_direct_seconds(flexpoch);
+    return err;
+}
+
+static inline ErrNo FP_get_ns(int64_t flexpoch, uint32_t *out){
+    ErrNo err = fp_direct_validate(flexpoch);
+    *out = err ? UINT32_MAX : fp_direct_ns(flexpoch);
+    return err;
+}
+
+static inline ErrNo FP_get_precision(int64_t flexpoch, Precision *out){
+    ErrNo err = fp_direct_validate(flexpoch);
+    *out = PRC_UNKNOWN;
+    if (err || !fp_direct_is_sec(flexpoch >> 56)){ return err; }
+    *out = fp_direct_prc(flexpoch);
+    return err;
+}
+
+// minutes, 0 for leap seconds like in FP_from_fp()
+static inline ErrNo FP_get_tz_offset(int64_t flexpoch, int16_t *out){
+    ErrNo err = fp_direct_validate(flexpoch);
+    *out = 0;
+    if (err || !fp_direct_is_sec(flexpoch >> 56)){ return err; }
+    int16_t tz = 0;
+    if ((flexpoch & 0b111) == 0b101){
+        tz = FP_tz_offset_from_bin(flexpoch >> 3);
+    } else if ((flexpoch & 0b111) == 0b111){
+        tz = FP_tz_offset_from_bin(flexpoch >> 13);
+    }
+    *out = (tz == TZ_LEAPSEC) ? 0 : tz;
+    return err;
+}
+
+
+// Encoding
+// ----------------------------------------------------------------------------
+
+// FP_from_unix() + FP_to_fp(): second precision, UTC
+static inline ErrNo FP_unix_to_fp_direct(int64_t unixtime, int64_t *out){
+    if (unixtime <= (int64_t)CP_ABS_YEAR_NEG<<32 || (int64_t)CP_ABS_YEAR_POS<<32 <= unixtime){
+        *out = CP_UNDEFINED_FP;
+        return ERR_OUT_OF_RANGE;
+    }
+    *out = (int64_t)((uint64_t)unixtime << 24) + ((int64_t)TZ_BIN_OFFSET << 13) + 0b111;
+    return SUCCESS;
+}
+
+// FP_from_java_batch() with PRC_MILLISEC, UTC: negative millis are floored
+static inline ErrNo FP_java_to_fp_direct(int64_t javatime, int64_t *out){
+    int64_t seconds = javatime / 1000;
+    int64_t millis = javatime % 1000;
+    if (millis < 0){
+        seconds -= 1;
+        millis += 1000;
+    }
+    if (seconds <= (int64_t)CP_ABS_YEAR_NEG<<32 || (int64_t)CP_ABS_YEAR_POS<<32 <= seconds){
+        *out = CP_UNDEFINED_FP;
+        return ERR_OUT_OF_RANGE;
+    }
+    int64_t frac = ns2frac(millis * 1000000) >> 13;
+    *out = (int64_t)((uint64_t)seconds << 24) + (frac << 14) + (TZ_BIN_OFFSET << 3) + 0b101;
+    return SUCCESS;
+}
+
+// inverse of fp_direct_split(), frac must be cut to prc. ERR_OUT_OF_RANGE if
+// the seconds do not fit.
+static inline ErrNo fp_direct_join(DirectParts p, int64_t *out){
+    *out = CP_UNDEFINED_FP;
+    if (p.rel ? p.seconds < 0 || p.seconds > REL_SEC_MAX :
+                p.seconds <= (int64_t)CP_ABS_YEAR_NEG<<32 || (int64_t)CP_ABS_YEAR_POS<<32 <= p.seconds){
+        return ERR_OUT_OF_RANGE;
+    }
+    uint64_t value = (uint64_t)p.seconds << 24;
+    switch (p.prc){
+        case PRC_23BIT:    value |= p.frac; break;
+        case PRC_MICROSEC: value |= p.frac | 0b001; break;
+        case PRC_15BIT:    value |= p.frac | 0b011; break;
+        case PRC_MILLISEC: value |= p.frac | p.tz_bin << 3 | 0b101; break;
+        default:           value |= p.tz_bin << 13 | (uint64_t)p.prc << 3 | 0b111; break;
+    }
+    if (p.rel){
+        value = (value & 0x0FFFFFFFFFFFFFFF) | (uint64_t)CP_REL_SEC << 60;
+    }
+    *out = value;
+    return SUCCESS;
+}
+
+
+#endif // _FP_DIRECT_H
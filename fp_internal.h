@@ -0,0 +1,62 @@
+/* Constants, fraction and calendar helpers of the Flexpoch encoding shared by
+ * the fp_*.c modules.
+ *
+ * Private header: not part of the API, so the unprefixed names stay out of
+ * flexpoch.h. Callers of the API see CP_UNDEFINED_FP as INT64_MIN.
+ */
+
+#ifndef _FP_INTERNAL_H
+#define _FP_INTERNAL_H
+
+#include "flexpoch.h"
+
+#define CP_FLOAT_SIGN 0x0000000080000000
+#define CP_UNDEFINED_FP -0x8000000000000000
+#define NS_PER_SEC 1000000000
+
+#define FP_YEAR_MAX 19254
+#define FP_YEAR_MIN -2250
+
+#define TZ_BIN_OFFSET 1024    // binary offset
+#define TZ_LEAPSEC 1023    // special offset value for leapsecond
+#define TZ_LEAP_BIN (TZ_LEAPSEC ^ TZ_BIN_OFFSET)    // tz field of a leap second
+
+#define REL_SEC_MAX 0x0FFFFFFFFF    // 36 bit relative seconds
+
+// codepoint (CP) bytes
+static const int8_t CP_ABS_YEAR_POS = 0x7F;  // codepoint absolute years
+static const int8_t CP_ABS_YEAR_NEG = -0x20; // codepoint absolute years: -0x20 or 0xE0
+static const int8_t CP_REL_SEC = 0b1101;   // 4-bit codepoint relative time 0xD0
+static const int8_t CP_REL_FRAC = 0b1100;   // 4-bit codepoint relative high-res fraction 0xC0
+static const int8_t CP_CUSTOM   = 0b1011;   // 4-bit codepoint for custom code 0xB0
+static const int8_t CP_LOGICAL  = 0b1010;   // 4-bit codepoint for logical clocks 0xA0
+static const int8_t CP_RESERVED = 0b100;    // 3-bit codepoint for reserved (0x8 or 0x9)
+
+// convert ns to a 23 bit fraction of a second (rounded)
+uint32_t ns2frac(uint32_t nanoseconds);
+
+// convert fraction to ns. This only works for small fraction (e.g. 20bit)
+uint32_t frac2ns(uint64_t binary);
+
+
+// calendar units of FP_truncate() and FP_aggregate()
+#define CAL_MONDAY (-3 * 86400)    // 1969-12-29, weeks start on it
+
+static inline int64_t floor_div(int64_t a, int64_t b){
+    int64_t q = a / b;
+    return q - (a % b < 0);
+}
+
+// first second of a month, counted from january of year 0
+static inline int64_t month_start(int64_t months){
+    int64_t year = floor_div(months, 12);
+    return FP_days_from_civil(year, months - year * 12 + 1, 1) * 86400;
+}
+
+// months of a unit PRC_MONTH ... PRC_MILLENNIUM
+static inline int64_t unit_months(Precision prc){
+    static const int64_t months[] = {1, 3, 4, 6, 12, 120, 1200, 12000};
+    return months[prc - PRC_MONTH];
+}
+
+#endif // _FP_INTERNAL_H
@@ -0,0 +1,463 @@
+#define _GNU_SOURCE  // pthread_setaffinity_np
+#include "fp_pool.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define POOL_TASK_ROWS 8192   // 64 KiB in + 64 KiB out for the int64 conversions, stays in L2
+#define POOL_CACHE_LINE 64
+#define POOL_ISO_WAVE 4       // ISO tasks per worker and round, bounds the scratch memory
+
+// Tasks [begin, end) of one worker packed into one word (begin << 32 | end).
+// The owner takes tasks from the front, thieves cut off the back half, both
+// with a single CAS. Only a worker with an empty range stores a new one.
+typedef struct {
+    uint64_t range;
+    char pad[POOL_CACHE_LINE - sizeof(uint64_t)];
+} PoolDeque;
+
+typedef struct {
+    FP_Pool *pool;
+    int index;
+    int cpu;                 // -1: not pinned
+} PoolWorker;
+
+struct FP_Pool {
+    int n_threads;
+    size_t task_rows;
+    pthread_t *tids;
+    PoolWorker *workers;
+    PoolDeque *deques;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    uint64_t generation;     // one per FP_pool_run()
+    int busy;                // workers still in the current run
+    bool stop;
+
+    // current run
+    FP_PoolTask task;
+    void *ctx;
+    size_t n;
+    size_t rows;
+};
+
+
+// Work stealing
+// ----------------------------------------------------------------------------
+
+static __thread int pool_self = -1;   // FP_pool_worker()
+
+static inline uint64_t deque_pack(uint32_t begin, uint32_t end){
+    return (uint64_t)begin << 32 | end;
+}
+
+static bool deque_pop(PoolDeque *d, uint32_t *task){
+    uint64_t r = __atomic_load_n(&d->range, __ATOMIC_ACQUIRE);
+    for (;;){
+        uint32_t begin = r >> 32, end = (uint32_t)r;
+        if (begin >= end){ return false; }
+        if (__atomic_compare_exchange_n(&d->range, &r, deque_pack(begin + 1, end), true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+            *task = begin;
+            return true;
+        }
+    }
+}
+
+// take the back half of the first non-empty victim, run its first task now and
+// keep the rest in the own (empty) deque where it can be stolen again
+static bool deque_steal(FP_Pool *pool, int self, uint32_t *task){
+    for (int i = 1; i < pool->n_threads; i++){
+        PoolDeque *victim = &pool->deques[(self + i) % pool->n_threads];
+        uint64_t r = __atomic_load_n(&victim->range, __ATOMIC_ACQUIRE);
+        for (;;){
+            uint32_t begin = r >> 32, end = (uint32_t)r;
+            if (begin >= end){ break; }
+            uint32_t split = end - (end - begin + 1) / 2;
+            if (__atomic_compare_exchange_n(&victim->range, &r, deque_pack(begin, split), true,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+                __atomic_store_n(&pool->deques[self].range, deque_pack(split + 1, end), __ATOMIC_RELEASE);
+                *task = split;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void pool_work(FP_Pool *pool, int self){
+    uint32_t t;
+    while (deque_pop(&pool->deques[self], &t) || deque_steal(pool, self, &t)){
+        size_t from = (size_t)t * pool->rows;
+        size_t to = (pool->n - from < pool->rows) ? pool->n : from + pool->rows;
+        pool->task(pool->ctx, from, to);
+    }
+}
+
+static void *pool_worker(void *arg){
+    PoolWorker *worker = arg;
+    FP_Pool *pool = worker->pool;
+    uint64_t seen = 0;
+    pool_self = worker->index;
+
+    if (worker->cpu >= 0){   // best effort, e.g. the CPU may be offline
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(worker->cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    for (;;){
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == seen && !pool->stop){
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        if (pool->stop){
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        pool_work(pool, worker->index);
+
+        // the last worker out ends the run, a worker that is still stealing could
+        // otherwise overwrite its deque of the next run
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0){
+            pthread_cond_signal(&pool->done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+
+// Pool
+// ----------------------------------------------------------------------------
+
+FP_Pool *FP_pool_create(const FP_PoolOptions *opt){
+    FP_PoolOptions defaults = {0};
+    if (!opt){ opt = &defaults; }
+
+    FP_Pool *pool = calloc(1, sizeof(FP_Pool));
+    if (!pool){ return NULL; }
+    int n_threads = opt->threads;
+    if (n_threads <= 0){
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = (online > 0) ? online : 1;
+    }
+    size_t rows = opt->task_rows ? opt->task_rows : POOL_TASK_ROWS;
+    pool->task_rows = (rows + 63) / 64 * 64;   // whole err_mask words per task
+
+    pool->tids = calloc(n_threads, sizeof(pthread_t));
+    pool->workers = calloc(n_threads, sizeof(PoolWorker));
+    pool->deques = aligned_alloc(POOL_CACHE_LINE, n_threads * sizeof(PoolDeque));
+    if (!pool->tids || !pool->workers || !pool->deques){
+        FP_pool_destroy(pool);
+        return NULL;
+    }
+    memset(pool->deques, 0, n_threads * sizeof(PoolDeque));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (int i = 0; i < n_threads; i++){
+        PoolWorker *worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->index = i;
+        worker->cpu = !opt->pin ? -1 : opt->cpus ? opt->cpus[i] : i;
+        if (pthread_create(&pool->tids[i], NULL, pool_worker, worker) != 0){ break; }
+        pool->n_threads++;
+    }
+    if (pool->n_threads == 0){
+        FP_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void FP_pool_destroy(FP_Pool *pool){
+    if (!pool){ return; }
+    if (pool->n_threads){
+        pthread_mutex_lock(&pool->lock);
+        pool->stop = true;
+        pthread_cond_broadcast(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+        for (int i = 0; i < pool->n_threads; i++){
+            pthread_join(pool->tids[i], NULL);
+        }
+        pthread_mutex_destroy(&pool->lock);
+        pthread_cond_destroy(&pool->wake);
+        pthread_cond_destroy(&pool->done);
+    }
+    free(pool->tids);
+    free(pool->workers);
+    free(pool->deques);
+    free(pool);
+}
+
+int FP_pool_size(const FP_Pool *pool){
+    return pool->n_threads;
+}
+
+int FP_pool_worker(void){
+    return pool_self;
+}
+
+void FP_pool_run(FP_Pool *pool, size_t n, FP_PoolTask task, void *ctx){
+    size_t rows = pool->task_rows;
+    size_t n_tasks = (n + rows - 1) / rows;
+    if (n_tasks <= 1){
+        if (n){ task(ctx, 0, n); }
+        return;
+    }
+    while (n_tasks > UINT32_MAX){
+        rows *= 2;
+        n_tasks = (n + rows - 1) / rows;
+    }
+
+    pool->task = task;
+    pool->ctx = ctx;
+    pool->n = n;
+    pool->rows = rows;
+    int n_threads = pool->n_threads;
+    for (int i = 0; i < n_threads; i++){
+        uint32_t begin = n_tasks * i / n_threads;
+        uint32_t end = n_tasks * (i + 1) / n_threads;
+        __atomic_store_n(&pool->deques[i].range, deque_pack(begin, end), __ATOMIC_RELEASE);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->busy = n_threads;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    while (pool->busy){
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+
+// Parallel batch conversions
+// ----------------------------------------------------------------------------
+
+typedef enum {
+    OP_FROM_FP,
+    OP_FROM_UNIX,
+    OP_FROM_JAVA,
+    OP_FROM_ISO,
+    OP_TO_UNIX,
+    OP_TO_JAVA,
+    OP_TO_NS,
+    OP_TO_ISO,    // fixed width records
+} PoolOp;
+
+typedef struct {
+    PoolOp op;
+    const int64_t *in;
+    int64_t *out;
+    int16_t *err;
+    Precision prc;
+    int16_t tz_offset;
+    FP_BatchOut *cols;
+    const char *base;
+    const size_t *offsets;
+    size_t stride;
+    uint64_t *err_mask;
+    char *arena;
+    size_t width;
+    size_t n_failed;         // atomic
+} PoolConvert;
+
+static inline void *shift(void *column, size_t bytes){
+    return column ? (char *)column + bytes : NULL;
+}
+
+static void convert_task(void *ctx, size_t from, size_t to){
+    PoolConvert *c = ctx;
+    size_t m = to - from;
+    const int64_t *in = c->in ? c->in + from : NULL;
+    int64_t *out = shift(c->out, from * sizeof(int64_t));
+    int16_t *err = shift(c->err, from * sizeof(int16_t));
+    size_t n_failed = 0;
+
+    switch (c->op){
+        case OP_FROM_FP: {
+            FP_BatchOut *o = c->cols;
+            FP_BatchOut cols = {
+                shift(o->seconds, from * sizeof(*o->seconds)),
+                shift(o->ns, from * sizeof(*o->ns)),
+                shift(o->precision, from * sizeof(*o->precision)),
+                shift(o->tz_offset, from * sizeof(*o->tz_offset)),
+                shift(o->is_leapsecond, from * sizeof(*o->is_leapsecond)),
+                shift(o->fmt, from * sizeof(*o->fmt)),
+                shift(o->err, from * sizeof(*o->err)),
+            };
+            n_failed = FP_from_fp_batch(in, m, &cols);
+            break;
+        }
+        case OP_FROM_UNIX: n_failed = FP_from_unix_batch(in, m, c->prc, c->tz_offset, out, err); break;
+        case OP_FROM_JAVA: n_failed = FP_from_java_batch(in, m, c->prc, c->tz_offset, out, err); break;
+        case OP_FROM_ISO: {
+            // from is a multiple of 64, so every task owns whole err_mask words
+            const char *base = c->offsets ? c->base : c->base + from * c->stride;
+            const size_t *offsets = c->offsets ? c->offsets + from : NULL;
+            n_failed = FP_from_iso_batch(base, offsets, c->stride, m, out, shift(c->err_mask, from / 8));
+            break;
+        }
+        case OP_TO_UNIX: n_failed = FP_to_unix_batch(in, m, out, err); break;
+        case OP_TO_JAVA: n_failed = FP_to_java_batch(in, m, out, err); break;
+        case OP_TO_NS:   n_failed = FP_to_ns_batch(in, m, out, err); break;
+        case OP_TO_ISO:
+            // exactly the own records as arena, in place writes must not spill into the next task
+            FP_to_iso_batch(in, m, c->arena + from * c->width, m * c->width, NULL, c->width, err);
+            break;
+    }
+    if (n_failed){
+        __atomic_fetch_add(&c->n_failed, n_failed, __ATOMIC_RELAXED);
+    }
+}
+
+static size_t convert(FP_Pool *pool, PoolConvert *c, size_t n){
+    FP_pool_run(pool, n, convert_task, c);
+    return c->n_failed;
+}
+
+size_t FP_pool_from_fp(FP_Pool *pool, const int64_t *in, size_t n, FP_BatchOut *out){
+    PoolConvert c = {.op = OP_FROM_FP, .in = in, .cols = out};
+    return convert(pool, &c, n);
+}
+
+size_t FP_pool_from_unix(FP_Pool *pool, const int64_t *in, size_t n, Precision prc, int16_t tz_offset,
+                         int64_t *out, int16_t *err){
+    PoolConvert c = {.op = OP_FROM_UNIX, .in = in, .out = out, .err = err, .prc = prc, .tz_offset = tz_offset};
+    return convert(pool, &c, n);
+}
+
+size_t FP_pool_from_java(FP_Pool *pool, const int64_t *in, size_t n, Precision prc, int16_t tz_offset,
+                         int64_t *out, int16_t *err){
+    PoolConvert c = {.op = OP_FROM_JAVA, .in = in, .out = out, .err = err, .prc = prc, .tz_offset = tz_offset};
+    return convert(pool, &c, n);
+}
+
+size_t FP_pool_from_iso(FP_Pool *pool, const char *base, const size_t *offsets, size_t stride, size_t n,
+                        int64_t *out, uint64_t *err_mask){
+    PoolConvert c = {.op = OP_FROM_ISO, .out = out, .base = base, .offsets = offsets, .stride = stride,
+                     .err_mask = err_mask};
+    return convert(pool, &c, n);
+}
+
+size_t FP_pool_to_unix(FP_Pool *pool, const int64_t *in, size_t n, int64_t *out, int16_t *err){
+    PoolConvert c = {.op = OP_TO_UNIX, .in = in, .out = out, .err = err};
+    return convert(pool, &c, n);
+}
+
+size_t FP_pool_to_java(FP_Pool *pool, const int64_t *in, size_t n, int64_t *out, int16_t *err){
+    PoolConvert c = {.op = OP_TO_JAVA, .in = in, .out = out, .err = err};
+    return convert(pool, &c, n);
+}
+
+size_t FP_pool_to_ns(FP_Pool *pool, const int64_t *in, size_t n, int64_t *out, int16_t *err){
+    PoolConvert c = {.op = OP_TO_NS, .in = in, .out = out, .err = err};
+    return convert(pool, &c, n);
+}
+
+
+// ISO strings with offsets
+// ----------------------------------------------------------------------------
+
+typedef struct {
+    const int64_t *in;
+    int16_t *err;
+    size_t rows;             // per task
+    char *scratch;           // rows * FP_ISO_MAX_LEN bytes per task
+    size_t *local;           // rows + 1 offsets per task
+    size_t *start;           // arena position of every task
+    char *arena;
+    size_t *offsets;
+} PoolIso;
+
+static void iso_format_task(void *ctx, size_t from, size_t to){
+    PoolIso *c = ctx;
+    size_t k = from / c->rows;
+    size_t cap = c->rows * FP_ISO_MAX_LEN;
+    FP_to_iso_batch(c->in + from, to - from, c->scratch + k * cap, cap, c->local + k * (c->rows + 1), 0,
+                    c->err ? c->err + from : NULL);
+}
+
+static void iso_copy_task(void *ctx, size_t from, size_t to){
+    PoolIso *c = ctx;
+    size_t k = from / c->rows;
+    const size_t *local = c->local + k * (c->rows + 1);
+    size_t m = to - from;
+    memcpy(c->arena + c->start[k], c->scratch + k * c->rows * FP_ISO_MAX_LEN, local[m]);
+    for (size_t i = 1; i <= m; i++){
+        c->offsets[from + i] = c->start[k] + local[i];
+    }
+}
+
+size_t FP_pool_to_iso(FP_Pool *pool, const int64_t *in, size_t n, char *arena, size_t size,
+                      size_t *offsets, size_t width, int16_t *err){
+    if (!offsets){
+        size_t fit = width ? size / width : n;
+        PoolConvert c = {.op = OP_TO_ISO, .in = in, .err = err, .arena = arena, .width = width};
+        if (fit < n){ n = fit; }
+        convert(pool, &c, n);
+        return n;
+    }
+
+    // Rows are formatted in rounds of a few tasks per worker into scratch buffers,
+    // the task lengths are summed up in order and the buffers copied into place.
+    size_t rows = pool->task_rows;
+    size_t n_tasks = (size_t)pool->n_threads * POOL_ISO_WAVE;
+    char *scratch = malloc(n_tasks * rows * FP_ISO_MAX_LEN);
+    size_t *local = malloc(n_tasks * (rows + 1) * sizeof(size_t));
+    size_t *start = malloc(n_tasks * sizeof(size_t));
+    if (!scratch || !local || !start){   // out of memory: single threaded
+        free(scratch);
+        free(local);
+        free(start);
+        return FP_to_iso_batch(in, n, arena, size, offsets, 0, err);
+    }
+
+    size_t done = 0, pos = 0;
+    offsets[0] = 0;
+    while (done < n){
+        size_t m = (n - done < n_tasks * rows) ? n - done : n_tasks * rows;
+        PoolIso c = {in + done, err ? err + done : NULL, rows, scratch, local, start, arena, offsets + done};
+        FP_pool_run(pool, m, iso_format_task, &c);
+
+        size_t tasks = (m + rows - 1) / rows;
+        for (size_t k = 0; k < tasks; k++){
+            size_t len = local[k * (rows + 1) + ((k + 1 < tasks) ? rows : m - k * rows)];
+            if (len > size - pos){
+                // the arena is full within this task, keep the rows that fit
+                const size_t *l = local + k * (rows + 1);
+                size_t task_rows = (k + 1 < tasks) ? rows : m - k * rows;
+                size_t i = 0;
+                while (i < task_rows && l[i + 1] <= size - pos){ i++; }
+                memcpy(arena + pos, scratch + k * rows * FP_ISO_MAX_LEN, l[i]);
+                for (size_t j = 1; j <= i; j++){
+                    offsets[done + k * rows + j] = pos + l[j];
+                }
+                FP_pool_run(pool, k * rows, iso_copy_task, &c);
+                done += k * rows + i;
+                goto cleanup;
+            }
+            start[k] = pos;
+            pos += len;
+        }
+        FP_pool_run(pool, m, iso_copy_task, &c);
+        done += m;
+    }
+
+cleanup:
+    free(scratch);
+    free(local);
+    free(start);
+    return done;
+}
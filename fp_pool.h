@@ -0,0 +1,76 @@
+#ifndef _FP_POOL_H
+#define _FP_POOL_H
+
+#include "fp_batch.h"
+
+
+// types
+// ============================================================================
+
+typedef struct FP_Pool FP_Pool;
+
+typedef struct {
+    int threads;         // 0 = online CPUs
+    bool pin;            // pin worker i to cpus[i] (or CPU i if cpus is NULL)
+    const int *cpus;
+    size_t task_rows;    // rows per task, rounded up to 64, 0 = default (cache sized)
+} FP_PoolOptions;
+
+// task of FP_pool_run(): rows [from, to)
+typedef void (*FP_PoolTask)(void *ctx, size_t from, size_t to);
+
+
+
+// Functions
+// ============================================================================
+
+// NULL opt for the defaults. Returns NULL if no thread could be started.
+FP_Pool *FP_pool_create(const FP_PoolOptions *opt);
+
+void FP_pool_destroy(FP_Pool *pool);
+
+int FP_pool_size(const FP_Pool *pool);
+
+// Split n rows into tasks and run them on the pool, returns when all are done.
+// Every worker starts on its own contiguous share of the tasks and steals half
+// of another worker's remaining tasks when it runs out. Small n runs inline.
+// Not reentrant: one FP_pool_run() per pool at a time.
+void FP_pool_run(FP_Pool *pool, size_t n, FP_PoolTask task, void *ctx);
+
+// Index of the pool worker running the calling task (0 .. FP_pool_size() - 1),
+// -1 in other threads, e.g. for tasks that FP_pool_run() ran inline. Lets tasks
+// keep per-thread state such as partial results.
+int FP_pool_worker(void);
+
+
+// Parallel batch conversions
+// ----------------------------------------------------------------------------
+// Same arguments and results as the fp_batch.h functions, independent of the
+// number of threads and of which worker ran which task.
+
+size_t FP_pool_from_fp(FP_Pool *pool, const int64_t *in, size_t n, FP_BatchOut *out);
+
+size_t FP_pool_from_unix(FP_Pool *pool, const int64_t *in, size_t n, Precision prc, int16_t tz_offset,
+                         int64_t *out, int16_t *err);
+
+size_t FP_pool_from_java(FP_Pool *pool, const int64_t *in, size_t n, Precision prc, int16_t tz_offset,
+                         int64_t *out, int16_t *err);
+
+size_t FP_pool_from_iso(FP_Pool *pool, const char *base, const size_t *offsets, size_t stride, size_t n,
+                        int64_t *out, uint64_t *err_mask);
+
+size_t FP_pool_to_unix(FP_Pool *pool, const int64_t *in, size_t n, int64_t *out, int16_t *err);
+
+size_t FP_pool_to_java(FP_Pool *pool, const int64_t *in, size_t n, int64_t *out, int16_t *err);
+
+size_t FP_pool_to_ns(FP_Pool *pool, const int64_t *in, size_t n, int64_t *out, int16_t *err);
+
+// With offsets the rows are formatted per task into scratch buffers and then
+// copied behind each other, so the arena holds the same bytes as with
+// FP_to_iso_batch(). Returns the number of rows written; if the arena is full,
+// err may also be set for rows behind them.
+size_t FP_pool_to_iso(FP_Pool *pool, const int64_t *in, size_t n, char *arena, size_t size,
+                      size_t *offsets, size_t width, int16_t *err);
+
+
+#endif // _FP_POOL_H
@@ -0,0 +1,204 @@
+#include <stdlib.h>
+
+#include "fp_search.h"
+#include "fp_internal.h"
+#include "fp_simd.h"
+
+#define SEARCH_WINDOW 8   // rows left for the SIMD compare, one cache line
+
+
+// Key compares
+// ----------------------------------------------------------------------------
+
+// key < target, or key <= target for upper bounds
+static inline bool key_below(FP_SortKey key, FP_SortKey target, bool upper){
+    return (key.hi < target.hi) | ((key.hi == target.hi) & (upper ? key.lo <= target.lo : key.lo < target.lo));
+}
+
+static size_t count_below_scalar(const int64_t *values, size_t n, FP_SortKey target, bool upper){
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++){
+        count += key_below(FP_sort_key(values[i]), target, upper);
+    }
+    return count;
+}
+
+// FP_sort_key() of valid absolute seconds on all lanes, SIZE_MAX if any row is
+// something else (the caller then takes the scalar path). n is a multiple of FP_VLANES.
+FP_SIMD_CLONES
+static size_t count_below_simd(const int64_t *values, size_t n, FP_SortKey target, bool upper){
+    fp_vi64 count = {0};
+    fp_vi64 other = {0};
+    for (size_t i = 0; i < n; i += FP_VLANES){
+        fp_vi64 v;
+        FP_VLOAD(v, values + i);
+        fp_vi64 first_byte = v >> 56;
+        fp_vi64 pattern = v & 0b111;
+        fp_vi64 sec_plus = (pattern == 0b111);
+        fp_vi64 prc_plus = (v >> 3) & 0xF;
+        other |= (first_byte <= CP_ABS_YEAR_NEG) | (first_byte >= CP_ABS_YEAR_POS) |
+                 (sec_plus & (prc_plus > PRC_MILLENNIUM));
+
+        // same fields as key_low() in fp_sort.c
+        fp_vi64 frac_mask = FP_VSEL(pattern == 0b001, 0xFFFFF0, FP_VSEL(pattern == 0b011, 0xFFFE00,
+                            FP_VSEL(pattern == 0b101, 0xFFC000, FP_VSEL(sec_plus, 0, 0xFFFFFE))));
+        fp_vi64 prc = FP_VSEL(sec_plus, prc_plus, FP_VSEL(pattern == 0b001, PRC_MICROSEC,
+                      FP_VSEL(pattern == 0b011, PRC_15BIT, FP_VSEL(pattern == 0b101, PRC_MILLISEC, PRC_23BIT))));
+        fp_vi64 tz = FP_VSEL(sec_plus, v >> 13, v >> 3) & 0x7FF;
+        fp_vi64 leap = ((pattern & 0b101) == 0b101) & (tz == 0x7FF);
+        fp_vu64 low = (fp_vu64)((leap & ((int64_t)1 << 28)) | ((v & frac_mask) >> 1) << 5 | (prc - PRC_NANOSEC));
+        fp_vu64 high = (fp_vu64)((v >> 24) + ((int64_t)1 << 40)) | (uint64_t)FP_KEY_ABS_SEC << 61;
+        fp_vu64 hi = high >> (64 - FP_KEY_LO_BITS);
+        fp_vu64 lo = high << FP_KEY_LO_BITS | low;
+
+        fp_vi64 lo_below = upper ? (lo <= target.lo) : (lo < target.lo);
+        count -= (hi < target.hi) | ((hi == target.hi) & lo_below);
+    }
+    size_t sum = 0;
+    bool any_other = false;
+    for (int l = 0; l < FP_VLANES; l++){
+        sum += count[l];
+        any_other |= other[l];
+    }
+    return any_other ? SIZE_MAX : sum;
+}
+
+// rows of a sorted window below target
+static size_t count_below(const int64_t *values, size_t n, FP_SortKey target, bool upper){
+    size_t full = n - n % FP_VLANES;
+    size_t count = SIZE_MAX;
+    if (full && fp_simd_available()){
+        count = count_below_simd(values, full, target, upper);
+    }
+    if (count == SIZE_MAX){
+        return count_below_scalar(values, n, target, upper);
+    }
+    return count + count_below_scalar(values + full, n - full, target, upper);
+}
+
+
+// Searches
+// ----------------------------------------------------------------------------
+
+// The first row not below target lies in [base, base + len]: halve the window
+// without branches until it is small enough for count_below().
+static size_t bound(const int64_t *values, size_t n, FP_SortKey target, bool upper){
+    const int64_t *base = values;
+    size_t len = n;
+    while (len > SEARCH_WINDOW){
+        size_t half = len / 2;
+        // both possible next probes, so the loads overlap with this compare
+        __builtin_prefetch(base + half / 2);
+        __builtin_prefetch(base + half + half / 2);
+        base = key_below(FP_sort_key(base[half]), target, upper) ? base + half : base;
+        len -= half;
+    }
+    return (size_t)(base - values) + count_below(base, len, target, upper);
+}
+
+// same on the block keys of a zone map
+static size_t key_bound(const FP_SortKey *keys, size_t n, FP_SortKey target, bool upper){
+    if (n == 0){ return 0; }
+    const FP_SortKey *base = keys;
+    size_t len = n;
+    while (len > 1){
+        size_t half = len / 2;
+        base = key_below(base[half], target, upper) ? base + half : base;
+        len -= half;
+    }
+    return (size_t)(base - keys) + key_below(*base, target, upper);
+}
+
+// the bound is in the first block whose max is not below target
+static size_t zone_bound(const FP_ZoneMap *map, const int64_t *values, FP_SortKey target, bool upper){
+    size_t b = key_bound(map->max, map->blocks, target, upper);
+    if (b == map->blocks){ return map->n; }
+    size_t from = b * FP_ZONE_ROWS;
+    size_t to = (map->n - from < FP_ZONE_ROWS) ? map->n : from + FP_ZONE_ROWS;
+    return from + bound(values + from, to - from, target, upper);
+}
+
+
+// Functions
+// ============================================================================
+
+size_t FP_lower_bound(const int64_t *values, size_t n, int64_t flexpoch){
+    return bound(values, n, FP_sort_key(flexpoch), false);
+}
+
+size_t FP_upper_bound(const int64_t *values, size_t n, int64_t flexpoch){
+    return bound(values, n, FP_sort_key(flexpoch), true);
+}
+
+size_t FP_range_search(FP_ZoneMap *map, const int64_t *values, size_t n, int64_t t1, int64_t t2,
+                       size_t *from){
+    FP_SortKey key1 = FP_sort_key(t1);
+    FP_SortKey key2 = FP_sort_key(t2);
+    if (map && map->n != n && !FP_zone_map_update(map, values, n)){
+        map = NULL;   // out of memory, search without it
+    }
+    size_t first = map ? zone_bound(map, values, key1, false) : bound(values, n, key1, false);
+    size_t last = map ? zone_bound(map, values, key2, true) : bound(values, n, key2, true);
+    *from = first;
+    return (last > first) ? last - first : 0;
+}
+
+
+// Zone maps
+// ----------------------------------------------------------------------------
+
+FP_ZoneMap *FP_zone_map_new(void){
+    return calloc(1, sizeof(FP_ZoneMap));
+}
+
+void FP_zone_map_free(FP_ZoneMap *map){
+    if (!map){ return; }
+    free(map->min);
+    free(map->max);
+    free(map);
+}
+
+bool FP_zone_map_update(FP_ZoneMap *map, const int64_t *values, size_t n){
+    size_t blocks = (n + FP_ZONE_ROWS - 1) / FP_ZONE_ROWS;
+    if (blocks > map->capacity){
+        size_t capacity = map->capacity ? map->capacity : 16;
+        while (capacity < blocks){ capacity *= 2; }
+        FP_SortKey *min = realloc(map->min, capacity * sizeof(FP_SortKey));
+        if (!min){ return false; }
+        map->min = min;
+        FP_SortKey *max = realloc(map->max, capacity * sizeof(FP_SortKey));
+        if (!max){ return false; }
+        map->max = max;
+        map->capacity = capacity;
+    }
+
+    // appended rows extend the last block, a shorter column rescans its new last block
+    size_t start = (n < map->n) ? n - n % FP_ZONE_ROWS : map->n;
+    for (size_t b = start / FP_ZONE_ROWS; b < blocks; b++){
+        size_t from = b * FP_ZONE_ROWS;
+        size_t to = (n - from < FP_ZONE_ROWS) ? n : from + FP_ZONE_ROWS;
+        size_t i = (start > from) ? start : from;
+        FP_SortKey min, max;
+        if (i > from){
+            min = map->min[b];
+            max = map->max[b];
+        } else {
+            min = max = FP_sort_key(values[i++]);
+        }
+        for (; i < to; i++){
+            FP_SortKey key = FP_sort_key(values[i]);
+            if (FP_sort_key_cmp(key, min) < 0){ min = key; }
+            if (FP_sort_key_cmp(key, max) > 0){ max = key; }
+        }
+        map->min[b] = min;
+        map->max[b] = max;
+    }
+    map->n = n;
+    map->blocks = blocks;
+    return true;
+}
+
+bool FP_zone_map_overlaps(const FP_ZoneMap *map, size_t b, int64_t t1, int64_t t2){
+    if (b >= map->blocks){ return false; }
+    return !key_below(map->max[b], FP_sort_key(t1), false) && !key_below(FP_sort_key(t2), map->min[b], false);
+}
@@ -0,0 +1,58 @@
+#ifndef _FP_SEARCH_H
+#define _FP_SEARCH_H
+
+#include "fp_sort.h"
+
+
+// types
+// ============================================================================
+
+#define FP_ZONE_ROWS 4096   // rows per zone map block
+
+// Min/max FP_sort_key() per block of FP_ZONE_ROWS rows of a column, block b
+// covers rows [b*FP_ZONE_ROWS, (b+1)*FP_ZONE_ROWS) of the first n.
+typedef struct {
+    size_t n;          // rows covered
+    size_t blocks;
+    size_t capacity;   // allocated blocks
+    FP_SortKey *min;
+    FP_SortKey *max;
+} FP_ZoneMap;
+
+
+
+// Functions
+// ============================================================================
+
+// Binary search in n flexpochs sorted by FP_sort_key() (e.g. by FP_radix_sort()):
+// the first row whose key is >= / > the key of flexpoch, n if there is none.
+// Branch free down to a few rows, which are compared with SIMD. Nothing is decoded.
+size_t FP_lower_bound(const int64_t *values, size_t n, int64_t flexpoch);
+
+size_t FP_upper_bound(const int64_t *values, size_t n, int64_t flexpoch);
+
+// Rows from t1 to t2 (both included) of n sorted flexpochs: returns their count
+// and the first one in from. With a zone map (may be NULL) only the two blocks
+// that hold the bounds are searched; the map is updated to n rows first.
+size_t FP_range_search(FP_ZoneMap *map, const int64_t *values, size_t n, int64_t t1, int64_t t2,
+                       size_t *from);
+
+
+// Zone maps
+// ----------------------------------------------------------------------------
+
+// empty map, NULL if out of memory
+FP_ZoneMap *FP_zone_map_new(void);
+
+void FP_zone_map_free(FP_ZoneMap *map);
+
+// Cover the first n values. The rows the map already covers must be unchanged
+// (append only), so only the last partial block and the new rows are scanned.
+// A smaller n drops the blocks behind it. Returns false if out of memory.
+bool FP_zone_map_update(FP_ZoneMap *map, const int64_t *values, size_t n);
+
+// true if block b may hold keys from t1 to t2, also for unsorted columns
+bool FP_zone_map_overlaps(const FP_ZoneMap *map, size_t b, int64_t t1, int64_t t2);
+
+
+#endif // _FP_SEARCH_H
@@ -0,0 +1,477 @@
+#include "fp_segment.h"
+#include "fp_direct.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SEG_MAGIC "FPSEG\0\0\1"
+#define SEG_MAGIC_END "FPSEGEND"
+#define SEG_VERSION 1
+#define SEG_SYNC_DEFAULT 1024    // appends per fdatasync()
+#define SEG_INDEX_DEFAULT 64     // records per index entry
+#define SEG_BUFFER (1 << 20)     // write buffer
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+} SegHeader;
+
+typedef struct {
+    int64_t flexpoch;
+    uint32_t len;
+    uint32_t crc;        // of flexpoch, len and the payload
+} SegRecord;
+
+typedef struct {
+    int64_t flexpoch;
+    uint64_t offset;
+} SegIndexEntry;
+
+typedef struct {
+    uint64_t index_offset;
+    uint64_t n_entries;
+    uint64_t n_records;
+    uint32_t crc;        // of the index entries and the fields above
+    uint32_t reserved;
+    char magic[8];
+} SegTrailer;
+
+// records and the footer stay 8 byte aligned in the mapping
+_Static_assert(sizeof(SegHeader) == 16 && sizeof(SegRecord) == 16 && sizeof(SegTrailer) == 40,
+               "segment structs must not be padded");
+
+struct FP_SegmentWriter {
+    int fd;
+    uint64_t size;             // file size incl. the buffered bytes
+    uint64_t n_records;
+    FP_SortKey last;
+    size_t sync_records;
+    size_t index_every;
+    size_t unsynced;           // appends since the last sync
+    SegIndexEntry *index;
+    size_t n_index;
+    size_t index_capacity;
+    char *buf;
+    size_t buf_len;
+    bool failed;               // a failed write could not be cut off again
+};
+
+struct FP_SegmentReader {
+    const char *map;
+    size_t map_size;
+    uint64_t end;              // offset behind the last record
+    uint64_t n_records;
+    const SegIndexEntry *index;
+    size_t n_index;
+    SegIndexEntry *rebuilt;    // index of a segment without footer
+};
+
+
+// CRC-32 (IEEE)
+// ----------------------------------------------------------------------------
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void crc_init(void){
+    for (uint32_t i = 0; i < 256; i++){
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++){
+            c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        }
+        crc_table[i] = c;
+    }
+}
+
+// continue crc (0 to start) over len bytes
+static uint32_t crc32(uint32_t crc, const void *data, size_t len){
+    const uint8_t *p = data;
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++){
+        crc = crc_table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t record_crc(int64_t flexpoch, uint32_t len, const void *data){
+    uint32_t crc = crc32(0, &flexpoch, sizeof(flexpoch));
+    crc = crc32(crc, &len, sizeof(len));
+    return crc32(crc, data, len);
+}
+
+static uint32_t trailer_crc(const SegIndexEntry *index, const SegTrailer *t){
+    uint32_t crc = crc32(0, index, t->n_entries * sizeof(SegIndexEntry));
+    return crc32(crc, t, offsetof(SegTrailer, crc));
+}
+
+static size_t record_size(uint32_t len){
+    return sizeof(SegRecord) + (((size_t)len + 7) & ~(size_t)7);
+}
+
+
+// Segment layout
+// ----------------------------------------------------------------------------
+
+static bool index_push(SegIndexEntry **index, size_t *n, size_t *capacity, int64_t flexpoch, uint64_t offset){
+    if (*n == *capacity){
+        size_t grown = *capacity ? *capacity * 2 : 256;
+        SegIndexEntry *p = realloc(*index, grown * sizeof(SegIndexEntry));
+        if (!p){ return false; }
+        *index = p;
+        *capacity = grown;
+    }
+    (*index)[(*n)++] = (SegIndexEntry){flexpoch, offset};
+    return true;
+}
+
+// the footer of a mapped segment, NULL if it has none (or a damaged one)
+static const SegTrailer *find_trailer(const char *map, size_t size){
+    if (size < sizeof(SegHeader) + sizeof(SegTrailer)){ return NULL; }
+    const SegTrailer *t = (const SegTrailer *)(map + size - sizeof(SegTrailer));
+    if (memcmp(t->magic, SEG_MAGIC_END, 8) != 0 || t->index_offset < sizeof(SegHeader) ||
+        t->n_entries > (size - sizeof(SegTrailer) - t->index_offset) / sizeof(SegIndexEntry) ||
+        t->index_offset + t->n_entries * sizeof(SegIndexEntry) != size - sizeof(SegTrailer)){
+        return NULL;
+    }
+    if (trailer_crc((const SegIndexEntry *)(map + t->index_offset), t) != t->crc){ return NULL; }
+    return t;
+}
+
+// Walk the records from the header on until the first torn or damaged one and
+// rebuild the index. Returns false if out of memory.
+static bool scan_records(const char *map, size_t size, size_t index_every, SegIndexEntry **index,
+                         size_t *n_index, size_t *capacity, uint64_t *end, uint64_t *n_records,
+                         FP_SortKey *last){
+    uint64_t pos = sizeof(SegHeader);
+    uint64_t n = 0;
+    while (size - pos >= sizeof(SegRecord)){
+        const SegRecord *rec = (const SegRecord *)(map + pos);
+        if (record_size(rec->len) > size - pos ||
+            record_crc(rec->flexpoch, rec->len, rec + 1) != rec->crc){
+            break;
+        }
+        if (n % index_every == 0 && !index_push(index, n_index, capacity, rec->flexpoch, pos)){
+            return false;
+        }
+        *last = FP_sort_key(rec->flexpoch);
+        pos += record_size(rec->len);
+        n++;
+    }
+    *end = pos;
+    *n_records = n;
+    return true;
+}
+
+static bool header_ok(const char *map, size_t size){
+    const SegHeader *h = (const SegHeader *)map;
+    return size >= sizeof(SegHeader) && memcmp(h->magic, SEG_MAGIC, 8) == 0 && h->version == SEG_VERSION;
+}
+
+static int write_all(int fd, const char *buf, size_t len){
+    while (len){
+        ssize_t w = write(fd, buf, len);
+        if (w < 0 && errno == EINTR){ continue; }
+        if (w <= 0){ return -1; }
+        buf += w;
+        len -= w;
+    }
+    return 0;
+}
+
+
+// Writing
+// ----------------------------------------------------------------------------
+
+// After a failed write: cut the file back behind the last written record, so that
+// the buffered records can be written again without the partial bytes in front.
+static ErrNo writer_rollback(FP_SegmentWriter *w){
+    int saved_errno = errno;
+    uint64_t end = w->size - w->buf_len;
+    if (ftruncate(w->fd, end) != 0 || lseek(w->fd, end, SEEK_SET) < 0){
+        w->failed = true;   // the offsets of later records would be wrong
+    }
+    errno = saved_errno;
+    return ERR_IO;
+}
+
+static ErrNo writer_flush(FP_SegmentWriter *w){
+    if (w->failed){
+        errno = EIO;
+        return ERR_IO;
+    }
+    if (w->buf_len && write_all(w->fd, w->buf, w->buf_len) != 0){ return writer_rollback(w); }
+    w->buf_len = 0;
+    return SUCCESS;
+}
+
+static void writer_free(FP_SegmentWriter *w){
+    if (w->fd >= 0){ close(w->fd); }
+    free(w->index);
+    free(w->buf);
+    free(w);
+}
+
+// Pick up an existing segment: load or rebuild its index and cut the file
+// back to the end of its records.
+static ErrNo writer_resume(FP_SegmentWriter *w, size_t size){
+    const char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, w->fd, 0);
+    if (map == MAP_FAILED){ return ERR_IO; }
+    ErrNo error = SUCCESS;
+    const SegTrailer *t = find_trailer(map, size);
+    if (!header_ok(map, size)){
+        errno = EINVAL;
+        error = ERR_IO;
+    } else if (t){
+        const SegIndexEntry *index = (const SegIndexEntry *)(map + t->index_offset);
+        for (size_t i = 0; i < t->n_entries && error == SUCCESS; i++){
+            if (!index_push(&w->index, &w->n_index, &w->index_capacity, index[i].flexpoch, index[i].offset)){
+                error = ERR_IO;
+            }
+        }
+        // the last key: walk the records behind the last index entry
+        uint64_t pos = t->n_entries ? index[t->n_entries - 1].offset : t->index_offset;
+        while (pos < t->index_offset){
+            const SegRecord *rec = (const SegRecord *)(map + pos);
+            w->last = FP_sort_key(rec->flexpoch);
+            pos += record_size(rec->len);
+        }
+        w->size = t->index_offset;
+        w->n_records = t->n_records;
+    } else if (!scan_records(map, size, w->index_every, &w->index, &w->n_index, &w->index_capacity,
+                             &w->size, &w->n_records, &w->last)){
+        error = ERR_IO;
+    }
+    int saved_errno = errno;
+    munmap((void *)map, size);
+    errno = saved_errno;
+    if (error == SUCCESS && w->size != size && (ftruncate(w->fd, w->size) != 0 || fdatasync(w->fd) != 0)){
+        error = ERR_IO;
+    }
+    // appends continue behind the last record
+    if (error == SUCCESS && lseek(w->fd, w->size, SEEK_SET) < 0){
+        error = ERR_IO;
+    }
+    return error;
+}
+
+ErrNo FP_segment_writer_open(const char *path, const FP_SegmentOptions *opt, FP_SegmentWriter **out){
+    pthread_once(&crc_once, crc_init);
+    *out = NULL;
+    FP_SegmentWriter *w = calloc(1, sizeof(FP_SegmentWriter));
+    if (!w){ return ERR_IO; }
+    w->fd = -1;
+    w->sync_records = (opt && opt->sync_records) ? opt->sync_records : SEG_SYNC_DEFAULT;
+    w->index_every = (opt && opt->index_every) ? opt->index_every : SEG_INDEX_DEFAULT;
+    w->buf = malloc(SEG_BUFFER);
+    if (!w->buf){
+        writer_free(w);
+        return ERR_IO;
+    }
+
+    w->fd = open(path, O_RDWR | O_CREAT, 0644);
+    struct stat st;
+    if (w->fd < 0 || fstat(w->fd, &st) != 0){
+        int saved_errno = errno;
+        writer_free(w);
+        errno = saved_errno;
+        return ERR_IO;
+    }
+
+    ErrNo error = SUCCESS;
+    if (st.st_size == 0){
+        SegHeader h = {SEG_MAGIC, SEG_VERSION, 0};
+        if (write_all(w->fd, (const char *)&h, sizeof(h)) != 0 || fdatasync(w->fd) != 0){
+            error = ERR_IO;
+        }
+        w->size = sizeof(h);
+    } else {
+        error = writer_resume(w, st.st_size);
+    }
+    if (error != SUCCESS){
+        int saved_errno = errno;
+        writer_free(w);
+        errno = saved_errno;
+        return error;
+    }
+    *out = w;
+    return SUCCESS;
+}
+
+ErrNo FP_segment_append(FP_SegmentWriter *w, int64_t flexpoch, const void *data, uint32_t len){
+    ErrNo error = fp_direct_validate(flexpoch);
+    if (error != SUCCESS){ return error; }
+    FP_SortKey key = FP_sort_key(flexpoch);
+    if (w->n_records && FP_sort_key_cmp(key, w->last) < 0){ return ERR_OUT_OF_RANGE; }
+    if (w->failed){
+        errno = EIO;
+        return ERR_IO;
+    }
+
+    size_t size = record_size(len);
+    if (size > SEG_BUFFER - w->buf_len && writer_flush(w) != SUCCESS){ return ERR_IO; }
+
+    SegRecord rec = {flexpoch, len, record_crc(flexpoch, len, data)};
+    static const char padding[8] = {0};
+    if (size <= SEG_BUFFER){
+        memcpy(w->buf + w->buf_len, &rec, sizeof(rec));
+        memcpy(w->buf + w->buf_len + sizeof(rec), data, len);
+        memset(w->buf + w->buf_len + sizeof(rec) + len, 0, size - sizeof(rec) - len);
+        w->buf_len += size;
+    } else if (write_all(w->fd, (const char *)&rec, sizeof(rec)) != 0 || write_all(w->fd, data, len) != 0 ||
+               write_all(w->fd, padding, size - sizeof(rec) - len) != 0){
+        return writer_rollback(w);   // the buffer is empty here
+    }
+    // without memory for the entry the seeks just scan a longer block
+    if (w->n_records % w->index_every == 0){
+        index_push(&w->index, &w->n_index, &w->index_capacity, flexpoch, w->size);
+    }
+    w->size += size;
+    w->n_records++;
+    w->last = key;
+
+    if (++w->unsynced >= w->sync_records){
+        return FP_segment_sync(w);
+    }
+    return SUCCESS;
+}
+
+ErrNo FP_segment_sync(FP_SegmentWriter *w){
+    if (writer_flush(w) != SUCCESS || fdatasync(w->fd) != 0){ return ERR_IO; }
+    w->unsynced = 0;
+    return SUCCESS;
+}
+
+ErrNo FP_segment_writer_close(FP_SegmentWriter *w){
+    SegTrailer t = {w->size, w->n_index, w->n_records, 0, 0, SEG_MAGIC_END};
+    t.crc = trailer_crc(w->index, &t);
+    // records first, so a torn footer never hides them
+    ErrNo error = FP_segment_sync(w);
+    if (error == SUCCESS &&
+        (write_all(w->fd, (const char *)w->index, w->n_index * sizeof(SegIndexEntry)) != 0 ||
+         write_all(w->fd, (const char *)&t, sizeof(t)) != 0 || fdatasync(w->fd) != 0)){
+        error = writer_rollback(w);   // a reopen rebuilds the index
+    }
+    int saved_errno = errno;
+    if (close(w->fd) != 0 && error == SUCCESS){
+        saved_errno = errno;
+        error = ERR_IO;
+    }
+    w->fd = -1;
+    writer_free(w);
+    errno = saved_errno;
+    return error;
+}
+
+size_t FP_segment_writer_count(const FP_SegmentWriter *w){
+    return w->n_records;
+}
+
+
+// Reading
+// ----------------------------------------------------------------------------
+
+ErrNo FP_segment_reader_open(const char *path, FP_SegmentReader **out){
+    pthread_once(&crc_once, crc_init);
+    *out = NULL;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0){ return ERR_IO; }
+    struct stat st;
+    if (fstat(fd, &st) != 0){
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return ERR_IO;
+    }
+    size_t size = st.st_size;
+    const char *map = (size > 0) ? mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    int saved_errno = (size > 0) ? errno : EINVAL;
+    close(fd);
+    if (map == MAP_FAILED){
+        errno = saved_errno;
+        return ERR_IO;
+    }
+
+    if (!header_ok(map, size)){
+        munmap((void *)map, size);
+        errno = EINVAL;
+        return ERR_IO;
+    }
+    FP_SegmentReader *r = calloc(1, sizeof(FP_SegmentReader));
+    if (!r){
+        munmap((void *)map, size);
+        return ERR_IO;
+    }
+    r->map = map;
+    r->map_size = size;
+
+    const SegTrailer *t = find_trailer(map, size);
+    if (t){
+        r->end = t->index_offset;
+        r->n_records = t->n_records;
+        r->index = (const SegIndexEntry *)(map + t->index_offset);
+        r->n_index = t->n_entries;
+    } else {
+        size_t capacity = 0;
+        FP_SortKey last;
+        if (!scan_records(map, size, SEG_INDEX_DEFAULT, &r->rebuilt, &r->n_index, &capacity,
+                          &r->end, &r->n_records, &last)){
+            FP_segment_reader_close(r);
+            errno = ENOMEM;
+            return ERR_IO;
+        }
+        r->index = r->rebuilt;
+    }
+    *out = r;
+    return SUCCESS;
+}
+
+void FP_segment_reader_close(FP_SegmentReader *r){
+    if (!r){ return; }
+    munmap((void *)r->map, r->map_size);
+    free(r->rebuilt);
+    free(r);
+}
+
+size_t FP_segment_count(const FP_SegmentReader *r){
+    return r->n_records;
+}
+
+void FP_segment_seek(const FP_SegmentReader *r, int64_t t1, int64_t t2, FP_SegmentCursor *cur){
+    FP_SortKey first = FP_sort_key(t1);
+    *cur = (FP_SegmentCursor){r, r->end, FP_sort_key(t2)};
+
+    // first index entry not below t1, the range may start in the block before it
+    size_t lo = 0, hi = r->n_index;
+    while (lo < hi){
+        size_t mid = lo + (hi - lo) / 2;
+        if (FP_sort_key_cmp(FP_sort_key(r->index[mid].flexpoch), first) < 0){ lo = mid + 1; } else { hi = mid; }
+    }
+    if (r->n_index == 0){ return; }
+    uint64_t pos = r->index[lo ? lo - 1 : 0].offset;
+    while (pos < r->end){
+        const SegRecord *rec = (const SegRecord *)(r->map + pos);
+        if (FP_sort_key_cmp(FP_sort_key(rec->flexpoch), first) >= 0){ break; }
+        pos += record_size(rec->len);
+    }
+    cur->pos = pos;
+}
+
+bool FP_segment_next(FP_SegmentCursor *cur, FP_SegmentRecord *rec){
+    const FP_SegmentReader *r = cur->seg;
+    if (cur->pos >= r->end){ return false; }
+    const SegRecord *head = (const SegRecord *)(r->map + cur->pos);
+    if (FP_sort_key_cmp(FP_sort_key(head->flexpoch), cur->last) > 0){
+        cur->pos = r->end;
+        return false;
+    }
+    *rec = (FP_SegmentRecord){head->flexpoch, head + 1, head->len};
+    cur->pos += record_size(head->len);
+    return true;
+}
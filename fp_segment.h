@@ -0,0 +1,90 @@
+#ifndef _FP_SEGMENT_H
+#define _FP_SEGMENT_H
+
+#include "fp_sort.h"
+
+// Segment files: append-only records keyed by a flexpoch in FP_sort_key() order.
+//
+//   header   "FPSEG\0\0\1", version, reserved                        16 bytes
+//   records  flexpoch, payload length, CRC-32, payload padded to 8   16 + len bytes
+//   footer   sparse index {flexpoch, file offset} of every index_every-th record,
+//            trailer {index offset, entries, records, CRC-32, "FPSEGEND"}
+//
+// All fields are in host byte order. The footer is written when a writer is
+// closed and dropped again when the segment is reopened for appending. A segment
+// without a valid footer (the writer crashed) is recovered by scanning the
+// records: the first one with a bad length or CRC ends the segment.
+
+
+// types
+// ============================================================================
+
+typedef struct FP_SegmentWriter FP_SegmentWriter;
+typedef struct FP_SegmentReader FP_SegmentReader;
+
+typedef struct {
+    size_t sync_records;   // fdatasync() after this many appends, 0 = default, SIZE_MAX = only on sync/close
+    size_t index_every;    // records per sparse index entry, 0 = default
+} FP_SegmentOptions;
+
+typedef struct {
+    int64_t flexpoch;
+    const void *data;      // points into the mapped file
+    uint32_t len;
+} FP_SegmentRecord;
+
+// records of FP_segment_seek() in order, advanced by FP_segment_next()
+typedef struct {
+    const FP_SegmentReader *seg;
+    uint64_t pos;          // file offset of the next record
+    FP_SortKey last;       // key of t2
+} FP_SegmentCursor;
+
+
+
+// Functions
+// ============================================================================
+
+// Writing
+// ----------------------------------------------------------------------------
+
+// Create path or reopen it for appending (NULL opt for the defaults). A torn tail
+// from a crash is cut off. Returns ERR_IO (see errno, EINVAL for a file that is
+// no segment) if the file cannot be opened or repaired.
+ErrNo FP_segment_writer_open(const char *path, const FP_SegmentOptions *opt, FP_SegmentWriter **out);
+
+// Append a record. Returns the ErrNo of an invalid flexpoch, ERR_OUT_OF_RANGE if
+// its key is below the one of the last record and ERR_IO if the write failed.
+// Records are buffered and durable after the next batched or explicit sync.
+// A failed write is cut off the file again and the buffered records stay for the
+// next sync; if the file cannot be cut, every further write fails with ERR_IO.
+ErrNo FP_segment_append(FP_SegmentWriter *w, int64_t flexpoch, const void *data, uint32_t len);
+
+// write out the buffered records and fdatasync() them
+ErrNo FP_segment_sync(FP_SegmentWriter *w);
+
+// Sync, write the footer and close. The writer is freed even on ERR_IO.
+ErrNo FP_segment_writer_close(FP_SegmentWriter *w);
+
+size_t FP_segment_writer_count(const FP_SegmentWriter *w);
+
+
+// Reading
+// ----------------------------------------------------------------------------
+
+// mmap a segment. Without a footer the index is rebuilt by a scan.
+ErrNo FP_segment_reader_open(const char *path, FP_SegmentReader **out);
+
+void FP_segment_reader_close(FP_SegmentReader *r);
+
+size_t FP_segment_count(const FP_SegmentReader *r);
+
+// Position cur on the first record from t1 to t2 (both included): a binary
+// search in the sparse index and a scan of at most index_every records.
+void FP_segment_seek(const FP_SegmentReader *r, int64_t t1, int64_t t2, FP_SegmentCursor *cur);
+
+// next record up to t2, false at the end of the range
+bool FP_segment_next(FP_SegmentCursor *cur, FP_SegmentRecord *rec);
+
+
+#endif // _FP_SEGMENT_H
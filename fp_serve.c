@@ -0,0 +1,508 @@
+#include "fp_serve.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SERVE_MAX_EVENTS 64
+#define SERVE_MAX_PAYLOAD ((size_t)FP_SERVE_MAX_COUNT * FP_ISO_MAX_LEN)
+#define SERVE_MIN_BUF 4096
+
+typedef struct Conn {
+    int fd;
+    uint32_t watched;        // epoll events, 0 = not registered
+    char *in;                // received bytes, the first request is at in[0]
+    size_t in_len;
+    size_t in_cap;
+    size_t req_len;          // bytes of the request at a worker
+    char *out;               // response, NULL if none pending
+    size_t out_len;
+    size_t out_pos;
+    bool busy;               // request at a worker, only the worker touches in/out
+    bool eof;                // peer stopped sending or the connection broke
+    struct Conn *next;       // work / done queue
+    struct Conn *prev_all, *next_all;
+} Conn;
+
+typedef struct {
+    int epoll_fd;
+    int done_fd;             // eventfd, wakes the epoll thread for finished requests
+    int signal_fd;           // signalfd of the blocked SIGINT/SIGTERM
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    Conn *work_head, *work_tail;
+    Conn *done;
+    Conn *all;
+    bool stop;
+} Server;
+
+// consume the pending SIGINT/SIGTERM, true if there was one
+static bool serve_signalled(int signal_fd){
+    struct signalfd_siginfo info;
+    bool got = false;
+    while (read(signal_fd, &info, sizeof(info)) == sizeof(info)){ got = true; }
+    return got;
+}
+
+
+// Conversion
+// ----------------------------------------------------------------------------
+
+static bool serve_valid(const FP_ServeHeader *hdr){
+    return hdr->magic == FP_SERVE_MAGIC && hdr->count <= FP_SERVE_MAX_COUNT && hdr->length <= SERVE_MAX_PAYLOAD
+        && FIELD_FP <= hdr->from && hdr->from <= FIELD_JAVA && FIELD_FP <= hdr->to && hdr->to <= FIELD_JAVA;
+}
+
+// header only response
+static void serve_fail(Conn *c, ErrNo status){
+    FP_ServeHeader resp = {FP_SERVE_MAGIC, 0, 0, status, 0, 0};
+    c->out = malloc(sizeof(resp));
+    if (c->out){ memcpy(c->out, &resp, sizeof(resp)); }
+    c->out_len = c->out ? sizeof(resp) : 0;
+    c->out_pos = 0;
+}
+
+// request at c->in -> response at c->out: every value goes through a flexpoch
+static void serve_convert(Conn *c){
+    FP_ServeHeader req;
+    memcpy(&req, c->in, sizeof(req));
+    const char *payload = c->in + sizeof(req);
+    size_t n = req.count;
+    size_t err_bytes = (n * sizeof(int16_t) + 7) & ~(size_t)7;
+
+    char *out = malloc(sizeof(req) + FP_SERVE_MAX_RESPONSE(n));
+    int64_t *fp = malloc(n * sizeof(int64_t) + 1);
+    int16_t *err2 = malloc(n * sizeof(int16_t) + 1);
+    size_t *offsets = (req.from == FIELD_ISO) ? malloc((n + 1) * sizeof(size_t)) : NULL;
+    uint64_t *mask = (req.from == FIELD_ISO) ? calloc(n / 64 + 1, sizeof(uint64_t)) : NULL;
+    ErrNo status = SUCCESS;
+    if (!out || !fp || !err2 || (req.from == FIELD_ISO && (!offsets || !mask))){
+        status = ERR_IO;   // out of memory
+    } else if (req.from != FIELD_ISO && req.length != n * sizeof(int64_t)){
+        status = ERR_OUT_OF_RANGE;
+    }
+    int16_t *err = (int16_t *)(out + sizeof(req));
+    char *values = out + sizeof(req) + err_bytes;
+
+    // lines of an ISO payload
+    if (status == SUCCESS && req.from == FIELD_ISO){
+        const char *p = payload, *end = payload + req.length;
+        for (size_t i = 0; i < n; i++){
+            const char *nl = memchr(p, '\n', end - p);
+            if (!nl){
+                status = ERR_INVALID_ISO;
+                break;
+            }
+            offsets[i] = p - payload;
+            p = nl + 1;
+        }
+        offsets[n] = p - payload;
+    }
+
+    size_t len = 0;
+    if (status == SUCCESS){
+        memset(err, 0, n * sizeof(int16_t));
+        switch (req.from){
+            case FIELD_FP:
+                memcpy(fp, payload, n * sizeof(int64_t));
+                break;
+            case FIELD_UNIX:
+                FP_from_unix_batch((const int64_t *)payload, n, PRC_SECOND, 0, fp, err);
+                break;
+            case FIELD_JAVA:
+                FP_from_java_batch((const int64_t *)payload, n, PRC_MILLISEC, 0, fp, err);
+                break;
+            default:
+                FP_from_iso_batch(payload, offsets, 0, n, fp, mask);
+                for (size_t i = 0; i < n; i++){
+                    if ((mask[i / 64] >> (i % 64)) & 1){ err[i] = ERR_INVALID_ISO; }
+                }
+                break;
+        }
+
+        switch (req.to){
+            case FIELD_FP:
+                memcpy(values, fp, n * sizeof(int64_t));
+                len = n * sizeof(int64_t);
+                break;
+            case FIELD_UNIX:
+                FP_to_unix_batch(fp, n, (int64_t *)values, err2);
+                len = n * sizeof(int64_t);
+                break;
+            case FIELD_JAVA:
+                FP_to_java_batch(fp, n, (int64_t *)values, err2);
+                len = n * sizeof(int64_t);
+                break;
+            default:
+                len = FP_to_iso_lines(fp, n, values, err2);
+                break;
+        }
+        if (req.to != FIELD_FP){   // first error of the two steps
+            for (size_t i = 0; i < n; i++){
+                if (!err[i]){ err[i] = err2[i]; }
+            }
+        }
+    }
+
+    free(fp);
+    free(err2);
+    free(offsets);
+    free(mask);
+    if (status != SUCCESS || !out){
+        free(out);
+        serve_fail(c, status);
+        return;
+    }
+    FP_ServeHeader resp = {FP_SERVE_MAGIC, req.from, req.to, SUCCESS, req.count, (uint32_t)(err_bytes + len)};
+    memcpy(out, &resp, sizeof(resp));
+    c->out = out;
+    c->out_len = sizeof(resp) + resp.length;
+    c->out_pos = 0;
+}
+
+static void *serve_worker(void *arg){
+    Server *srv = arg;
+    for (;;){
+        pthread_mutex_lock(&srv->lock);
+        while (!srv->work_head && !srv->stop){
+            pthread_cond_wait(&srv->work, &srv->lock);
+        }
+        if (srv->stop){
+            pthread_mutex_unlock(&srv->lock);
+            return NULL;
+        }
+        Conn *c = srv->work_head;
+        srv->work_head = c->next;
+        if (!srv->work_head){ srv->work_tail = NULL; }
+        pthread_mutex_unlock(&srv->lock);
+
+        serve_convert(c);
+
+        pthread_mutex_lock(&srv->lock);
+        c->next = srv->done;
+        srv->done = c;
+        pthread_mutex_unlock(&srv->lock);
+        uint64_t one = 1;
+        if (write(srv->done_fd, &one, sizeof(one)) < 0){ /* counter is already non-zero */ }
+    }
+}
+
+
+// Connections (epoll thread only)
+// ----------------------------------------------------------------------------
+
+static void conn_watch(Server *srv, Conn *c, uint32_t events){
+    if (events == c->watched){ return; }
+    struct epoll_event ev = {.events = events, .data.ptr = c};
+    if (!events){
+        epoll_ctl(srv->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);   // no EPOLLHUP spin while busy
+    } else {
+        epoll_ctl(srv->epoll_fd, c->watched ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, c->fd, &ev);
+    }
+    c->watched = events;
+}
+
+static void conn_close(Server *srv, Conn *c){
+    conn_watch(srv, c, 0);
+    close(c->fd);
+    if (c->prev_all){ c->prev_all->next_all = c->next_all; } else { srv->all = c->next_all; }
+    if (c->next_all){ c->next_all->prev_all = c->prev_all; }
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+// false while the socket buffer is full
+static bool conn_flush(Conn *c){
+    while (c->out && c->out_pos < c->out_len){
+        ssize_t w = send(c->fd, c->out + c->out_pos, c->out_len - c->out_pos, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR){ continue; }
+        if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){ return false; }
+        if (w < 0){
+            c->eof = true;
+            c->in_len = 0;
+            break;
+        }
+        c->out_pos += w;
+    }
+    free(c->out);
+    c->out = NULL;
+    return true;
+}
+
+static void conn_read(Conn *c){
+    for (;;){
+        if (c->in_len == c->in_cap){
+            size_t cap = c->in_cap ? 2 * c->in_cap : SERVE_MIN_BUF;
+            if (cap > sizeof(FP_ServeHeader) + SERVE_MAX_PAYLOAD){ cap = sizeof(FP_ServeHeader) + SERVE_MAX_PAYLOAD; }
+            if (cap == c->in_cap){ return; }   // a whole request is buffered
+            char *in = realloc(c->in, cap);
+            if (!in){ return; }
+            c->in = in;
+            c->in_cap = cap;
+        }
+        ssize_t r = read(c->fd, c->in + c->in_len, c->in_cap - c->in_len);
+        if (r < 0 && errno == EINTR){ continue; }
+        if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){ return; }
+        if (r <= 0){
+            c->eof = true;
+            return;
+        }
+        c->in_len += r;
+    }
+}
+
+// hand the next buffered request to a worker, or wait for more bytes / the socket
+static void conn_next(Server *srv, Conn *c){
+    if (c->busy){ return; }
+    if (c->out && !conn_flush(c)){
+        conn_watch(srv, c, EPOLLOUT);
+        return;
+    }
+    if (c->in_len >= sizeof(FP_ServeHeader)){
+        FP_ServeHeader hdr;
+        memcpy(&hdr, c->in, sizeof(hdr));
+        if (!serve_valid(&hdr)){   // no way to find the next request, answer and hang up
+            serve_fail(c, ERR_OUT_OF_RANGE);
+            c->in_len = 0;
+            c->eof = true;
+            conn_next(srv, c);
+            return;
+        }
+        if (c->in_len >= sizeof(hdr) + hdr.length){
+            c->req_len = sizeof(hdr) + hdr.length;
+            c->busy = true;
+            conn_watch(srv, c, 0);
+            pthread_mutex_lock(&srv->lock);
+            c->next = NULL;
+            if (srv->work_tail){ srv->work_tail->next = c; } else { srv->work_head = c; }
+            srv->work_tail = c;
+            pthread_cond_signal(&srv->work);
+            pthread_mutex_unlock(&srv->lock);
+            return;
+        }
+    }
+    if (c->eof){
+        conn_close(srv, c);
+        return;
+    }
+    conn_watch(srv, c, EPOLLIN);
+}
+
+static void serve_accept(Server *srv, int listen_fd){
+    for (;;){
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0){ return; }
+        Conn *c = calloc(1, sizeof(Conn));
+        if (!c){
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->next_all = srv->all;
+        if (srv->all){ srv->all->prev_all = c; }
+        srv->all = c;
+        conn_watch(srv, c, EPOLLIN);
+    }
+}
+
+static void serve_done(Server *srv){
+    uint64_t count;
+    if (read(srv->done_fd, &count, sizeof(count)) < 0){ return; }
+    pthread_mutex_lock(&srv->lock);
+    Conn *c = srv->done;
+    srv->done = NULL;
+    pthread_mutex_unlock(&srv->lock);
+    while (c){
+        Conn *next = c->next;
+        c->busy = false;
+        c->in_len -= c->req_len;
+        memmove(c->in, c->in + c->req_len, c->in_len);
+        conn_next(srv, c);
+        c = next;
+    }
+}
+
+
+// Public functions
+// ----------------------------------------------------------------------------
+
+ErrNo FP_serve(const char *path, int workers){
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)){
+        errno = ENAMETOOLONG;
+        return ERR_IO;
+    }
+    strcpy(addr.sun_path, path);
+
+    Server srv = {.epoll_fd = -1, .done_fd = -1, .signal_fd = -1};
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0){ return ERR_IO; }
+    unlink(path);
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, SOMAXCONN) != 0){
+        int saved_errno = errno;
+        close(listen_fd);
+        errno = saved_errno;
+        return ERR_IO;
+    }
+
+    // SIGINT/SIGTERM are blocked before the workers inherit the mask and arrive
+    // through a signalfd in the epoll loop, no thread takes them in a handler
+    sigset_t stop_set, old_mask;
+    sigemptyset(&stop_set);
+    sigaddset(&stop_set, SIGINT);
+    sigaddset(&stop_set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_set, &old_mask);
+
+    srv.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    srv.done_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    srv.signal_fd = signalfd(-1, &stop_set, SFD_NONBLOCK | SFD_CLOEXEC);
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = &listen_fd};
+    struct epoll_event done_ev = {.events = EPOLLIN, .data.ptr = &srv.done_fd};
+    struct epoll_event signal_ev = {.events = EPOLLIN, .data.ptr = &srv.signal_fd};
+    if (srv.epoll_fd < 0 || srv.done_fd < 0 || srv.signal_fd < 0
+        || epoll_ctl(srv.epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) != 0
+        || epoll_ctl(srv.epoll_fd, EPOLL_CTL_ADD, srv.done_fd, &done_ev) != 0
+        || epoll_ctl(srv.epoll_fd, EPOLL_CTL_ADD, srv.signal_fd, &signal_ev) != 0){
+        int saved_errno = errno;
+        if (srv.epoll_fd >= 0){ close(srv.epoll_fd); }
+        if (srv.done_fd >= 0){ close(srv.done_fd); }
+        if (srv.signal_fd >= 0){ close(srv.signal_fd); }
+        pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+        close(listen_fd);
+        unlink(path);
+        errno = saved_errno;
+        return ERR_IO;
+    }
+
+    pthread_mutex_init(&srv.lock, NULL);
+    pthread_cond_init(&srv.work, NULL);
+    if (workers <= 0){ workers = (int)sysconf(_SC_NPROCESSORS_ONLN); }
+    if (workers < 1){ workers = 1; }
+    pthread_t *tids = calloc(workers, sizeof(pthread_t));
+    int n_workers = 0;
+    while (tids && n_workers < workers && pthread_create(&tids[n_workers], NULL, serve_worker, &srv) == 0){
+        n_workers++;
+    }
+
+    struct epoll_event events[SERVE_MAX_EVENTS];
+    bool stop = false;
+    while (!stop && n_workers > 0){
+        int k = epoll_wait(srv.epoll_fd, events, SERVE_MAX_EVENTS, -1);
+        if (k < 0 && errno == EINTR){ continue; }
+        if (k < 0){ break; }
+        for (int i = 0; i < k; i++){
+            void *ptr = events[i].data.ptr;
+            if (ptr == &listen_fd){
+                serve_accept(&srv, listen_fd);
+            } else if (ptr == &srv.done_fd){
+                serve_done(&srv);
+            } else if (ptr == &srv.signal_fd){
+                stop = serve_signalled(srv.signal_fd);
+            } else {
+                Conn *c = ptr;
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)){ conn_read(c); }
+                conn_next(&srv, c);
+            }
+        }
+    }
+
+    // workers finish their current request, queued ones are dropped
+    pthread_mutex_lock(&srv.lock);
+    srv.stop = true;
+    pthread_cond_broadcast(&srv.work);
+    pthread_mutex_unlock(&srv.lock);
+    for (int t = 0; t < n_workers; t++){
+        pthread_join(tids[t], NULL);
+    }
+    free(tids);
+    while (srv.all){
+        conn_close(&srv, srv.all);
+    }
+    pthread_cond_destroy(&srv.work);
+    pthread_mutex_destroy(&srv.lock);
+    // a signal that came in meanwhile would hit the caller's handler on unblocking
+    serve_signalled(srv.signal_fd);
+    close(srv.signal_fd);
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    close(srv.done_fd);
+    close(srv.epoll_fd);
+    close(listen_fd);
+    unlink(path);
+    return SUCCESS;
+}
+
+
+// Client
+// ----------------------------------------------------------------------------
+
+static int send_all(int fd, const void *buf, size_t len){
+    const char *p = buf;
+    while (len){
+        ssize_t w = send(fd, p, len, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR){ continue; }
+        if (w <= 0){ return -1; }
+        p += w;
+        len -= w;
+    }
+    return 0;
+}
+
+// out == NULL discards the bytes
+static int recv_all(int fd, void *buf, size_t len){
+    char scratch[4096];
+    char *p = buf;
+    while (len){
+        size_t chunk = p ? len : (len < sizeof(scratch) ? len : sizeof(scratch));
+        ssize_t r = recv(fd, p ? p : scratch, chunk, 0);
+        if (r < 0 && errno == EINTR){ continue; }
+        if (r <= 0){
+            if (r == 0){ errno = ECONNRESET; }
+            return -1;
+        }
+        if (p){ p += r; }
+        len -= r;
+    }
+    return 0;
+}
+
+int FP_client_connect(const char *path){
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)){
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0){ return -1; }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0){
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+    return fd;
+}
+
+ErrNo FP_client_request(int fd, FP_FieldFormat from, FP_FieldFormat to, uint32_t count,
+                        const void *payload, uint32_t length, FP_ServeHeader *resp,
+                        void *out, size_t size){
+    FP_ServeHeader req = {FP_SERVE_MAGIC, from, to, SUCCESS, count, length};
+    if (send_all(fd, &req, sizeof(req)) != 0 || send_all(fd, payload, length) != 0){ return ERR_IO; }
+    if (recv_all(fd, resp, sizeof(*resp)) != 0){ return ERR_IO; }
+    if (resp->magic != FP_SERVE_MAGIC){
+        errno = EPROTO;
+        return ERR_IO;
+    }
+    if (resp->length > size){
+        return recv_all(fd, NULL, resp->length) == 0 ? ERR_OUT_OF_RANGE : ERR_IO;
+    }
+    if (recv_all(fd, out, resp->length) != 0){ return ERR_IO; }
+    return resp->status;
+}
@@ -0,0 +1,53 @@
+#ifndef _FP_SERVE_H
+#define _FP_SERVE_H
+
+#include "fp_batch.h"
+#include "fp_transcode.h"  // FP_FieldFormat
+
+#define FP_SERVE_MAGIC 0x31535046u   // "FPS1"
+#define FP_SERVE_MAX_COUNT 65536     // values per request
+
+// payload bytes of a response with count values (upper bound)
+#define FP_SERVE_MAX_RESPONSE(count) ((size_t)(count) * (2 + FP_ISO_MAX_LEN) + 8)
+
+
+// types
+// ============================================================================
+
+// Request and response header, host byte order (the socket is local).
+// Request payload: count int64 for FIELD_FP/UNIX/JAVA, count '\n' terminated
+// strings for FIELD_ISO. Response payload: count int16 row ErrNos padded to 8
+// bytes, then the values in the to-format layout (failed rows INT64_MIN or empty).
+typedef struct {
+    uint32_t magic;
+    int8_t from;         // FP_FieldFormat, no FIELD_AUTO
+    int8_t to;
+    int16_t status;      // response: ErrNo for the whole request, ERR_IO if the server is out of memory
+    uint32_t count;
+    uint32_t length;     // payload bytes after the header
+} FP_ServeHeader;
+
+
+
+// Functions
+// ============================================================================
+
+// Answer requests on a UNIX domain socket at path (replaced if it exists) until
+// SIGINT/SIGTERM, which are blocked in the calling thread and its workers while
+// serving. One epoll thread handles all connections, conversions run on worker
+// threads (0 = online CPUs). Returns ERR_IO (see errno) if the socket cannot be
+// set up.
+ErrNo FP_serve(const char *path, int workers);
+
+// connect to FP_serve(), returns the socket or -1 (see errno)
+int FP_client_connect(const char *path);
+
+// One round trip. The response payload is stored in out (size bytes, see
+// FP_SERVE_MAX_RESPONSE), its header in resp. Returns ERR_IO on socket errors,
+// ERR_OUT_OF_RANGE if out is too small, otherwise resp->status.
+ErrNo FP_client_request(int fd, FP_FieldFormat from, FP_FieldFormat to, uint32_t count,
+                        const void *payload, uint32_t length, FP_ServeHeader *resp,
+                        void *out, size_t size);
+
+
+#endif // _FP_SERVE_H
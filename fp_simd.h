@@ -0,0 +1,120 @@
+/* Portable SIMD helpers for the Flexpoch batch kernels.
+ *
+ * Kernels are written once with GCC vector extensions on a fixed lane count.
+ * On x86-64 they are cloned for AVX-512 and AVX2 and selected at load time
+ * (ifunc), on aarch64 the same code is lowered to NEON. Plain SSE2 lacks 64 bit
+ * compares, so callers fall back to their scalar path there (fp_simd_available).
+ */
+
+#ifndef _FP_SIMD_H
+#define _FP_SIMD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define FP_VLANES 4   // 4x64 bit: one ymm or two xmm/NEON registers
+
+typedef int64_t  fp_vi64 __attribute__((vector_size(8*FP_VLANES)));
+typedef uint64_t fp_vu64 __attribute__((vector_size(8*FP_VLANES)));
+typedef double   fp_vf64 __attribute__((vector_size(8*FP_VLANES)));
+typedef int32_t  fp_vi32 __attribute__((vector_size(4*FP_VLANES)));
+typedef uint32_t fp_vu32 __attribute__((vector_size(4*FP_VLANES)));
+typedef float    fp_vf32 __attribute__((vector_size(4*FP_VLANES)));
+typedef int16_t  fp_vi16 __attribute__((vector_size(2*FP_VLANES)));
+typedef int8_t   fp_vi8  __attribute__((vector_size(1*FP_VLANES)));
+typedef uint8_t  fp_vu8  __attribute__((vector_size(1*FP_VLANES)));
+
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__)
+#define FP_SIMD_X86 1
+#define FP_SIMD_CLONES __attribute__((target_clones("arch=x86-64-v4", "avx2", "default")))
+#else
+#define FP_SIMD_X86 0
+#define FP_SIMD_CLONES
+#endif
+
+// true if the cloned kernels run on real 64 bit vector units
+static inline bool fp_simd_available(void){
+#if FP_SIMD_X86
+    return __builtin_cpu_supports("avx2");
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    return true;
+#else
+    return false;
+#endif
+}
+
+// name of the instruction set used by the cloned kernels
+static inline const char *fp_simd_name(void){
+#if FP_SIMD_X86
+    if (__builtin_cpu_supports("x86-64-v4")){ return "avx512"; }
+    if (__builtin_cpu_supports("avx2")){ return "avx2"; }
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    return "neon";
+#endif
+    return "scalar";
+}
+
+// lane-wise select with a 0/-1 mask (C has no vector ternary)
+#define FP_VSEL(mask, a, b) (((mask) & (a)) | (~(mask) & (b)))
+
+#define FP_VLOAD(dst, src)  memcpy(&(dst), (src), sizeof(dst))
+#define FP_VSTORE(dst, src) memcpy((dst), &(src), sizeof(src))
+
+#define FP_MAGIC_DBL 4503599627370496.0   // 2^52
+#define FP_MAGIC_BITS 0x4330000000000000  // bit pattern of 2^52
+
+// exact int64 -> double for 0 <= x < 2^52 without AVX-512DQ conversions
+static inline __attribute__((always_inline)) fp_vf64 fp_v_u52_to_f64(fp_vi64 x){
+    return (fp_vf64)(x | FP_MAGIC_BITS) - FP_MAGIC_DBL;
+}
+
+// round 0 <= x < 2^52 to nearest int64
+static inline __attribute__((always_inline)) fp_vi64 fp_v_f64_to_u52(fp_vf64 x){
+    return (fp_vi64)(x + FP_MAGIC_DBL) - FP_MAGIC_BITS;
+}
+
+#define FP_MAGIC_DBL_SIGNED 6755399441055744.0   // 1.5 * 2^52
+#define FP_MAGIC_BITS_SIGNED 0x4338000000000000
+
+// exact int64 -> double for |x| < 2^51
+static inline __attribute__((always_inline)) fp_vf64 fp_v_i51_to_f64(fp_vi64 x){
+    return (fp_vf64)(x + FP_MAGIC_BITS_SIGNED) - FP_MAGIC_DBL_SIGNED;
+}
+
+// round |x| < 2^51 to nearest, result stays double
+static inline __attribute__((always_inline)) fp_vf64 fp_v_round_f64(fp_vf64 x){
+    return (x + FP_MAGIC_DBL_SIGNED) - FP_MAGIC_DBL_SIGNED;
+}
+
+// round |x| < 2^51 to nearest int64
+static inline __attribute__((always_inline)) fp_vi64 fp_v_f64_to_i51(fp_vf64 x){
+    return (fp_vi64)(x + FP_MAGIC_DBL_SIGNED) - FP_MAGIC_BITS_SIGNED;
+}
+
+// frac2ns() on all lanes: ((frac>>1) * 119209289551 + 5e8) / 1e9 for 24 bit fractions.
+// Split into f*119 + (f*209289551 + 5e8) / 1e9 so that every product fits 52 bits,
+// then divide by 1e9 = 2^9 * 1953125 with a double estimate and one correction step.
+static inline __attribute__((always_inline)) fp_vi64 fp_v_frac2ns(fp_vi64 frac){
+    fp_vi64 f = frac >> 1;
+    fp_vi64 z = (f * 209289551 + 500000000) >> 9;
+    fp_vi64 q = fp_v_f64_to_u52(fp_v_u52_to_f64(z) * (1.0 / 1953125.0));
+    fp_vi64 r = z - q * 1953125;
+    q += (r < 0);              // true lanes are -1
+    q -= (r >= 1953125);
+    return f * 119 + q;
+}
+
+// ns2frac() on all lanes for 0 <= ns < 1e9: (ns*1e9 + 59604644775) / 119209289551.
+// The quotient is estimated in double precision and corrected by one step.
+static inline __attribute__((always_inline)) fp_vi64 fp_v_ns2frac(fp_vi64 ns){
+    const int64_t div = 119209289551;
+    fp_vi64 x = ns * 1000000000 + 59604644775;
+    fp_vi64 q = fp_v_f64_to_u52(fp_v_u52_to_f64(ns) * (1e9 / div) + (59604644775.0 / div));
+    fp_vi64 r = x - q * div;
+    q += (r < 0);
+    q -= (r >= div);
+    return q;
+}
+
+#endif // _FP_SIMD_H
@@ -0,0 +1,133 @@
+#include "fp_sort.h"
+#include "fp_internal.h"
+#include "fp_direct.h"
+
+#define SORT_BITS 11
+#define SORT_RADIX (1 << SORT_BITS)
+#define SORT_DIGITS 9    // 11 bit digits of the 93 bit key, lowest first
+
+// fraction masks and precisions of the low 3 bits, sec+ takes its precision from bits 3..6
+static const uint32_t frac_mask[8] = {0xFFFFFE, 0xFFFFF0, 0xFFFFFE, 0xFFFE00, 0xFFFFFE, 0xFFC000, 0xFFFFFE, 0};
+static const int8_t frac_prc[8] = {PRC_23BIT, PRC_MICROSEC, PRC_23BIT, PRC_15BIT, PRC_23BIT, PRC_MILLISEC,
+                                   PRC_23BIT, 0};
+
+// float bits that compare like the floats as unsigned integers
+static inline uint64_t key_float(uint32_t bits){
+    return (bits & 0x80000000) ? ~bits & 0xFFFFFFFF : bits | 0x80000000;
+}
+
+// The key is the 93 bit number class (3) | seconds or year (61) | leap (1) |
+// fraction >> 1 (23) | precision - PRC_NANOSEC (5), split into two words.
+static inline FP_SortKey key_make(uint64_t cls, uint64_t payload, uint64_t low){
+    uint64_t high = cls << 61 | payload;
+    return (FP_SortKey){high >> (64 - FP_KEY_LO_BITS), high << FP_KEY_LO_BITS | low};
+}
+
+// leap, fraction and precision bits of absolute or relative seconds
+static inline uint64_t key_low(int64_t flexpoch){
+    unsigned pattern = flexpoch & 0b111;
+    uint64_t frac = (flexpoch & frac_mask[pattern]) >> 1;
+    int prc = (pattern == 0b111) ? (flexpoch >> 3) & 0xF : frac_prc[pattern];
+    // tz field of ms (bits 3..13) or sec+ (bits 13..23) all ones: TZ_LEAPSEC
+    int tz_shift = (pattern == 0b111) ? 13 : 3;
+    uint64_t leap = (pattern & 0b101) == 0b101 && ((flexpoch >> tz_shift) & 0x7FF) == 0x7FF;
+    return leap << 28 | frac << 5 | (uint64_t)(prc - PRC_NANOSEC);
+}
+
+// key of a valid absolute seconds value
+static inline FP_SortKey key_abs_sec(int64_t flexpoch){
+    return key_make(FP_KEY_ABS_SEC, (uint64_t)((flexpoch >> 24) + ((int64_t)1 << 40)), key_low(flexpoch));
+}
+
+static inline FP_SortKey sort_key(int64_t flexpoch){
+    int8_t first_byte = flexpoch >> 56;
+    if (fp_direct_validate(flexpoch) != SUCCESS){ return key_make(FP_KEY_INVALID, 0, 0); }
+
+    if (fp_direct_is_sec(first_byte)){
+        if (((uint8_t)first_byte >> 4) == CP_REL_SEC){
+            return key_make(FP_KEY_REL_SEC, (flexpoch >> 24) & 0x0FFFFFFFFF, key_low(flexpoch));
+        }
+        return key_abs_sec(flexpoch);
+    }
+    if (first_byte == CP_ABS_YEAR_NEG || first_byte == CP_ABS_YEAR_POS){
+        uint64_t cls = (first_byte == CP_ABS_YEAR_POS) ? FP_KEY_YEAR_POS : FP_KEY_YEAR_NEG;
+        return key_make(cls, key_float((uint32_t)(flexpoch >> 24)), 0);
+    }
+    return key_make(FP_KEY_LOGICAL, flexpoch & 0x0FFFFFFFFFFFFFFF, 0);
+}
+
+static inline unsigned key_digit(FP_SortKey key, int digit){
+    int shift = digit * SORT_BITS;
+    uint64_t word = (shift >= 64) ? key.hi >> (shift - 64)
+                  : (shift == 0) ? key.lo : key.lo >> shift | key.hi << (64 - shift);
+    return word & (SORT_RADIX - 1);
+}
+
+
+// Functions
+// ============================================================================
+
+FP_SortKey FP_sort_key(int64_t flexpoch){
+    return sort_key(flexpoch);
+}
+
+int FP_sort_key_cmp(FP_SortKey a, FP_SortKey b){
+    if (a.hi != b.hi){ return (a.hi < b.hi) ? -1 : 1; }
+    if (a.lo != b.lo){ return (a.lo < b.lo) ? -1 : 1; }
+    return 0;
+}
+
+// one counting pass, key_of is inlined for each caller
+static inline __attribute__((always_inline))
+void radix_pass(const int64_t *src, int64_t *dst, size_t n, size_t *start, int digit,
+                FP_SortKey (*key_of)(int64_t)){
+    for (size_t i = 0; i < n; i++){
+        int64_t v = src[i];
+        dst[start[key_digit(key_of(v), digit)]++] = v;
+    }
+}
+
+ErrNo FP_radix_sort(int64_t *values, size_t n, int64_t *scratch){
+    // histograms of all digits, on the heap: ~150 KB is too much for the stack or TLS
+    size_t (*count)[SORT_RADIX] = calloc(SORT_DIGITS, sizeof(*count));
+    if (!count){ return ERR_IO; }
+
+    // all histograms in one pass, the other passes skip the validation if every
+    // value is a valid absolute time (the usual case)
+    uint64_t abs_sec = 1;
+    for (size_t i = 0; i < n; i++){
+        FP_SortKey key = sort_key(values[i]);
+        abs_sec &= (key.hi >> (61 - (64 - FP_KEY_LO_BITS))) == FP_KEY_ABS_SEC;
+        for (int d = 0; d < SORT_DIGITS; d++){
+            count[d][key_digit(key, d)]++;
+        }
+    }
+
+    int64_t *src = values, *dst = scratch;
+    for (int d = 0; d < SORT_DIGITS; d++){
+        size_t *c = count[d];
+        bool trivial = false;
+        size_t sum = 0;
+        for (int b = 0; b < SORT_RADIX; b++){
+            trivial |= (c[b] == n);
+            size_t k = c[b];
+            c[b] = sum;   // start of bucket b
+            sum += k;
+        }
+        if (trivial){ continue; }
+
+        if (abs_sec){
+            radix_pass(src, dst, n, c, d, key_abs_sec);
+        } else {
+            radix_pass(src, dst, n, c, d, sort_key);
+        }
+        int64_t *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    if (src != values){
+        memcpy(values, src, n * sizeof(int64_t));
+    }
+    free(count);
+    return SUCCESS;
+}
@@ -0,0 +1,44 @@
+#ifndef _FP_SORT_H
+#define _FP_SORT_H
+
+#include "flexpoch.h"
+
+
+// types
+// ============================================================================
+
+// 93 bit key: class (3 bits), seconds or the ordered float year (61), leap
+// second (1), fraction (23), precision (5). Compare hi first, then lo.
+#define FP_KEY_LO_BITS 29   // leap second, fraction and precision
+
+// key classes, the top 3 bits
+enum { FP_KEY_YEAR_NEG, FP_KEY_ABS_SEC, FP_KEY_YEAR_POS, FP_KEY_REL_SEC, FP_KEY_LOGICAL, FP_KEY_INVALID = 7 };
+
+typedef struct {
+    uint64_t hi;   // upper 29 bits
+    uint64_t lo;
+} FP_SortKey;
+
+
+
+// Functions
+// ============================================================================
+
+// Key of a flexpoch that sorts chronologically: by UTC instant (a leap second
+// after the 59th second it is stored on), then by precision, finer first. The
+// tz offset does not change the key. Classes in order: float years before the
+// seconds range, absolute seconds, float years after it, relative seconds,
+// logical clocks, invalid values (all the same key, so they keep their order).
+FP_SortKey FP_sort_key(int64_t flexpoch);
+
+// <0, 0, >0 like strcmp
+int FP_sort_key_cmp(FP_SortKey a, FP_SortKey b);
+
+// Stable LSD radix sort of n flexpochs by FP_sort_key() without decoding them.
+// scratch must hold n values. 11 bit digits that are equal for all values are
+// skipped, so sorting events of a few days takes about five passes. Returns
+// ERR_IO if the histograms cannot be allocated, values are unchanged then.
+ErrNo FP_radix_sort(int64_t *values, size_t n, int64_t *scratch);
+
+
+#endif // _FP_SORT_H
@@ -0,0 +1,434 @@
+#define _GNU_SOURCE  // memmem
+#include "fp_transcode.h"
+#include "fp_internal.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#define TC_BUF_SIZE (1 << 20)  // input and output buffer each
+#define TC_NONE SIZE_MAX
+
+typedef struct {
+    FP_TranscodeOptions opt;
+    FP_TranscodeStats *stats;
+    FP_IsoCache iso_cache;
+    char *key;               // "json_field"
+    size_t key_len;
+    int out_fd;
+    char *out;
+    size_t out_len;
+    int error;               // errno of a failed write
+    bool skip;               // record started in an earlier buffer, pass it through
+    uint64_t carry;          // CSV: all ones if the buffer starts inside quotes
+} Transcoder;
+
+
+// Output
+// ----------------------------------------------------------------------------
+
+static int write_all(int fd, const char *buf, size_t len){
+    while (len){
+        ssize_t w = write(fd, buf, len);
+        if (w < 0 && errno == EINTR){ continue; }
+        if (w <= 0){ return -1; }
+        buf += w;
+        len -= w;
+    }
+    return 0;
+}
+
+static void tc_flush(Transcoder *tc){
+    if (!tc->error && write_all(tc->out_fd, tc->out, tc->out_len) != 0){
+        tc->error = errno ? errno : EIO;
+    }
+    tc->out_len = 0;
+}
+
+static void tc_put(Transcoder *tc, const char *p, size_t len){
+    if (tc->out_len + len > TC_BUF_SIZE){
+        tc_flush(tc);
+        if (len > TC_BUF_SIZE){
+            if (!tc->error && write_all(tc->out_fd, p, len) != 0){ tc->error = errno ? errno : EIO; }
+            return;
+        }
+    }
+    memcpy(tc->out + tc->out_len, p, len);
+    tc->out_len += len;
+}
+
+
+// Field conversion
+// ----------------------------------------------------------------------------
+
+static bool parse_fp_hex(const char *s, size_t len, int64_t *out){
+    if (len == 18 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')){
+        s += 2;
+        len -= 2;
+    }
+    if (len != 16){ return false; }
+    uint64_t value = 0;
+    for (size_t i = 0; i < len; i++){
+        char c = s[i];
+        int digit = ('0' <= c && c <= '9') ? c - '0' :
+                    ('A' <= c && c <= 'F') ? c - 'A' + 10 :
+                    ('a' <= c && c <= 'f') ? c - 'a' + 10 : -1;
+        if (digit < 0){ return false; }
+        value = (value << 4) | digit;
+    }
+    *out = value;
+    return true;
+}
+
+static bool parse_int(const char *s, size_t len, int64_t *out){
+    bool neg = (len > 0 && s[0] == '-');
+    size_t i = neg;
+    if (i == len){ return false; }
+    int64_t value = 0;
+    for (; i < len; i++){
+        if (s[i] < '0' || '9' < s[i]){ return false; }
+        if (__builtin_mul_overflow(value, 10, &value) ||
+            __builtin_add_overflow(value, neg ? -(s[i] - '0') : s[i] - '0', &value)){ return false; }
+    }
+    *out = value;
+    return true;
+}
+
+// convert one field value into out (FP_ISO_MAX_LEN bytes), returns the length or a
+// negative ErrNo
+static int tc_convert(Transcoder *tc, const char *s, size_t len, char *out, bool *is_string){
+    static const char hex[] = "0123456789ABCDEF";
+    FP_Components fpc = FP_new();
+    FP_FieldFormat from = tc->opt.from;
+    int64_t value;
+    ErrNo error;
+
+    if (from == FIELD_AUTO){   // as guess_single_arg() in main.c
+        from = parse_fp_hex(s, len, &value) ? FIELD_FP : (len > 5 && s[4] == '-') ? FIELD_ISO : FIELD_UNIX;
+    }
+    switch (from){
+        case FIELD_FP:
+            if (!parse_fp_hex(s, len, &value)){ return ERR_OUT_OF_RANGE; }
+            if (((value >> 60) & 0xF) == CP_REL_FRAC){ return ERR_RESERVED_FORMAT; }  // FP_from_fp() prints
+            error = FP_from_fp(value, &fpc);
+            break;
+        case FIELD_ISO: {
+            int n = FP_parse_iso(s, len, &fpc);
+            error = (n < 0) ? n : ((size_t)n != len) ? ERR_INVALID_ISO : SUCCESS;
+            break;
+        }
+        case FIELD_UNIX:
+            error = parse_int(s, len, &value) ? FP_from_unix(value, &fpc) : ERR_OUT_OF_RANGE;
+            break;
+        case FIELD_JAVA:
+            error = parse_int(s, len, &value) ? FP_from_java(value, &fpc) : ERR_OUT_OF_RANGE;
+            break;
+        default:
+            return ERR_INCOMPATIBLE_OUTPUT;
+    }
+    if (error){ return error; }
+
+    FP_FieldFormat to = tc->opt.to;
+    if (to == FIELD_AUTO){ to = (from == FIELD_FP) ? FIELD_ISO : FIELD_FP; }
+    *is_string = (to == FIELD_FP || to == FIELD_ISO);
+    switch (to){
+        case FIELD_FP:
+            error = FP_to_fp(&fpc, &value);
+            if (error){ return error; }
+            out[0] = '0';
+            out[1] = 'x';
+            for (int i = 0; i < 16; i++){
+                out[2 + i] = hex[((uint64_t)value >> (60 - 4*i)) & 0xF];
+            }
+            return 18;
+        case FIELD_ISO:
+            return FP_format_iso_cached(&tc->iso_cache, &fpc, out, FP_ISO_MAX_LEN);
+        case FIELD_UNIX:
+            FP_to_unix(&fpc, &value);
+            return snprintf(out, FP_ISO_MAX_LEN, "%li", value);
+        case FIELD_JAVA:
+            FP_to_java(&fpc, &value);
+            return snprintf(out, FP_ISO_MAX_LEN, "%li", value);
+        default:
+            return ERR_INCOMPATIBLE_OUTPUT;
+    }
+}
+
+// copy one record with rec[fs..fe) converted, the whole record if that fails
+static void tc_record(Transcoder *tc, const char *rec, size_t len, size_t fs, size_t fe, bool is_json){
+    char value[FP_ISO_MAX_LEN + 2];
+    bool is_string = false;
+    tc->stats->records++;
+
+    if (fs != TC_NONE && fe != TC_NONE){
+        size_t vs = fs, ve = fe;
+        bool quoted = (ve - vs >= 2 && rec[vs] == '"' && rec[ve - 1] == '"');
+        if (quoted){
+            vs++;
+            ve--;
+        }
+        int n = tc_convert(tc, rec + vs, ve - vs, value + 1, &is_string);
+        if (n >= 0){
+            bool quote = is_json ? is_string : quoted;   // JSON by type, CSV as before
+            value[0] = '"';
+            value[n + 1] = '"';
+            tc_put(tc, rec, fs);
+            tc_put(tc, value + !quote, n + 2*quote);
+            tc_put(tc, rec + fe, len - fe);
+            tc->stats->converted++;
+            return;
+        }
+    }
+    tc->stats->failed++;
+    tc_put(tc, rec, len);
+}
+
+// rest of a record longer than the input buffer
+static void tc_skipped(Transcoder *tc, const char *rec, size_t len){
+    tc->stats->records++;
+    tc->stats->failed++;
+    tc_put(tc, rec, len);
+    tc->skip = false;
+}
+
+
+// CSV
+// ----------------------------------------------------------------------------
+
+#define TC_ONES 0x0101010101010101ULL
+#define TC_LOW7 0x7F7F7F7F7F7F7F7FULL
+
+// bit b of the result is set if byte b of x is zero
+static inline uint64_t swar_zero_bits(uint64_t x){
+    uint64_t zero = ~(((x & TC_LOW7) + TC_LOW7) | x | TC_LOW7);
+    return ((zero >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
+// quote, delimiter and newline positions of 64 bytes as bitmasks (SWAR, 8 bytes
+// per step)
+static inline void csv_classify(const char *p, char sep, uint64_t *quote, uint64_t *delim, uint64_t *nl){
+    uint64_t q = 0, d = 0, n = 0;
+    for (int w = 0; w < 8; w++){
+        uint64_t x;
+        memcpy(&x, p + 8*w, 8);
+        q |= swar_zero_bits(x ^ (TC_ONES * '"')) << (8*w);
+        d |= swar_zero_bits(x ^ (TC_ONES * (uint8_t)sep)) << (8*w);
+        n |= swar_zero_bits(x ^ (TC_ONES * '\n')) << (8*w);
+    }
+    *quote = q;
+    *delim = d;
+    *nl = n;
+}
+
+// bit i = xor of bits 0..i: set between an opening and a closing quote. Doubled
+// quotes ("") toggle twice and need no extra handling.
+static inline uint64_t prefix_xor(uint64_t x){
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// emit all complete records in buf, returns the bytes consumed
+static size_t csv_scan(Transcoder *tc, const char *buf, size_t len, bool eof){
+    const int target = tc->opt.csv_column;
+    const char sep = tc->opt.delimiter ? tc->opt.delimiter : ',';
+    size_t rec = 0;
+    size_t fs = (target == 0) ? 0 : TC_NONE;
+    size_t fe = TC_NONE;
+    int col = 0;
+    uint64_t carry = tc->carry;
+    char pad[64];
+
+    for (size_t b = 0; b < len; b += 64){
+        const char *p = buf + b;
+        if (len - b < 64){
+            memset(pad, 0, sizeof(pad));
+            memcpy(pad, p, len - b);
+            p = pad;
+        }
+        uint64_t quote, delim, nl;
+        csv_classify(p, sep, &quote, &delim, &nl);
+        uint64_t inside = prefix_xor(quote) ^ carry;
+        carry = (uint64_t)((int64_t)inside >> 63);
+
+        uint64_t events = (delim | nl) & ~inside;
+        while (events){
+            size_t i = b + __builtin_ctzll(events);
+            events &= events - 1;
+            if (buf[i] != '\n'){
+                if (col == target){ fe = i; }
+                if (++col == target){ fs = i + 1; }
+                continue;
+            }
+            if (col == target){ fe = (i > fs && buf[i - 1] == '\r') ? i - 1 : i; }
+            if (tc->skip){
+                tc_skipped(tc, buf + rec, i + 1 - rec);
+            } else {
+                tc_record(tc, buf + rec, i + 1 - rec, fs == TC_NONE ? fs : fs - rec,
+                          fe == TC_NONE ? fe : fe - rec, false);
+            }
+            rec = i + 1;
+            col = 0;
+            fs = (target == 0) ? rec : TC_NONE;
+            fe = TC_NONE;
+        }
+    }
+    tc->carry = carry;
+
+    // last record without newline
+    if (eof && rec < len){
+        if (col == target){ fe = (len > fs && buf[len - 1] == '\r') ? len - 1 : len; }
+        if (tc->skip){
+            tc_skipped(tc, buf + rec, len - rec);
+        } else {
+            tc_record(tc, buf + rec, len - rec, fs == TC_NONE ? fs : fs - rec,
+                      fe == TC_NONE ? fe : fe - rec, false);
+        }
+        rec = len;
+    }
+    return rec;
+}
+
+
+// NDJSON
+// ----------------------------------------------------------------------------
+
+// quote preceded by an odd number of backslashes
+static bool json_escaped(const char *rec, const char *q){
+    const char *b = q;
+    while (b > rec && b[-1] == '\\'){ b--; }
+    return (q - b) & 1;
+}
+
+// value of the first "key": outside of strings, fs = TC_NONE if there is none
+static void json_find(const Transcoder *tc, const char *rec, size_t len, size_t *fs, size_t *fe){
+    const char *end = rec + len;
+    const char *p = rec;
+    bool inside = false;   // string state at p
+    *fs = *fe = TC_NONE;
+
+    for (;;){
+        const char *key = memmem(p, end - p, tc->key, tc->key_len);
+        if (!key){ return; }
+        for (const char *q; (q = memchr(p, '"', key - p)); p = q + 1){
+            if (!json_escaped(rec, q)){ inside = !inside; }
+        }
+        if (json_escaped(rec, key)){   // match inside a string
+            p = key + 1;
+            continue;
+        }
+        if (inside){   // the match starts with a closing quote
+            inside = false;
+            p = key + 1;
+            continue;
+        }
+
+        const char *v = key + tc->key_len;
+        while (v < end && isspace((unsigned char)*v)){ v++; }
+        if (v == end || *v != ':'){   // string value, not a key
+            p = key + tc->key_len;
+            continue;
+        }
+        v++;
+        while (v < end && isspace((unsigned char)*v)){ v++; }
+        if (v == end){ return; }
+
+        const char *ve = v;
+        if (*v == '"'){
+            const char *q = v;
+            do {
+                q = memchr(q + 1, '"', end - q - 1);
+                if (!q){ return; }
+            } while (json_escaped(rec, q));
+            ve = q + 1;
+        } else {
+            while (ve < end && *ve != ',' && *ve != '}' && *ve != ']' && !isspace((unsigned char)*ve)){ ve++; }
+        }
+        *fs = v - rec;
+        *fe = ve - rec;
+        return;
+    }
+}
+
+static size_t json_scan(Transcoder *tc, const char *buf, size_t len, bool eof){
+    size_t rec = 0;
+    while (rec < len){
+        const char *nl = memchr(buf + rec, '\n', len - rec);   // never part of a JSON string
+        if (!nl && !eof){ break; }
+        size_t end = nl ? (size_t)(nl - buf) + 1 : len;
+        if (tc->skip){
+            tc_skipped(tc, buf + rec, end - rec);
+        } else {
+            size_t fs, fe;
+            json_find(tc, buf + rec, end - rec, &fs, &fe);
+            tc_record(tc, buf + rec, end - rec, fs, fe, true);
+        }
+        rec = end;
+    }
+    return rec;
+}
+
+
+// Public functions
+// ----------------------------------------------------------------------------
+
+ErrNo FP_transcode_fd(int in_fd, int out_fd, const FP_TranscodeOptions *opt, FP_TranscodeStats *stats){
+    FP_TranscodeStats local;
+    if (!stats){ stats = &local; }
+    *stats = (FP_TranscodeStats){0, 0, 0};
+
+    Transcoder tc = {.opt = *opt, .stats = stats, .out_fd = out_fd};
+    FP_iso_cache_init(&tc.iso_cache);
+    char *in = malloc(TC_BUF_SIZE);
+    tc.out = malloc(TC_BUF_SIZE);
+    if (opt->json_field){
+        tc.key_len = strlen(opt->json_field) + 2;
+        tc.key = malloc(tc.key_len + 1);
+        if (tc.key){ sprintf(tc.key, "\"%s\"", opt->json_field); }
+    }
+    if (!in || !tc.out || (opt->json_field && !tc.key)){
+        free(in);
+        free(tc.out);
+        free(tc.key);
+        errno = ENOMEM;
+        return ERR_IO;
+    }
+
+    size_t len = 0;
+    bool eof = false;
+    while (!eof){
+        ssize_t r = read(in_fd, in + len, TC_BUF_SIZE - len);
+        if (r < 0 && errno == EINTR){ continue; }
+        if (r < 0){
+            tc.error = errno;
+            break;
+        }
+        eof = (r == 0);
+        len += r;
+
+        uint64_t start_carry = tc.carry;
+        size_t done = opt->json_field ? json_scan(&tc, in, len, eof) : csv_scan(&tc, in, len, eof);
+        if (done == 0 && len == TC_BUF_SIZE){   // record longer than the buffer
+            tc_put(&tc, in, len);
+            tc.skip = true;
+            done = len;
+        } else {   // the unfinished record is scanned again after the next read
+            tc.carry = done ? 0 : start_carry;
+        }
+        memmove(in, in + done, len - done);
+        len -= done;
+    }
+    tc_flush(&tc);
+
+    free(in);
+    free(tc.out);
+    free(tc.key);
+    if (tc.error){
+        errno = tc.error;
+        return ERR_IO;
+    }
+    return SUCCESS;
+}
@@ -0,0 +1,46 @@
+#ifndef _FP_TRANSCODE_H
+#define _FP_TRANSCODE_H
+
+#include "flexpoch.h"
+
+
+// types
+// ============================================================================
+
+typedef enum {
+    FIELD_AUTO = -1,  // in: guessed per value, out: ISO for flexpochs, else flexpoch
+    FIELD_FP   = 0,   // 0x + 16 hex digits
+    FIELD_ISO  = 1,
+    FIELD_UNIX = 2,
+    FIELD_JAVA = 3,
+} FP_FieldFormat;
+
+typedef struct {
+    FP_FieldFormat from;
+    FP_FieldFormat to;
+    const char *json_field;  // NDJSON key to convert, NULL for CSV
+    int csv_column;          // 0 based CSV column
+    char delimiter;          // CSV delimiter, 0 = ','
+} FP_TranscodeOptions;
+
+typedef struct {
+    size_t records;
+    size_t converted;
+    size_t failed;           // field missing or not convertible, copied as is
+} FP_TranscodeStats;
+
+
+
+// Functions
+// ============================================================================
+
+// Copy CSV or NDJSON records from in_fd to out_fd and convert one field per
+// record. Fields that fail to convert (e.g. a header line) and all other bytes
+// are copied unchanged. Quoted CSV fields stay quoted, NDJSON gets strings for
+// ISO/flexpoch and numbers for unix/java. Memory stays at two fixed buffers,
+// records longer than a buffer are passed through. Returns ERR_IO (see errno)
+// if reading or writing fails, stats may be NULL.
+ErrNo FP_transcode_fd(int in_fd, int out_fd, const FP_TranscodeOptions *opt, FP_TranscodeStats *stats);
+
+
+#endif // _FP_TRANSCODE_H
@@ -0,0 +1,294 @@
+#include "fp_wire.h"
+#include "fp_internal.h"
+#include "fp_simd.h"
+
+#define WIRE_REL 16          // tags of relative seconds start here
+#define WIRE_LOGICAL 31
+#define WIRE_SEC_PRC_MAX 11  // sec+ precisions with a tag of their own
+
+#define WIRE_REL_MASK 0x0FFFFFFFFF          // 36 bit relative seconds
+#define WIRE_LOGICAL_MASK 0x0FFFFFFFFFFFFFFF
+#define WIRE_UTC_SEC 0x800000               // tz bits of UTC in a sec+ suffix
+#define WIRE_UTC_MS 0x2000                  // in a millisec suffix
+
+// Where the suffix bits go. Its bits (after XOR with xor) are taken from a field
+// A and a field B into the low part below the seconds (A at the bottom), from a
+// field T into the top part above them, the rest is fixed by the tag.
+typedef struct {
+    uint8_t a_shift, b_shift, t_shift;
+    uint8_t a_bits, low_bits;    // low_bits = a_bits + bits of B
+    uint32_t a_mask, b_mask, t_mask;
+    uint32_t xor;
+    uint32_t fixed;
+} WireForm;
+
+// sec+ in UTC without unused bits, only the seconds remain
+#define FORM_SEC_UTC(prc) {0, 0, 0, 0, 0, 0, 0, 0, WIRE_UTC_SEC, (prc) << 3 | 0b111}
+// other sec+: precision and tz low, unused bits 7..12 on top
+#define FORM_SEC_ANY {3, 13, 7, 4, 15, 0xF, 0x7FF, 0x3F, WIRE_UTC_SEC, 0b111}
+#define FORM_MS_UTC  {14, 0, 0, 10, 10, 0x3FF, 0, 0, WIRE_UTC_MS, 0b101}
+#define FORM_MS_ANY  {14, 3, 0, 10, 21, 0x3FF, 0x7FF, 0, WIRE_UTC_MS, 0b101}
+#define FORM_MS_TOP  {14, 0, 3, 10, 10, 0x3FF, 0, 0x7FF, WIRE_UTC_MS, 0b101}   // relative millisec
+#define FORM_SUFFIX  {0, 0, 0, 24, 24, 0xFFFFFF, 0, 0, 0, 0}
+
+static const WireForm forms[32] = {
+    FORM_SEC_UTC(0), FORM_SEC_UTC(1), FORM_SEC_UTC(2), FORM_SEC_UTC(3), FORM_SEC_UTC(4), FORM_SEC_UTC(5),
+    FORM_SEC_UTC(6), FORM_SEC_UTC(7), FORM_SEC_UTC(8), FORM_SEC_UTC(9), FORM_SEC_UTC(10), FORM_SEC_UTC(11),
+    FORM_SEC_ANY, FORM_MS_UTC, FORM_MS_ANY, FORM_SUFFIX,
+    FORM_SEC_UTC(0), FORM_SEC_UTC(1), FORM_SEC_UTC(2), FORM_SEC_UTC(3), FORM_SEC_UTC(4), FORM_SEC_UTC(5),
+    FORM_SEC_UTC(6), FORM_SEC_UTC(7), FORM_SEC_UTC(8), FORM_SEC_UTC(9), FORM_SEC_UTC(10), FORM_SEC_UTC(11),
+    FORM_SEC_ANY, FORM_MS_TOP, FORM_SUFFIX, FORM_SUFFIX,   // the last is WIRE_LOGICAL
+};
+
+
+// Scalar
+// ----------------------------------------------------------------------------
+
+static inline uint64_t zigzag(int64_t x){
+    return ((uint64_t)x << 1) ^ (uint64_t)(x >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t x){
+    return (int64_t)(x >> 1) ^ -(int64_t)(x & 1);
+}
+
+// the body is sent little endian
+static inline uint64_t to_le(uint64_t x){
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap64(x);
+#else
+    return x;
+#endif
+}
+
+// 1..8 significant bytes
+static inline size_t body_bytes(uint64_t body){
+    return (71 - __builtin_clzll(body | 1)) / 8;
+}
+
+static inline uint64_t body_mask(size_t bytes){
+    return ~(uint64_t)0 >> (64 - 8 * bytes);
+}
+
+static inline unsigned wire_tag(uint64_t u){
+    uint64_t suffix = u & 0xFFFFFF;
+    unsigned prc = (u >> 3) & 0xF;
+    bool rel = (u >> 60) == (uint64_t)CP_REL_SEC;
+    bool sec = (u & 0b111) == 0b111;
+    bool ms = (u & 0b111) == 0b101;
+    bool sec_utc = sec & (prc <= WIRE_SEC_PRC_MAX) & ((suffix ^ WIRE_UTC_SEC) >> 7 == 0);
+    bool ms_utc = ms & !rel & (((suffix ^ WIRE_UTC_MS) & 0x3FF8) == 0);
+    unsigned idx = (-(unsigned)sec_utc & prc) | (-(unsigned)(sec & !sec_utc) & 12) |
+                   (-(unsigned)!sec & (15 - rel - ms - ms_utc));
+    unsigned logical = -(unsigned)((u >> 60) == (uint64_t)CP_LOGICAL);
+    return (logical & WIRE_LOGICAL) | (~logical & (idx | rel << 4));
+}
+
+static inline uint64_t wire_body(int64_t flexpoch, unsigned tag){
+    uint64_t u = flexpoch;
+    const WireForm *f = &forms[tag];
+    uint64_t rel_mask = -(uint64_t)(tag >= WIRE_REL);
+    int width = 40 - (rel_mask & 4);
+    uint64_t seconds = (rel_mask & (u >> 24) & WIRE_REL_MASK) | (~rel_mask & zigzag(flexpoch >> 24));
+    uint64_t s = (u & 0xFFFFFF) ^ f->xor;
+    uint64_t low = ((s >> f->a_shift) & f->a_mask) | ((s >> f->b_shift) & f->b_mask) << f->a_bits;
+    uint64_t top = (s >> f->t_shift) & f->t_mask;
+    uint64_t body = low | seconds << f->low_bits | (top << (f->low_bits + width - 1)) << 1;
+    uint64_t logical_mask = -(uint64_t)(tag == WIRE_LOGICAL);
+    return (logical_mask & u & WIRE_LOGICAL_MASK) | (~logical_mask & body);
+}
+
+static inline int64_t wire_value(unsigned tag, uint64_t body){
+    const WireForm *f = &forms[tag];
+    bool rel = tag >= WIRE_REL;
+    int width = rel ? 36 : 40;
+    uint64_t low = body & (((uint64_t)1 << f->low_bits) - 1);
+    uint64_t seconds = (body >> f->low_bits) & (((uint64_t)1 << width) - 1);
+    uint64_t top = ((body >> (f->low_bits + width - 1)) >> 1) & f->t_mask;
+    uint64_t s = (low & f->a_mask) << f->a_shift | ((low >> f->a_bits) & f->b_mask) << f->b_shift |
+                 top << f->t_shift | f->fixed;
+    uint64_t suffix = s ^ f->xor;
+
+    // selected with masks, the compiler would branch on them
+    uint64_t rel_mask = -(uint64_t)rel;
+    uint64_t logical_mask = -(uint64_t)(tag == WIRE_LOGICAL);
+    uint64_t value = (rel_mask & (uint64_t)CP_REL_SEC << 60) |
+                     ((rel_mask & seconds) | (~rel_mask & (uint64_t)unzigzag(seconds))) << 24 | suffix;
+    uint64_t logical = (uint64_t)CP_LOGICAL << 60 | (body & WIRE_LOGICAL_MASK);
+    return (logical_mask & logical) | (~logical_mask & value);
+}
+
+size_t FP_wire_size(int64_t flexpoch){
+    return body_bytes(wire_body(flexpoch, wire_tag(flexpoch))) + 1;
+}
+
+size_t FP_wire_encode(int64_t flexpoch, uint8_t *out){
+    unsigned tag = wire_tag(flexpoch);
+    uint64_t body = wire_body(flexpoch, tag);
+    size_t bytes = body_bytes(body);
+    out[0] = tag << 3 | (bytes - 1);
+    body = to_le(body);
+    memcpy(out + 1, &body, sizeof(body));
+    return bytes + 1;
+}
+
+size_t FP_wire_decode(const uint8_t *in, size_t len, int64_t *out){
+    if (len == 0){ return 0; }
+    unsigned tag = in[0] >> 3;
+    size_t bytes = (in[0] & 0b111) + 1;
+    if (bytes >= len){ return 0; }
+    uint64_t body = 0;
+    if (len >= FP_WIRE_MAX){   // one load, the bytes after the value are masked
+        memcpy(&body, in + 1, sizeof(body));
+        body = to_le(body) & body_mask(bytes);
+    } else {
+        memcpy(&body, in + 1, bytes);
+        body = to_le(body);
+    }
+    *out = wire_value(tag, body);
+    return bytes + 1;
+}
+
+
+// Batches
+// ----------------------------------------------------------------------------
+// The transforms run on FP_VLANES values at once with the forms selected per
+// lane. Only the prefix bytes, which chain the value positions, are handled
+// one by one.
+
+// form parameters of the lanes from the (exclusive) form masks
+typedef struct {
+    fp_vu64 a_shift, b_shift, t_shift, a_bits, low_bits;
+    fp_vu64 a_mask, b_mask, t_mask, xor, fixed, width;
+} WireFormV;
+
+static inline __attribute__((always_inline)) WireFormV wire_forms_v(fp_vu64 sec_utc, fp_vu64 sec_any,
+        fp_vu64 ms_utc, fp_vu64 ms_any, fp_vu64 ms_top, fp_vu64 suffix, fp_vu64 prc, fp_vu64 rel){
+    fp_vu64 ms = ms_utc | ms_any | ms_top;
+    WireFormV f;
+    f.a_shift = (sec_any & 3) | (ms & 14);
+    f.b_shift = (sec_any & 13) | (ms_any & 3);
+    f.t_shift = (sec_any & 7) | (ms_top & 3);
+    f.a_bits = (sec_any & 4) | (ms & 10) | (suffix & 24);
+    f.low_bits = (sec_any & 15) | (ms_utc & 10) | (ms_any & 21) | (ms_top & 10) | (suffix & 24);
+    f.a_mask = (sec_any & 0xF) | (ms & 0x3FF) | (suffix & 0xFFFFFF);
+    f.b_mask = (sec_any | ms_any) & 0x7FF;
+    f.t_mask = (sec_any & 0x3F) | (ms_top & 0x7FF);
+    f.xor = ((sec_utc | sec_any) & WIRE_UTC_SEC) | (ms & WIRE_UTC_MS);
+    f.fixed = (sec_utc & (prc << 3 | 0b111)) | (sec_any & 0b111) | (ms & 0b101);
+    f.width = FP_VSEL(rel, (fp_vu64){0} + 36, (fp_vu64){0} + 40);
+    return f;
+}
+
+FP_SIMD_CLONES
+static size_t encode_simd(const int64_t *in, size_t n, uint8_t *out, size_t *pos){
+    size_t i = 0;
+    size_t p = 0;
+    for (; i + FP_VLANES <= n; i += FP_VLANES){
+        fp_vi64 v;
+        FP_VLOAD(v, in + i);
+        fp_vu64 u = (fp_vu64)v;
+        fp_vu64 suffix = u & 0xFFFFFF;
+        fp_vu64 prc = (u >> 3) & 0xF;
+        fp_vu64 rel = (fp_vu64)((u >> 60) == (uint64_t)CP_REL_SEC);
+        fp_vu64 sec = (fp_vu64)((u & 0b111) == 0b111);
+        fp_vu64 ms = (fp_vu64)((u & 0b111) == 0b101);
+        fp_vu64 sec_utc = sec & (fp_vu64)(prc <= WIRE_SEC_PRC_MAX) & (fp_vu64)(((suffix ^ WIRE_UTC_SEC) >> 7) == 0);
+        fp_vu64 ms_utc = ms & ~rel & (fp_vu64)(((suffix ^ WIRE_UTC_MS) & 0x3FF8) == 0);
+        fp_vu64 idx = FP_VSEL(sec, FP_VSEL(sec_utc, prc, (fp_vu64){0} + 12), 15 + rel + ms + ms_utc);
+        WireFormV f = wire_forms_v(sec_utc, sec & ~sec_utc, ms_utc, ms & ~ms_utc & ~rel, ms & rel,
+                                   ~sec & ~ms, prc, rel);
+
+        fp_vi64 s = v >> 24;
+        fp_vu64 seconds = FP_VSEL(rel, (u >> 24) & WIRE_REL_MASK, ((fp_vu64)s << 1) ^ (fp_vu64)(s >> 63));
+        fp_vu64 x = suffix ^ f.xor;
+        fp_vu64 low = ((x >> f.a_shift) & f.a_mask) | ((x >> f.b_shift) & f.b_mask) << f.a_bits;
+        fp_vu64 top = (x >> f.t_shift) & f.t_mask;
+        fp_vu64 body = low | seconds << f.low_bits | (top << (f.low_bits + f.width - 1)) << 1;
+        fp_vu64 tag = idx | (rel & WIRE_REL);
+
+        fp_vu64 logical = (fp_vu64)((u >> 60) == (uint64_t)CP_LOGICAL);
+        body = FP_VSEL(logical, u & WIRE_LOGICAL_MASK, body);
+        tag = FP_VSEL(logical, (fp_vu64){0} + WIRE_LOGICAL, tag);
+
+        fp_vu64 extra = (fp_vu64){0};   // significant bytes - 1
+        for (int k = 1; k < 8; k++){
+            extra -= (fp_vu64)((body >> (8 * k)) != 0);
+        }
+        fp_vu64 prefix = tag << 3 | extra;
+        for (int l = 0; l < FP_VLANES; l++){
+            out[p] = prefix[l];
+            uint64_t b = to_le(body[l]);
+            memcpy(out + p + 1, &b, sizeof(b));
+            p += extra[l] + 2;
+        }
+    }
+    *pos = p;
+    return i;
+}
+
+FP_SIMD_CLONES
+static size_t decode_simd(const uint8_t *in, size_t len, int64_t *out, size_t n, size_t *pos){
+    size_t i = 0;
+    size_t p = 0;
+    for (; i + FP_VLANES <= n && p + FP_VLANES * FP_WIRE_MAX <= len; i += FP_VLANES){
+        fp_vu64 tag, body;
+        for (int l = 0; l < FP_VLANES; l++){
+            size_t bytes = (in[p] & 0b111) + 1;
+            uint64_t b;
+            memcpy(&b, in + p + 1, sizeof(b));
+            tag[l] = in[p] >> 3;
+            body[l] = to_le(b) & body_mask(bytes);
+            p += bytes + 1;
+        }
+
+        fp_vu64 idx = tag & 15;
+        fp_vu64 rel = (fp_vu64)(tag >= WIRE_REL);
+        fp_vu64 sec_utc = (fp_vu64)(idx <= WIRE_SEC_PRC_MAX);
+        fp_vu64 idx13 = (fp_vu64)(idx == 13);
+        fp_vu64 idx14 = (fp_vu64)(idx == 14);
+        WireFormV f = wire_forms_v(sec_utc, (fp_vu64)(idx == 12), idx13 & ~rel, idx14 & ~rel, idx13 & rel,
+                                   (fp_vu64)(idx == 15) | (idx14 & rel), idx, rel);
+
+        fp_vu64 low = body & ((1 << f.low_bits) - 1);
+        fp_vu64 seconds = (body >> f.low_bits) & ((1 << f.width) - 1);
+        fp_vu64 top = ((body >> (f.low_bits + f.width - 1)) >> 1) & f.t_mask;
+        fp_vu64 x = (low & f.a_mask) << f.a_shift | ((low >> f.a_bits) & f.b_mask) << f.b_shift |
+                    top << f.t_shift | f.fixed;
+        fp_vu64 suffix = x ^ f.xor;
+
+        fp_vi64 s = (fp_vi64)(seconds >> 1) ^ -(fp_vi64)(seconds & 1);
+        fp_vu64 abs = (fp_vu64)s << 24 | suffix;
+        fp_vu64 relative = (uint64_t)CP_REL_SEC << 60 | seconds << 24 | suffix;
+        fp_vu64 logical = (uint64_t)CP_LOGICAL << 60 | (body & WIRE_LOGICAL_MASK);
+        fp_vu64 value = FP_VSEL((fp_vu64)(tag == WIRE_LOGICAL), logical, FP_VSEL(rel, relative, abs));
+        FP_VSTORE(out + i, value);
+    }
+    *pos = p;
+    return i;
+}
+
+size_t FP_wire_encode_batch(const int64_t *in, size_t n, uint8_t *out){
+    size_t i = 0, pos = 0;
+    if (fp_simd_available()){
+        i = encode_simd(in, n, out, &pos);
+    }
+    for (; i < n; i++){
+        pos += FP_wire_encode(in[i], out + pos);
+    }
+    return pos;
+}
+
+size_t FP_wire_decode_batch(const uint8_t *in, size_t len, int64_t *out, size_t n, size_t *used){
+    size_t i = 0, pos = 0;
+    if (fp_simd_available()){
+        i = decode_simd(in, len, out, n, &pos);
+    }
+    for (; i < n; i++){
+        size_t bytes = FP_wire_decode(in + pos, len - pos, out + i);
+        if (!bytes){ break; }
+        pos += bytes;
+    }
+    if (used){ *used = pos; }
+    return i;
+}
@@ -0,0 +1,54 @@
+#ifndef _FP_WIRE_H
+#define _FP_WIRE_H
+
+#include "flexpoch.h"
+
+// Self-delimiting variable-length encoding of single flexpochs for messages. A
+// prefix byte holds a 5 bit tag and the number of body bytes minus one, the body
+// holds only the significant bytes of a little endian payload:
+//
+//   tag  0..11  absolute seconds, sec+ (0b111) in UTC with precision = tag
+//   tag  12     absolute seconds, other sec+
+//   tag  13, 14 absolute seconds, millisec (0b101) in UTC / with a tz offset
+//   tag  15     absolute seconds with any other suffix (kept as is)
+//   tag  16..30 relative seconds (CP_REL_SEC): as 0..15 with 16 added, except
+//               that 29 are all millisec and 30 the other suffixes
+//   tag  31     logical clock (CP_LOGICAL)
+//
+// The payload puts the seconds (zigzag coded if absolute) above the suffix bits
+// that usually change (fraction, tz offset, precision) and the ones that are
+// usually 0 above the seconds. A unix time of second precision in UTC takes 5
+// bytes, a millisec one 7, a duration of minutes 2. Any int64 round-trips
+// (invalid flexpochs take the absolute seconds forms), the longest encoding is
+// FP_WIRE_MAX bytes.
+
+// types
+// ============================================================================
+
+#define FP_WIRE_MAX 9   // prefix + 8 bytes
+
+
+
+// Functions
+// ============================================================================
+
+// number of bytes FP_wire_encode() writes for flexpoch
+size_t FP_wire_size(int64_t flexpoch);
+
+// Encode one value, returns its size. out must have room for FP_WIRE_MAX bytes,
+// bytes past the returned size may be overwritten.
+size_t FP_wire_encode(int64_t flexpoch, uint8_t *out);
+
+// Decode one value from the len bytes at in. Returns the bytes read, 0 if in ends
+// within the value.
+size_t FP_wire_decode(const uint8_t *in, size_t len, int64_t *out);
+
+// Encode n values back to back into out (FP_WIRE_MAX * n bytes), returns the bytes written.
+size_t FP_wire_encode_batch(const int64_t *in, size_t n, uint8_t *out);
+
+// Decode up to n values from the len bytes at in. Returns the number of values
+// decoded, fewer than n if in ends. used (may be NULL) gets the bytes read.
+size_t FP_wire_decode_batch(const uint8_t *in, size_t len, int64_t *out, size_t n, size_t *used);
+
+
+#endif // _FP_WIRE_H
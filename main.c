@@ -3,8 +3,14 @@
 #include <string.h> // Include this header for memcpy
 #include <ctype.h> // isxdigit
 #include <locale.h>  // set locale to UTF-8
+#include <errno.h>
+#include <unistd.h>  // STDIN_FILENO
 
 #include "flexpoch.h"
+#include "fp_bulk.h"
+#include "fp_transcode.h"
+#include "fp_serve.h"
+#include "fp_internal.h"
 
 #define ARG_FROM_ISO "--from-iso"
 #define ARG_FROM_FP "--from-fp"
@@ -15,8 +21,21 @@
 #define ARG_TO_FP "--to-fp"
 #define ARG_TO_UNIX "--to-unix"
 #define ARG_TO_JAVA "--to-java"
+#define ARG_TO_NS "--to-ns"
+#define ARG_TO_HTTP "--to-http"
+#define ARG_TO_RFC2822 "--to-rfc2822"
+#define ARG_TO_RFC3339 "--to-rfc3339"
 #define ARG_JSON "--json"
 #define ARG_VERBOSE "--verbose"
+#define ARG_STREAM "--stream"
+#define ARG_BULK "--bulk"
+#define ARG_BIG_ENDIAN "--big-endian"
+#define ARG_THREADS "--threads"
+#define ARG_CSV_COL "--csv-col"
+#define ARG_CSV_DELIM "--csv-delim"
+#define ARG_SERVE "--serve"
+#define ARG_CONNECT "--connect"
+#define ARG_JSON_FIELD "--json-field"
 #define ARG_HELP "--help"
 #define ARG_VERSION "--version"
 
@@ -26,6 +45,10 @@ typedef enum {
     ISO = 1,
     UNIX = 2,
     JAVA = 3,
+    HTTP = 4,
+    RFC2822 = 5,
+    RFC3339 = 6,
+    NS = 7,
     LOGICAL = 10,
 } TimeFormat;
 
@@ -35,12 +58,21 @@ void print_version(){
 
 void print_usage(){
     print_version();
-    printf("\nUsage: \"fp --from-FMT VALUE --to-FMT (--json|--help|--verbose)\"\n");
-    printf("  with FMT = iso|unix|fp\n\n");
+    printf("\nUsage: \"fp --from-FMT VALUE --to-FMT (--json|--stream|--help|--verbose)\"\n");
+    printf("  with FMT = iso|unix|java|fp (in), iso|unix|java|ns|fp|http|rfc2822|rfc3339 (out)\n\n");
     printf("Examples:\n");
     printf("fp 0xXXXXXXXXXXXXXXXX            // fp hex  -> ISO str\n");
     printf("fp 0xXXXXXXXXXXXXXXXX --to-unix  // fp hex  -> unix int\n");
     printf("fp --from-iso ISO_STR            // ISO str -> fp hex\n");
+    printf("fp --to-http                     // now     -> HTTP Date header\n");
+    printf("fp --stream --to-iso < FILE      // one value per line (stdin) -> one result per line\n");
+    printf("fp --bulk IN OUT --to-unix       // raw int64 fp file -> int64 file (--to-iso: lines)\n");
+    printf("   (--big-endian|--threads N)\n");
+    printf("fp --csv-col 2 --from-iso < IN   // convert column 2 (0 based) of CSV records\n");
+    printf("   (--csv-delim C)\n");
+    printf("fp --serve SOCK (--threads N)    // conversion daemon on a UNIX socket\n");
+    printf("fp --connect SOCK --to-iso < IN  // like --stream, converted by the daemon\n");
+    printf("fp --json-field ts --to-iso < IN // convert field \"ts\" of NDJSON records\n");
 }
 
 int get_current_time(FP_Components* fpc){
@@ -99,6 +131,15 @@ int try_parse_unix(char *argstr, int64_t *unixtime){
 }
 
 
+// argument did not match the (given or guessed) in-format
+#define ERR_CLI_PARSE -101
+// neither in- nor out-format could be determined
+#define ERR_CLI_FORMAT -102
+
+// stdout buffer size for --stream
+#define STREAM_BUF_SIZE (1 << 20)
+
+
 int guess_single_arg(char *argstr, TimeFormat *infmt, TimeFormat *outfmt){
     size_t len=strlen(argstr);
     int64_t unixtime;
@@ -113,11 +154,381 @@ int guess_single_arg(char *argstr, TimeFormat *infmt, TimeFormat *outfmt){
         *infmt = UNIX;
         if(*outfmt == UNKNOWN){ *outfmt = FP; }
     } else {
-        printf("Argument does not match any known format: %s\n", argstr);
+        return -1;
+    }
+    return 0;
+}
+
+
+// parse one payload into fpc, guesses the formats if infmt is UNKNOWN
+int parse_value(char *argstr, TimeFormat *infmt, TimeFormat *outfmt, FP_Components *fpc, bool is_verbose){
+    if(*infmt == UNKNOWN){
+        if(is_verbose){ printf("No in-format specified, guessing...\n"); }
+        if(guess_single_arg(argstr, infmt, outfmt) != 0){ return ERR_CLI_FORMAT; }
+    }
+
+    int64_t value;
+    switch(*infmt){
+        case ISO:
+            if(is_verbose){ printf("in-format=ISO\n"); }
+            if (*outfmt == ISO || *outfmt == UNKNOWN){ *outfmt = FP; }
+            return FP_from_iso(argstr, fpc);
+        case FP:
+            if(is_verbose){ printf("in-format=Flexpoch\n"); }
+            if (*outfmt == UNKNOWN){ *outfmt = FP; }
+            if (try_parse_fp_hex(argstr, &value) != 0){ return ERR_CLI_PARSE; }
+            if (((value >> 60) & 0xF) == CP_REL_FRAC){ return ERR_RESERVED_FORMAT; }   // FP_from_fp() would print a warning
+            return FP_from_fp(value, fpc);
+        case UNIX:
+            if(is_verbose){ printf("in-format=UNIX\n"); }
+            if (*outfmt == UNKNOWN){ *outfmt = FP; }
+            if (try_parse_unix(argstr, &value) != 0){ return ERR_CLI_PARSE; }
+            return FP_from_unix(value, fpc);
+        case JAVA:
+            if(is_verbose){ printf("in-format=JAVA\n"); }
+            if (*outfmt == UNKNOWN){ *outfmt = FP; }
+            if (try_parse_unix(argstr, &value) != 0){ return ERR_CLI_PARSE; }
+            return FP_from_java(value, fpc);
+        case LOGICAL:
+            if(is_verbose){ printf("in-format=LOGICAL\n"); }
+            if(*outfmt == UNKNOWN){ *outfmt = FP; }
+            if (try_parse_unix(argstr, &value) != 0){ return ERR_CLI_PARSE; }
+            return FP_from_logic(value, fpc);
+        default:
+            return ERR_CLI_FORMAT;
+    }
+}
+
+
+// print fpc as one line (JSON object with is_json_out) in outfmt
+int print_value(FP_Components *fpc, TimeFormat outfmt, bool is_json_out, bool is_verbose){
+    int error = 0;
+    int64_t value = 0;
+    char str[FP_ISO_MAX_LEN];
+
+    switch(outfmt){
+        case ISO:
+            if(is_verbose){ printf("out-format=ISO\n"); }
+            error = FP_format_iso(fpc, str, sizeof(str));
+            if(error < 0){ return error; }
+            if(is_json_out){
+                printf("{\"iso_time\": \"%s\"}\n", str);
+            } else {
+                printf("%s\n", str);
+            }
+            return 0;
+        case HTTP:
+        case RFC2822:
+        case RFC3339:
+            if(is_verbose){ printf("out-format=RFC\n"); }
+            error = FP_format_rfc(fpc, outfmt == HTTP ? RFC_7231 : outfmt == RFC2822 ? RFC_2822 : RFC_3339,
+                                  str, sizeof(str));
+            if(error < 0){ return error; }
+            if(is_json_out){
+                printf("{\"%s\": \"%s\"}\n", outfmt == HTTP ? "http_date" : outfmt == RFC2822 ? "rfc2822_time" : "rfc3339_time",
+                       str);
+            } else {
+                printf("%s\n", str);
+            }
+            return 0;
+        case FP:
+            if(is_verbose){ printf("out-format=Flexpoch\n"); }
+            error = FP_to_fp(fpc, &value);
+            if(error){ return error; }
+            if(is_json_out){
+                printf("{\"fp_time\": \"0x%016lX\"}\n", value);
+            } else {
+                printf("0x%016lX\n", value);
+            }
+            return 0;
+        case UNIX:
+            if(is_verbose){ printf("out-format=UNIX\n"); }
+            FP_to_unix(fpc, &value);
+            if(is_json_out){
+                printf("{\"unix_time\": %li}\n", value);
+            } else {
+                printf("%li\n", value);
+            }
+            return 0;
+        case NS:
+            if(is_verbose){ printf("out-format=NS\n"); }
+            if(__builtin_mul_overflow(fpc->seconds, (int64_t)1000000000, &value) ||
+               __builtin_add_overflow(value, (int64_t)fpc->ns, &value)){ return ERR_INCOMPATIBLE_OUTPUT; }
+            if(is_json_out){
+                printf("{\"ns_time\": %li}\n", value);
+            } else {
+                printf("%li\n", value);
+            }
+            return 0;
+        case JAVA:
+            if(is_verbose){ printf("out-format=JAVA\n"); }
+            FP_to_java(fpc, &value);
+            if(is_json_out){
+                printf("{\"java_time\": %li}\n", value);
+            } else {
+                printf("%li\n", value);
+            }
+            return 0;
+        case LOGICAL:
+            if(is_verbose){ printf("out-format=LOGICAL\n"); }
+            FP_to_logic(fpc, &value);
+            if(is_json_out){
+                printf("{\"logic_time\": %li}\n", value);
+            } else {
+                printf("%li\n", value);
+            }
+            return 0;
+        default:
+            return ERR_CLI_FORMAT;
+    }
+}
+
+
+// message for an ErrNo, NULL if unknown
+const char *error_message(int error){
+    switch(error){
+        case ERR_INVALID_ISO: return "ISO Error.";
+        case ERR_INVALID_OFFSET: return "Timezone offset outside of allowed range (-17:00 .. +17:00).";
+        case ERR_OUT_OF_RANGE: return "Value outside of encodable time range.";
+        case ERR_INVALID_YEAR: return "Invalid Floating Point Year.";
+        case ERR_INVALID_PRECISION: return "Precision Error.";
+        case ERR_OFFSET_AND_LEAPSECOND: return "Timezone offset and Leapsecond cannot be encoded at the same time.";
+        case ERR_CUSTOM_FORMAT: return "Custom codepoint range (start = 0xB). Please decode with custom decoder.";
+        case ERR_RESERVED_FORMAT: return "Reserved codepoint range (start = 0x8 or 0x9). Not supported by this version.";
+        case ERR_INCOMPATIBLE_OUTPUT: return "Value cannot be shown in this output format.";
+        case ERR_IO: return "File access failed.";
+        case ERR_CLI_PARSE: return "Value does not match the in-format.";
+        case ERR_CLI_FORMAT: return "Argument does not match any known format.";
+        default: return NULL;
+    }
+}
+
+void print_error(int error, size_t line, bool is_json_out){
+    const char *msg = error_message(error);
+    if(is_json_out){
+        printf("{\"line\": %zu, \"error\": %i, \"message\": \"%s\"}\n", line, error, msg ? msg : "Unknown Error.");
+    } else if(msg){
+        printf("Error! %s\n", msg);
+    } else {
+        printf("Error! Unkown Error: %i.\n", error);
+    }
+}
+
+
+// convert newline-delimited values from stdin, one output line per non-empty input
+// line. Failed lines print an error line and the stream continues.
+int run_stream(TimeFormat infmt, TimeFormat outfmt, bool is_json_out){
+    setvbuf(stdout, NULL, _IOFBF, STREAM_BUF_SIZE);
+
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    size_t line_no = 0;
+    size_t n_failed = 0;
+
+    while((len = getline(&line, &cap, stdin)) >= 0){
+        line_no++;
+        while(len > 0 && isspace((unsigned char)line[len-1])){ line[--len] = '\0'; }
+        if(len == 0){ continue; }
+
+        // guessing may pick different formats per line
+        TimeFormat line_infmt = infmt;
+        TimeFormat line_outfmt = outfmt;
+        FP_Components fpc = FP_new();
+
+        int error = parse_value(line, &line_infmt, &line_outfmt, &fpc, false);
+        if(!error){ error = print_value(&fpc, line_outfmt, is_json_out, false); }
+        if(error){
+            print_error(error, line_no, is_json_out);
+            n_failed++;
+        }
+    }
+
+    free(line);
+    fflush(stdout);
+    return n_failed ? 1 : 0;
+}
+
+
+// raw int64 flexpoch file -> int64 column or ISO lines
+int run_bulk(char *in_path, char *out_path, TimeFormat outfmt, FP_BulkOptions *opt, bool is_verbose){
+    switch(outfmt){
+        case UNKNOWN:
+        case UNIX: opt->output = BULK_UNIX; break;
+        case JAVA: opt->output = BULK_JAVA; break;
+        case NS:   opt->output = BULK_NS; break;
+        case ISO:  opt->output = BULK_ISO; break;
+        default:
+            print_error(ERR_INCOMPATIBLE_OUTPUT, 1, false);
+            return ERR_INCOMPATIBLE_OUTPUT;
+    }
+
+    FP_BulkStats stats;
+    int error = FP_bulk_transcode(in_path, out_path, opt, &stats);
+    if(error){
+        printf("Error! %s (%s)\n", error_message(error), strerror(errno));
+        return error;
+    }
+    if(is_verbose){ printf("%i threads, SIMD: %s\n", stats.threads, FP_batch_simd_name()); }
+    printf("%zu values, %zu failed\n", stats.n_values, stats.n_failed);
+    return stats.n_failed ? 1 : 0;
+}
+
+// TimeFormat -> field format of the transcoder, false if there is none
+bool to_field_format(TimeFormat fmt, FP_FieldFormat *out){
+    switch(fmt){
+        case UNKNOWN: *out = FIELD_AUTO; return true;
+        case FP:      *out = FIELD_FP; return true;
+        case ISO:     *out = FIELD_ISO; return true;
+        case UNIX:    *out = FIELD_UNIX; return true;
+        case JAVA:    *out = FIELD_JAVA; return true;
+        default: return false;
+    }
+}
+
+// CSV column / NDJSON field of stdin -> stdout
+int run_transcode(TimeFormat infmt, TimeFormat outfmt, FP_TranscodeOptions *opt, bool is_verbose){
+    if(!to_field_format(infmt, &opt->from) || !to_field_format(outfmt, &opt->to)){
+        print_error(ERR_INCOMPATIBLE_OUTPUT, 1, false);
+        return ERR_INCOMPATIBLE_OUTPUT;
+    }
+
+    fflush(stdout);
+    FP_TranscodeStats stats;
+    int error = FP_transcode_fd(STDIN_FILENO, STDOUT_FILENO, opt, &stats);
+    if(error){
+        fprintf(stderr, "Error! %s (%s)\n", error_message(error), strerror(errno));
+        return error;
+    }
+    // stdout carries the data
+    if(is_verbose){ fprintf(stderr, "%zu records, %zu converted, %zu failed\n", stats.records, stats.converted, stats.failed); }
+    return 0;
+}
+
+
+int run_serve(char *path, int workers, bool is_verbose){
+    if(is_verbose){
+        printf("Listening on %s\n", path);
+        fflush(stdout);
+    }
+    int error = FP_serve(path, workers);
+    if(error){ printf("Error! %s (%s)\n", error_message(error), strerror(errno)); }
+    return error;
+}
+
+// send up to FP_SERVE_MAX_COUNT lines per request, print one result per line
+int client_lines(int fd, char *text, size_t len, TimeFormat *infmt, TimeFormat *outfmt, size_t *n_failed){
+    static char payload[FP_SERVE_MAX_COUNT * FP_ISO_MAX_LEN];
+    static char response[FP_SERVE_MAX_RESPONSE(FP_SERVE_MAX_COUNT)];
+    static int16_t local_err[FP_SERVE_MAX_COUNT];
+    char *p = text;
+    char *end = text + len;
+
+    while(p < end){
+        FP_FieldFormat from = FIELD_AUTO, to = FIELD_AUTO;
+        uint32_t count = 0;
+        size_t length = 0;
+        while(p < end && count < FP_SERVE_MAX_COUNT){
+            char *nl = memchr(p, '\n', end - p);
+            char *line = p;
+            char *line_end = nl ? nl : end;
+            p = nl ? nl + 1 : end;
+            while(line_end > line && isspace((unsigned char)line_end[-1])){ line_end--; }
+            if(line_end == line){ continue; }
+            *line_end = '\0';
+
+            if(*infmt == UNKNOWN && guess_single_arg(line, infmt, outfmt) != 0){
+                print_error(ERR_CLI_FORMAT, 0, false);   // nothing queued before it
+                (*n_failed)++;
+                continue;
+            }
+            if(!to_field_format(*infmt, &from) || !to_field_format(*outfmt, &to) || from == FIELD_AUTO || to == FIELD_AUTO){
+                return ERR_INCOMPATIBLE_OUTPUT;
+            }
+            size_t line_len = line_end - line;
+            int64_t value = 0;
+            local_err[count] = 0;
+            if(from == FIELD_ISO){
+                if(line_len >= FP_ISO_MAX_LEN){ line_len = 0; local_err[count] = ERR_INVALID_ISO; }
+                memcpy(payload + length, line, line_len);
+                payload[length + line_len] = '\n';
+                length += line_len + 1;
+            } else {
+                int ok = (from == FIELD_FP) ? try_parse_fp_hex(line, &value) : try_parse_unix(line, &value);
+                if(ok != 0){ local_err[count] = ERR_CLI_PARSE; }
+                memcpy(payload + length, &value, sizeof(value));
+                length += sizeof(value);
+            }
+            count++;
+        }
+        if(count == 0){ break; }
+
+        FP_ServeHeader resp;
+        int error = FP_client_request(fd, from, to, count, payload, length, &resp, response, sizeof(response));
+        if(error == ERR_IO){ return error; }
+        const int16_t *err = (const int16_t *)response;
+        const char *values = response + ((count * sizeof(int16_t) + 7) & ~(size_t)7);
+        for(uint32_t i = 0; i < count; i++){
+            int row_error = error ? error : local_err[i] ? local_err[i] : err[i];
+            const char *line = values;
+            if(!error && to == FIELD_ISO){ values = (const char *)memchr(values, '\n', response + resp.length - values) + 1; }
+            if(row_error){
+                print_error(row_error, 0, false);
+                (*n_failed)++;
+            } else if(to == FIELD_ISO){
+                printf("%.*s\n", (int)(values - line - 1), line);
+            } else {
+                int64_t value;
+                memcpy(&value, values + i * sizeof(int64_t), sizeof(value));
+                if(to == FIELD_FP){ printf("0x%016lX\n", value); } else { printf("%li\n", value); }
+            }
+        }
+        fflush(stdout);
     }
     return 0;
 }
 
+// --stream through the daemon: stdin lines -> stdout, one request per read()
+int run_client(char *path, TimeFormat infmt, TimeFormat outfmt){
+    static char text[(1 << 20) + 1];
+    const size_t cap = sizeof(text) - 1;   // room for the NUL of an unterminated last line
+    if(infmt != UNKNOWN && outfmt == UNKNOWN){ outfmt = (infmt == FP) ? ISO : FP; }
+
+    int fd = FP_client_connect(path);
+    if(fd < 0){
+        printf("Error! %s (%s)\n", error_message(ERR_IO), strerror(errno));
+        return ERR_IO;
+    }
+
+    size_t len = 0;
+    size_t n_failed = 0;
+    bool eof = false;
+    int error = 0;
+    while(!eof && !error){
+        ssize_t r = read(STDIN_FILENO, text + len, cap - len);
+        if(r < 0 && errno == EINTR){ continue; }
+        eof = (r <= 0);
+        if(r > 0){ len += r; }
+
+        size_t end = len;
+        if(!eof){   // complete lines only, unless one fills the buffer
+            while(end > 0 && text[end - 1] != '\n'){ end--; }
+            if(end == 0 && len < cap){ continue; }
+            if(end == 0){ end = len; }
+        }
+        error = client_lines(fd, text, end, &infmt, &outfmt, &n_failed);
+        memmove(text, text + end, len - end);
+        len -= end;
+    }
+    close(fd);
+
+    if(error){
+        print_error(error, 0, false);
+        if(error == ERR_IO){ printf("(%s)\n", strerror(errno)); }
+        return error;
+    }
+    return n_failed ? 1 : 0;
+}
 
 
 int main(int argc, char *argv[]) {
@@ -127,6 +538,14 @@ int main(int argc, char *argv[]) {
     TimeFormat outfmt = UNKNOWN;
     bool is_json_out = false;
     bool is_verbose = false;
+    bool is_stream = false;
+    char *bulk_in = NULL;
+    char *bulk_out = NULL;
+    FP_BulkOptions bulk_opt = {BULK_UNIX, false, 0, 0};
+    bool is_transcode = false;
+    char *serve_path = NULL;
+    char *connect_path = NULL;
+    FP_TranscodeOptions transcode_opt = {FIELD_AUTO, FIELD_AUTO, NULL, 0, ','};
     int payload_arg_idx = 0;
     int error = 0;
     FP_Components fpc = FP_new();
@@ -151,10 +570,67 @@ int main(int argc, char *argv[]) {
             outfmt = UNIX;
         } else if (strncmp(argv[i], ARG_TO_JAVA, strlen(ARG_TO_JAVA)) == 0){
             outfmt = JAVA;
+        } else if (strncmp(argv[i], ARG_TO_NS, strlen(ARG_TO_NS)) == 0){
+            outfmt = NS;
+        } else if (strncmp(argv[i], ARG_TO_HTTP, strlen(ARG_TO_HTTP)) == 0){
+            outfmt = HTTP;
+        } else if (strncmp(argv[i], ARG_TO_RFC2822, strlen(ARG_TO_RFC2822)) == 0){
+            outfmt = RFC2822;
+        } else if (strncmp(argv[i], ARG_TO_RFC3339, strlen(ARG_TO_RFC3339)) == 0){
+            outfmt = RFC3339;
+        } else if (strncmp(argv[i], ARG_JSON_FIELD, strlen(ARG_JSON_FIELD)) == 0){  // before ARG_JSON (prefix)
+            if (i + 1 >= argc){
+                print_usage();
+                return 1;
+            }
+            is_transcode = true;
+            transcode_opt.json_field = argv[++i];
         } else if (strncmp(argv[i], ARG_JSON, strlen(ARG_JSON)) == 0){
             is_json_out = true;
         } else if (strncmp(argv[i], ARG_VERBOSE, strlen(ARG_VERBOSE)) == 0){
             is_verbose = true;
+        } else if (strncmp(argv[i], ARG_STREAM, strlen(ARG_STREAM)) == 0){
+            is_stream = true;
+        } else if (strncmp(argv[i], ARG_BULK, strlen(ARG_BULK)) == 0){
+            if (i + 2 >= argc){
+                print_usage();
+                return 1;
+            }
+            bulk_in = argv[++i];
+            bulk_out = argv[++i];
+        } else if (strncmp(argv[i], ARG_CSV_COL, strlen(ARG_CSV_COL)) == 0){
+            if (i + 1 >= argc){
+                print_usage();
+                return 1;
+            }
+            is_transcode = true;
+            transcode_opt.csv_column = atoi(argv[++i]);
+        } else if (strncmp(argv[i], ARG_CSV_DELIM, strlen(ARG_CSV_DELIM)) == 0){
+            if (i + 1 >= argc){
+                print_usage();
+                return 1;
+            }
+            transcode_opt.delimiter = argv[++i][0];
+        } else if (strncmp(argv[i], ARG_SERVE, strlen(ARG_SERVE)) == 0){
+            if (i + 1 >= argc){
+                print_usage();
+                return 1;
+            }
+            serve_path = argv[++i];
+        } else if (strncmp(argv[i], ARG_CONNECT, strlen(ARG_CONNECT)) == 0){
+            if (i + 1 >= argc){
+                print_usage();
+                return 1;
+            }
+            connect_path = argv[++i];
+        } else if (strncmp(argv[i], ARG_BIG_ENDIAN, strlen(ARG_BIG_ENDIAN)) == 0){
+            bulk_opt.big_endian = true;
+        } else if (strncmp(argv[i], ARG_THREADS, strlen(ARG_THREADS)) == 0){
+            if (i + 1 >= argc){
+                print_usage();
+                return 1;
+            }
+            bulk_opt.threads = atoi(argv[++i]);
         } else if (strncmp(argv[i], ARG_HELP, strlen(ARG_HELP)) == 0){
             print_usage();
             return 0;
@@ -166,156 +642,28 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    if(bulk_in){ return run_bulk(bulk_in, bulk_out, outfmt, &bulk_opt, is_verbose); }
+    if(serve_path){ return run_serve(serve_path, bulk_opt.threads, is_verbose); }
+    if(connect_path){ return run_client(connect_path, infmt, outfmt); }
+    if(is_transcode){ return run_transcode(infmt, outfmt, &transcode_opt, is_verbose); }
+    if(is_stream){ return run_stream(infmt, outfmt, is_json_out); }
+
     if(is_verbose){ print_version(); }
 
     if(payload_arg_idx){
-        if(infmt == UNKNOWN){
-            if(is_verbose){ printf("No in-format specified, guessing...\n"); }
-            guess_single_arg(argv[payload_arg_idx], &infmt, &outfmt);
-        }
-
-        switch(infmt){
-            case ISO: 
-                if(is_verbose){ printf("in-format=ISO\n"); }
-                error = FP_from_iso(argv[payload_arg_idx], &fpc);
-                if (error == 0) {
-                    if (outfmt == ISO || outfmt == UNKNOWN){ outfmt = FP; }
-                } else {
-                    printf("Unable to parse ISO sring %s", argv[payload_arg_idx]);
-                }
-                break;
-            case FP:
-                if(is_verbose){ printf("in-format=Flexpoch\n"); }
-                if (outfmt == UNKNOWN){ outfmt = FP; }
-                int64_t flexpoch = 0;
-                if (try_parse_fp_hex(argv[payload_arg_idx], &flexpoch) == 0) {
-                    error = FP_from_fp(flexpoch, &fpc);
-                } else {
-                    printf("Unable to parse FP hex!");
-                }
-                break;               
-            case UNIX:
-                if(is_verbose){ printf("in-format=UNIX\n"); }
-                if (outfmt == UNKNOWN){ outfmt = FP; }
-                int64_t unixtime;
-                if (try_parse_unix(argv[payload_arg_idx], &unixtime) == 0) {
-                    error = FP_from_unix(unixtime, &fpc);
-                } else {
-                    printf("Unable to parse integer time: %s!", argv[payload_arg_idx]);
-                }
-                break;
-            case JAVA:
-                if(is_verbose){ printf("in-format=JAVA\n"); }
-                if (outfmt == UNKNOWN){ outfmt = FP; }
-                int64_t javatime;
-                if (try_parse_unix(argv[payload_arg_idx], &javatime) == 0) {
-                    error = FP_from_java(javatime, &fpc);
-                } else {
-                    printf("Unable to parse integer time: %s!", argv[payload_arg_idx]);
-                }
-                break;
-            case LOGICAL:
-                if(is_verbose){ printf("in-format=LOGICAL\n"); }
-                if(outfmt == UNKNOWN){ outfmt = FP; }
-                int64_t logictime;
-                if (try_parse_unix(argv[payload_arg_idx], &logictime) == 0) {
-                    error = FP_from_logic(logictime, &fpc);
-                } else {
-                    printf("Unable to parse integer time: %s!", argv[payload_arg_idx]);
-                }
-                break;
-            default:
-                printf("Unknown in-FMT: \"%s\"", argv[payload_arg_idx]);
-                break;
-        }
+        error = parse_value(argv[payload_arg_idx], &infmt, &outfmt, &fpc, is_verbose);
     } else {
         if(is_verbose){ printf("No value for time format provided. Using system time.\n"); }
         get_current_time(&fpc);
         if(outfmt == UNKNOWN){ outfmt = FP; }
     }
 
-
     if(is_verbose){
         FP_print_components(&fpc);
     }
 
-    switch(outfmt){
-        case ISO:
-            if(is_verbose){ printf("out-format=ISO\n"); }
-            if(error){ break; }
-            char iso_string[50];
-            FP_to_iso(&fpc, iso_string);
-            if(is_json_out){
-                printf("{\"iso_time\": \"%s\"}\n", iso_string);
-            } else {
-                printf("%s\n", iso_string);
-            }
-            break;
-        case FP:
-            if(is_verbose){ printf("out-format=Flexpoch\n"); }
-            if(error){ break; }
-            int64_t fp;
-            error = FP_to_fp(&fpc, &fp);
-            if(error){ break; }
-            if(is_json_out){
-                printf("{\"fp_time\": \"0x%016lX\"}\n", fp);
-            } else {
-                printf("0x%016lX\n", fp);
-            }
-            break;
-        case UNIX:
-            if(is_verbose){ printf("out-format=UNIX\n"); }
-            if(error){ break; }
-            int64_t unixtime = 0;
-            FP_to_unix(&fpc, &unixtime);
-            if(is_json_out){
-                printf("\"unix_time\": %li\n", unixtime);
-            } else {
-                printf("%li\n", unixtime);
-            }
-            break;
-        case JAVA:
-            if(is_verbose){ printf("out-format=JAVA\n"); }
-            if(error){ break; }
-            int64_t javatime = 0;
-            FP_to_java(&fpc, &javatime);
-            if(is_json_out){
-                printf("\"java_time\": %li\n", javatime);
-            } else {
-                printf("%li\n", javatime);
-            }
-            break;
-        case LOGICAL:
-            if(is_verbose){ printf("out-format=LOGICAL\n"); }
-            if(error){ break; }
-            int64_t logictime = 0;
-            FP_to_logic(&fpc, &logictime);
-            if(is_json_out){
-                printf("\"logic_time\": %li\n", logictime);
-            } else {
-                printf("%li\n", logictime);
-            }
-            break;
-        default:
-            printf("Unknown output-format");
-            break;
-    }
-
-    if(error){ printf("Error! "); }
-
-    switch(error){
-        case 0: return 0; break;
-        case ERR_INVALID_ISO: printf("ISO Error.\n"); break;
-        case ERR_INVALID_OFFSET: printf("Timezone offset outside of allowed range (-17:00 .. +17:00).\n"); break;
-        case ERR_OUT_OF_RANGE: printf("Value outside of encodable time range.\n"); break;
-        case ERR_INVALID_YEAR: printf("Invalid Floating Point Year.\n"); break;
-        case ERR_INVALID_PRECISION: printf("Precision Error.\n"); break;
-        case ERR_OFFSET_AND_LEAPSECOND: printf("Timezone offset and Leapsecond cannot be encoded at the same time.\n"); break;
-        case ERR_CUSTOM_FORMAT: printf("Custom codepoint range (start = 0xB). Please decode with custom decoder.\n"); break;
-        case ERR_RESERVED_FORMAT: printf("Reserved codepoint range (start = 0x8 or 0x9). Not supported by this version.\n"); break;
-        default:
-            printf("Unkown Error: %i.\n", error);
-    }
+    if(!error){ error = print_value(&fpc, outfmt, is_json_out, is_verbose); }
+    if(error){ print_error(error, 1, false); }
 
     return error;
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include <stdio.h>
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "flexpoch.h"
+#include "fp_batch.h"
+#include "fp_agg.h"
+
+// Throughput of time-bucketed aggregation (fp_agg.h) over 30 days of millisec
+// telemetry, in time order and shuffled, by minute, hour, day and month for 1, 2,
+// 4, ... threads up to the online CPUs. Every result is compared with the single
+// threaded one (integer values, so that the sums are exact in any order).
+
+#define CFG_ROWS (1 << 24)
+#define CFG_ROUNDS 5
+#define CFG_START 1700000000
+#define CFG_DAYS 30
+
+enum { CASE_MINUTE, CASE_HOUR, CASE_DAY, CASE_MONTH, N_CASES };
+static const char *case_names[N_CASES] = {"minute", "hour", "day", "month"};
+static const FP_AggSpec specs[N_CASES] = {
+    {PRC_MINUTE, 0, CFG_START, 60, CFG_DAYS * 1440},
+    {PRC_UNKNOWN, 3600, CFG_START, 0, CFG_DAYS * 24},
+    {PRC_DAY, 0, CFG_START, 60, CFG_DAYS},
+    {PRC_MONTH, 0, CFG_START, 60, 2},
+};
+
+static FP_AggBucket *ref[N_CASES], *out;
+static size_t ref_used[N_CASES];
+static size_t mismatches;
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t xorshift(uint64_t *state){
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+int main(){
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    int64_t *java = malloc(CFG_ROWS * sizeof(int64_t));
+    int64_t *fp[2] = {malloc(CFG_ROWS * sizeof(int64_t)), malloc(CFG_ROWS * sizeof(int64_t))};
+    double *values[2] = {malloc(CFG_ROWS * sizeof(double)), malloc(CFG_ROWS * sizeof(double))};
+    out = malloc(CFG_DAYS * 1440 * sizeof(FP_AggBucket));
+    for (int c = 0; c < N_CASES; c++){ ref[c] = malloc(specs[c].n_buckets * sizeof(FP_AggBucket)); }
+    if (!java || !fp[0] || !fp[1] || !values[0] || !values[1] || !out || !ref[N_CASES - 1]){
+        printf("out of memory\n");
+        return 1;
+    }
+
+    // rows in time order, then a shuffled copy
+    uint64_t state = 0x9E3779B97F4A7C15;
+    int64_t step = (int64_t)CFG_DAYS * 86400000 / CFG_ROWS;
+    for (size_t i = 0; i < CFG_ROWS; i++){
+        java[i] = (int64_t)CFG_START * 1000 + i * step + xorshift(&state) % step;
+        values[0][i] = (double)(xorshift(&state) % 1000);
+    }
+    FP_from_java_batch(java, CFG_ROWS, PRC_MILLISEC, 60, fp[0], NULL);
+    memcpy(fp[1], fp[0], CFG_ROWS * sizeof(int64_t));
+    memcpy(values[1], values[0], CFG_ROWS * sizeof(double));
+    for (size_t i = CFG_ROWS - 1; i > 0; i--){
+        size_t j = xorshift(&state) % (i + 1);
+        int64_t t = fp[1][i]; fp[1][i] = fp[1][j]; fp[1][j] = t;
+        double v = values[1][i]; values[1][i] = values[1][j]; values[1][j] = v;
+    }
+    for (int c = 0; c < N_CASES; c++){ FP_aggregate(NULL, &specs[c], fp[0], values[0], CFG_ROWS, ref[c], &ref_used[c]); }
+
+    printf("\n\n----\nTime-bucketed aggregation (%d rows, %ld online CPUs)\n----\n", CFG_ROWS, online);
+    for (int shuffled = 0; shuffled < 2; shuffled++){
+        printf("%-8s", shuffled ? "shuffled" : "sorted");
+        for (int c = 0; c < N_CASES; c++){ printf(" %8s", case_names[c]); }
+        printf("   [Mrows/s]\n");
+        for (long threads = 0; ; threads = threads ? threads * 2 : 1){
+            if (threads > online){ threads = online; }
+            FP_Pool *pool = NULL;
+            if (threads){
+                FP_PoolOptions opt = {.threads = threads, .pin = true};
+                pool = FP_pool_create(&opt);
+                if (!pool){
+                    printf("pool with %ld threads failed\n", threads);
+                    return 1;
+                }
+            }
+            if (pool){ printf("%8d", FP_pool_size(pool)); } else { printf("%8s", "no pool"); }
+            for (int c = 0; c < N_CASES; c++){
+                double best = 1e9;
+                for (int r = 0; r < CFG_ROUNDS; r++){
+                    size_t used = 0;
+                    double t0 = now();
+                    FP_aggregate(pool, &specs[c], fp[shuffled], values[shuffled], CFG_ROWS, out, &used);
+                    double t = now() - t0;
+                    if (t < best){ best = t; }
+                    mismatches += used != ref_used[c];
+                }
+                mismatches += memcmp(out, ref[c], specs[c].n_buckets * sizeof(FP_AggBucket)) != 0;
+                printf(" %8.1f", CFG_ROWS / best * 1e-6);
+            }
+            printf("\n");
+            if (pool){ FP_pool_destroy(pool); }
+            if (threads == online){ break; }
+        }
+    }
+
+    printf("Aggregation: %zu mismatches\n", mismatches);
+    return mismatches != 0;
+}
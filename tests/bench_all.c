@@ -0,0 +1,645 @@
+#include <stdio.h>
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include "flexpoch.h"
+#include "fp_batch.h"
+#include "fp_bulk.h"
+#include "fp_transcode.h"
+#include "fp_serve.h"
+#include "fp_direct.h"
+#include "fp_sort.h"
+#include "fp_search.h"
+#include "fp_codec.h"
+#include "fp_wire.h"
+#include "fp_calendar.h"
+#include "fp_arith.h"
+#include "fp_internal.h"
+#include "prf.h"
+#include "tests.h"
+
+// Cycles per value of the single value decoder and of the batch functions (scalar
+// and SIMD), and throughput of the codecs, calendar, arithmetic, file transcoders
+// and the daemon next to the decode-everything way they replace. The results are
+// checked by bin/test_all, here they only keep the compiler from dropping the work.
+
+#define CFG_ROUNDS_PER_CODE 100
+#define CFG_BATCH_SIZE 4096
+#define CFG_COLUMN_SIZE (1 << 20)
+#define CFG_ISO_STRIDE 40
+PRF_Profile prf;
+static size_t sink;
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// xorshift64 generator with a bias towards valid codepoints
+static int64_t random_flexpoch(uint64_t *state){
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    int64_t value = *state;
+    switch (value & 0x30){
+        case 0x00: return value & 0x00FFFFFFFFFFFFFF;    // positive seconds
+        case 0x10: return (value & 0x0000FFFFFFFFFFFF) | ((int64_t)0xFF << 56) | 0x7; // sec+ precision
+        default: return value;
+    }
+}
+
+// an event of a few days in any precision, tz offset and leap second
+static int64_t random_event(uint64_t *state){
+    uint64_t r = random_flexpoch(state);
+    FP_Components fpc = FP_new();
+    fpc.seconds = 1483000000 + (r >> 40) % 400000;
+    fpc.ns = (r >> 8) % NS_PER_SEC;
+    fpc.precision = (Precision[]){PRC_23BIT, PRC_MICROSEC, PRC_15BIT, PRC_MILLISEC, PRC_SECOND, PRC_MINUTE}[r % 6];
+    fpc.tz_offset = (fpc.precision == PRC_MILLISEC || fpc.precision >= PRC_SECOND) ? (int)((r >> 4) % 61) * 15 - 450 : 0;
+    fpc.is_leapsecond = (r & 0x3F0) == 0;
+    if (fpc.is_leapsecond){ fpc.tz_offset = 0; }
+    int64_t value;
+    if (FP_to_fp(&fpc, &value) != SUCCESS){ value = r; }
+    return value;
+}
+
+// FP_from_fp() that skips the relative fractions it prints a warning for
+static ErrNo decode(int64_t flexpoch, FP_Components *fpc){
+    *fpc = FP_new();
+    return (((flexpoch >> 60) & 0xF) == CP_REL_FRAC) ? ERR_RESERVED_FORMAT : FP_from_fp(flexpoch, fpc);
+}
+
+static void bench_values(){
+    FP_Components fpc;
+#if defined(__aarch64__) || defined(_M_ARM64)
+    printf("Running on ARM\n");
+    enable_cycle_counter();
+#endif
+    printf("\n\n----\nSingle value decoder (FP_from_fp)\n----\n");
+    for (size_t k = 0; k < 2; k++){
+        const int64_t *values = k ? TEST_VALUES_NEG : TEST_VALUES_POS;
+        size_t n = k ? sizeof(TEST_VALUES_NEG)/8 : sizeof(TEST_VALUES_POS)/8;
+        if (k){ printf("\nnegative examples (should fail)\n"); }
+        for (size_t i = 0; i < n; i++){
+            PRF_reset(&prf);
+            for (int r = 0; r < CFG_ROUNDS_PER_CODE; r++){
+                FP_init(&fpc);
+                PRF_start(&prf);
+                sink += FP_from_fp(values[i], &fpc);
+                PRF_stop(&prf);
+            }
+            printf("FP=%016lX: ", values[i]);
+            PRF_print("fp", &prf);
+        }
+    }
+}
+
+static void bench_batch_decode(){
+    static int64_t values[CFG_BATCH_SIZE], seconds[CFG_BATCH_SIZE];
+    static uint32_t ns[CFG_BATCH_SIZE];
+    static int8_t precision[CFG_BATCH_SIZE];
+    static int16_t tz_offset[CFG_BATCH_SIZE], err[CFG_BATCH_SIZE];
+    static bool is_leapsecond[CFG_BATCH_SIZE];
+    static uint8_t fmt[CFG_BATCH_SIZE];
+    static uint64_t mask[CFG_BATCH_SIZE / 64];
+    uint64_t state = 0x9E3779B97F4A7C15;
+    size_t n_valid = 0, first;
+
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        values[i] = random_flexpoch(&state);
+    }
+    printf("\n\n----\nBatch decoder and validation (%d values)\n----\n", CFG_BATCH_SIZE);
+    FP_BatchOut out = {seconds, ns, precision, tz_offset, is_leapsecond, fmt, err};
+    for (int k = 0; k < 2; k++){
+        FP_batch_set_simd(k == 1);
+        PRF_reset(&prf);
+        for (int i = 0; i < CFG_ROUNDS_PER_CODE; i++){
+            PRF_start(&prf);
+            FP_from_fp_batch(values, CFG_BATCH_SIZE, &out);
+            PRF_stop(&prf);
+        }
+        printf("decode   %-10s %6.2f cycles/value\n", FP_batch_simd_name(), (double)prf.t_min / CFG_BATCH_SIZE);
+    }
+
+    // validation on valid values against decoding every value
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        FP_Components fpc;
+        if (decode(values[i], &fpc) == SUCCESS && FP_validate_batch(&values[i], 1, NULL, &first) == SUCCESS){
+            values[n_valid++] = values[i];
+        }
+    }
+    for (int k = 0; k < 2; k++){
+        FP_batch_set_simd(k == 1);
+        PRF_reset(&prf);
+        for (int i = 0; i < CFG_ROUNDS_PER_CODE; i++){
+            PRF_start(&prf);
+            sink += FP_validate_batch(values, n_valid, mask, &first);
+            PRF_stop(&prf);
+        }
+        printf("validate %-10s %6.2f cycles/value\n", FP_batch_simd_name(), (double)prf.t_min / n_valid);
+    }
+    FP_batch_set_simd(true);
+    PRF_reset(&prf);
+    for (int i = 0; i < CFG_ROUNDS_PER_CODE; i++){
+        PRF_start(&prf);
+        for (size_t k = 0; k < n_valid; k++){
+            FP_Components fpc = FP_new();
+            sink += FP_from_fp(values[k], &fpc);
+        }
+        PRF_stop(&prf);
+    }
+    printf("FP_from_fp          %6.2f cycles/value\n", (double)prf.t_min / n_valid);
+}
+
+static void bench_batch_encode(){
+    static int64_t unixtime[CFG_BATCH_SIZE], javatime[CFG_BATCH_SIZE], out[CFG_BATCH_SIZE];
+    static struct timespec ts[CFG_BATCH_SIZE];
+    static int16_t err[CFG_BATCH_SIZE];
+    uint64_t state = 0x2545F4914F6CDD1D;
+
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        uint64_t r = random_flexpoch(&state);
+        unixtime[i] = (int64_t)r >> 26;
+        javatime[i] = (int64_t)r >> 18;
+        ts[i] = (struct timespec){unixtime[i], (long)((r >> 8) % NS_PER_SEC)};
+    }
+    printf("\n\n----\nBatch encoders (%d values, nanosec)\n----\n", CFG_BATCH_SIZE);
+    for (int f = 0; f < 3; f++){
+        for (int k = 0; k < 2; k++){
+            FP_batch_set_simd(k == 1);
+            PRF_reset(&prf);
+            for (int i = 0; i < CFG_ROUNDS_PER_CODE; i++){
+                PRF_start(&prf);
+                switch (f){
+                    case 0: FP_from_unix_batch(unixtime, CFG_BATCH_SIZE, PRC_NANOSEC, 0, out, err); break;
+                    case 1: FP_from_java_batch(javatime, CFG_BATCH_SIZE, PRC_NANOSEC, 0, out, err); break;
+                    case 2: FP_from_timespec_batch(ts, CFG_BATCH_SIZE, PRC_NANOSEC, 0, out, err); break;
+                }
+                PRF_stop(&prf);
+            }
+            printf("%-8s %-10s %6.2f cycles/value\n", (const char*[]){"unix", "java", "timespec"}[f],
+                FP_batch_simd_name(), (double)prf.t_min / CFG_BATCH_SIZE);
+        }
+    }
+    FP_batch_set_simd(true);
+}
+
+static void bench_batch_iso(){
+    static char column[CFG_BATCH_SIZE * CFG_ISO_STRIDE];
+    static int64_t out[CFG_BATCH_SIZE];
+    static uint64_t err_mask[CFG_BATCH_SIZE / 64];
+    const char *layouts[] = {"%04d-%02d-%02dT%02d:%02d:%02dZ", "%04d-%02d-%02dT%02d:%02d:%02d.%03d+%02d:%02d",
+                             "%04d-%02d-%02dT%02d:%02d:%02d.%06d", "%04d-%02d-%02dT%02d:%02d:%02d.%09d-%02d:%02d"};
+    const int frac_mod[] = {1, 1000, 1000000, 1000000000};
+    uint64_t state = 0x853C49E6748FEA9B;
+
+    printf("\n\n----\nISO column parser (%d values)\n----\n", CFG_BATCH_SIZE);
+    for (int f = 0; f < 4; f++){
+        for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+            uint64_t r = random_flexpoch(&state);
+            char *row = column + i * CFG_ISO_STRIDE;
+            memset(row, 0, CFG_ISO_STRIDE);
+            snprintf(row, CFG_ISO_STRIDE, layouts[f], (int)(r % 10000), (int)((r >> 14) % 12) + 1,
+                (int)((r >> 18) % 28) + 1, (int)((r >> 23) % 24), (int)((r >> 28) % 60), (int)((r >> 34) % 60),
+                (int)((r >> 20) % frac_mod[f]), (int)((r >> 40) % 17), (int)((r >> 46) % 60));
+        }
+        for (int k = 0; k < 2; k++){
+            FP_batch_set_simd(k == 1);
+            PRF_reset(&prf);
+            for (int i = 0; i < CFG_ROUNDS_PER_CODE; i++){
+                PRF_start(&prf);
+                FP_from_iso_batch(column, NULL, CFG_ISO_STRIDE, CFG_BATCH_SIZE, out, err_mask);
+                PRF_stop(&prf);
+            }
+            printf("%-46s %-10s %7.2f cycles/value\n", layouts[f], FP_batch_simd_name(),
+                (double)prf.t_min / CFG_BATCH_SIZE);
+        }
+    }
+    FP_batch_set_simd(true);
+}
+
+static void bench_iso_format(){
+    static int64_t values[CFG_BATCH_SIZE];
+    static char arena[CFG_BATCH_SIZE * FP_ISO_MAX_LEN];
+    static size_t offsets[CFG_BATCH_SIZE + 1];
+    static int16_t err[CFG_BATCH_SIZE];
+    char out[FP_ISO_MAX_LEN];
+    uint64_t state = 0x6A09E667F3BCC908;
+
+    printf("\n\n----\nISO and RFC formatters\n----\n");
+    // cached against direct on mostly the same second
+    FP_IsoCache cache;
+    FP_RfcCache rfc_cache;
+    FP_iso_cache_init(&cache);
+    FP_rfc_cache_init(&rfc_cache);
+    FP_Components fpc = FP_new();
+    fpc.seconds = 1745857043;
+    fpc.precision = PRC_MILLISEC;
+    fpc.tz_offset = 0;
+    for (int style = -1; style <= RFC_3339; style++){
+        for (int k = 0; k < 2; k++){
+            PRF_reset(&prf);
+            for (int i = 0; i < CFG_ROUNDS_PER_CODE * 10; i++){
+                uint64_t r = random_flexpoch(&state);
+                fpc.seconds += (r & 0xFF) == 0;
+                fpc.ns = (r >> 8) % NS_PER_SEC;
+                PRF_start(&prf);
+                if (style < 0){
+                    sink += k ? FP_format_iso_cached(&cache, &fpc, out, sizeof(out)) : FP_format_iso(&fpc, out, sizeof(out));
+                } else {
+                    sink += k ? FP_format_rfc_cached(&rfc_cache, &fpc, style, out, sizeof(out))
+                              : FP_format_rfc(&fpc, style, out, sizeof(out));
+                }
+                PRF_stop(&prf);
+            }
+            printf("%-8s %-8s ", (const char*[]){"iso", "rfc 7231", "rfc 2822", "rfc 3339"}[style + 1], k ? "cached" : "direct");
+            PRF_print("fmt", &prf);
+        }
+    }
+
+    // a sorted export with millisecond values, one at a time as main.c does it and in batches
+    int64_t seconds = 1745857043;
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        uint64_t r = random_flexpoch(&state);
+        seconds += (r & 0x7) == 0;
+        values[i] = (seconds << 24) | (r & 0xFFC000) | ((int64_t)FP_tz_offset_to_bin((i / 1024) * 60) << 3) | 0b101;
+    }
+    for (int k = 0; k < 3; k++){
+        PRF_reset(&prf);
+        for (int i = 0; i < CFG_ROUNDS_PER_CODE; i++){
+            PRF_start(&prf);
+            if (k == 0){
+                size_t pos = 0;
+                for (size_t j = 0; j < CFG_BATCH_SIZE; j++){
+                    char iso_string[FP_ISO_MAX_LEN] = "";
+                    if (decode(values[j], &fpc) == SUCCESS){ FP_to_iso(&fpc, iso_string); }
+                    size_t len = strlen(iso_string);
+                    memcpy(arena + pos, iso_string, len);
+                    pos += len;
+                }
+            } else {
+                FP_to_iso_batch(values, CFG_BATCH_SIZE, arena, sizeof(arena), k == 1 ? offsets : NULL, 32, err);
+            }
+            PRF_stop(&prf);
+        }
+        printf("to_iso %-8s %7.2f cycles/value\n", (const char*[]){"single", "offsets", "fixed"}[k],
+            (double)prf.t_min / CFG_BATCH_SIZE);
+    }
+}
+
+static void bench_direct(){
+    static int64_t values[CFG_COLUMN_SIZE], times[CFG_BATCH_SIZE], out[CFG_COLUMN_SIZE];
+    static int16_t err[CFG_BATCH_SIZE];
+    uint64_t state = 0xA54FF53A5F1D36F1;
+
+    for (size_t i = 0; i < CFG_COLUMN_SIZE; i++){
+        values[i] = random_flexpoch(&state);
+    }
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        times[i] = (int64_t)(state >> (i % 24)) >> 20;
+    }
+    printf("\n\n----\nDirect conversions and FP_Column\n----\n");
+    for (int k = 0; k < 4; k++){
+        PRF_reset(&prf);
+        for (int r = 0; r < CFG_ROUNDS_PER_CODE; r++){
+            PRF_start(&prf);
+            for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+                switch (k){
+                    case 0: err[i] = FP_fp_to_unix_direct(values[i], &out[i]); break;
+                    case 1: err[i] = FP_fp_to_java_direct(values[i], &out[i]); break;
+                    case 2: err[i] = FP_unix_to_fp_direct(times[i], &out[i]); break;
+                    case 3: err[i] = FP_java_to_fp_direct(times[i], &out[i]); break;
+                }
+            }
+            PRF_stop(&prf);
+        }
+        sink += err[CFG_BATCH_SIZE - 1];
+        printf("%-9s %6.2f cycles/value\n", (const char*[]){"fp->unix", "fp->java", "unix->fp", "java->fp"}[k],
+            (double)prf.t_min / CFG_BATCH_SIZE);
+    }
+    PRF_reset(&prf);
+    for (int r = 0; r < CFG_ROUNDS_PER_CODE; r++){
+        PRF_start(&prf);
+        for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+            FP_Components fpc;
+            if (decode(values[i], &fpc) == SUCCESS){ FP_to_unix(&fpc, &out[i]); }
+        }
+        PRF_stop(&prf);
+    }
+    printf("%-9s %6.2f cycles/value (FP_from_fp + FP_to_unix)\n", "fp->unix", (double)prf.t_min / CFG_BATCH_SIZE);
+
+    // decode + java millis through an array of structs and through the column
+    FP_Column *col = FP_column_from_fp(values, CFG_COLUMN_SIZE);
+    FP_Components *aos = (FP_Components *)malloc(CFG_COLUMN_SIZE * sizeof(FP_Components));
+    for (int k = 0; k < 2; k++){
+        PRF_reset(&prf);
+        for (int r = 0; r < 5; r++){
+            PRF_start(&prf);
+            if (k == 0){
+                for (size_t i = 0; i < CFG_COLUMN_SIZE; i++){ decode(values[i], &aos[i]); }
+                for (size_t i = 0; i < CFG_COLUMN_SIZE; i++){ FP_to_java(&aos[i], &out[i]); }
+            } else {
+                FP_column_decode(col, values, CFG_COLUMN_SIZE);
+                FP_column_to_java(col, out, NULL);
+            }
+            PRF_stop(&prf);
+        }
+        size_t row_bytes = k ? sizeof(int64_t) + sizeof(uint32_t) + sizeof(int16_t) + sizeof(uint16_t)
+                             : sizeof(FP_Components);
+        printf("%-8s %3zu bytes/row %7.2f cycles/value\n", k ? "column" : "structs", row_bytes,
+            (double)prf.t_min / CFG_COLUMN_SIZE);
+    }
+    free(aos);
+    FP_column_free(col);
+}
+
+// comparator through the full decoder, the way the radix sort and the search avoid
+static int decode_cmp(const void *a, const void *b){
+    FP_Components x, y;
+    decode(*(const int64_t *)a, &x);
+    decode(*(const int64_t *)b, &y);
+    if (x.seconds != y.seconds){ return (x.seconds > y.seconds) - (x.seconds < y.seconds); }
+    return (x.ns > y.ns) - (x.ns < y.ns);
+}
+
+#define CFG_SEARCH_LOOKUPS 100000
+
+static void bench_sort_search(){
+    static int64_t values[CFG_COLUMN_SIZE], sorted[CFG_COLUMN_SIZE], scratch[CFG_COLUMN_SIZE];
+    static int64_t targets[CFG_SEARCH_LOOKUPS];
+    uint64_t state = 0x1F83D9AB5BE0CD19;
+
+    for (size_t i = 0; i < CFG_COLUMN_SIZE; i++){
+        values[i] = random_event(&state);
+    }
+    printf("\n\n----\nRadix sort and range search (%d values)\n----\n", CFG_COLUMN_SIZE);
+    PRF_reset(&prf);
+    for (int r = 0; r < 5; r++){
+        memcpy(sorted, values, sizeof(values));
+        PRF_start(&prf);
+        FP_radix_sort(sorted, CFG_COLUMN_SIZE, scratch);
+        PRF_stop(&prf);
+    }
+    printf("radix  %7.2f cycles/value\n", (double)prf.t_min / CFG_COLUMN_SIZE);
+    memcpy(scratch, values, sizeof(values));
+    PRF_reset(&prf);
+    PRF_start(&prf);
+    qsort(scratch, CFG_COLUMN_SIZE, sizeof(int64_t), decode_cmp);
+    PRF_stop(&prf);
+    printf("qsort  %7.2f cycles/value (FP_from_fp in the comparator)\n", (double)prf.t_min / CFG_COLUMN_SIZE);
+
+    for (size_t i = 0; i < CFG_SEARCH_LOOKUPS; i++){
+        targets[i] = (i & 1) ? sorted[(uint64_t)random_flexpoch(&state) % CFG_COLUMN_SIZE] : random_event(&state);
+    }
+    FP_ZoneMap *map = FP_zone_map_new();
+    FP_zone_map_update(map, sorted, CFG_COLUMN_SIZE);
+    size_t from;
+    for (int k = 0; k < 2; k++){
+        PRF_reset(&prf);
+        PRF_start(&prf);
+        for (size_t i = 0; i + 1 < CFG_SEARCH_LOOKUPS; i += 2){
+            sink += FP_range_search(k ? NULL : map, sorted, CFG_COLUMN_SIZE, targets[i], targets[i + 1], &from);
+        }
+        PRF_stop(&prf);
+        printf("range search %-10s %7.1f cycles/range\n", k ? "without" : "zone map", (double)prf.t_min * 2 / CFG_SEARCH_LOOKUPS);
+    }
+    // binary search with the decoding comparator
+    PRF_reset(&prf);
+    PRF_start(&prf);
+    for (size_t i = 0; i < CFG_SEARCH_LOOKUPS; i++){
+        size_t lo = 0, hi = CFG_COLUMN_SIZE;
+        while (lo < hi){
+            size_t mid = lo + (hi - lo) / 2;
+            if (decode_cmp(&scratch[mid], &targets[i]) < 0){ lo = mid + 1; } else { hi = mid; }
+        }
+        sink += lo;
+    }
+    PRF_stop(&prf);
+    printf("range search %-10s %7.1f cycles/range\n", "FP_from_fp", (double)prf.t_min * 2 / CFG_SEARCH_LOOKUPS);
+    FP_zone_map_free(map);
+}
+
+#define CFG_CODEC_SIZE ((1 << 20) + 123)
+
+static void bench_codec(){
+    static int64_t values[CFG_CODEC_SIZE], decoded[CFG_CODEC_SIZE + FP_CODEC_BLOCK];
+    static struct timespec ts[CFG_CODEC_SIZE];
+    static uint8_t wire[CFG_CODEC_SIZE * FP_WIRE_MAX];
+    uint8_t *buf = (uint8_t *)malloc(FP_codec_bound(CFG_CODEC_SIZE));
+    uint64_t state = 0x510E527FADE682D1;
+
+    printf("\n\n----\nDelta/XOR codec and wire encoding (%d values)\n----\n", CFG_CODEC_SIZE);
+    for (int k = 0; k < 4; k++){
+        // telemetry: ~100 events per second with jitter, or random bits
+        int64_t t = 1700000000LL * NS_PER_SEC;
+        for (size_t i = 0; i < CFG_CODEC_SIZE; i++){
+            uint64_t r = random_flexpoch(&state);
+            t += 5000000 + r % 10000000;
+            ts[i].tv_sec = t / NS_PER_SEC;
+            ts[i].tv_nsec = (k == 2) ? t % NS_PER_SEC : (k == 1) ? t % NS_PER_SEC / 1000000 * 1000000 : 0;
+            values[i] = r;
+        }
+        if (k < 3){
+            Precision prc = (Precision[]){PRC_SECOND, PRC_MILLISEC, PRC_NANOSEC}[k];
+            FP_from_timespec_batch(ts, CFG_CODEC_SIZE, prc, (k == 1) ? 60 : 0, values, NULL);
+        }
+
+        double enc = 1e9, dec = 1e9, wenc = 1e9, wdec = 1e9;
+        size_t size = 0, wsize = 0, used;
+        for (int r = 0; r < 5; r++){
+            double t0 = now();
+            size = FP_codec_encode(values, CFG_CODEC_SIZE, buf);
+            double t1 = now();
+            sink += FP_codec_decode(buf, decoded);
+            double t2 = now();
+            wsize = FP_wire_encode_batch(values, CFG_CODEC_SIZE, wire);
+            double t3 = now();
+            sink += FP_wire_decode_batch(wire, wsize, decoded, CFG_CODEC_SIZE, &used);
+            double t4 = now();
+            enc = (t1 - t0 < enc) ? t1 - t0 : enc;
+            dec = (t2 - t1 < dec) ? t2 - t1 : dec;
+            wenc = (t3 - t2 < wenc) ? t3 - t2 : wenc;
+            wdec = (t4 - t3 < wdec) ? t4 - t3 : wdec;
+        }
+        double raw = CFG_CODEC_SIZE * sizeof(int64_t);
+        const char *name = (const char*[]){"second", "millisec", "ns", "any"}[k];
+        printf("codec %-8s %5.2f bits/value,  encode %5.2f GB/s, decode %5.2f GB/s\n", name,
+               size * 8.0 / CFG_CODEC_SIZE, raw / enc * 1e-9, raw / dec * 1e-9);
+        printf("wire  %-8s %5.2f bytes/value, encode %5.2f GB/s, decode %5.2f GB/s\n", name,
+               (double)wsize / CFG_CODEC_SIZE, raw / wenc * 1e-9, raw / wdec * 1e-9);
+    }
+    free(buf);
+}
+
+#define CFG_CALENDAR_SIZE (1 << 20)
+
+// in place over sorted telemetry against decode + gmtime() / + seconds + encode
+static void bench_calendar_arith(){
+    static int64_t values[CFG_CALENDAR_SIZE], result[CFG_CALENDAR_SIZE];
+    uint64_t state = 0x1F83D9ABFB41BD6B;
+
+    int64_t t = 1700000000;
+    for (size_t i = 0; i < CFG_CALENDAR_SIZE; i++){
+        t += (random_flexpoch(&state) & 0xFF) == 0;
+        values[i] = (int64_t)(((uint64_t)t << 24) | (FP_tz_offset_to_bin(60) << 3) | 0b101);
+    }
+    printf("\n\n----\nCalendar truncation and arithmetic (%d values)\n----\n", CFG_CALENDAR_SIZE);
+    for (int k = 0; k < 2; k++){
+        Precision prc = k ? PRC_MONTH : PRC_DAY;
+        double t0 = now();
+        for (size_t i = 0; i < CFG_CALENDAR_SIZE; i++){
+            FP_Components fpc;
+            decode(values[i], &fpc);
+            time_t local = fpc.seconds + fpc.tz_offset * 60;
+            struct tm tm;
+            gmtime_r(&local, &tm);
+            tm.tm_sec = tm.tm_min = tm.tm_hour = 0;
+            tm.tm_mday = k ? 1 : tm.tm_mday;
+            fpc.seconds = timegm(&tm) - fpc.tz_offset * 60;
+            fpc.precision = prc;
+            FP_to_fp(&fpc, &result[i]);
+        }
+        double naive = now() - t0;
+        memcpy(result, values, sizeof(values));
+        t0 = now();
+        sink += FP_truncate_batch(result, CFG_CALENDAR_SIZE, prc, result, NULL);
+        double batch = now() - t0;
+        printf("truncate to %-5s %7.1f M/s, decode + gmtime + encode %6.1f M/s\n", k ? "month" : "day",
+               CFG_CALENDAR_SIZE / batch * 1e-6, CFG_CALENDAR_SIZE / naive * 1e-6);
+    }
+
+    int64_t hour = (int64_t)((uint64_t)CP_REL_SEC << 60 | (uint64_t)3600 << 24);
+    double t0 = now();
+    for (size_t i = 0; i < CFG_CALENDAR_SIZE; i++){
+        FP_Components c;
+        decode(values[i], &c);
+        c.seconds += 3600;
+        FP_to_fp(&c, &result[i]);
+    }
+    double naive = now() - t0;
+    t0 = now();
+    sink += FP_add_batch(values, CFG_CALENDAR_SIZE, hour, result, NULL);
+    double batch = now() - t0;
+    printf("add 1 h %7.1f M/s, decode + add + encode %6.1f M/s\n", CFG_CALENDAR_SIZE / batch * 1e-6,
+           CFG_CALENDAR_SIZE / naive * 1e-6);
+}
+
+#define CFG_BULK_SIZE (1 << 22)
+#define CFG_TRANSCODE_ROWS 1000000
+
+static void bench_files(){
+    char in[] = "/tmp/fp_bench_in_XXXXXX";
+    char out[] = "/tmp/fp_bench_out_XXXXXX";
+    uint64_t state = 0xBB67AE8584CAA73B;
+
+    printf("\n\n----\nBulk and CSV file transcoders\n----\n");
+    FILE *f = fdopen(mkstemp(in), "wb");
+    close(mkstemp(out));
+    for (size_t i = 0; i < CFG_BULK_SIZE; i++){
+        int64_t v = random_flexpoch(&state);
+        fwrite(&v, sizeof(v), 1, f);
+    }
+    fclose(f);
+    const FP_BulkOutput outputs[] = {BULK_UNIX, BULK_JAVA, BULK_NS, BULK_ISO};
+    for (int k = 0; k < 4; k++){
+        FP_BulkOptions opt = {outputs[k], false, 0, 0};
+        FP_BulkStats stats;
+        double t0 = now();
+        sink += FP_bulk_transcode(in, out, &opt, &stats);
+        double sec = now() - t0;
+        printf("bulk %-5s %6.1f Mvalues/s (%d threads)\n", (const char*[]){"unix", "java", "ns", "iso"}[k],
+            CFG_BULK_SIZE / sec * 1e-6, stats.threads);
+    }
+
+    // CSV with an ISO column, to flexpoch and back
+    f = fopen(in, "w");
+    fprintf(f, "id,ts,msg\n");
+    int64_t seconds = 1745857043;
+    for (int i = 0; i < CFG_TRANSCODE_ROWS; i++){
+        seconds += random_flexpoch(&state) & 0x3;
+        FP_Components fpc = FP_new();
+        char iso[FP_ISO_MAX_LEN];
+        FP_from_unix(seconds, &fpc);
+        FP_format_iso(&fpc, iso, sizeof(iso));
+        fprintf(f, "%d,%s,msg%d\n", i, iso, i);
+    }
+    fclose(f);
+    FP_TranscodeOptions opts[] = {{FIELD_ISO, FIELD_FP, NULL, 1, ','}, {FIELD_FP, FIELD_ISO, NULL, 1, ','}};
+    for (int k = 0; k < 2; k++){
+        int in_fd = open(k ? out : in, O_RDONLY);
+        int out_fd = open(k ? in : out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        double t0 = now();
+        sink += FP_transcode_fd(in_fd, out_fd, &opts[k], NULL);
+        double sec = now() - t0;
+        printf("csv %s %7.1f MB/s\n", k ? "fp->iso" : "iso->fp", lseek(in_fd, 0, SEEK_END) / sec * 1e-6);
+        close(in_fd);
+        close(out_fd);
+    }
+    remove(in);
+    remove(out);
+}
+
+#define CFG_SERVE_ROUNDS 2000
+
+static void bench_serve(){
+    static int64_t values[CFG_BATCH_SIZE];
+    static char response[FP_SERVE_MAX_RESPONSE(CFG_BATCH_SIZE)];
+    char path[] = "/tmp/fp_serve_XXXXXX";
+    close(mkstemp(path));
+    uint64_t state = 0x510E527FADE682D1;
+
+    fflush(stdout);   // the child would print the buffered output again
+    pid_t pid = fork();
+    if (pid == 0){
+        exit(FP_serve(path, 2));
+    }
+    int fd = -1;
+    for (int i = 0; i < 100 && fd < 0; i++){   // until the daemon listens
+        usleep(10000);
+        fd = FP_client_connect(path);
+    }
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        values[i] = random_flexpoch(&state);
+    }
+
+    printf("\n\n----\nConversion daemon (round trips)\n----\n");
+    FP_ServeHeader resp;
+    for (int k = 0; k < 2; k++){
+        uint32_t count = k ? CFG_BATCH_SIZE : 1;
+        PRF_reset(&prf);
+        for (int i = 0; i < CFG_SERVE_ROUNDS; i++){
+            PRF_start(&prf);
+            FP_client_request(fd, FIELD_FP, FIELD_UNIX, count, values, count * sizeof(int64_t),
+                              &resp, response, sizeof(response));
+            PRF_stop(&prf);
+        }
+        printf("%5u values %10.0f cycles/request\n", count, (double)prf.t_min);
+    }
+    close(fd);
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+}
+
+int main(){
+    bench_values();
+    bench_batch_decode();
+    bench_batch_encode();
+    bench_batch_iso();
+    bench_iso_format();
+    bench_direct();
+    bench_sort_search();
+    bench_codec();
+    bench_calendar_arith();
+    bench_files();
+    bench_serve();
+    printf("\n(checksum %zu)\n", sink);
+    return 0;
+}
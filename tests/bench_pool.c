@@ -0,0 +1,125 @@
+#include <stdio.h>
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "flexpoch.h"
+#include "fp_batch.h"
+#include "fp_pool.h"
+
+// Scaling of the thread pool conversions: throughput for 1, 2, 4, ... threads up
+// to the online CPUs (speedup should be near linear up to the physical cores).
+// Every result is compared with the single threaded fp_batch.h function.
+
+#define CFG_VALUES (1 << 22)
+#define CFG_ROUNDS 5
+
+enum { OP_TO_UNIX, OP_FROM_UNIX, OP_TO_ISO, OP_FROM_ISO, N_OPS };
+static const char *op_names[N_OPS] = {"fp->unix", "unix->fp", "fp->iso", "iso->fp"};
+
+static int64_t *fp, *unixtime, *out, *ref_out;
+static char *arena, *ref_arena;
+static size_t *offsets, *ref_offsets;
+static uint64_t *err_mask;
+static size_t arena_size;
+static size_t mismatches;
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run_op(FP_Pool *pool, int op){
+    switch (op){
+        case OP_TO_UNIX:   FP_pool_to_unix(pool, fp, CFG_VALUES, out, NULL); break;
+        case OP_FROM_UNIX: FP_pool_from_unix(pool, unixtime, CFG_VALUES, PRC_SECOND, 0, out, NULL); break;
+        case OP_TO_ISO:    FP_pool_to_iso(pool, fp, CFG_VALUES, arena, arena_size, offsets, 0, NULL); break;
+        case OP_FROM_ISO:  FP_pool_from_iso(pool, ref_arena, ref_offsets, 0, CFG_VALUES, out, err_mask); break;
+    }
+}
+
+static void check_op(int op){
+    switch (op){
+        case OP_TO_UNIX:   FP_to_unix_batch(fp, CFG_VALUES, ref_out, NULL); break;
+        case OP_FROM_UNIX: FP_from_unix_batch(unixtime, CFG_VALUES, PRC_SECOND, 0, ref_out, NULL); break;
+        case OP_FROM_ISO:  memcpy(ref_out, fp, CFG_VALUES * sizeof(int64_t)); break;
+        case OP_TO_ISO:
+            mismatches += memcmp(offsets, ref_offsets, (CFG_VALUES + 1) * sizeof(size_t)) != 0;
+            mismatches += memcmp(arena, ref_arena, ref_offsets[CFG_VALUES]) != 0;
+            return;
+    }
+    mismatches += memcmp(out, ref_out, CFG_VALUES * sizeof(int64_t)) != 0;
+}
+
+int main(){
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    arena_size = (size_t)CFG_VALUES * FP_ISO_MAX_LEN;
+    fp = malloc(CFG_VALUES * sizeof(int64_t));
+    unixtime = malloc(CFG_VALUES * sizeof(int64_t));
+    out = malloc(CFG_VALUES * sizeof(int64_t));
+    ref_out = malloc(CFG_VALUES * sizeof(int64_t));
+    arena = malloc(arena_size);
+    ref_arena = malloc(arena_size);
+    offsets = malloc((CFG_VALUES + 1) * sizeof(size_t));
+    ref_offsets = malloc((CFG_VALUES + 1) * sizeof(size_t));
+    err_mask = malloc(CFG_VALUES / 64 * sizeof(uint64_t));
+    if (!fp || !unixtime || !out || !ref_out || !arena || !ref_arena || !offsets || !ref_offsets || !err_mask){
+        printf("out of memory\n");
+        return 1;
+    }
+
+    // second precision timestamps, so that iso->fp gives the input back
+    uint64_t state = 0x9E3779B97F4A7C15;
+    for (size_t i = 0; i < CFG_VALUES; i++){
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        unixtime[i] = state % 4102444800;   // 1970..2100
+    }
+    FP_from_unix_batch(unixtime, CFG_VALUES, PRC_SECOND, 0, fp, NULL);
+    FP_to_iso_batch(fp, CFG_VALUES, ref_arena, arena_size, ref_offsets, 0, NULL);
+
+    printf("\n\n----\nThread pool scaling (%d values, %ld online CPUs)\n----\n", CFG_VALUES, online);
+    printf("threads");
+    for (int op = 0; op < N_OPS; op++){ printf(" %10s", op_names[op]); }
+    printf("   [Mvalues/s, speedup]\n");
+
+    double base[N_OPS] = {0};
+    for (long threads = 1; ; threads *= 2){
+        if (threads > online){ threads = online; }
+        FP_PoolOptions opt = {.threads = threads, .pin = true};
+        FP_Pool *pool = FP_pool_create(&opt);
+        if (!pool){
+            printf("pool with %ld threads failed\n", threads);
+            return 1;
+        }
+
+        printf("%7d", FP_pool_size(pool));
+        double rate[N_OPS];
+        for (int op = 0; op < N_OPS; op++){
+            double best = 1e9;
+            for (int r = 0; r < CFG_ROUNDS; r++){
+                double t0 = now();
+                run_op(pool, op);
+                double t = now() - t0;
+                if (t < best){ best = t; }
+            }
+            check_op(op);
+            rate[op] = CFG_VALUES / best * 1e-6;
+            if (threads == 1){ base[op] = rate[op]; }
+            printf(" %10.1f", rate[op]);
+        }
+        printf("  ");
+        for (int op = 0; op < N_OPS; op++){ printf(" %4.2fx", rate[op] / base[op]); }
+        printf("\n");
+        FP_pool_destroy(pool);
+        if (threads == online){ break; }
+    }
+
+    printf("Thread pool: %zu mismatches\n", mismatches);
+    return mismatches != 0;
+}
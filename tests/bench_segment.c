@@ -0,0 +1,122 @@
+#include <stdio.h>
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "flexpoch.h"
+#include "fp_batch.h"
+#include "fp_segment.h"
+
+// Append throughput of segment files for several fsync batch sizes and the
+// latency of time range reads through the sparse index. The file is created in
+// the working directory (or argv[1]) so that it lands on the local disk.
+
+#define CFG_RECORDS (1 << 20)
+#define CFG_PAYLOAD 48
+#define CFG_RANGES 100000
+#define CFG_RANGE_LEN 100    // records per range read
+
+static int64_t *events;
+static size_t mismatches;
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int cmp_double(const void *a, const void *b){
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// append n records with an fdatasync() every sync_records, returns records/s
+static double bench_append(const char *path, size_t n, size_t sync_records){
+    FP_SegmentOptions opt = {.sync_records = sync_records};
+    FP_SegmentWriter *w;
+    char payload[CFG_PAYLOAD];
+    unlink(path);
+    if (FP_segment_writer_open(path, &opt, &w) != SUCCESS){
+        perror(path);
+        exit(1);
+    }
+    double t0 = now();
+    for (size_t i = 0; i < n; i++){
+        memcpy(payload, &i, sizeof(i));
+        mismatches += FP_segment_append(w, events[i], payload, sizeof(payload)) != SUCCESS;
+    }
+    mismatches += FP_segment_writer_close(w) != SUCCESS;
+    return n / (now() - t0);
+}
+
+int main(int argc, char **argv){
+    const char *path = (argc > 1) ? argv[1] : "fp_bench_segment.seg";
+    events = malloc(CFG_RECORDS * sizeof(int64_t));
+    int64_t *seconds = malloc(CFG_RECORDS * sizeof(int64_t));
+    double *latency = malloc(CFG_RANGES * sizeof(double));
+    if (!events || !seconds || !latency){
+        printf("out of memory\n");
+        return 1;
+    }
+
+    // one event every ~10 ms of a few hours, second precision
+    uint64_t state = 0x9E3779B97F4A7C15;
+    int64_t t = 1700000000;
+    for (size_t i = 0; i < CFG_RECORDS; i++){
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        t += (state % 100 == 0);
+        seconds[i] = t;
+    }
+    FP_from_unix_batch(seconds, CFG_RECORDS, PRC_SECOND, 0, events, NULL);
+
+    printf("\n\n----\nSegment files (%d records of %d bytes, %s)\n----\n", CFG_RECORDS, CFG_PAYLOAD, path);
+    size_t syncs[] = {1, 64, 1024, 16384, SIZE_MAX};
+    for (size_t k = 0; k < sizeof(syncs) / sizeof(syncs[0]); k++){
+        size_t n = (syncs[k] < 64) ? CFG_RECORDS / 64 : CFG_RECORDS;   // one fsync per record is slow
+        double rate = bench_append(path, n, syncs[k]);
+        if (syncs[k] == SIZE_MAX){
+            printf("append, fsync on close      %10.0f records/s %8.1f MB/s\n", rate, rate * (16 + CFG_PAYLOAD) * 1e-6);
+        } else {
+            printf("append, fsync every %6zu  %10.0f records/s %8.1f MB/s\n", syncs[k], rate, rate * (16 + CFG_PAYLOAD) * 1e-6);
+        }
+    }
+
+    // range reads on the last (full) segment
+    FP_SegmentReader *r;
+    double t0 = now();
+    if (FP_segment_reader_open(path, &r) != SUCCESS){
+        perror(path);
+        return 1;
+    }
+    printf("open          %8.1f us\n", (now() - t0) * 1e6);
+    mismatches += FP_segment_count(r) != CFG_RECORDS;
+    size_t rows = 0;
+    for (size_t q = 0; q < CFG_RANGES; q++){
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        size_t a = state % (CFG_RECORDS - CFG_RANGE_LEN);
+        double t1 = now();
+        FP_SegmentCursor cur;
+        FP_SegmentRecord rec;
+        FP_segment_seek(r, events[a], events[a + CFG_RANGE_LEN], &cur);
+        while (FP_segment_next(&cur, &rec)){
+            rows++;
+            mismatches += rec.len != CFG_PAYLOAD;
+        }
+        latency[q] = now() - t1;
+    }
+    qsort(latency, CFG_RANGES, sizeof(double), cmp_double);
+    printf("range read    %8.2f us median, %.2f us p99 (%.0f records per range)\n",
+           latency[CFG_RANGES / 2] * 1e6, latency[CFG_RANGES * 99 / 100] * 1e6, (double)rows / CFG_RANGES);
+    FP_segment_reader_close(r);
+    unlink(path);
+
+    printf("Segment files: %zu mismatches\n", mismatches);
+    return mismatches != 0;
+}
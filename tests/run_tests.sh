@@ -57,10 +57,14 @@ test "--from-unix 1743154226 --to-iso" "2025-03-28T09:30:26Z"
 test "--from-unix 1743154226 --to-fp" "0x0067E66C32800007"
 test "--from-iso 2025-03-28T09:30:26 --to-unix" "1743154226"
 test "--from-iso 2025-03-28T09:30:26 --to-fp" "0x0067E66C32800007"
+test "--from-iso 2025-03-28T09:30:26 --to-java" "1743154226000"   # no fraction counts as 0 ns
+test "--from-iso 2025-03-28T09:30:26+01:00 --to-java" "1743150626000"
 test "0x0067E66C32000000 --to-unix" "1743154226"
 test "0x0067E66C32000000 --to-iso" "2025-03-28T09:30:26.000000000Z"
 
 test "--from-unix 0 --to-iso" "1970-01-01T00:00:00Z"
+test "--from-unix -1 --to-iso" "1969-12-31T23:59:59Z"
+test "--from-unix -62135596801 --to-iso" "0000-12-31T23:59:59Z"
 test "--from-unix 0 --to-fp" "0x0000000000800007"
 
 test "--from-unix 545460846591" "0x7EFFFFFFFF800007"  # max value
@@ -176,6 +180,10 @@ test "--from-iso 2016-12-31T23:59:59.000 --to-fp" "0x005868467F002005" # leapsec
 test "--from-iso 2016-12-31T23:59:60.000 --to-fp" "0x005868467F003FFD" # leapsecond at millisec prescision
 test "0x005868467F003FFD --to-iso" "2016-12-31T23:59:60.000Z"
 
+# ISO timezone offsets
+test "--from-iso 2025-04-28T18:17:23.123+02:00 --to-fp" "0x00680FAA131F63C5"
+test "--from-iso 2020-10-05T11:11:11-05:30 --to-fp" "0x005F7B4CA756C007"
+
 test_status
 
 ############################
@@ -309,3 +317,141 @@ test "0x8000000000000000 --to-unix" "Error! Reserved codepoint range (start = 0x
 test "0x9FFFFFFFFFFFFFFF --to-unix" "Error! Reserved codepoint range (start = 0x8 or 0x9). Not supported by this version."
 
 test_status
+
+###################
+### RFC formats ###
+###################
+
+echo "Test RFC 7231 / 2822 / 3339 output..."
+echo "-------------------------------------"
+test "--from-unix 784111777 --to-http" "Sun, 06 Nov 1994 08:49:37 GMT"
+test "--from-iso 2025-04-28T18:17:23.123+02:00 --to-http" "Mon, 28 Apr 2025 16:17:23 GMT"
+test "--from-iso 2025-04-28T18:17:23.123+02:00 --to-rfc2822" "Mon, 28 Apr 2025 18:17:23 +0200"
+test "--from-iso 2020-10-05T11:11:11-05:30 --to-rfc2822" "Mon, 05 Oct 2020 11:11:11 -0530"
+test "--from-iso 2025-04-28T18:17:23.123+02:00 --to-rfc3339" "2025-04-28T18:17:23.123+02:00"
+test "0x005868467FFFE007 --to-rfc3339" "2016-12-31T23:59:60Z"
+test "0x005868467FFFE007 --to-http" "Sat, 31 Dec 2016 23:59:60 GMT"
+test "--from-unix 784111777 --to-http --json" "{http_date: Sun, 06 Nov 1994 08:49:37 GMT}"
+test "--from-unix -62167219201 --to-http" "Error! Value outside of encodable time range."
+
+test_status
+
+
+##############
+### Stream ###
+##############
+
+test_stream () {
+    # args: stdin lines, fp params, expected output (lines joined by blanks)
+    actual="$(printf "$1" | ./bin/fp --stream $2 | xargs)"
+    expected="$3"
+    assert_eq "$expected" "$actual" "not equivalent! (printf '$1' | ./bin/fp --stream $2)"
+    if [ "$?" -gt "0" ]; then
+        test_failed=true
+    fi
+}
+
+echo "Test stream mode..."
+echo "-------------------------------------"
+test_stream "1743154226\n0\n" "--from-unix --to-iso" "2025-03-28T09:30:26Z 1970-01-01T00:00:00Z"
+test_stream "1743154226\n\n0x0067E66C32000000\r\n2025-03-28T09:30:26\n" "" "0x0067E66C32800007 2025-03-28T09:30:26.000000000Z 0x0067E66C32800007"
+test_stream "1743154226\n545460846592\n0\n" "--from-unix --to-fp" "0x0067E66C32800007 Error! Value outside of encodable time range. 0x0000000000800007"
+test_stream "784111777\nnot-a-time\n" "--to-http --json" "{http_date: Sun, 06 Nov 1994 08:49:37 GMT} {line: 2, error: -102, message: Argument does not match any known format.}"
+test_stream "1\n2\n" "--from-unix --to-unix --json" "{unix_time: 1} {unix_time: 2}"
+test_stream "0xC000000000000001\n1743154226\n" "--json" "{line: 1, error: -128, message: Reserved codepoint range (start = 0x8 or 0x9). Not supported by this version.} {fp_time: 0x0067E66C32800007}"
+
+test_status
+
+
+############
+### Bulk ###
+############
+
+bulk_in="$(mktemp)"
+bulk_out="$(mktemp)"
+
+echo "Test bulk mode..."
+echo "-------------------------------------"
+printf '\x07\x00\x80\x32\x6C\xE6\x67\x00\x00\x00\x00\x00\x00\x00\x00\x80' > "$bulk_in"  # 0x0067E66C32800007, reserved
+test "--bulk $bulk_in $bulk_out --to-iso" "2 values, 1 failed"
+assert_eq "2025-03-28T09:30:26Z" "$(cat "$bulk_out" | xargs)" "not equivalent! (--bulk --to-iso)" || test_failed=true
+test "--bulk $bulk_in $bulk_out --to-unix" "2 values, 1 failed"
+assert_eq "1743154226 -9223372036854775808" "$(od -An -td8 "$bulk_out" | xargs)" "not equivalent! (--bulk --to-unix)" || test_failed=true
+printf '\x00\x67\xE6\x6C\x32\x80\x00\x07' > "$bulk_in"
+test "--bulk $bulk_in $bulk_out --to-java --big-endian --threads 2" "1 values, 0 failed"
+assert_eq "1743154226000" "$(od -An -td8 "$bulk_out" | xargs)" "not equivalent! (--bulk --to-java --big-endian)" || test_failed=true
+test "--bulk /nonexistent/in $bulk_out --to-unix" "Error! File access failed. (No such file or directory)"
+
+rm -f "$bulk_in" "$bulk_out"
+
+test_status
+
+
+#################
+### Transcode ###
+#################
+
+test_transcode () {
+    # args: stdin records, fp params, expected output (records joined by blanks)
+    actual="$(printf "$1" | ./bin/fp $2 | tr -d '\r' | tr '\n' ' ' | sed 's/ *$//')"
+    expected="$3"
+    assert_eq "$expected" "$actual" "not equivalent! (printf '$1' | ./bin/fp $2)"
+    if [ "$?" -gt "0" ]; then
+        test_failed=true
+    fi
+}
+
+echo "Test CSV / NDJSON transcoder..."
+echo "-------------------------------------"
+test_transcode "id,ts\n1,2025-03-28T09:30:26Z\n" "--csv-col 1 --from-iso" "id,ts 1,0x0067E66C32800007"
+test_transcode "a,\"x,y\",0x0067E66C32000000,z\n" "--csv-col 2 --to-unix" "a,\"x,y\",1743154226,z"
+test_transcode "\"2025-03-28T09:30:26Z\";x\r\n" "--csv-col 0 --csv-delim ; --from-iso --to-java" "\"1743154226000\";x"
+test_transcode "1,\"multi\nline\",1743154226\n2,x,bad\n" "--csv-col 2 --from-unix --to-iso" "1,\"multi line\",2025-03-28T09:30:26Z 2,x,bad"
+test_transcode "{\"ts\":1743154226000,\"v\":1}\n" "--json-field ts --from-java --to-iso" "{\"ts\":\"2025-03-28T09:30:26.000Z\",\"v\":1}"
+test_transcode "{\"a\":\"ts\",\"ts\": \"0x0067E66C32800007\"}\n" "--json-field ts --to-unix" "{\"a\":\"ts\",\"ts\": 1743154226}"
+
+test_status
+
+
+##############
+### Daemon ###
+##############
+
+serve_sock="$(mktemp -u)"
+./bin/fp --serve "$serve_sock" --threads 2 &
+serve_pid=$!
+for i in $(seq 50); do [ -S "$serve_sock" ] && break; sleep 0.05; done
+
+test_client () {
+    # args: stdin lines, fp params, expected output (lines joined by blanks)
+    actual="$(printf "$1" | ./bin/fp --connect "$serve_sock" $2 | xargs)"
+    expected="$3"
+    assert_eq "$expected" "$actual" "not equivalent! (printf '$1' | ./bin/fp --connect SOCK $2)"
+    if [ "$?" -gt "0" ]; then
+        test_failed=true
+    fi
+}
+
+echo "Test daemon and client..."
+echo "-------------------------------------"
+test_client "1743154226\n0\n" "--from-unix --to-iso" "2025-03-28T09:30:26Z 1970-01-01T00:00:00Z"
+test_client "2025-03-28T09:30:26\n\nnot-a-time\n" "--from-iso --to-fp" "0x0067E66C32800007 Error! ISO Error."
+test_client "0x0067E66C32000000\n0x8000000000000000\n" "--to-unix" "1743154226 Error! Reserved codepoint range (start = 0x8 or 0x9). Not supported by this version."
+test_client "1743154226500\n" "--from-java --to-iso" "2025-03-28T09:30:26.500Z"
+test_client "1743154226\n545460846592\n" "" "0x0067E66C32800007 Error! Value outside of encodable time range."
+
+kill $serve_pid
+wait $serve_pid
+[ ! -e "$serve_sock" ] || { echo "socket not removed"; test_failed=true; }
+
+test_status
+
+##################
+### Unit Tests ###
+##################
+
+echo "Test batch functions and modules (bin/test_all)..."
+echo "-------------------------------------"
+unit_out="$(./bin/test_all)" || { echo "$unit_out" | grep "mismatches" | grep -v " 0 mismatches"; test_failed=true; }
+
+test_status
@@ -5,54 +5,1681 @@
 #include <stdlib.h> // strtoul
 #include <ctype.h> // isxdigit
 #include <locale.h>  // set locale to UTF-8
+#include <math.h>  // INFINITY
+#include <unistd.h>  // mkstemp
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 #include "flexpoch.h"
-#include "prf.h"
+#include "fp_batch.h"
+#include "fp_bulk.h"
+#include "fp_transcode.h"
+#include "fp_serve.h"
+#include "fp_pool.h"
+#include "fp_direct.h"
+#include "fp_sort.h"
+#include "fp_search.h"
+#include "fp_segment.h"
+#include "fp_codec.h"
+#include "fp_wire.h"
+#include "fp_calendar.h"
+#include "fp_agg.h"
+#include "fp_arith.h"
+#include "fp_internal.h"
 #include "tests.h"
 
-#define CFG_ROUNDS_PER_CODE 100
-PRF_Profile prf;
+#define CFG_BATCH_SIZE 4096
 
-void test_value(int64_t flexpoch){
-    FP_Components fpc;
-    PRF_reset(&prf);
-    int result;
+// The known values decode, the negative examples fail
+size_t test_values(){
+    size_t mismatches = 0;
+    printf("\n\n----\nTesting example values\n----\n");
+    for (size_t i = 0; i < sizeof(TEST_VALUES_POS)/8; i++){
+        FP_Components fpc = FP_new();
+        mismatches += FP_from_fp(TEST_VALUES_POS[i], &fpc) != SUCCESS;
+    }
+    for (size_t i = 0; i < sizeof(TEST_VALUES_NEG)/8; i++){
+        FP_Components fpc = FP_new();
+        mismatches += FP_from_fp(TEST_VALUES_NEG[i], &fpc) == SUCCESS;
+    }
+    printf("Example values: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+// xorshift64 generator with a bias towards valid codepoints
+int64_t random_flexpoch(uint64_t *state){
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    int64_t value = *state;
+    switch (value & 0x30){
+        case 0x00: return value & 0x00FFFFFFFFFFFFFF;    // positive seconds
+        case 0x10: return (value & 0x0000FFFFFFFFFFFF) | ((int64_t)0xFF << 56) | 0x7; // sec+ precision
+        default: return value;
+    }
+}
+
+size_t test_batch_decode(){
+    static int64_t values[CFG_BATCH_SIZE];
+    static int64_t seconds[2][CFG_BATCH_SIZE];
+    static uint32_t ns[2][CFG_BATCH_SIZE];
+    static int8_t precision[2][CFG_BATCH_SIZE];
+    static int16_t tz_offset[2][CFG_BATCH_SIZE];
+    static bool is_leapsecond[2][CFG_BATCH_SIZE];
+    static uint8_t fmt[2][CFG_BATCH_SIZE];
+    static int16_t err[2][CFG_BATCH_SIZE];
+    uint64_t state = 0x9E3779B97F4A7C15;
+    size_t n_pos = sizeof(TEST_VALUES_POS)/8;
+    size_t n_neg = sizeof(TEST_VALUES_NEG)/8;
+
+    memcpy(values, TEST_VALUES_POS, sizeof(TEST_VALUES_POS));
+    memcpy(values + n_pos, TEST_VALUES_NEG, sizeof(TEST_VALUES_NEG));
+    for (size_t i = n_pos + n_neg; i < CFG_BATCH_SIZE; i++){
+        values[i] = random_flexpoch(&state);
+    }
+
+    printf("\n\n----\nTesting batch decoder (%d values)\n----\n", CFG_BATCH_SIZE);
+    for (int k = 0; k < 2; k++){
+        FP_batch_set_simd(k == 1);
+        FP_BatchOut out = {seconds[k], ns[k], precision[k], tz_offset[k], is_leapsecond[k], fmt[k], err[k]};
+        FP_from_fp_batch(values, CFG_BATCH_SIZE, &out);
+    }
+    FP_batch_set_simd(true);
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        FP_Components fpc = FP_new();
+        ErrNo result = ERR_RESERVED_FORMAT;
+        if (((values[i] >> 60) & 0xF) != CP_REL_FRAC){ result = FP_from_fp(values[i], &fpc); }
+        if (result != SUCCESS){ fpc = FP_new(); }
+        if (seconds[0][i] != seconds[1][i] || ns[0][i] != ns[1][i] ||
+            precision[0][i] != precision[1][i] || tz_offset[0][i] != tz_offset[1][i] ||
+            is_leapsecond[0][i] != is_leapsecond[1][i] || fmt[0][i] != fmt[1][i] || err[0][i] != err[1][i] ||
+            err[1][i] != result || seconds[1][i] != fpc.seconds || ns[1][i] != fpc.ns ||
+            precision[1][i] != fpc.precision || tz_offset[1][i] != fpc.tz_offset ||
+            is_leapsecond[1][i] != fpc.is_leapsecond || fmt[1][i] != fpc.fmt){
+            printf("Mismatch for FP=%016lX\n", values[i]);
+            mismatches++;
+        }
+    }
+    printf("Batch decoder: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+// FP_from_fp() error of a value, plus ERR_INVALID_OFFSET beyond the FP_to_fp() range
+static ErrNo validate_ref(int64_t flexpoch){
+    if (((flexpoch >> 60) & 0xF) == CP_REL_FRAC){ return ERR_RESERVED_FORMAT; }   // FP_from_fp() prints
+    FP_Components fpc = FP_new();
+    ErrNo err = FP_from_fp(flexpoch, &fpc);
+    if (err == SUCCESS && (fpc.fmt == FMT_ABS_SEC || fpc.fmt == FMT_REL_SEC) &&
+        (fpc.tz_offset < -1020 || 1020 < fpc.tz_offset)){
+        err = ERR_INVALID_OFFSET;
+    }
+    return err;
+}
+
+size_t test_validate(){
+    static int64_t values[CFG_BATCH_SIZE];
+    static uint64_t mask[2][CFG_BATCH_SIZE / 64];
+    static ErrNo ref[CFG_BATCH_SIZE];
+    uint64_t state = 0x6A09E667F3BCC908;
+    size_t n_pos = sizeof(TEST_VALUES_POS)/8;
+    size_t n_neg = sizeof(TEST_VALUES_NEG)/8;
+    size_t mismatches = 0;
+
+    memcpy(values, TEST_VALUES_POS, sizeof(TEST_VALUES_POS));
+    memcpy(values + n_pos, TEST_VALUES_NEG, sizeof(TEST_VALUES_NEG));
+    for (size_t i = n_pos + n_neg; i < CFG_BATCH_SIZE; i++){
+        uint64_t r = random_flexpoch(&state);
+        switch (i % 4){
+            case 0: values[i] = r; break;
+            case 1: values[i] = (r & ~(uint64_t)0x7FF8) | 0b101 | ((r >> 40) % 2048) << 3; break;   // ms, any tz bin
+            case 2: values[i] = (r & ~(uint64_t)0xFFFFFF) | 0b111 | ((r >> 40) % 2048) << 13 | (r >> 20) % 16 << 3; break;
+            default: values[i] = (r & 0xFF000000FFFFFFFF) | (i % 3 ? 0 : r & 0xFF);   // float years with and without tail
+        }
+        values[i] = (i % 64 == 7) ? (int64_t)((uint64_t)((i / 64) % 2 ? 0x7F : 0xE0) << 56 | (r & 0xFFFFFFFF) << 24) : values[i];
+    }
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        ref[i] = validate_ref(values[i]);
+    }
+
+    printf("\n\n----\nTesting batch validation (%d values)\n----\n", CFG_BATCH_SIZE);
+    for (int k = 0; k < 2; k++){
+        FP_batch_set_simd(k == 1);
+        size_t first = 0;
+        ErrNo err = FP_validate_batch(values, CFG_BATCH_SIZE, mask[k], &first);
+
+        size_t expect = CFG_BATCH_SIZE;
+        for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+            bool bad = (mask[k][i / 64] >> (i % 64)) & 1;
+            mismatches += bad != (ref[i] != SUCCESS);
+            if (ref[i] != SUCCESS && expect == CFG_BATCH_SIZE){ expect = i; }
+        }
+        mismatches += first != expect || err != ref[expect];
+
+        // without a mask from every start row and for short tails
+        for (size_t from = 0; from < 200; from++){
+            size_t n = CFG_BATCH_SIZE - from - from % 7;
+            size_t at = n;
+            for (size_t i = from; i < from + n; i++){
+                if (ref[i] != SUCCESS){ at = i - from; break; }
+            }
+            mismatches += FP_validate_batch(values + from, n, NULL, &first) != ((at < n) ? ref[from + at] : SUCCESS);
+            mismatches += first != at;
+        }
+    }
+    FP_batch_set_simd(true);
+
+    // all valid, and only the last row invalid
+    static int64_t valid[CFG_BATCH_SIZE];
+    size_t n_valid = 0;
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        if (ref[i] == SUCCESS){ valid[n_valid++] = values[i]; }
+    }
+    size_t first;
+    mismatches += FP_validate_batch(valid, n_valid, mask[0], &first) != SUCCESS || first != n_valid;
+    for (size_t i = 0; i < n_valid; i += 64){ mismatches += mask[0][i / 64] != 0; }
+    for (size_t n = 1; n < 140; n += 3){
+        int64_t keep = valid[n - 1];
+        valid[n - 1] = (int64_t)((uint64_t)CP_CUSTOM << 60);
+        mismatches += FP_validate_batch(valid, n, mask[0], &first) != ERR_CUSTOM_FORMAT || first != n - 1;
+        mismatches += mask[0][(n - 1) / 64] != (uint64_t)1 << ((n - 1) % 64);
+        valid[n - 1] = keep;
+    }
+    mismatches += FP_validate_batch(valid, 0, NULL, &first) != SUCCESS || first != 0;
+    printf("Batch validation: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+size_t test_batch_encode(){
+    static int64_t unixtime[CFG_BATCH_SIZE], javatime[CFG_BATCH_SIZE];
+    static struct timespec ts[CFG_BATCH_SIZE];
+    static int64_t out[2][CFG_BATCH_SIZE];
+    static int16_t err[2][CFG_BATCH_SIZE];
+    const Precision precisions[] = {PRC_NANOSEC, PRC_23BIT, PRC_MICROSEC, PRC_15BIT, PRC_MILLISEC, PRC_SECOND, PRC_DAY};
+    uint64_t state = 0x2545F4914F6CDD1D;
+    size_t mismatches = 0;
+
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        uint64_t r = random_flexpoch(&state);
+        unixtime[i] = (int64_t)r >> (i % 3 == 0 ? 20 : 26);   // some out of range
+        javatime[i] = (int64_t)r >> (i % 3 == 0 ? 8 : 18);
+        ts[i].tv_sec = unixtime[i];
+        ts[i].tv_nsec = (i % 17 == 0) ? NS_PER_SEC : (long)((r >> 8) % NS_PER_SEC);
+        if (i % 17 == 1){   // rounds up into the next second, odd and even seconds
+            ts[i].tv_sec = (int64_t)(r >> 30) + i % 2;
+            ts[i].tv_nsec = 999999941 + (long)((r >> 8) % 59);
+        }
+    }
+    unixtime[0] = 0;
+    unixtime[1] = 545460846591;  // max value
+    unixtime[2] = 545460846592;  // max value + 1
+
+    printf("\n\n----\nTesting batch encoders (%d values)\n----\n", CFG_BATCH_SIZE);
+    for (size_t p = 0; p < sizeof(precisions)/sizeof(precisions[0]); p++){
+        int16_t tz = (precisions[p] >= PRC_MILLISEC) ? 120 : 0;
+        for (int f = 0; f < 3; f++){
+            for (int k = 0; k < 2; k++){
+                FP_batch_set_simd(k == 1);
+                switch (f){
+                    case 0: FP_from_unix_batch(unixtime, CFG_BATCH_SIZE, precisions[p], tz, out[k], err[k]); break;
+                    case 1: FP_from_java_batch(javatime, CFG_BATCH_SIZE, precisions[p], tz, out[k], err[k]); break;
+                    case 2: FP_from_timespec_batch(ts, CFG_BATCH_SIZE, precisions[p], tz, out[k], err[k]); break;
+                }
+            }
+            mismatches += memcmp(out[0], out[1], sizeof(out[0])) != 0;
+            mismatches += memcmp(err[0], err[1], sizeof(err[0])) != 0;
+        }
+    }
+    FP_batch_set_simd(true);
+
+    // compare against the single value encoders
+    FP_from_unix_batch(unixtime, CFG_BATCH_SIZE, PRC_SECOND, 0, out[0], err[0]);
+    FP_from_java_batch(javatime, CFG_BATCH_SIZE, PRC_MILLISEC, 0, out[1], err[1]);
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        FP_Components fpc = FP_new();
+        fpc.tz_offset = 0;
+        if (FP_from_unix(unixtime[i], &fpc) != err[0][i] || (!err[0][i] && fpc.rawdata != out[0][i])){
+            printf("Mismatch for unix=%li\n", unixtime[i]);
+            mismatches++;
+        }
+        fpc = FP_new();
+        if (javatime[i] >= 0 && (FP_from_java(javatime[i], &fpc) != err[1][i] || (!err[1][i] && fpc.rawdata != out[1][i]))){
+            printf("Mismatch for java=%li\n", javatime[i]);
+            mismatches++;
+        }
+    }
+    for (size_t p = 0; p < 5; p++){   // the sub-second precisions against FP_to_fp()
+        FP_from_timespec_batch(ts, CFG_BATCH_SIZE, precisions[p], 0, out[0], err[0]);
+        for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+            if (err[0][i]){ continue; }
+            FP_Components fpc = FP_new();
+            fpc.seconds = ts[i].tv_sec;
+            fpc.ns = ts[i].tv_nsec;
+            fpc.precision = precisions[p];
+            fpc.tz_offset = 0;
+            int64_t expect;
+            if (FP_to_fp(&fpc, &expect) != SUCCESS || expect != out[0][i]){
+                printf("Mismatch for timespec=%li.%09li\n", (long)ts[i].tv_sec, ts[i].tv_nsec);
+                mismatches++;
+            }
+        }
+    }
+    printf("Batch encoders: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+#define CFG_ISO_STRIDE 40
+
+size_t test_batch_iso(){
+    static char column[CFG_BATCH_SIZE * CFG_ISO_STRIDE];
+    static size_t offsets[CFG_BATCH_SIZE + 1];
+    static int64_t out[2][CFG_BATCH_SIZE];
+    static uint64_t err_mask[2][CFG_BATCH_SIZE / 64];
+    const char *layouts[] = {"%04d-%02d-%02dT%02d:%02d:%02dZ", "%04d-%02d-%02dT%02d:%02d:%02d.%03d+%02d:%02d",
+                             "%04d-%02d-%02dT%02d:%02d:%02d.%06d", "%04d-%02d-%02dT%02d:%02d:%02d.%09d-%02d:%02d"};
+    const int frac_mod[] = {1, 1000, 1000000, 1000000000};
+    uint64_t state = 0x853C49E6748FEA9B;
+    size_t mismatches = 0;
+
+    printf("\n\n----\nTesting ISO column parser (%d values)\n----\n", CFG_BATCH_SIZE);
+    for (int f = 0; f < 4; f++){
+        for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+            uint64_t r = random_flexpoch(&state);
+            char *row = column + i * CFG_ISO_STRIDE;
+            memset(row, 0, CFG_ISO_STRIDE);
+            int len = snprintf(row, CFG_ISO_STRIDE, layouts[f], (int)(r % 10000), (int)((r >> 14) % 12) + 1,
+                (int)((r >> 18) % 31) + 1, (int)((r >> 23) % 24), (int)((r >> 28) % 60), (int)((r >> 34) % 60),
+                (int)((r >> 20) % frac_mod[f]), (int)((r >> 40) % 17), (int)((r >> 46) % 60));
+            switch (i % 29){   // sprinkle rows the fast path has to hand over
+                case 3: row[17] = '6'; row[18] = '0'; break;   // leap second
+                case 5: row[6] = 'x'; break;
+                case 7: row[5] = '1'; row[6] = '9'; break;     // month 19
+                case 11: row[len] = '\n'; break;
+                case 13: row[len - 1] = '\0'; break;           // shorter row
+                case 17: row[len] = '7'; break;                // trailing garbage
+            }
+            offsets[i] = i * CFG_ISO_STRIDE;
+        }
+        offsets[CFG_BATCH_SIZE] = CFG_BATCH_SIZE * CFG_ISO_STRIDE;
+
+        for (int k = 0; k < 2; k++){
+            FP_batch_set_simd(k == 1);
+            FP_from_iso_batch(column, NULL, CFG_ISO_STRIDE, CFG_BATCH_SIZE, out[k], err_mask[k]);
+        }
+        mismatches += memcmp(out[0], out[1], sizeof(out[0])) != 0;
+        mismatches += memcmp(err_mask[0], err_mask[1], sizeof(err_mask[0])) != 0;
+        FP_batch_set_simd(true);
+        FP_from_iso_batch(column, offsets, 0, CFG_BATCH_SIZE, out[0], err_mask[0]);
+        mismatches += memcmp(out[0], out[1], sizeof(out[0])) != 0;
+
+        // compare against FP_from_iso() + FP_to_fp() on the NUL terminated rows
+        for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+            char *row = column + i * CFG_ISO_STRIDE;
+            size_t len = strnlen(row, CFG_ISO_STRIDE);
+            if (row[len ? len - 1 : 0] == '\n'){ continue; }
+            FP_Components fpc = FP_new();
+            int64_t expected = CP_UNDEFINED_FP;
+            if (FP_parse_iso(row, len, &fpc) != (int)len || FP_to_fp(&fpc, &expected) != SUCCESS){
+                expected = CP_UNDEFINED_FP;
+            }
+            bool failed = (err_mask[1][i / 64] >> (i % 64)) & 1;
+            if (out[1][i] != expected || failed != (expected == CP_UNDEFINED_FP)){
+                printf("Mismatch for ISO=%s\n", row);
+                mismatches++;
+            }
+        }
+    }
+
+    // fractions that round up into the next second, on odd and even seconds
+    const char *round_up[] = {"2024-01-01T00:00:%02d.%.3sZ", "2024-01-01T00:00:%02d.%.6s+01:00",
+                              "2024-01-01T00:00:%02d.%.9sZ", "2024-01-01T00:00:%02d.%.9s-05:30"};
+    for (int f = 0; f < 4; f++){
+        for (size_t i = 0; i < 256; i++){
+            char digits[16];
+            snprintf(digits, sizeof(digits), "%09d", 999999941 + (int)(i % 59));
+            memset(column + i * CFG_ISO_STRIDE, 0, CFG_ISO_STRIDE);
+            snprintf(column + i * CFG_ISO_STRIDE, CFG_ISO_STRIDE, round_up[f], (int)(i % 60), f < 2 ? "999999999" : digits);
+        }
+        FP_from_iso_batch(column, NULL, CFG_ISO_STRIDE, 256, out[1], err_mask[1]);
+        for (size_t i = 0; i < 256; i++){
+            char *row = column + i * CFG_ISO_STRIDE;
+            FP_Components fpc = FP_new();
+            int64_t expected = CP_UNDEFINED_FP;
+            FP_parse_iso(row, strlen(row), &fpc);
+            FP_to_fp(&fpc, &expected);
+            if (out[1][i] != expected){
+                printf("Mismatch for ISO=%s\n", row);
+                mismatches++;
+            }
+        }
+    }
+    printf("ISO column parser: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+#define CFG_ISO_CACHE_ROUNDS 1000
+
+size_t test_iso_cache(){
+    const Precision precisions[] = {PRC_NANOSEC, PRC_MICROSEC, PRC_MILLISEC, PRC_SECOND, PRC_HOUR, PRC_DAY};
+    FP_IsoCache cache;
+    FP_iso_cache_init(&cache);
+    FP_Components fpc = FP_new();
+    fpc.seconds = 1745857043;
+    uint64_t state = 0xDA942042E4DD58B5;
+    size_t mismatches = 0;
+    char expected[FP_ISO_MAX_LEN], actual[FP_ISO_MAX_LEN];
+
+    printf("\n\n----\nTesting cached ISO formatter\n----\n");
+    for (size_t p = 0; p < sizeof(precisions)/sizeof(precisions[0]); p++){
+        fpc.precision = precisions[p];
+        fpc.tz_offset = (p % 2) ? 120 : 0;
+        for (int i = 0; i < CFG_ISO_CACHE_ROUNDS; i++){
+            uint64_t r = random_flexpoch(&state);
+            fpc.seconds += (r & 0xF) == 0;   // mostly the same second
+            fpc.ns = (r >> 8) % NS_PER_SEC;
+            fpc.is_leapsecond = (r >> 40) % 97 == 0;
+            int len = FP_format_iso_cached(&cache, &fpc, actual, sizeof(actual));
+            if (len != FP_format_iso(&fpc, expected, sizeof(expected)) || strcmp(expected, actual)){
+                printf("Mismatch: %s vs %s\n", expected, actual);
+                mismatches++;
+            }
+        }
+    }
+    printf("Cached ISO formatter: %zu mismatches\n", mismatches);
+
+    FP_RfcCache rfc_cache;
+    FP_rfc_cache_init(&rfc_cache);
+    fpc.precision = PRC_MILLISEC;
+    fpc.is_leapsecond = false;
+    size_t rfc_mismatches = 0;
+    for (int style = RFC_7231; style <= RFC_3339; style++){
+        for (int i = 0; i < CFG_ISO_CACHE_ROUNDS; i++){
+            uint64_t r = random_flexpoch(&state);
+            fpc.seconds += (r & 0xFF) == 0;   // thousands of stamps per second
+            fpc.ns = (r >> 8) % NS_PER_SEC;
+            fpc.tz_offset = (r >> 40) % 331 == 0 ? 60 : 0;
+            int len = FP_format_rfc_cached(&rfc_cache, &fpc, style, actual, sizeof(actual));
+            if (len != FP_format_rfc(&fpc, style, expected, sizeof(expected)) || strcmp(expected, actual)){
+                printf("Mismatch: %s vs %s\n", expected, actual);
+                rfc_mismatches++;
+            }
+        }
+    }
+    printf("Cached RFC formatter: %zu mismatches\n", rfc_mismatches);
+    return mismatches + rfc_mismatches;
+}
+
+size_t test_batch_to_iso(){
+    static int64_t values[CFG_BATCH_SIZE];
+    static char arena[CFG_BATCH_SIZE * FP_ISO_MAX_LEN];
+    static size_t offsets[CFG_BATCH_SIZE + 1];
+    static int16_t err[CFG_BATCH_SIZE];
+    const size_t width = 32;
+    uint64_t state = 0x6A09E667F3BCC908;
+    size_t mismatches = 0;
+
+    int64_t seconds = 1745857043;
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        uint64_t r = random_flexpoch(&state);
+        seconds += (r & 0x7) == 0;   // sorted export with millisecond values
+        values[i] = (seconds << 24) | (r & 0xFFC000) | ((int64_t)FP_tz_offset_to_bin((i / 1024) * 60) << 3) | 0b101;
+        if (i % 61 == 0){ values[i] = r; }   // any codepoint
+    }
+
+    printf("\n\n----\nTesting batch ISO formatter (%d values)\n----\n", CFG_BATCH_SIZE);
+    FP_to_iso_batch(values, CFG_BATCH_SIZE, arena, sizeof(arena), offsets, 0, err);
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        FP_Components fpc = FP_new();
+        char expected[FP_ISO_MAX_LEN] = "";
+        ErrNo result = ERR_RESERVED_FORMAT;
+        if (((values[i] >> 60) & 0xF) != CP_REL_FRAC){ result = FP_from_fp(values[i], &fpc); }
+        if (result == SUCCESS){ result = FP_to_iso(&fpc, expected); }
+        if (result != SUCCESS){ expected[0] = '\0'; }
+        size_t len = offsets[i+1] - offsets[i];
+        if (err[i] != result || len != strlen(expected) || memcmp(arena + offsets[i], expected, len)){
+            printf("Mismatch for FP=%016lX: %s\n", values[i], expected);
+            mismatches++;
+        }
+    }
+    // arena overflow stops at a row boundary
+    size_t rows = FP_to_iso_batch(values, CFG_BATCH_SIZE, arena, 1000, offsets, 0, err);
+    mismatches += (rows == CFG_BATCH_SIZE || offsets[rows] > 1000);
+    rows = FP_to_iso_batch(values, CFG_BATCH_SIZE, arena, 1000, NULL, width, err);
+    mismatches += (rows != 1000 / width);
+    printf("Batch ISO formatter: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+size_t test_direct(){
+    static int64_t values[CFG_BATCH_SIZE], times[CFG_BATCH_SIZE];
+    static int64_t out[2][CFG_BATCH_SIZE];
+    static int16_t err[2][CFG_BATCH_SIZE];
+    static int64_t seconds[CFG_BATCH_SIZE];
+    static uint32_t ns[CFG_BATCH_SIZE];
+    static int8_t precision[CFG_BATCH_SIZE];
+    static int16_t tz_offset[CFG_BATCH_SIZE];
+    uint64_t state = 0xA54FF53A5F1D36F1;
+    size_t mismatches = 0;
+    size_t n_pos = sizeof(TEST_VALUES_POS) / sizeof(TEST_VALUES_POS[0]);
+    size_t n_neg = sizeof(TEST_VALUES_NEG) / sizeof(TEST_VALUES_NEG[0]);
+
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        values[i] = (i < n_pos) ? TEST_VALUES_POS[i] : (i < n_pos + n_neg) ? TEST_VALUES_NEG[i - n_pos]
+                  : random_flexpoch(&state);
+        times[i] = (int64_t)(state >> (i % 24)) >> 20;   // also beyond the encodable range
+        if (i % 2){ times[i] = -times[i]; }
+    }
+    printf("\n\n----\nTesting direct conversions (%d values)\n----\n", CFG_BATCH_SIZE);
+
+    // decoding and accessors against the batch decoder
+    FP_BatchOut cols = {seconds, ns, precision, tz_offset, NULL, NULL, err[0]};
+    FP_from_fp_batch(values, CFG_BATCH_SIZE, &cols);
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        int64_t s;
+        uint32_t n;
+        Precision p;
+        int16_t tz;
+        mismatches += FP_get_seconds(values[i], &s) != err[0][i] || s != seconds[i];
+        mismatches += FP_get_ns(values[i], &n) != err[0][i] || n != ns[i];
+        mismatches += FP_get_precision(values[i], &p) != err[0][i] || p != precision[i];
+        mismatches += FP_get_tz_offset(values[i], &tz) != err[0][i] || tz != tz_offset[i];
+    }
+    for (int k = 0; k < 4; k++){
+        switch (k){
+            case 0: FP_to_unix_batch(values, CFG_BATCH_SIZE, out[0], err[0]); break;
+            case 1: FP_to_java_batch(values, CFG_BATCH_SIZE, out[0], err[0]); break;
+            case 2: FP_from_unix_batch(times, CFG_BATCH_SIZE, PRC_SECOND, 0, out[0], err[0]); break;
+            case 3: FP_from_java_batch(times, CFG_BATCH_SIZE, PRC_MILLISEC, 0, out[0], err[0]); break;
+        }
+        for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+            switch (k){
+                case 0: err[1][i] = FP_fp_to_unix_direct(values[i], &out[1][i]); break;
+                case 1: err[1][i] = FP_fp_to_java_direct(values[i], &out[1][i]); break;
+                case 2: err[1][i] = FP_unix_to_fp_direct(times[i], &out[1][i]); break;
+                case 3: err[1][i] = FP_java_to_fp_direct(times[i], &out[1][i]); break;
+            }
+        }
+        mismatches += memcmp(out[0], out[1], sizeof(out[0])) != 0 || memcmp(err[0], err[1], sizeof(err[0])) != 0;
+    }
+    printf("Direct conversions: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+#define CFG_COLUMN_SIZE (1 << 20)
+
+size_t test_column(){
+    static int64_t values[CFG_COLUMN_SIZE];
+    static int64_t out[2][CFG_COLUMN_SIZE];
+    static int16_t err[2][CFG_COLUMN_SIZE];
+    static char arena[2][CFG_BATCH_SIZE * FP_ISO_MAX_LEN];
+    static size_t offsets[2][CFG_BATCH_SIZE + 1];
+    uint64_t state = 0x3C6EF372FE94F82B;
+    size_t mismatches = 0;
+    size_t n_pos = sizeof(TEST_VALUES_POS) / sizeof(TEST_VALUES_POS[0]);
+
+    for (size_t i = 0; i < CFG_COLUMN_SIZE; i++){
+        values[i] = (i < n_pos) ? TEST_VALUES_POS[i] : random_flexpoch(&state);
+    }
+    printf("\n\n----\nTesting FP_Column (%d values)\n----\n", CFG_COLUMN_SIZE);
+    FP_Column *col = FP_column_from_fp(values, CFG_COLUMN_SIZE);
+
+    // every row as FP_from_fp() gives it
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        FP_Components expected = FP_new(), fpc;
+        ErrNo result = ERR_RESERVED_FORMAT;
+        if (((values[i] >> 60) & 0xF) != CP_REL_FRAC){ result = FP_from_fp(values[i], &expected); }
+        if (result != SUCCESS){ expected = FP_new(); }
+        ErrNo row = FP_column_get(col, i, &fpc);
+        if (row != result || fpc.seconds != expected.seconds || fpc.ns != expected.ns ||
+            fpc.precision != expected.precision || fpc.tz_offset != expected.tz_offset ||
+            fpc.is_leapsecond != expected.is_leapsecond || fpc.fmt != expected.fmt ||
+            memcmp(&fpc.year, &expected.year, sizeof(float))){
+            printf("Mismatch for FP=%016lX\n", values[i]);
+            mismatches++;
+        }
+    }
+
+    // conversions equal the batch functions on the flexpochs
+    for (int k = 0; k < 3; k++){
+        size_t n_err = (k == 0) ? FP_to_unix_batch(values, CFG_COLUMN_SIZE, out[0], err[0])
+                     : (k == 1) ? FP_to_java_batch(values, CFG_COLUMN_SIZE, out[0], err[0])
+                     :            FP_to_ns_batch(values, CFG_COLUMN_SIZE, out[0], err[0]);
+        mismatches += n_err != ((k == 0) ? FP_column_to_unix(col, out[1], err[1])
+                             :  (k == 1) ? FP_column_to_java(col, out[1], err[1])
+                             :             FP_column_to_ns(col, out[1], err[1]));
+        mismatches += memcmp(out[0], out[1], sizeof(out[0])) != 0 || memcmp(err[0], err[1], sizeof(err[0])) != 0;
+    }
+    FP_Column *head = FP_column_from_fp(values, CFG_BATCH_SIZE);
+    for (size_t width = 0; width <= 32; width += 32){
+        size_t rows = FP_to_iso_batch(values, CFG_BATCH_SIZE, arena[0], sizeof(arena[0]), width ? NULL : offsets[0], width, err[0]);
+        mismatches += rows != FP_column_to_iso(head, arena[1], sizeof(arena[1]), width ? NULL : offsets[1], width, err[1]);
+        size_t len = width ? rows * width : offsets[0][rows];
+        mismatches += memcmp(arena[0], arena[1], len) != 0 || memcmp(err[0], err[1], rows * sizeof(int16_t)) != 0;
+    }
+    FP_column_free(head);
+    FP_column_free(col);
+    printf("FP_Column: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+#define CFG_SORT_SIZE (1 << 20)
+
+// an event of a few days in any precision, tz offset and leap second, or any codepoint
+static int64_t random_event(uint64_t *state, bool any){
+    uint64_t r = random_flexpoch(state);
+    FP_Components fpc = FP_new();
+    fpc.seconds = 1483000000 + (r >> 40) % 400000;
+    fpc.ns = (r >> 8) % NS_PER_SEC;
+    fpc.precision = (Precision[]){PRC_23BIT, PRC_MICROSEC, PRC_15BIT, PRC_MILLISEC, PRC_SECOND, PRC_MINUTE}[r % 6];
+    fpc.tz_offset = (fpc.precision == PRC_MILLISEC || fpc.precision >= PRC_SECOND) ? (int)((r >> 4) % 61) * 15 - 450 : 0;
+    fpc.is_leapsecond = (r & 0x3F0) == 0;
+    if (fpc.is_leapsecond){ fpc.tz_offset = 0; }
+    int64_t value;
+    if (FP_to_fp(&fpc, &value) != SUCCESS || any){ value = r; }
+    return value;
+}
+
+typedef struct {
+    FP_SortKey key;
+    size_t index;
+    int64_t value;
+} SortRef;
+
+static int sort_ref_cmp(const void *a, const void *b){
+    const SortRef *x = a, *y = b;
+    int c = FP_sort_key_cmp(x->key, y->key);
+    return c ? c : (x->index > y->index) - (x->index < y->index);
+}
+
+size_t test_sort(){
+    static int64_t values[CFG_SORT_SIZE], sorted[CFG_SORT_SIZE], scratch[CFG_SORT_SIZE];
+    static SortRef ref[CFG_SORT_SIZE];
+    uint64_t state = 0x1F83D9AB5BE0CD19;
+    size_t mismatches = 0;
+
+    for (size_t i = 0; i < CFG_SORT_SIZE; i++){
+        values[i] = random_event(&state, i % 97 == 0);
+    }
+
+    printf("\n\n----\nTesting radix sort (%d values)\n----\n", CFG_SORT_SIZE);
+    for (size_t i = 0; i < CFG_SORT_SIZE; i++){
+        ref[i] = (SortRef){FP_sort_key(values[i]), i, values[i]};
+    }
+    qsort(ref, CFG_SORT_SIZE, sizeof(SortRef), sort_ref_cmp);
+
+    memcpy(sorted, values, sizeof(values));
+    mismatches += (FP_radix_sort(sorted, CFG_SORT_SIZE, scratch) != SUCCESS);
+
+    // stable and in key order
+    for (size_t i = 0; i < CFG_SORT_SIZE; i++){
+        mismatches += (sorted[i] != ref[i].value);
+    }
+    // chronological: decoded (seconds, leap second, ns) never decrease
+    FP_Components prev = FP_new();
+    for (size_t i = 0; i < CFG_SORT_SIZE; i++){
+        FP_Components fpc = FP_new();
+        if (((sorted[i] >> 60) & 0xF) == CP_REL_FRAC || FP_from_fp(sorted[i], &fpc) != SUCCESS ||
+            fpc.fmt != FMT_ABS_SEC){
+            continue;
+        }
+        if (prev.ns != (uint32_t)-1 &&
+            (fpc.seconds < prev.seconds || (fpc.seconds == prev.seconds &&
+             (fpc.is_leapsecond < prev.is_leapsecond ||
+              (fpc.is_leapsecond == prev.is_leapsecond && fpc.ns < prev.ns))))){
+            mismatches++;
+        }
+        prev = fpc;
+    }
+    printf("Radix sort: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+#define CFG_SEARCH_SIZE (1 << 20)
+#define CFG_SEARCH_LOOKUPS 100000
+
+// branchy lower/upper bound with FP_sort_key_cmp() as reference
+static size_t search_ref(const int64_t *values, size_t n, int64_t flexpoch, bool upper){
+    FP_SortKey key = FP_sort_key(flexpoch);
+    size_t lo = 0, hi = n;
+    while (lo < hi){
+        size_t mid = lo + (hi - lo) / 2;
+        int c = FP_sort_key_cmp(FP_sort_key(values[mid]), key);
+        if (c < 0 || (upper && c == 0)){ lo = mid + 1; } else { hi = mid; }
+    }
+    return lo;
+}
+
+size_t test_search(){
+    static int64_t values[CFG_SEARCH_SIZE], scratch[CFG_SEARCH_SIZE], targets[CFG_SEARCH_LOOKUPS];
+    uint64_t state = 0x5BE0CD191F83D9AB;
+    size_t mismatches = 0;
+
+    printf("\n\n----\nTesting range search (%d values, %d lookups)\n----\n", CFG_SEARCH_SIZE, CFG_SEARCH_LOOKUPS);
+    for (int valid = 0; valid < 2; valid++){
+        for (size_t i = 0; i < CFG_SEARCH_SIZE; i++){
+            values[i] = random_event(&state, !valid && i % 97 == 0);
+        }
+        mismatches += (FP_radix_sort(values, CFG_SEARCH_SIZE, scratch) != SUCCESS);
+        // stored values (with runs of equal keys) and new ones
+        for (size_t i = 0; i < CFG_SEARCH_LOOKUPS; i++){
+            targets[i] = (i & 1) ? values[(uint64_t)random_flexpoch(&state) % CFG_SEARCH_SIZE] : random_event(&state, !valid && i % 10 == 0);
+        }
+
+        // zone map appended in chunks of any size, compared with one built at once
+        FP_ZoneMap *map = FP_zone_map_new();
+        FP_ZoneMap *full = FP_zone_map_new();
+        FP_zone_map_update(full, values, CFG_SEARCH_SIZE);
+        for (size_t n = 0; n < CFG_SEARCH_SIZE; ){
+            n += (uint64_t)random_flexpoch(&state) % 10000;
+            if (n > CFG_SEARCH_SIZE){ n = CFG_SEARCH_SIZE; }
+            FP_zone_map_update(map, values, n);
+        }
+        mismatches += (map->blocks != full->blocks);
+        for (size_t b = 0; b < full->blocks; b++){
+            mismatches += FP_sort_key_cmp(map->min[b], full->min[b]) != 0;
+            mismatches += FP_sort_key_cmp(map->max[b], full->max[b]) != 0;
+            mismatches += !FP_zone_map_overlaps(map, b, values[b * FP_ZONE_ROWS], values[b * FP_ZONE_ROWS]);
+        }
+        mismatches += FP_zone_map_overlaps(map, full->blocks, values[0], values[CFG_SEARCH_SIZE - 1]);
+        FP_zone_map_free(full);
+
+        // bounds and ranges, on a prefix of any length for the partial blocks
+        for (size_t i = 0; i + 1 < CFG_SEARCH_LOOKUPS; i += 2){
+            size_t n = (i % 20 == 0) ? (uint64_t)random_flexpoch(&state) % CFG_SEARCH_SIZE : CFG_SEARCH_SIZE;
+            size_t lower = search_ref(values, n, targets[i], false);
+            size_t upper = search_ref(values, n, targets[i + 1], true);
+            size_t count = (upper > lower) ? upper - lower : 0;
+            mismatches += FP_lower_bound(values, n, targets[i]) != lower;
+            mismatches += FP_upper_bound(values, n, targets[i + 1]) != upper;
+            size_t from = 0;
+            mismatches += FP_range_search(NULL, values, n, targets[i], targets[i + 1], &from) != count;
+            mismatches += (from != lower);
+            mismatches += FP_range_search(map, values, n, targets[i], targets[i + 1], &from) != count;
+            mismatches += (from != lower);
+        }
+        FP_zone_map_free(map);
+    }
+    printf("Range search: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+#define CFG_SEGMENT_SIZE 100000
+
+// payload of record i: i % 41 bytes derived from i
+static uint32_t segment_payload(size_t i, uint8_t *buf){
+    uint32_t len = i % 41;
+    for (uint32_t k = 0; k < len; k++){ buf[k] = (uint8_t)(i * 31 + k); }
+    return len;
+}
+
+static size_t segment_append(FP_SegmentWriter *w, const int64_t *values, size_t from, size_t to){
+    uint8_t buf[64];
+    size_t failed = 0;
+    for (size_t i = from; i < to; i++){
+        failed += FP_segment_append(w, values[i], buf, segment_payload(i, buf)) != SUCCESS;
+    }
+    return failed;
+}
+
+// records t1..t2 of the segment against the sorted values
+static size_t segment_check_range(const FP_SegmentReader *r, const int64_t *values, size_t n, int64_t t1, int64_t t2){
+    size_t mismatches = 0;
+    size_t i = search_ref(values, n, t1, false);
+    size_t end = search_ref(values, n, t2, true);
+    FP_SegmentCursor cur;
+    FP_SegmentRecord rec;
+    uint8_t buf[64];
+    FP_segment_seek(r, t1, t2, &cur);
+    for (; FP_segment_next(&cur, &rec); i++){
+        uint32_t len = segment_payload(i, buf);
+        mismatches += (i >= end || rec.flexpoch != values[i] || rec.len != len || memcmp(rec.data, buf, len) != 0);
+    }
+    return mismatches + (i < end);
+}
+
+size_t test_segment(){
+    static int64_t values[CFG_SEGMENT_SIZE], scratch[CFG_SEGMENT_SIZE];
+    char path[] = "/tmp/fp_segment_XXXXXX";
+    uint64_t state = 0x6A09E667F3BCC908;
+    size_t mismatches = 0;
+
+    printf("\n\n----\nTesting segment files (%d records)\n----\n", CFG_SEGMENT_SIZE);
+    for (size_t i = 0; i < CFG_SEGMENT_SIZE; i++){
+        values[i] = random_event(&state, false);
+    }
+    mismatches += (FP_radix_sort(values, CFG_SEGMENT_SIZE, scratch) != SUCCESS);
+    close(mkstemp(path));
+
+    // first half, reopened for the second, out of order and invalid keys rejected
+    FP_SegmentOptions opt = {.sync_records = 1000, .index_every = 16};
+    FP_SegmentWriter *w;
+    size_t half = CFG_SEGMENT_SIZE / 2;
+    mismatches += FP_segment_writer_open(path, &opt, &w) != SUCCESS;
+    mismatches += segment_append(w, values, 0, half);
+    mismatches += FP_segment_writer_close(w) != SUCCESS;
+    mismatches += FP_segment_writer_open(path, NULL, &w) != SUCCESS;
+    mismatches += FP_segment_writer_count(w) != half;
+    mismatches += FP_segment_append(w, values[0], "", 0) != ERR_OUT_OF_RANGE;
+    mismatches += FP_segment_append(w, CP_UNDEFINED_FP, "", 0) == SUCCESS;
+    mismatches += segment_append(w, values, half, CFG_SEGMENT_SIZE);
+    mismatches += FP_segment_writer_close(w) != SUCCESS;
+
+    FP_SegmentReader *r;
+    mismatches += FP_segment_reader_open(path, &r) != SUCCESS;
+    mismatches += FP_segment_count(r) != CFG_SEGMENT_SIZE;
+    for (int k = 0; k < 1000; k++){
+        size_t a = (uint64_t)random_flexpoch(&state) % CFG_SEGMENT_SIZE;
+        size_t b = a + (uint64_t)random_flexpoch(&state) % 500;
+        int64_t t1 = (k & 1) ? values[a] : random_event(&state, false);
+        int64_t t2 = (b < CFG_SEGMENT_SIZE) ? values[b] : random_event(&state, false);
+        mismatches += segment_check_range(r, values, CFG_SEGMENT_SIZE, t1, t2);
+    }
+    mismatches += segment_check_range(r, values, CFG_SEGMENT_SIZE, values[0], values[CFG_SEGMENT_SIZE - 1]);
+    FP_segment_reader_close(r);
+
+    // crash: a writer killed after its last sync leaves the synced records and no footer
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0){
+        FP_SegmentWriter *crashed;
+        if (truncate(path, 0) != 0 || FP_segment_writer_open(path, &opt, &crashed) != SUCCESS){ _exit(1); }
+        segment_append(crashed, values, 0, 2500);
+        _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    mismatches += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    mismatches += FP_segment_reader_open(path, &r) != SUCCESS;
+    mismatches += FP_segment_count(r) != 2000;
+    mismatches += segment_check_range(r, values, 2000, values[0], values[CFG_SEGMENT_SIZE - 1]);
+    FP_segment_reader_close(r);
+
+    // torn record at the end: cut off on reopen, the writer continues behind the last good one
+    struct stat st;
+    stat(path, &st);
+    mismatches += truncate(path, st.st_size - 5) != 0;
+    mismatches += FP_segment_writer_open(path, &opt, &w) != SUCCESS;
+    mismatches += FP_segment_writer_count(w) != 1999;
+    mismatches += segment_append(w, values, 1999, 3000);
+    mismatches += FP_segment_writer_close(w) != SUCCESS;
+    mismatches += FP_segment_reader_open(path, &r) != SUCCESS;
+    mismatches += FP_segment_count(r) != 3000;
+    mismatches += segment_check_range(r, values, 3000, values[0], values[CFG_SEGMENT_SIZE - 1]);
+    FP_segment_reader_close(r);
+
+    // failed write (file size limit like a full disk): the partial bytes are cut off
+    // and the retry continues behind the last written record
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0){
+        signal(SIGXFSZ, SIG_IGN);
+        struct rlimit limit;
+        if (truncate(path, 0) != 0 || FP_segment_writer_open(path, &opt, &w) != SUCCESS ||
+            segment_append(w, values, 0, 1500) != 0 || stat(path, &st) != 0){ _exit(1); }
+        off_t synced = st.st_size;
+        getrlimit(RLIMIT_FSIZE, &limit);
+        rlim_t max = limit.rlim_cur;
+        limit.rlim_cur = synced + 100;
+        setrlimit(RLIMIT_FSIZE, &limit);
+        if (FP_segment_sync(w) != ERR_IO || stat(path, &st) != 0 || st.st_size != synced){ _exit(2); }
+        limit.rlim_cur = max;
+        setrlimit(RLIMIT_FSIZE, &limit);
+        if (FP_segment_sync(w) != SUCCESS || segment_append(w, values, 1500, 3000) != 0 ||
+            FP_segment_writer_close(w) != SUCCESS){ _exit(3); }
+        _exit(0);
+    }
+    waitpid(pid, &status, 0);
+    mismatches += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    mismatches += FP_segment_reader_open(path, &r) != SUCCESS;
+    mismatches += FP_segment_count(r) != 3000;
+    mismatches += segment_check_range(r, values, 3000, values[0], values[CFG_SEGMENT_SIZE - 1]);
+    for (int k = 0; k < 100; k++){
+        size_t a = (uint64_t)random_flexpoch(&state) % 3000;
+        mismatches += segment_check_range(r, values, 3000, values[a], values[a + (a < 2900 ? 99 : 0)]);
+    }
+    FP_segment_reader_close(r);
+
+    // not a segment
+    FILE *f = fopen(path, "w");
+    fputs("timestamp,value\n", f);
+    fclose(f);
+    mismatches += FP_segment_reader_open(path, &r) != ERR_IO;
+    mismatches += FP_segment_writer_open(path, NULL, &w) != ERR_IO;
+    unlink(path);
+    printf("Segment files: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+#define CFG_CODEC_SIZE ((1 << 20) + 123)
+
+size_t test_codec(){
+    static int64_t values[CFG_CODEC_SIZE], decoded[CFG_CODEC_SIZE + FP_CODEC_BLOCK];
+    static int64_t seconds[CFG_CODEC_SIZE];
+    static uint32_t ns[CFG_CODEC_SIZE];
+    uint8_t *buf = malloc(FP_codec_bound(CFG_CODEC_SIZE));
+    uint64_t state = 0x510E527FADE682D1;
+    size_t mismatches = 0;
+
+    printf("\n\n----\nTesting delta/XOR codec (%d values)\n----\n", CFG_CODEC_SIZE);
+    for (int k = 0; k < 4; k++){
+        // telemetry: ~100 events per second with jitter, or random bits
+        int64_t t = 1700000000LL * NS_PER_SEC;
+        for (size_t i = 0; i < CFG_CODEC_SIZE; i++){
+            uint64_t r = random_flexpoch(&state);
+            t += 5000000 + r % 10000000;
+            seconds[i] = t / NS_PER_SEC;
+            ns[i] = (k == 2) ? t % NS_PER_SEC : (k == 1) ? t % NS_PER_SEC / 1000000 * 1000000 : 0;
+            values[i] = r;
+        }
+        if (k < 3){
+            Precision prc = (Precision[]){PRC_SECOND, PRC_MILLISEC, PRC_NANOSEC}[k];
+            struct timespec *ts = malloc(CFG_CODEC_SIZE * sizeof(struct timespec));
+            for (size_t i = 0; i < CFG_CODEC_SIZE; i++){ ts[i] = (struct timespec){seconds[i], ns[i]}; }
+            mismatches += FP_from_timespec_batch(ts, CFG_CODEC_SIZE, prc, (k == 1) ? 60 : 0, values, NULL) != 0;
+            free(ts);
+        }
+
+        size_t size = FP_codec_encode(values, CFG_CODEC_SIZE, buf);
+        mismatches += FP_codec_decode(buf, decoded) != CFG_CODEC_SIZE;
+        mismatches += (size > FP_codec_bound(CFG_CODEC_SIZE));
+        mismatches += memcmp(values, decoded, sizeof(values)) != 0;
+
+        // random access to single blocks
+        size_t blocks = (CFG_CODEC_SIZE + FP_CODEC_BLOCK - 1) / FP_CODEC_BLOCK;
+        for (int q = 0; q < 100; q++){
+            size_t b = (uint64_t)random_flexpoch(&state) % blocks;
+            size_t n = FP_codec_decode_block(buf, b, decoded);
+            size_t expect = (b + 1 < blocks) ? FP_CODEC_BLOCK : CFG_CODEC_SIZE - b * FP_CODEC_BLOCK;
+            mismatches += (n != expect) || memcmp(decoded, values + b * FP_CODEC_BLOCK, n * sizeof(int64_t)) != 0;
+        }
+    }
+
+    // short streams and blocks: 0, 1, 2 and a few values
+    for (size_t n = 0; n < 12; n++){
+        size_t size = FP_codec_encode(values, n, buf);
+        mismatches += (size > FP_codec_bound(n)) || FP_codec_decode(buf, decoded) != n;
+        mismatches += memcmp(values, decoded, n * sizeof(int64_t)) != 0;
+    }
+    free(buf);
+    printf("Codec: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+#define CFG_WIRE_SIZE ((1 << 20) + 3)
+#define WIRE_TEST_LOW60 0x0FFFFFFFFFFFFFFF
+
+size_t test_wire(){
+    static int64_t values[CFG_WIRE_SIZE], decoded[CFG_WIRE_SIZE];
+    static uint8_t buf[CFG_WIRE_SIZE * FP_WIRE_MAX];
+    uint64_t state = 0x9B05688C2B3E6C1F;
+    size_t mismatches = 0;
+
+    printf("\n\n----\nTesting variable-length wire encoding (%d values)\n----\n", CFG_WIRE_SIZE);
+    const Precision prcs[] = {PRC_SECOND, PRC_SECOND, PRC_MILLISEC, PRC_MILLISEC, PRC_NANOSEC};
+    for (int k = 0; k < 8; k++){
+        for (size_t i = 0; i < CFG_WIRE_SIZE; i++){
+            uint64_t r = random_flexpoch(&state);
+            int64_t secs = 1700000000 + r % 100000000;
+            uint32_t ns = r % NS_PER_SEC;
+            switch (k){
+                case 5: values[i] = (int64_t)((uint64_t)CP_REL_SEC << 60 | (r % 7200) << 24 |
+                                              FP_tz_offset_to_bin(0) << 13 | PRC_SECOND << 3 | 0b111); break;
+                case 6: values[i] = (int64_t)((uint64_t)CP_LOGICAL << 60 | r % 100000000); break;
+                case 7:   // any bits, forced into every tag now and then
+                    values[i] = r;
+                    if (r % 5 == 0){ values[i] = (r & WIRE_TEST_LOW60) | (uint64_t)CP_REL_SEC << 60; }
+                    if (r % 5 == 1){ values[i] = (r & WIRE_TEST_LOW60) | (uint64_t)CP_LOGICAL << 60; }
+                    if (r % 3 == 0){ values[i] |= 0b111; }
+                    if (r % 3 == 1){ values[i] = (values[i] & ~0b111) | 0b101; }
+                    break;
+                default: {
+                    FP_Components fpc = FP_new();
+                    fpc.seconds = secs;
+                    fpc.precision = prcs[k];
+                    fpc.ns = (k < 2) ? 0 : (k < 4) ? ns / 1000000 * 1000000 : ns;
+                    fpc.tz_offset = (k == 1 || k == 3) ? 60 : 0;
+                    mismatches += FP_to_fp(&fpc, &values[i]) != SUCCESS;
+                }
+            }
+        }
+
+        size_t used = 0, pos = 0;
+        for (size_t i = 0; i < CFG_WIRE_SIZE; i++){
+            pos += FP_wire_encode(values[i], buf + pos);
+        }
+        size_t size = FP_wire_encode_batch(values, CFG_WIRE_SIZE, buf);
+        mismatches += pos != size;
+        mismatches += FP_wire_decode_batch(buf, size, decoded, CFG_WIRE_SIZE, &used) != CFG_WIRE_SIZE;
+
+        // single value decode and sizes
+        size_t sizes = 0;
+        pos = 0;
+        for (size_t i = 0; i < CFG_WIRE_SIZE; i++){
+            int64_t v;
+            size_t n = FP_wire_decode(buf + pos, size - pos, &v);
+            mismatches += (n == 0) || (n != FP_wire_size(values[i])) || v != values[i];
+            pos += n ? n : 1;
+            sizes += FP_wire_size(values[i]);
+        }
+        mismatches += (used != size) || (sizes != size);
+        mismatches += memcmp(values, decoded, sizeof(values)) != 0;
+    }
+
+    // edges and truncated input
+    const int64_t edges[] = {0, -1, INT64_MAX, CP_UNDEFINED_FP, 0x7FFFFFFFFFFFFF7F, (int64_t)0xD0000000000000FF,
+                             (int64_t)0xDFFFFFFFFFFFFF7D, (int64_t)0xA000000000000000, (int64_t)0xAFFFFFFFFFFFFFFF};
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++){
+        uint8_t one[FP_WIRE_MAX];
+        int64_t v = 0;
+        size_t n = FP_wire_encode(edges[i], one);
+        mismatches += FP_wire_decode(one, n, &v) != n || v != edges[i];
+        for (size_t len = 0; len < n; len++){
+            mismatches += FP_wire_decode(one, len, &v) != 0;
+        }
+    }
+    size_t n = FP_wire_encode_batch(values, 64, buf), used = 0;
+    mismatches += FP_wire_decode_batch(buf, n - 1, decoded, 64, &used) != 63 || used != n - FP_wire_size(values[63]);
+    printf("Wire encoding: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+#define CFG_CALENDAR_SIZE (1 << 20)
+
+// bucket [lo, hi) of local seconds t through gmtime() / timegm()
+static void calendar_ref(int64_t t, Precision prc, int64_t *lo, int64_t *hi){
+    time_t tt = t;
+    struct tm tm;
+    gmtime_r(&tt, &tm);
+    tm.tm_sec = 0;
+    if (prc >= PRC_HOUR){ tm.tm_min = 0; }
+    if (prc >= PRC_DAY){ tm.tm_hour = 0; }
+    if (prc == PRC_WEEK){ tm.tm_mday -= (tm.tm_wday + 6) % 7; }
+    if (prc >= PRC_MONTH){ tm.tm_mday = 1; }
+    int months = (int[]){1, 3, 4, 6, 12, 120, 1200, 12000}[(prc >= PRC_MONTH) ? prc - PRC_MONTH : 0];
+    int year = tm.tm_year + 1900;
+    if (prc >= PRC_QUATER && prc <= PRC_SEMESTER){ tm.tm_mon = tm.tm_mon / months * months; }
+    if (prc >= PRC_YEAR){
+        int years = months / 12;
+        tm.tm_mon = 0;
+        tm.tm_year = (year - ((year % years) + years) % years) - 1900;
+    }
+    *lo = timegm(&tm);
+    switch (prc){
+        case PRC_MINUTE: tm.tm_min += 1; break;
+        case PRC_HOUR:   tm.tm_hour += 1; break;
+        case PRC_DAY:    tm.tm_mday += 1; break;
+        case PRC_WEEK:   tm.tm_mday += 7; break;
+        default:         tm.tm_mon += months; break;
+    }
+    *hi = timegm(&tm);
+}
+
+size_t test_calendar(){
+    static int64_t values[CFG_CALENDAR_SIZE], result[CFG_CALENDAR_SIZE];
+    static int16_t err[CFG_CALENDAR_SIZE];
+    uint64_t state = 0x1F83D9ABFB41BD6B;
+    size_t mismatches = 0;
+
+    printf("\n\n----\nTesting calendar truncation (%d values)\n----\n", CFG_CALENDAR_SIZE);
+    // random times 1900..2100 of all precisions with tz offsets
+    const Precision prcs[] = {PRC_NANOSEC, PRC_MICROSEC, PRC_15BIT, PRC_MILLISEC, PRC_SECOND, PRC_HOUR, PRC_MONTH};
+    for (size_t i = 0; i < CFG_CALENDAR_SIZE; i++){
+        uint64_t r = random_flexpoch(&state);
+        FP_Components fpc = FP_new();
+        fpc.seconds = (int64_t)(r % 6311390400) - 2208988800;
+        fpc.ns = (r >> 34) % NS_PER_SEC;
+        fpc.precision = prcs[(r >> 20) % 7];
+        fpc.tz_offset = (fpc.precision == PRC_MILLISEC || fpc.precision >= 0) ? (int)((r >> 8) % 1441) - 720 : 0;
+        fpc.is_leapsecond = (r % 1000 == 0) && fpc.precision >= PRC_MILLISEC;
+        fpc.tz_offset = fpc.is_leapsecond ? 0 : fpc.tz_offset;
+        mismatches += FP_to_fp(&fpc, &values[i]) != SUCCESS;
+    }
+
+    for (Precision prc = PRC_MINUTE; prc <= PRC_MILLENNIUM; prc++){
+        for (int round = 0; round < 2; round++){
+            size_t n_err = round ? FP_round_batch(values, CFG_CALENDAR_SIZE, prc, result, err)
+                                 : FP_truncate_batch(values, CFG_CALENDAR_SIZE, prc, result, err);
+            mismatches += n_err != 0;
+            for (size_t i = 0; i < CFG_CALENDAR_SIZE; i += 7){
+                Precision have, got;
+                int64_t seconds, expect;
+                int16_t tz, tz_out;
+                FP_get_precision(values[i], &have);
+                FP_get_tz_offset(values[i], &tz);
+                FP_get_seconds(values[i], &seconds);
+                if (have >= prc){
+                    mismatches += result[i] != values[i];
+                    continue;
+                }
+                int64_t lo, hi, local = seconds + tz * 60;
+                calendar_ref(local, prc, &lo, &hi);
+                expect = ((round && 2 * (local - lo) >= hi - lo) ? hi : lo) - tz * 60;
+                mismatches += FP_get_seconds(result[i], &seconds) != SUCCESS || seconds != expect;
+                mismatches += FP_get_precision(result[i], &got) != SUCCESS || got != prc;
+                FP_get_tz_offset(result[i], &tz_out);
+                mismatches += tz_out != tz;
+                int64_t single;
+                mismatches += (round ? FP_round(values[i], prc, &single) : FP_truncate(values[i], prc, &single)) != SUCCESS;
+                mismatches += single != result[i];
+            }
+        }
+    }
+
+    // sub-second: truncation is FP_to_fp() at the coarser precision, rounding carries
+    for (size_t i = 0; i < CFG_CALENDAR_SIZE; i += 3){
+        FP_Components fpc = FP_new();
+        FP_from_fp(values[i], &fpc);
+        if (fpc.precision != PRC_23BIT){ continue; }
+        for (int k = 0; k < 3; k++){
+            Precision prc = (Precision[]){PRC_MICROSEC, PRC_15BIT, PRC_MILLISEC}[k];
+            FP_Components coarse = fpc;
+            int64_t expect, got;
+            coarse.precision = prc;
+            mismatches += FP_to_fp(&coarse, &expect) != SUCCESS;
+            mismatches += FP_truncate(values[i], prc, &got) != SUCCESS || got != expect;
+        }
+        int64_t up, expect = values[i] + 0x2000;   // half a millisec unit, carries into the seconds
+        mismatches += FP_round(values[i], PRC_23BIT, &up) != SUCCESS || up != values[i];
+        FP_truncate(expect, PRC_MILLISEC, &expect);
+        mismatches += FP_round(values[i], PRC_MILLISEC, &up) != SUCCESS || up != expect;
+    }
+    int64_t v, out;
+    FP_from_unix_batch((int64_t[]){1700000000}, 1, PRC_SECOND, 0, &v, NULL);
+    v = (v & ~0xFFFFFF) | 0xFFFFFE;   // 23 bit, last fraction of the second
+    mismatches += FP_round(v, PRC_MILLISEC, &out) != SUCCESS || out != (int64_t)(((uint64_t)1700000001 << 24) | 0x2005);
+    mismatches += FP_round(v, PRC_SECOND, &out) != SUCCESS || out != (int64_t)(((uint64_t)1700000001 << 24) | 0x800007);
+
+    // relative seconds, other formats and bad precisions
+    int64_t rel = (int64_t)((uint64_t)CP_REL_SEC << 60 | (uint64_t)6000 << 24 | 0x800007);
+    mismatches += FP_truncate(rel, PRC_HOUR, &out) != SUCCESS ||
+                  out != (int64_t)((uint64_t)CP_REL_SEC << 60 | (uint64_t)3600 << 24 | 0x800017);
+    mismatches += FP_round(rel, PRC_HOUR, &out) != SUCCESS ||
+                  out != (int64_t)((uint64_t)CP_REL_SEC << 60 | (uint64_t)7200 << 24 | 0x800017);
+    mismatches += FP_truncate(rel, PRC_MONTH, &out) != ERR_INCOMPATIBLE_OUTPUT || out != CP_UNDEFINED_FP;
+    mismatches += FP_truncate((int64_t)((uint64_t)CP_LOGICAL << 60 | 42), PRC_DAY, &out) != ERR_INCOMPATIBLE_OUTPUT;
+    mismatches += FP_truncate(values[0], PRC_UNKNOWN, &out) != ERR_INVALID_PRECISION;
+    mismatches += FP_truncate_batch(values, 4, -4, result, err) != 4 || err[3] != ERR_INVALID_PRECISION;
+
+    // in place over sorted telemetry against decode + gmtime() + timegm() + encode
+    int64_t t = 1700000000;
+    for (size_t i = 0; i < CFG_CALENDAR_SIZE; i++){
+        t += (random_flexpoch(&state) & 0xFF) == 0;
+        values[i] = (int64_t)(((uint64_t)t << 24) | (FP_tz_offset_to_bin(60) << 3) | 0b101);
+    }
+    for (int k = 0; k < 2; k++){
+        Precision prc = k ? PRC_MONTH : PRC_DAY;
+        for (size_t i = 0; i < CFG_CALENDAR_SIZE; i++){
+            FP_Components fpc = FP_new();
+            FP_from_fp(values[i], &fpc);
+            time_t local = fpc.seconds + fpc.tz_offset * 60;
+            struct tm tm;
+            gmtime_r(&local, &tm);
+            tm.tm_sec = tm.tm_min = tm.tm_hour = 0;
+            tm.tm_mday = k ? 1 : tm.tm_mday;
+            fpc.seconds = timegm(&tm) - fpc.tz_offset * 60;
+            fpc.precision = prc;
+            FP_to_fp(&fpc, &result[i]);
+        }
+        static int64_t copy[CFG_CALENDAR_SIZE];
+        memcpy(copy, values, sizeof(values));
+        mismatches += FP_truncate_batch(copy, CFG_CALENDAR_SIZE, prc, copy, NULL) != 0;
+        mismatches += memcmp(copy, result, sizeof(copy)) != 0;
+    }
+    printf("Calendar: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+#define CFG_BULK_SIZE (1 << 20)
+
+// write n int64 to a new temp file, optionally byte swapped
+static void write_tmp(char *path, const int64_t *values, size_t n, bool swap){
+    int fd = mkstemp(path);
+    FILE *f = fdopen(fd, "wb");
+    for (size_t i = 0; i < n; i++){
+        int64_t v = swap ? (int64_t)__builtin_bswap64(values[i]) : values[i];
+        fwrite(&v, sizeof(v), 1, f);
+    }
+    fclose(f);
+}
+
+size_t test_bulk(){
+    static int64_t values[CFG_BULK_SIZE];
+    static int64_t result[CFG_BULK_SIZE];
+    static char arena[CFG_BATCH_SIZE * FP_ISO_MAX_LEN];
+    static size_t offsets[CFG_BATCH_SIZE + 1];
+    char in_le[] = "/tmp/fp_bulk_le_XXXXXX";
+    char in_be[] = "/tmp/fp_bulk_be_XXXXXX";
+    char out[] = "/tmp/fp_bulk_out_XXXXXX";
+    uint64_t state = 0xBB67AE8584CAA73B;
+    size_t mismatches = 0;
+
+    for (size_t i = 0; i < CFG_BULK_SIZE; i++){
+        values[i] = random_flexpoch(&state);
+    }
+    write_tmp(in_le, values, CFG_BULK_SIZE, false);
+    write_tmp(in_be, values, CFG_BULK_SIZE, true);
+    close(mkstemp(out));
+
+    printf("\n\n----\nTesting bulk file transcoder (%d values)\n----\n", CFG_BULK_SIZE);
+    const FP_BulkOutput outputs[] = {BULK_UNIX, BULK_JAVA, BULK_NS, BULK_ISO};
+    for (int k = 0; k < 4; k++){
+        FP_BulkOptions opt = {outputs[k], false, 0, 0};
+        FP_BulkStats stats;
+        ErrNo error = FP_bulk_transcode(in_le, out, &opt, &stats);
+        mismatches += (error != SUCCESS || stats.n_values != CFG_BULK_SIZE);
+    }
+
+    // small page aligned chunks, more threads than cores, both byte orders
+    for (int k = 0; k < 6; k++){
+        FP_BulkOptions opt = {k < 2 ? BULK_UNIX : k < 4 ? BULK_JAVA : BULK_NS, k & 1, 4, 4096};
+        FP_bulk_transcode((k & 1) ? in_be : in_le, out, &opt, NULL);
+        FILE *f = fopen(out, "rb");
+        size_t n = fread(result, sizeof(int64_t), CFG_BULK_SIZE, f);
+        fclose(f);
+        mismatches += (n != CFG_BULK_SIZE);
+        for (size_t i = 0; i < CFG_BATCH_SIZE && i < n; i++){
+            FP_Components fpc = FP_new();
+            int64_t expected = INT64_MIN;
+            if (((values[i] >> 60) & 0xF) != CP_REL_FRAC && FP_from_fp(values[i], &fpc) == SUCCESS){
+                if (opt.output == BULK_UNIX){ FP_to_unix(&fpc, &expected); }
+                if (opt.output == BULK_JAVA){ FP_to_java(&fpc, &expected); }
+                if (opt.output == BULK_NS && (__builtin_mul_overflow(fpc.seconds, (int64_t)1000000000, &expected)
+                                           || __builtin_add_overflow(expected, (int64_t)fpc.ns, &expected))){
+                    expected = INT64_MIN;
+                }
+            }
+            if (result[i] != expected){
+                printf("Mismatch for FP=%016lX: %li != %li\n", values[i], result[i], expected);
+                mismatches++;
+            }
+        }
+    }
 
-    for (int i = 0; i < CFG_ROUNDS_PER_CODE; i++){
-        FP_init(&fpc);
-        PRF_start(&prf);
-        result = FP_from_fp(flexpoch, &fpc);
-        PRF_stop(&prf);
+    // ISO lines equal FP_to_iso_batch() rows
+    FP_BulkOptions opt = {BULK_ISO, true, 3, 4096};
+    FP_bulk_transcode(in_be, out, &opt, NULL);
+    FP_to_iso_batch(values, CFG_BATCH_SIZE, arena, sizeof(arena), offsets, 0, NULL);
+    FILE *f = fopen(out, "r");
+    char line[2 * FP_ISO_MAX_LEN];
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        size_t len = offsets[i+1] - offsets[i];
+        if (!fgets(line, sizeof(line), f) || strlen(line) != len + 1 || memcmp(line, arena + offsets[i], len)){
+            printf("Mismatch in ISO line %zu\n", i);
+            mismatches++;
+        }
     }
-    if(result != 0){
-        printf("Error: %i", result);
+    fclose(f);
+
+    remove(in_le);
+    remove(in_be);
+    remove(out);
+    printf("Bulk transcoder: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+#define CFG_TRANSCODE_ROWS 200000
+
+// transcode file in -> out
+static ErrNo transcode_file(const char *in, const char *out, const FP_TranscodeOptions *opt, FP_TranscodeStats *stats){
+    int in_fd = open(in, O_RDONLY);
+    int out_fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ErrNo error = FP_transcode_fd(in_fd, out_fd, opt, stats);
+    close(in_fd);
+    close(out_fd);
+    return error;
+}
+
+size_t test_transcode(){
+    char csv[] = "/tmp/fp_csv_XXXXXX";
+    char fp_csv[] = "/tmp/fp_csv_fp_XXXXXX";
+    char iso_csv[] = "/tmp/fp_csv_iso_XXXXXX";
+    FILE *f = fdopen(mkstemp(csv), "w");
+    close(mkstemp(fp_csv));
+    close(mkstemp(iso_csv));
+    uint64_t state = 0x3C6EF372FE94F82B;
+    size_t mismatches = 0;
+
+    // quoted fields with delimiters and newlines, CRLF and a record longer than the buffer
+    fprintf(f, "id,ts,msg\n");
+    int64_t seconds = 1745857043;
+    for (int i = 0; i < CFG_TRANSCODE_ROWS; i++){
+        uint64_t r = random_flexpoch(&state);
+        seconds += r & 0x3;
+        FP_Components fpc = FP_new();
+        char iso[FP_ISO_MAX_LEN];
+        FP_from_unix(seconds, &fpc);
+        FP_format_iso(&fpc, iso, sizeof(iso));
+        fprintf(f, (r & 0x70) ? "%d,%s,msg%d\r\n" : "%d,\"%s\",\"a, \"\"b\"\"\n%d\"\n", i, iso, i);
     }
+    fputs("x,", f);
+    for (int i = 0; i < (3 << 19); i++){ fputc('y', f); }
+    fputs("\nlast,2025-04-28T16:17:23Z,end", f);
+    fclose(f);
+
+    printf("\n\n----\nTesting CSV transcoder (%d records)\n----\n", CFG_TRANSCODE_ROWS);
+    FP_TranscodeOptions to_fp = {FIELD_ISO, FIELD_FP, NULL, 1, ','};
+    FP_TranscodeOptions to_iso = {FIELD_FP, FIELD_ISO, NULL, 1, ','};
+    FP_TranscodeStats stats;
+    mismatches += transcode_file(csv, fp_csv, &to_fp, &stats) != SUCCESS;
+    mismatches += (stats.records != CFG_TRANSCODE_ROWS + 3 || stats.failed != 2);
+    mismatches += transcode_file(fp_csv, iso_csv, &to_iso, &stats) != SUCCESS;
+    mismatches += (stats.converted != CFG_TRANSCODE_ROWS + 1);
+
+    // the round trip gives the input back byte by byte
+    FILE *a = fopen(csv, "rb");
+    FILE *b = fopen(iso_csv, "rb");
+    int ca, cb;
+    do {
+        ca = fgetc(a);
+        cb = fgetc(b);
+    } while (ca == cb && ca != EOF);
+    mismatches += (ca != cb);
+    fclose(a);
+    fclose(b);
+
+    remove(csv);
+    remove(fp_csv);
+    remove(iso_csv);
+    printf("CSV transcoder: %zu mismatches\n", mismatches);
+    return mismatches;
 }
 
-void test_performance(){
-    int64_t flexpoch;
-#if defined(__aarch64__) || defined(_M_ARM64)
-    printf("Running on ARM\n");
-    enable_cycle_counter();
-#endif
-    for (size_t i = 0; i < sizeof(TEST_VALUES_POS)/8; i++) {
-        flexpoch = TEST_VALUES_POS[i];
-        test_value(flexpoch);
-        printf("\n------------------\nTesting FP=%016lX: ", flexpoch);
-        PRF_print("fp", &prf);
+size_t test_serve(){
+    static int64_t values[CFG_BATCH_SIZE];
+    static int64_t expected[CFG_BATCH_SIZE];
+    static char response[FP_SERVE_MAX_RESPONSE(CFG_BATCH_SIZE)];
+    char path[] = "/tmp/fp_serve_XXXXXX";
+    close(mkstemp(path));
+    uint64_t state = 0x510E527FADE682D1;
+    size_t mismatches = 0;
+
+    fflush(stdout);   // the child would print the buffered output again
+    pid_t pid = fork();
+    if (pid == 0){   // SIGTERM ends FP_serve(), which hands back the signal mask as it was
+        ErrNo result = FP_serve(path, 2);
+        sigset_t mask;
+        pthread_sigmask(SIG_SETMASK, NULL, &mask);
+        exit(result != SUCCESS || sigismember(&mask, SIGTERM) || sigismember(&mask, SIGINT));
+    }
+    int fd = -1;
+    for (int i = 0; i < 100 && fd < 0; i++){   // until the daemon listens
+        usleep(10000);
+        fd = FP_client_connect(path);
+    }
+
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        values[i] = random_flexpoch(&state);
     }
+    FP_to_unix_batch(values, CFG_BATCH_SIZE, expected, NULL);
 
-    printf("\n\n----\nTesting negative examples (should fail)\n----\n");
-    for (size_t i = 0; i < sizeof(TEST_VALUES_NEG)/8; i++) {
-        flexpoch = TEST_VALUES_NEG[i];
-        test_value(flexpoch);
-        printf("\n------------------\nTesting FP=%016lX: ", flexpoch);
-        PRF_print("fp", &prf);
+    printf("\n\n----\nTesting conversion daemon (round trips)\n----\n");
+    FP_ServeHeader resp;
+    for (int k = 0; k < 2; k++){
+        uint32_t count = k ? CFG_BATCH_SIZE : 1;
+        mismatches += FP_client_request(fd, FIELD_FP, FIELD_UNIX, count, values, count * sizeof(int64_t),
+                                        &resp, response, sizeof(response)) != SUCCESS;
+    }
+
+    const int64_t *result = (const int64_t *)(response + CFG_BATCH_SIZE * sizeof(int16_t));
+    mismatches += (resp.status != SUCCESS || resp.count != CFG_BATCH_SIZE);
+    mismatches += (resp.from != FIELD_FP || resp.to != FIELD_UNIX);
+    mismatches += (memcmp(result, expected, sizeof(expected)) != 0);
+    // a broken header is answered and the connection closed
+    mismatches += (FP_client_request(fd, FIELD_FP, FIELD_UNIX, FP_SERVE_MAX_COUNT + 1, values, 0,
+                                     &resp, response, sizeof(response)) != ERR_OUT_OF_RANGE);
+    close(fd);
+
+    kill(pid, SIGTERM);
+    int status;
+    waitpid(pid, &status, 0);
+    mismatches += (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || access(path, F_OK) == 0);
+    printf("Conversion daemon: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+// small tasks on more threads than rows per task, so that workers steal
+size_t test_pool(){
+    static int64_t values[CFG_BATCH_SIZE];
+    static int64_t out[2][CFG_BATCH_SIZE];
+    static int16_t err[2][CFG_BATCH_SIZE];
+    static int64_t seconds[2][CFG_BATCH_SIZE];
+    static uint8_t fmt[2][CFG_BATCH_SIZE];
+    static char arena[2][CFG_BATCH_SIZE * FP_ISO_MAX_LEN];
+    static size_t offsets[2][CFG_BATCH_SIZE + 1];
+    static uint64_t err_mask[2][CFG_BATCH_SIZE / 64];
+    const size_t width = 32;
+    uint64_t state = 0xBB67AE8584CAA73B;
+    size_t mismatches = 0;
+
+    for (size_t i = 0; i < CFG_BATCH_SIZE; i++){
+        values[i] = random_flexpoch(&state);
+    }
+    FP_PoolOptions opt = {.threads = 4, .task_rows = 64};
+    FP_Pool *pool = FP_pool_create(&opt);
+    printf("\n\n----\nTesting thread pool (%d threads)\n----\n", FP_pool_size(pool));
+
+    FP_BatchOut cols[2] = {{.seconds = seconds[0], .fmt = fmt[0], .err = err[0]},
+                           {.seconds = seconds[1], .fmt = fmt[1], .err = err[1]}};
+    size_t n_failed = FP_from_fp_batch(values, CFG_BATCH_SIZE, &cols[0]);
+    mismatches += FP_pool_from_fp(pool, values, CFG_BATCH_SIZE, &cols[1]) != n_failed;
+    mismatches += memcmp(seconds[0], seconds[1], sizeof(seconds[0])) != 0;
+    mismatches += memcmp(fmt[0], fmt[1], sizeof(fmt[0])) != 0;
+    mismatches += memcmp(err[0], err[1], sizeof(err[0])) != 0;
+
+    mismatches += FP_to_java_batch(values, CFG_BATCH_SIZE, out[0], err[0])
+               != FP_pool_to_java(pool, values, CFG_BATCH_SIZE, out[1], err[1]);
+    mismatches += memcmp(out[0], out[1], sizeof(out[0])) != 0 || memcmp(err[0], err[1], sizeof(err[0])) != 0;
+
+    // offsets into an arena that is full after about half of the rows, and fixed width
+    size_t size = CFG_BATCH_SIZE * 16;
+    for (int k = 0; k < 2; k++){
+        size_t n = FP_to_iso_batch(values, CFG_BATCH_SIZE, arena[0], size, offsets[0], 0, NULL);
+        mismatches += FP_pool_to_iso(pool, values, CFG_BATCH_SIZE, arena[1], size, offsets[1], 0, NULL) != n;
+        mismatches += memcmp(offsets[0], offsets[1], (n + 1) * sizeof(size_t)) != 0;
+        mismatches += memcmp(arena[0], arena[1], offsets[0][n]) != 0;
+        size = sizeof(arena[0]);
+    }
+    size_t n = FP_to_iso_batch(values, CFG_BATCH_SIZE, arena[0], CFG_BATCH_SIZE * width, NULL, width, err[0]);
+    mismatches += FP_pool_to_iso(pool, values, CFG_BATCH_SIZE, arena[1], CFG_BATCH_SIZE * width, NULL, width, err[1]) != n;
+    mismatches += memcmp(arena[0], arena[1], n * width) != 0 || memcmp(err[0], err[1], sizeof(err[0])) != 0;
+
+    // and parsed back
+    FP_to_iso_batch(values, CFG_BATCH_SIZE, arena[0], sizeof(arena[0]), offsets[0], 0, NULL);
+    mismatches += FP_from_iso_batch(arena[0], offsets[0], 0, CFG_BATCH_SIZE, out[0], err_mask[0])
+               != FP_pool_from_iso(pool, arena[0], offsets[0], 0, CFG_BATCH_SIZE, out[1], err_mask[1]);
+    mismatches += memcmp(out[0], out[1], sizeof(out[0])) != 0 || memcmp(err_mask[0], err_mask[1], sizeof(err_mask[0])) != 0;
+
+    FP_pool_destroy(pool);
+    printf("Thread pool: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+#define CFG_AGG_SIZE (1 << 18)
+
+// unsorted rows of any precision and tz offset, some not aggregatable, against
+// bucket starts stepped with calendar_ref() and a binary search per row
+size_t test_agg(){
+    static int64_t values[CFG_AGG_SIZE];
+    static double vals[CFG_AGG_SIZE];
+    static int64_t starts[4097];
+    static FP_AggBucket ref[4096], got[4096];
+    uint64_t state = 0x3C6EF372FE94F82B;
+    size_t mismatches = 0;
+
+    printf("\n\n----\nTesting time-bucketed aggregation (%d rows)\n----\n", CFG_AGG_SIZE);
+    const Precision prcs[] = {PRC_NANOSEC, PRC_MILLISEC, PRC_SECOND, PRC_HOUR};
+    for (size_t i = 0; i < CFG_AGG_SIZE; i++){
+        uint64_t r = random_flexpoch(&state);
+        FP_Components fpc = FP_new();
+        fpc.seconds = 946684800 + (int64_t)(r % 946684800);   // 2000 .. 2030
+        fpc.ns = (r >> 34) % NS_PER_SEC;
+        fpc.precision = prcs[(r >> 20) % 4];
+        fpc.tz_offset = (fpc.precision == PRC_MILLISEC || fpc.precision >= 0) ? (int)((r >> 8) % 1441) - 720 : 0;
+        mismatches += FP_to_fp(&fpc, &values[i]) != SUCCESS;
+        if (r % 50 == 0){ values[i] = random_flexpoch(&state); }   // mostly invalid, relative or logical
+        vals[i] = (double)((int64_t)(r >> 44) % 2001 - 1000);
+    }
+
+    FP_PoolOptions opt = {.threads = 4, .task_rows = 64};
+    FP_Pool *pool = FP_pool_create(&opt);
+    const FP_AggSpec specs[] = {
+        {PRC_UNKNOWN, 86400 * 3 + 7, 1000000000, 0, 4000},   // ends before the last rows
+        {PRC_HOUR, 0, 1500000000, 0, 4096},                  // starts after the first rows
+        {PRC_DAY, 0, 946684800, 60, 4096},
+        {PRC_WEEK, 0, 946684800, -300, 1600},
+        {PRC_MONTH, 0, 946684800, 330, 400},
+        {PRC_QUATER, 0, 946684800, -720, 130},
+        {PRC_YEAR, 0, 946684800, 0, 31},
+        {PRC_DECADE, 0, 946684800, 600, 4},
+    };
+    for (size_t k = 0; k < sizeof(specs) / sizeof(specs[0]); k++){
+        const FP_AggSpec *spec = &specs[k];
+        size_t n_buckets = spec->n_buckets;
+        int64_t offset = spec->tz_offset * 60;
+        if (spec->prc == PRC_UNKNOWN){
+            for (size_t b = 0; b <= n_buckets; b++){ starts[b] = spec->start + (int64_t)b * spec->width; }
+        } else {
+            int64_t lo, hi;
+            calendar_ref(spec->start + offset, spec->prc, &lo, &hi);
+            for (size_t b = 0; b <= n_buckets; b++){
+                starts[b] = lo - offset;
+                calendar_ref(hi, spec->prc, &lo, &hi);
+            }
+        }
+        for (size_t b = 0; b < n_buckets; b++){ ref[b] = (FP_AggBucket){0, 0.0, INFINITY, -INFINITY}; }
+        size_t n_ref = 0;
+        for (size_t i = 0; i < CFG_AGG_SIZE; i++){
+            int64_t v = values[i];
+            if (fp_direct_validate(v) || !fp_direct_is_sec(v >> 56) || ((uint64_t)v >> 60) == CP_REL_SEC){ continue; }
+            int64_t seconds = v >> 24;
+            if (seconds < starts[0] || seconds >= starts[n_buckets]){ continue; }
+            size_t lo = 0, hi = n_buckets;   // last start <= seconds
+            while (hi - lo > 1){
+                size_t mid = (lo + hi) / 2;
+                if (starts[mid] <= seconds){ lo = mid; } else { hi = mid; }
+            }
+            ref[lo].count++;
+            ref[lo].sum += vals[i];
+            ref[lo].min = (vals[i] < ref[lo].min) ? vals[i] : ref[lo].min;
+            ref[lo].max = (vals[i] > ref[lo].max) ? vals[i] : ref[lo].max;
+            n_ref++;
+        }
+        for (size_t b = 0; b <= n_buckets; b += 1 + b / 8){
+            mismatches += FP_agg_bucket_start(spec, b) != starts[b];
+        }
+        for (int threads = 0; threads < 2; threads++){
+            size_t used = 0;
+            memset(got, 0xFF, sizeof(got));
+            mismatches += FP_aggregate(threads ? pool : NULL, spec, values, vals, CFG_AGG_SIZE, got, &used) != SUCCESS;
+            mismatches += used != n_ref || memcmp(ref, got, n_buckets * sizeof(FP_AggBucket)) != 0;
+        }
+        mismatches += n_ref == 0;
+        FP_aggregate(pool, spec, values, NULL, CFG_AGG_SIZE, got, NULL);
+        for (size_t b = 0; b < n_buckets; b++){
+            mismatches += got[b].count != ref[b].count || got[b].sum != 0.0 || got[b].min != INFINITY;
+        }
+    }
+
+    // bad specs leave out alone
+    FP_AggSpec bad[] = {
+        {PRC_MILLISEC, 0, 0, 0, 10}, {PRC_UNKNOWN, 0, 0, 0, 10}, {PRC_DAY, 0, 0, 0, 0},
+        {PRC_DAY, 0, 0, 1100, 10}, {PRC_YEAR, 0, 0, 0, 1000000}, {PRC_MINUTE, 0, INT64_MAX, 0, 1},
+    };
+    ErrNo expect[] = {ERR_INVALID_PRECISION, ERR_OUT_OF_RANGE, ERR_OUT_OF_RANGE, ERR_INVALID_OFFSET,
+                      ERR_OUT_OF_RANGE, ERR_OUT_OF_RANGE};
+    for (size_t k = 0; k < sizeof(bad) / sizeof(bad[0]); k++){
+        got[0].count = 42;
+        mismatches += FP_aggregate(NULL, &bad[k], values, vals, CFG_AGG_SIZE, got, NULL) != expect[k];
+        mismatches += got[0].count != 42 || FP_agg_bucket_start(&bad[k], 0) != INT64_MIN;
+    }
+    FP_pool_destroy(pool);
+    printf("Aggregation: %zu mismatches\n", mismatches);
+    return mismatches;
+}
+
+#define CFG_ARITH_SIZE (1 << 20)
+
+// nanoseconds since 1970 of a decoded value
+static int64_t arith_ns(int64_t flexpoch, FP_Components *fpc){
+    *fpc = FP_new();
+    FP_from_fp(flexpoch, fpc);
+    return fpc->seconds * NS_PER_SEC + fpc->ns;
+}
+
+size_t test_arith(){
+    static int64_t times[CFG_ARITH_SIZE], durations[CFG_ARITH_SIZE], result[CFG_ARITH_SIZE], back[CFG_ARITH_SIZE];
+    static int16_t err[CFG_ARITH_SIZE];
+    uint64_t state = 0xA54FF53A5F1D36F1;
+    size_t mismatches = 0;
+
+    printf("\n\n----\nTesting arithmetic on encoded values (%d values)\n----\n", CFG_ARITH_SIZE);
+    const Precision prcs[] = {PRC_23BIT, PRC_MICROSEC, PRC_15BIT, PRC_MILLISEC, PRC_SECOND, PRC_MINUTE};
+    const int64_t unit_ns[] = {120, 954, 30518, 976563, NS_PER_SEC, NS_PER_SEC};   // of a fraction bit, rounded up
+    for (size_t i = 0; i < CFG_ARITH_SIZE; i++){
+        uint64_t r = random_flexpoch(&state);
+        FP_Components fpc = FP_new();
+        fpc.seconds = (int64_t)(r % 6311390400) - 2208988800;   // 1900 .. 2100
+        fpc.ns = (r >> 34) % NS_PER_SEC;
+        fpc.precision = prcs[(r >> 20) % 6];
+        fpc.tz_offset = (fpc.precision == PRC_MILLISEC || fpc.precision >= 0) ? (int)((r >> 8) % 1441) - 720 : 0;
+        fpc.is_leapsecond = (r % 1000 == 0) && fpc.precision >= PRC_MILLISEC;
+        fpc.tz_offset = fpc.is_leapsecond ? 0 : fpc.tz_offset;
+        mismatches += FP_to_fp(&fpc, &times[i]) != SUCCESS;
+
+        r = random_flexpoch(&state);
+        FP_Components dur = FP_new();
+        dur.seconds = (r & 1) ? (int64_t)(r >> 8) % 100000000 : (int64_t)(r >> 8) % 100;
+        dur.ns = (r >> 34) % NS_PER_SEC;
+        dur.precision = prcs[(r >> 2) % 6];
+        FP_to_fp(&dur, &durations[i]);
+        durations[i] = (durations[i] & 0x0FFFFFFFFFFFFFFF) | (int64_t)((uint64_t)CP_REL_SEC << 60);
+    }
+
+    // against decoded nanoseconds, cut to the coarser precision
+    mismatches += FP_add_batch(times, CFG_ARITH_SIZE, durations[0], result, err) != 0;
+    for (int op = 0; op < 3; op++){
+        for (size_t i = 0; i < CFG_ARITH_SIZE; i++){
+            int64_t got;
+            ErrNo e = (op == 0) ? FP_add(times[i], durations[i], &got) :
+                      (op == 1) ? FP_sub(times[i], durations[i], &got) : FP_add(durations[i], times[i], &got);
+            mismatches += e != SUCCESS;
+            FP_Components t, d, g;
+            int64_t expect = (op == 1) ? arith_ns(times[i], &t) - arith_ns(durations[i], &d)
+                                       : arith_ns(times[i], &t) + arith_ns(durations[i], &d);
+            int64_t ns = arith_ns(got, &g);
+            Precision prc = (t.precision > d.precision) ? t.precision : d.precision;
+            int64_t unit = unit_ns[(prc == PRC_23BIT) ? 0 : (prc == PRC_MICROSEC) ? 1 : (prc == PRC_15BIT) ? 2 :
+                                   (prc == PRC_MILLISEC) ? 3 : 4];
+            mismatches += g.fmt != FMT_ABS_SEC || g.precision != prc || g.tz_offset != t.tz_offset;
+            mismatches += ns > expect + 1 || ns <= expect - unit - 1;
+            mismatches += g.is_leapsecond != (t.is_leapsecond && g.seconds == t.seconds);
+        }
+    }
+
+    // same precision: exact round trips through FP_diff() and FP_sub()
+    for (size_t i = 0; i < CFG_ARITH_SIZE; i++){
+        FP_Components t, d;
+        arith_ns(times[i], &t);
+        arith_ns(durations[i], &d);
+        if (t.precision != d.precision || t.is_leapsecond){ continue; }
+        int64_t sum, diff, sub;
+        mismatches += FP_add(times[i], durations[i], &sum) != SUCCESS;
+        mismatches += FP_diff(sum, times[i], &diff) != SUCCESS || diff != durations[i];
+        mismatches += FP_sub(sum, durations[i], &sub) != SUCCESS || sub != times[i];
+        mismatches += FP_diff(times[i], sum, &diff) != (d.seconds || d.ns ? ERR_OUT_OF_RANGE : SUCCESS);
+    }
+
+    // batches against the single value functions, in place
+    memcpy(result, times, sizeof(times));
+    mismatches += FP_sub_batch(result, CFG_ARITH_SIZE, durations[1], result, err) != 0;
+    mismatches += FP_diff_batch(times, result, CFG_ARITH_SIZE, back, err) != 0;
+    for (size_t i = 0; i < CFG_ARITH_SIZE; i += 5){
+        int64_t single;
+        mismatches += FP_sub(times[i], durations[1], &single) != SUCCESS || single != result[i];
+        mismatches += FP_diff(times[i], result[i], &single) != SUCCESS || single != back[i];
+    }
+
+    // ErrNo of every row against the single value functions, invalid values and
+    // durations on all lane positions and in the scalar tail
+    static const int64_t odd[] = {(int64_t)0xF1800000000000F7, (int64_t)0xB000000000000000, (int64_t)0x8000000000000000,
+                                  (int64_t)0xA00000000000002A, (int64_t)0xC000000000000001, (int64_t)0x7F4A000000000000};
+    const size_t n_rows = 1003;
+    for (size_t k = 0; k < sizeof(odd)/sizeof(odd[0]) + 2; k++){
+        int64_t dur = (k < sizeof(odd)/sizeof(odd[0])) ? odd[k] : durations[k];
+        for (size_t i = 0; i < n_rows; i++){
+            back[i] = (i % 7 < 3) ? odd[(i / 7 + k) % (sizeof(odd)/sizeof(odd[0]))] : times[i];
+        }
+        for (int op = 0; op < 2; op++){
+            size_t n_err = op ? FP_sub_batch(back, n_rows, dur, result, err) : FP_add_batch(back, n_rows, dur, result, err);
+            for (size_t i = 0; i < n_rows; i++){
+                int64_t single;
+                ErrNo e = op ? FP_sub(back[i], dur, &single) : FP_add(back[i], dur, &single);
+                mismatches += err[i] != e || result[i] != single;
+                n_err -= e != SUCCESS;
+            }
+            mismatches += n_err != 0;
+        }
+    }
+
+    // carry and borrow over the fraction, leap seconds, errors
+    int64_t t, d, out;
+    t = (int64_t)((uint64_t)1700000000 << 24 | 0xFFFFFE);                      // 23 bit, last fraction
+    d = (int64_t)((uint64_t)CP_REL_SEC << 60 | (uint64_t)1 << 24 | 0x000002);   // 1 s + one fraction
+    mismatches += FP_add(t, d, &out) != SUCCESS || out != (int64_t)((uint64_t)1700000002 << 24);
+    mismatches += FP_sub((int64_t)((uint64_t)1700000002 << 24), d, &out) != SUCCESS || out != t;
+    mismatches += FP_diff((int64_t)((uint64_t)1700000002 << 24), t, &out) != SUCCESS ||
+                  out != (int64_t)((uint64_t)CP_REL_SEC << 60 | (uint64_t)1 << 24 | 0x000002);
+    FP_Components leap = FP_new();
+    leap.seconds = 1483228799;   // 2016-12-31T23:59:60
+    leap.ns = 0;
+    leap.precision = PRC_MILLISEC;
+    leap.is_leapsecond = true;
+    FP_to_fp(&leap, &t);
+    d = (int64_t)((uint64_t)CP_REL_SEC << 60 | 0x400005 | (uint64_t)TZ_BIN_OFFSET << 3);   // 0.25 s
+    FP_Components fpc = FP_new();
+    mismatches += FP_add(t, d, &out) != SUCCESS || FP_from_fp(out, &fpc) != SUCCESS || !fpc.is_leapsecond;
+    mismatches += FP_add(out, (int64_t)((uint64_t)CP_REL_SEC << 60 | 0xC00005 | (uint64_t)TZ_BIN_OFFSET << 3), &out) != SUCCESS;
+    fpc = FP_new();
+    mismatches += FP_from_fp(out, &fpc) != SUCCESS || fpc.is_leapsecond || fpc.seconds != 1483228800 || fpc.ns != 0;
+
+    int64_t logical = (int64_t)((uint64_t)CP_LOGICAL << 60 | 42);
+    int64_t rel_max = (int64_t)((uint64_t)CP_REL_SEC << 60 | (uint64_t)0x0FFFFFFFFF << 24 | 0x800007);
+    mismatches += FP_add(times[0], times[1], &out) != ERR_INCOMPATIBLE_OUTPUT || out != CP_UNDEFINED_FP;
+    mismatches += FP_sub(durations[0], times[1], &out) != ERR_INCOMPATIBLE_OUTPUT;
+    mismatches += FP_diff(times[0], durations[0], &out) != ERR_INCOMPATIBLE_OUTPUT;
+    mismatches += FP_add(logical, durations[0], &out) != ERR_INCOMPATIBLE_OUTPUT;
+    mismatches += FP_add(rel_max, rel_max, &out) != ERR_OUT_OF_RANGE;
+    mismatches += FP_sub(durations[2], rel_max, &out) != ERR_OUT_OF_RANGE;
+    mismatches += FP_add((int64_t)((uint64_t)0x7E << 56 | 0x800007), rel_max, &out) != ERR_OUT_OF_RANGE;
+    mismatches += FP_add(times[0], (int64_t)((uint64_t)CP_REL_SEC << 60 | 0xFF), &out) != ERR_INVALID_PRECISION;
+    mismatches += FP_add_batch(times, 4, logical, result, err) != 4 || err[3] != ERR_INCOMPATIBLE_OUTPUT ||
+                  result[3] != CP_UNDEFINED_FP;
+
+    // shift by one hour (23 bit, so that the precision is kept) against decode + add + encode
+    d = (int64_t)((uint64_t)CP_REL_SEC << 60 | (uint64_t)3600 << 24);
+    for (size_t i = 0; i < CFG_ARITH_SIZE; i++){
+        FP_Components c = FP_new();
+        FP_from_fp(times[i], &c);
+        c.seconds += 3600;
+        FP_to_fp(&c, &back[i]);
+    }
+    mismatches += FP_add_batch(times, CFG_ARITH_SIZE, d, result, NULL) != 0;
+    for (size_t i = 0; i < CFG_ARITH_SIZE; i++){
+        FP_Components c = FP_new();
+        FP_from_fp(times[i], &c);
+        mismatches += !c.is_leapsecond && result[i] != back[i];
     }
+    printf("Arithmetic: %zu mismatches\n", mismatches);
+    return mismatches;
 }
 
 int main(int argc, char *argv[]) {
-    // run_tests();
-    test_performance();
-    return 0;
+    size_t mismatches = test_values();
+    mismatches += test_batch_decode();
+    mismatches += test_validate();
+    mismatches += test_batch_encode();
+    mismatches += test_batch_iso();
+    mismatches += test_iso_cache();
+    mismatches += test_batch_to_iso();
+    mismatches += test_column();
+    mismatches += test_direct();
+    mismatches += test_sort();
+    mismatches += test_search();
+    mismatches += test_segment();
+    mismatches += test_codec();
+    mismatches += test_wire();
+    mismatches += test_calendar();
+    mismatches += test_arith();
+    mismatches += test_bulk();
+    mismatches += test_transcode();
+    mismatches += test_serve();
+    mismatches += test_pool();
+    mismatches += test_agg();
+    printf("\n\nTotal: %zu mismatches\n", mismatches);
+    return mismatches != 0;
 }
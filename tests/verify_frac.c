@@ -0,0 +1,109 @@
+#include <stdio.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "flexpoch.h"
+#include "fp_internal.h"
+
+// Exhaustive check of the division free fraction conversions against the
+// original division based code: frac2ns() for all 2^23 fraction codes,
+// ns2frac() for every ns in [0, 1e9) and FP_ns_to_precision() for all
+// precisions on a ns grid, edge values and random 64 bit inputs.
+
+#define CFG_RANDOM 10000000
+
+static uint32_t ref_ns2frac(uint32_t nanoseconds){
+    return (uint32_t)(((uint64_t)nanoseconds * 1000000000 + 59604644775) / 119209289551);
+}
+
+static uint32_t ref_frac2ns(uint64_t binary){
+    return (uint32_t)(((binary >> 1) * 119209289551 + 500000000) / 1000000000);
+}
+
+static uint64_t ref_ns_to_precision(uint64_t ns, Precision prc){
+    uint64_t frac = ((uint64_t)(ns) * 1000000000 + 59604644775) / 119209289551;
+    switch (prc) {
+        case PRC_NANOSEC:  return ns;
+        case PRC_MICROSEC: return ns / 1000;
+        case PRC_MILLISEC: return ns / 1000000;
+        case PRC_SECOND:   return ns / NS_PER_SEC;
+        case PRC_MINUTE:   return ns / NS_PER_SEC / 60;
+        case PRC_HOUR:     return ns / NS_PER_SEC / 60 / 60;
+        case PRC_DAY:      return ns / NS_PER_SEC / 60 / 60 / 24;
+        case PRC_WEEK:     return ns / NS_PER_SEC / 60 / 60 / 24 / 7;
+        case PRC_MONTH:    return ns / NS_PER_SEC / 60 / 60 / 24 / 30;
+        case PRC_QUATER:   return ns / NS_PER_SEC / 60 / 60 / 24;
+        case PRC_YEAR:     return ns / NS_PER_SEC / 60 / 60 / 24 * 100 / 36525;
+        case PRC_23BIT:    return frac;
+        case PRC_15BIT:    return frac >> 8;
+        default: return -1;
+    }
+}
+
+static const Precision precisions[] = {
+    PRC_NANOSEC, PRC_23BIT, PRC_MICROSEC, PRC_15BIT, PRC_MILLISEC, PRC_SECOND, PRC_MINUTE,
+    PRC_HOUR, PRC_DAY, PRC_WEEK, PRC_MONTH, PRC_QUATER, PRC_YEAR, PRC_DECADE,
+};
+#define N_PRECISIONS (sizeof(precisions) / sizeof(precisions[0]))
+
+static size_t check_precisions(uint64_t ns){
+    size_t mismatches = 0;
+    for (size_t p = 0; p < N_PRECISIONS; p++){
+        if (FP_ns_to_precision(ns, precisions[p]) != ref_ns_to_precision(ns, precisions[p])){
+            if (mismatches == 0){ printf("  ns=%llu prc=%d\n", (unsigned long long)ns, precisions[p]); }
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+int main(){
+    size_t mismatches, total = 0;
+
+    mismatches = 0;
+    for (uint64_t code = 0; code < (1 << 23); code++){
+        mismatches += frac2ns(code << 1) != ref_frac2ns(code << 1);
+    }
+    printf("frac2ns, 2^23 fraction codes:  %zu mismatches\n", mismatches);
+    total += mismatches;
+
+    mismatches = 0;
+    for (uint32_t ns = 0; ns < NS_PER_SEC; ns++){
+        mismatches += ns2frac(ns) != ref_ns2frac(ns);
+    }
+    printf("ns2frac, ns in [0, 1e9):       %zu mismatches\n", mismatches);
+    total += mismatches;
+
+    // every fraction code survives the round trip
+    mismatches = 0;
+    for (uint32_t code = 0; code < (1 << 23); code++){
+        mismatches += ns2frac(frac2ns((uint64_t)code << 1)) != code;
+    }
+    printf("ns2frac(frac2ns(code)) = code: %zu mismatches\n", mismatches);
+    total += mismatches;
+
+    mismatches = 0;
+    for (uint64_t ns = 0; ns < NS_PER_SEC; ns += 997){
+        mismatches += check_precisions(ns);
+    }
+    const uint64_t edges[] = {
+        NS_PER_SEC - 1, NS_PER_SEC, 59999999999, 60000000000, 86399999999999, 86400000000000,
+        (uint64_t)INT64_MAX, (uint64_t)INT64_MAX + 1, UINT64_MAX - 1, UINT64_MAX,
+    };
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++){
+        mismatches += check_precisions(edges[i]);
+    }
+    uint64_t state = 0x243F6A8885A308D3;
+    for (int i = 0; i < CFG_RANDOM; i++){
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        mismatches += check_precisions(state >> (i % 64));   // all magnitudes
+    }
+    printf("FP_ns_to_precision:            %zu mismatches\n", mismatches);
+    total += mismatches;
+
+    printf("Fraction conversions: %zu mismatches\n", total);
+    return total != 0;
+}